@@ -0,0 +1,100 @@
+/*
+ * Copyright 2021-2022 Brennan Shacklett and contributors
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+#pragma once
+
+#include <madrona/types.hpp>
+#include <madrona/span.hpp>
+#include <madrona/optional.hpp>
+#include <madrona/io.hpp>
+
+#include <type_traits>
+
+namespace madrona {
+
+// Hashes the source data an asset was built from. Cache files are keyed on
+// the resulting value, so any change to the inputs (or to the build
+// parameters folded in by the caller) invalidates the cached copy.
+class AssetHasher {
+public:
+    AssetHasher(uint64_t seed = 0);
+
+    void addBytes(const void *data, size_t num_bytes);
+
+    template <typename T>
+    inline void add(const T &v);
+
+    template <typename T>
+    inline void addArray(const T *data, CountT num_elems);
+
+    uint64_t finish() const;
+
+private:
+    uint64_t state_;
+    uint64_t numBytes_;
+};
+
+// Read-only view of an asset cache file. The payload is mapped directly
+// from disk, so the pages are shared between every process loading the
+// same cache. Mappings are private: the few pointer fixups a loader does
+// copy only the pages they touch and never reach the file.
+class MappedAssetCache {
+public:
+    // Returns none if the file doesn't exist, is truncated, or was written
+    // by a different format version / cache kind / source hash.
+    static Optional<MappedAssetCache> map(const char *path,
+                                          uint32_t cache_kind,
+                                          uint64_t source_hash);
+
+    inline char * data() const { return payload_; }
+    inline size_t numBytes() const { return numPayloadBytes_; }
+
+private:
+    inline MappedAssetCache(MappedFile &&file, char *payload,
+                            size_t num_payload_bytes)
+        : file_(std::move(file)),
+          payload_(payload),
+          numPayloadBytes_(num_payload_bytes)
+    {}
+
+    MappedFile file_;
+    char *payload_;
+    size_t numPayloadBytes_;
+};
+
+// Writes payload to path behind a versioned header. The file is written
+// under a temporary name and renamed into place, so processes starting
+// concurrently never observe a partially written cache.
+bool writeAssetCache(const char *path,
+                     uint32_t cache_kind,
+                     uint64_t source_hash,
+                     const void *payload,
+                     size_t num_payload_bytes);
+
+// Payload offset alignment guaranteed by writeAssetCache, loaders can lay
+// out arrays inside the payload assuming this alignment.
+inline constexpr size_t assetCachePayloadAlignment = 64;
+
+template <typename T>
+void AssetHasher::add(const T &v)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    addBytes(&v, sizeof(T));
+}
+
+template <typename T>
+void AssetHasher::addArray(const T *data, CountT num_elems)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    add(num_elems);
+    if (data != nullptr) {
+        addBytes(data, sizeof(T) * num_elems);
+    }
+}
+
+}
@@ -2,6 +2,25 @@
 
 #include <madrona/math.hpp>
 #include <madrona/context.hpp>
+#include <madrona/crash.hpp>
+
+// Child bounds of a node are tested 4 at a time with SSE / NEON on the
+// CPU (8 at a time, two nodes per test, with AVX2). The GPU uses the
+// scalar fallback.
+#if !defined(MADRONA_GPU_MODE) && defined(MADRONA_X64)
+#define MADRONA_BVH_SSE (1)
+#include <immintrin.h>
+#if defined(__AVX2__)
+#define MADRONA_BVH_AVX2 (1)
+#endif
+#elif !defined(MADRONA_GPU_MODE) && defined(MADRONA_ARM)
+#define MADRONA_BVH_NEON (1)
+#include <arm_neon.h>
+#endif
+
+#ifndef MADRONA_GPU_MODE
+#include <madrona/simd_math.hpp>
+#endif
 
 namespace madrona::phys {
 
@@ -20,7 +39,11 @@ public:
     BVH(const ObjectManager *obj_mgr,
         CountT max_leaves,
         float leaf_velocity_expansion,
-        float leaf_accel_expansion);
+        float leaf_accel_expansion,
+        float rebuild_cost_ratio = 1.5f);
+
+    // Frees the buffers allocated by the constructor
+    void destroy();
 
     inline LeafID reserveLeaf(Entity e, base::ObjectID obj_id);
     inline math::AABB getLeafAABB(LeafID leaf_id) const;
@@ -44,19 +67,45 @@ public:
                             const math::Vector3 &linear_vel,
                             const math::AABB &obj_aabb);
 
+#ifndef MADRONA_GPU_MODE
+    // updateLeafPosition for FloatN::width leaves at once, lane i
+    // updates leaf_ids[i] if bit i of update_lanes is set. Other lanes
+    // (and their leaf_ids entries) are ignored.
+    void updateLeafPositions(const LeafID *leaf_ids,
+                             const math::Vector3N &pos,
+                             const math::QuatN &rot,
+                             const math::Vector3N &scale,
+                             const math::Vector3N &linear_vel,
+                             const math::AABBN &obj_aabbs,
+                             uint32_t update_lanes);
+#endif
+
+    // True if the leaf was last updated with exactly this transform
+    inline bool leafTransformMatches(LeafID leaf_id,
+                                     const math::Vector3 &pos,
+                                     const math::Quat &rot,
+                                     const math::Diag3x3 &scale) const;
+
     math::AABB expandLeaf(LeafID leaf_id,
                           const math::Vector3 &linear_vel);
 
     void refitLeaf(LeafID leaf_id, const math::AABB &leaf_aabb);
 
     inline void rebuildOnUpdate();
+
+    // Rebuilds the tree if requested with rebuildOnUpdate() or if refitting
+    // has pushed sahCost() past rebuild_cost_ratio times its cost when
+    // last built.
     void updateTree();
 
-    inline void clearLeaves();
+    // Surface area heuristic cost of the tree, normalized by the area of
+    // the root bounds. Lower is better.
+    float sahCost() const;
 
-private:
-    static constexpr int32_t sentinel_ = 0xFFFF'FFFF_i32;
+    inline void clearLeaves();
 
+    // 4 wide internal node. Public so tests can check its child tests
+    // against the scalar AABB ones.
     struct Node {
         float minX[4];
         float minY[4];
@@ -74,8 +123,53 @@ private:
         inline void setInternal(CountT child, int32_t internal_idx);
         inline bool hasChild(CountT child) const;
         inline void clearChild(CountT child);
+
+        // Bit i is set if child i exists
+        inline uint32_t childMask() const;
+
+        // Bit i is set if child i exists and its bounds overlap aabb
+        // (same test as AABB::overlaps)
+        inline uint32_t overlapMask(const math::AABB &aabb) const;
+
+        // Bit i is set if child i exists and the ray hits its bounds in
+        // [t_min, t_max] (same test as AABB::rayIntersects)
+        inline uint32_t rayIntersectMask(math::Vector3 ray_o,
+                                         math::Diag3x3 inv_ray_d,
+                                         float t_min,
+                                         float t_max) const;
+
+#ifdef MADRONA_BVH_AVX2
+        // Tests the children of a and b at once. Bits 0-3 are a's
+        // children, bits 4-7 are b's.
+        static inline uint32_t overlapMask2(const Node &a, const Node &b,
+                                            const math::AABB &aabb);
+        static inline uint32_t rayIntersectMask2(const Node &a,
+                                                 const Node &b,
+                                                 math::Vector3 ray_o,
+                                                 math::Diag3x3 inv_ray_d,
+                                                 float t_min,
+                                                 float t_max);
+#endif
     };
 
+private:
+    static constexpr int32_t sentinel_ = 0xFFFF'FFFF_i32;
+    static constexpr int32_t numSAHBins_ = 16;
+
+    // rebuild() uses SAH splits for the top maxSAHDepth_ levels and median
+    // splits below, which quarter the leaves per level. Even 2^31 leaves
+    // then fit in maxTreeDepth_ levels of internal nodes.
+    static constexpr int32_t maxSAHDepth_ = 16;
+    static constexpr int32_t maxTreeDepth_ = maxSAHDepth_ + 16;
+
+    // Traversal stack for findIntersecting / traceRay. Popping one node
+    // pushes at most 4 children (+3), popping two with AVX2 pushes at most
+    // 8 (+6), so the paired pop is only taken when that still fits. A tree
+    // of maxTreeDepth_ levels needs at most 3 * maxTreeDepth_ + 1 entries.
+    // Overflowing it is fatal, also in release builds.
+    static constexpr CountT traversalStackSize_ = 128;
+    static_assert(3 * maxTreeDepth_ + 1 <= traversalStackSize_);
+
     // FIXME: evaluate whether storing this in-line in the tree
     // makes sense or if we should force a lookup through the entity ID
     struct LeafTransform {
@@ -86,6 +180,11 @@ private:
 
     inline CountT numInternalNodes(CountT num_leaves) const;
 
+    // Run fn(node, i) for each child i of node set in mask, in order
+    template <typename Fn>
+    static inline void forEachChild(const Node &node, uint32_t mask,
+                                    Fn &&fn);
+
     void rebuild();
     void refit(LeafID *leaf_ids, CountT num_moved);
 
@@ -111,6 +210,8 @@ private:
     int32_t num_allocated_leaves_;
     float leaf_velocity_expansion_;
     float leaf_accel_expansion_;
+    float rebuild_cost_ratio_;
+    float built_sah_cost_;
     bool force_rebuild_;
 };
 
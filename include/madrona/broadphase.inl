@@ -18,43 +18,58 @@ math::AABB BVH::getLeafAABB(LeafID leaf_id) const
     return leaf_aabbs_[leaf_id.id];
 }
 
+bool BVH::leafTransformMatches(LeafID leaf_id,
+                               const math::Vector3 &pos,
+                               const math::Quat &rot,
+                               const math::Diag3x3 &scale) const
+{
+    const LeafTransform &txfm = leaf_transforms_[leaf_id.id];
+
+    return txfm.pos.x == pos.x && txfm.pos.y == pos.y &&
+        txfm.pos.z == pos.z &&
+        txfm.rot.w == rot.w && txfm.rot.x == rot.x &&
+        txfm.rot.y == rot.y && txfm.rot.z == rot.z &&
+        txfm.scale.d0 == scale.d0 && txfm.scale.d1 == scale.d1 &&
+        txfm.scale.d2 == scale.d2;
+}
+
 template <typename Fn>
 void BVH::findIntersecting(const math::AABB &aabb, Fn &&fn) const
 {
-    int32_t stack[32];
+    int32_t stack[traversalStackSize_];
     stack[0] = 0;
     CountT stack_size = 1;
 
+    auto visitChild = [&](const Node &node, int32_t i) {
+        if (node.isLeaf(i)) {
+            Entity e = leaf_entities_[node.leafIDX(i)];
+            fn(e);
+        } else {
+            if (stack_size == traversalStackSize_) [[unlikely]] {
+                FATAL("BVH::findIntersecting: traversal stack overflow");
+            }
+            stack[stack_size++] = node.children[i];
+        }
+    };
+
     while (stack_size > 0) {
+#ifdef MADRONA_BVH_AVX2
+        if (stack_size >= 2 && stack_size + 6 <= traversalStackSize_) {
+            const Node &a = nodes_[stack[--stack_size]];
+            const Node &b = nodes_[stack[--stack_size]];
+
+            uint32_t mask = Node::overlapMask2(a, b, aabb);
+            forEachChild(a, mask & 0xF, visitChild);
+            forEachChild(b, mask >> 4, visitChild);
+
+            continue;
+        }
+#endif
+
         int32_t node_idx = stack[--stack_size];
         const Node &node = nodes_[node_idx];
-        for (int i = 0; i < 4; i++) {
-            if (!node.hasChild(i)) {
-                continue; // Technically this could be break?
-            };
-
-            madrona::math::AABB child_aabb {
-                /* .pMin = */ {
-                    node.minX[i],
-                    node.minY[i],
-                    node.minZ[i],
-                },
-                /* .pMax = */ {
-                    node.maxX[i],
-                    node.maxY[i],
-                    node.maxZ[i],
-                },
-            };
-
-            if (aabb.overlaps(child_aabb)) {
-                if (node.isLeaf(i)) {
-                    Entity e = leaf_entities_[node.leafIDX(i)];
-                    fn(e);
-                } else {
-                    stack[stack_size++] = node.children[i];
-                }
-            }
-        }
+
+        forEachChild(node, node.overlapMask(aabb), visitChild);
     }
 }
 
@@ -105,4 +120,303 @@ void BVH::Node::clearChild(CountT child)
     children[child] = sentinel_;
 }
 
+template <typename Fn>
+void BVH::forEachChild(const Node &node, uint32_t mask, Fn &&fn)
+{
+    for (int32_t i = 0; i < 4; i++) {
+        if ((mask & (1_u32 << i)) != 0) {
+            fn(node, i);
+        }
+    }
+}
+
+#if defined(MADRONA_BVH_SSE)
+
+uint32_t BVH::Node::childMask() const
+{
+    __m128i sentinel = _mm_set1_epi32(sentinel_);
+    __m128i child_idxs = _mm_loadu_si128((const __m128i *)children);
+    __m128i is_empty = _mm_cmpeq_epi32(child_idxs, sentinel);
+
+    return ~uint32_t(_mm_movemask_ps(_mm_castsi128_ps(is_empty))) & 0xF;
+}
+
+uint32_t BVH::Node::overlapMask(const math::AABB &aabb) const
+{
+    __m128 x_overlap = _mm_and_ps(
+        _mm_cmplt_ps(_mm_loadu_ps(minX), _mm_set1_ps(aabb.pMax.x)),
+        _mm_cmplt_ps(_mm_set1_ps(aabb.pMin.x), _mm_loadu_ps(maxX)));
+    __m128 y_overlap = _mm_and_ps(
+        _mm_cmplt_ps(_mm_loadu_ps(minY), _mm_set1_ps(aabb.pMax.y)),
+        _mm_cmplt_ps(_mm_set1_ps(aabb.pMin.y), _mm_loadu_ps(maxY)));
+    __m128 z_overlap = _mm_and_ps(
+        _mm_cmplt_ps(_mm_loadu_ps(minZ), _mm_set1_ps(aabb.pMax.z)),
+        _mm_cmplt_ps(_mm_set1_ps(aabb.pMin.z), _mm_loadu_ps(maxZ)));
+
+    __m128 overlap = _mm_and_ps(_mm_and_ps(x_overlap, y_overlap), z_overlap);
+
+    return uint32_t(_mm_movemask_ps(overlap)) & childMask();
+}
+
+uint32_t BVH::Node::rayIntersectMask(math::Vector3 ray_o,
+                                     math::Diag3x3 inv_ray_d,
+                                     float t_min,
+                                     float t_max) const
+{
+    // Same slab test as AABB::rayIntersects. t_lower or t_upper is NaN
+    // (0 * inf) when the ray is parallel to a slab and starts on one of
+    // its planes. fminf / fmaxf return the other operand then, while
+    // _mm_min_ps / _mm_max_ps return their second operand if either is
+    // NaN, so the per slab min / max pick t_lower explicitly when t_upper
+    // is NaN. The running interval goes second to ignore NaNs the same way.
+    __m128 box_t_min = _mm_set1_ps(t_min);
+    __m128 box_t_max = _mm_set1_ps(t_max);
+
+    auto slab = [&](const float *mins, const float *maxs, float o,
+                    float inv_d) {
+        __m128 o_v = _mm_set1_ps(o);
+        __m128 inv_d_v = _mm_set1_ps(inv_d);
+
+        __m128 t_lower = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(mins), o_v),
+                                    inv_d_v);
+        __m128 t_upper = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(maxs), o_v),
+                                    inv_d_v);
+
+        __m128 upper_nan = _mm_cmpunord_ps(t_upper, t_upper);
+        __m128 slab_min = _mm_or_ps(_mm_and_ps(upper_nan, t_lower),
+            _mm_andnot_ps(upper_nan, _mm_min_ps(t_lower, t_upper)));
+        __m128 slab_max = _mm_or_ps(_mm_and_ps(upper_nan, t_lower),
+            _mm_andnot_ps(upper_nan, _mm_max_ps(t_lower, t_upper)));
+
+        box_t_min = _mm_max_ps(slab_min, box_t_min);
+        box_t_max = _mm_min_ps(slab_max, box_t_max);
+    };
+
+    slab(minX, maxX, ray_o.x, inv_ray_d.d0);
+    slab(minY, maxY, ray_o.y, inv_ray_d.d1);
+    slab(minZ, maxZ, ray_o.z, inv_ray_d.d2);
+
+    return uint32_t(_mm_movemask_ps(_mm_cmple_ps(box_t_min, box_t_max))) &
+        childMask();
+}
+
+#ifdef MADRONA_BVH_AVX2
+
+uint32_t BVH::Node::overlapMask2(const Node &a, const Node &b,
+                                 const math::AABB &aabb)
+{
+    auto load2 = [](const float *lo, const float *hi) {
+        return _mm256_set_m128(_mm_loadu_ps(hi), _mm_loadu_ps(lo));
+    };
+
+    __m256 x_overlap = _mm256_and_ps(
+        _mm256_cmp_ps(load2(a.minX, b.minX), _mm256_set1_ps(aabb.pMax.x),
+                      _CMP_LT_OQ),
+        _mm256_cmp_ps(_mm256_set1_ps(aabb.pMin.x), load2(a.maxX, b.maxX),
+                      _CMP_LT_OQ));
+    __m256 y_overlap = _mm256_and_ps(
+        _mm256_cmp_ps(load2(a.minY, b.minY), _mm256_set1_ps(aabb.pMax.y),
+                      _CMP_LT_OQ),
+        _mm256_cmp_ps(_mm256_set1_ps(aabb.pMin.y), load2(a.maxY, b.maxY),
+                      _CMP_LT_OQ));
+    __m256 z_overlap = _mm256_and_ps(
+        _mm256_cmp_ps(load2(a.minZ, b.minZ), _mm256_set1_ps(aabb.pMax.z),
+                      _CMP_LT_OQ),
+        _mm256_cmp_ps(_mm256_set1_ps(aabb.pMin.z), load2(a.maxZ, b.maxZ),
+                      _CMP_LT_OQ));
+
+    __m256 overlap = _mm256_and_ps(_mm256_and_ps(x_overlap, y_overlap),
+                                   z_overlap);
+
+    return uint32_t(_mm256_movemask_ps(overlap)) &
+        (a.childMask() | (b.childMask() << 4));
+}
+
+uint32_t BVH::Node::rayIntersectMask2(const Node &a, const Node &b,
+                                      math::Vector3 ray_o,
+                                      math::Diag3x3 inv_ray_d,
+                                      float t_min,
+                                      float t_max)
+{
+    auto load2 = [](const float *lo, const float *hi) {
+        return _mm256_set_m128(_mm_loadu_ps(hi), _mm_loadu_ps(lo));
+    };
+
+    __m256 box_t_min = _mm256_set1_ps(t_min);
+    __m256 box_t_max = _mm256_set1_ps(t_max);
+
+    auto slab = [&](__m256 mins, __m256 maxs, float o, float inv_d) {
+        __m256 o_v = _mm256_set1_ps(o);
+        __m256 inv_d_v = _mm256_set1_ps(inv_d);
+
+        __m256 t_lower = _mm256_mul_ps(_mm256_sub_ps(mins, o_v), inv_d_v);
+        __m256 t_upper = _mm256_mul_ps(_mm256_sub_ps(maxs, o_v), inv_d_v);
+
+        // NaN handling matches rayIntersectMask
+        __m256 upper_nan = _mm256_cmp_ps(t_upper, t_upper, _CMP_UNORD_Q);
+        __m256 slab_min = _mm256_blendv_ps(
+            _mm256_min_ps(t_lower, t_upper), t_lower, upper_nan);
+        __m256 slab_max = _mm256_blendv_ps(
+            _mm256_max_ps(t_lower, t_upper), t_lower, upper_nan);
+
+        box_t_min = _mm256_max_ps(slab_min, box_t_min);
+        box_t_max = _mm256_min_ps(slab_max, box_t_max);
+    };
+
+    slab(load2(a.minX, b.minX), load2(a.maxX, b.maxX),
+         ray_o.x, inv_ray_d.d0);
+    slab(load2(a.minY, b.minY), load2(a.maxY, b.maxY),
+         ray_o.y, inv_ray_d.d1);
+    slab(load2(a.minZ, b.minZ), load2(a.maxZ, b.maxZ),
+         ray_o.z, inv_ray_d.d2);
+
+    __m256 hit = _mm256_cmp_ps(box_t_min, box_t_max, _CMP_LE_OQ);
+
+    return uint32_t(_mm256_movemask_ps(hit)) &
+        (a.childMask() | (b.childMask() << 4));
+}
+
+#endif
+
+#elif defined(MADRONA_BVH_NEON)
+
+uint32_t BVH::Node::childMask() const
+{
+    uint32x4_t is_child = vmvnq_u32(vceqq_s32(vld1q_s32(children),
+                                              vdupq_n_s32(sentinel_)));
+
+    const uint32_t lane_bits_arr[4] = { 1, 2, 4, 8 };
+    return vaddvq_u32(vandq_u32(is_child, vld1q_u32(lane_bits_arr)));
+}
+
+uint32_t BVH::Node::overlapMask(const math::AABB &aabb) const
+{
+    uint32x4_t x_overlap = vandq_u32(
+        vcltq_f32(vld1q_f32(minX), vdupq_n_f32(aabb.pMax.x)),
+        vcltq_f32(vdupq_n_f32(aabb.pMin.x), vld1q_f32(maxX)));
+    uint32x4_t y_overlap = vandq_u32(
+        vcltq_f32(vld1q_f32(minY), vdupq_n_f32(aabb.pMax.y)),
+        vcltq_f32(vdupq_n_f32(aabb.pMin.y), vld1q_f32(maxY)));
+    uint32x4_t z_overlap = vandq_u32(
+        vcltq_f32(vld1q_f32(minZ), vdupq_n_f32(aabb.pMax.z)),
+        vcltq_f32(vdupq_n_f32(aabb.pMin.z), vld1q_f32(maxZ)));
+
+    uint32x4_t overlap =
+        vandq_u32(vandq_u32(x_overlap, y_overlap), z_overlap);
+
+    const uint32_t lane_bits_arr[4] = { 1, 2, 4, 8 };
+    return vaddvq_u32(vandq_u32(overlap, vld1q_u32(lane_bits_arr))) &
+        childMask();
+}
+
+uint32_t BVH::Node::rayIntersectMask(math::Vector3 ray_o,
+                                     math::Diag3x3 inv_ray_d,
+                                     float t_min,
+                                     float t_max) const
+{
+    // vminnmq / vmaxnmq ignore NaN operands, matching fminf / fmaxf in
+    // AABB::rayIntersects
+    float32x4_t box_t_min = vdupq_n_f32(t_min);
+    float32x4_t box_t_max = vdupq_n_f32(t_max);
+
+    auto slab = [&](const float *mins, const float *maxs, float o,
+                    float inv_d) {
+        float32x4_t o_v = vdupq_n_f32(o);
+        float32x4_t inv_d_v = vdupq_n_f32(inv_d);
+
+        float32x4_t t_lower = vmulq_f32(vsubq_f32(vld1q_f32(mins), o_v),
+                                        inv_d_v);
+        float32x4_t t_upper = vmulq_f32(vsubq_f32(vld1q_f32(maxs), o_v),
+                                        inv_d_v);
+
+        box_t_min = vmaxnmq_f32(vminnmq_f32(t_lower, t_upper), box_t_min);
+        box_t_max = vminnmq_f32(vmaxnmq_f32(t_lower, t_upper), box_t_max);
+    };
+
+    slab(minX, maxX, ray_o.x, inv_ray_d.d0);
+    slab(minY, maxY, ray_o.y, inv_ray_d.d1);
+    slab(minZ, maxZ, ray_o.z, inv_ray_d.d2);
+
+    const uint32_t lane_bits_arr[4] = { 1, 2, 4, 8 };
+    return vaddvq_u32(vandq_u32(vcleq_f32(box_t_min, box_t_max),
+                                vld1q_u32(lane_bits_arr))) & childMask();
+}
+
+#else
+
+uint32_t BVH::Node::childMask() const
+{
+    uint32_t mask = 0;
+    for (CountT i = 0; i < 4; i++) {
+        if (hasChild(i)) {
+            mask |= 1_u32 << i;
+        }
+    }
+
+    return mask;
+}
+
+uint32_t BVH::Node::overlapMask(const math::AABB &aabb) const
+{
+    uint32_t mask = 0;
+    for (CountT i = 0; i < 4; i++) {
+        if (!hasChild(i)) {
+            continue;
+        }
+
+        math::AABB child_aabb {
+            /* .pMin = */ {
+                minX[i],
+                minY[i],
+                minZ[i],
+            },
+            /* .pMax = */ {
+                maxX[i],
+                maxY[i],
+                maxZ[i],
+            },
+        };
+
+        if (aabb.overlaps(child_aabb)) {
+            mask |= 1_u32 << i;
+        }
+    }
+
+    return mask;
+}
+
+uint32_t BVH::Node::rayIntersectMask(math::Vector3 ray_o,
+                                     math::Diag3x3 inv_ray_d,
+                                     float t_min,
+                                     float t_max) const
+{
+    uint32_t mask = 0;
+    for (CountT i = 0; i < 4; i++) {
+        if (!hasChild(i)) {
+            continue;
+        }
+
+        math::AABB child_aabb {
+            /* .pMin = */ {
+                minX[i],
+                minY[i],
+                minZ[i],
+            },
+            /* .pMax = */ {
+                maxX[i],
+                maxY[i],
+                maxZ[i],
+            },
+        };
+
+        if (child_aabb.rayIntersects(ray_o, inv_ray_d, t_min, t_max)) {
+            mask |= 1_u32 << i;
+        }
+    }
+
+    return mask;
+}
+
+#endif
+
 }
@@ -17,6 +17,12 @@ namespace madrona {
 enum class ArchetypeFlags : uint32_t {
     None = 0,
     ImportOffsets = 1_u32 << 0,
+    // CPU backend, archetypes without a max number of entities per world:
+    // every world's rows of a column live in one shared reservation at a
+    // stride of StateManager::zeroCopyMaxRowsPerWorld rows, so exported
+    // columns point directly at the ECS data rather than at a copy. Use
+    // ECSRegistry::exportRowRanges to find each world's rows.
+    ZeroCopyExport = 1_u32 << 1,
 };
 
 enum class ComponentFlags : uint32_t {
@@ -25,6 +31,21 @@ enum class ComponentFlags : uint32_t {
     ImportMemory = 1_u32 << 1,
 };
 
+// Direction(s) an exported column is copied in on the CPU backend, from
+// the point of view of the code using the exported pointer. Only applies
+// to archetypes without a max number of entities per world, other columns
+// are exported in place.
+enum class ExportFlags : uint32_t {
+    None = 0,
+    // Only read outside the ECS (observations etc): copied out after
+    // each step.
+    ReadOnly = 1_u32 << 0,
+    // Only written outside the ECS (actions etc): copied in before
+    // each step.
+    WriteOnly = 1_u32 << 1,
+    ReadWrite = ReadOnly | WriteOnly,
+};
+
 template <typename... ComponentTs>
 struct ComponentMetadataSelector {
     std::array<ComponentFlags, sizeof...(ComponentTs)> flags;
@@ -45,6 +66,11 @@ inline ComponentFlags operator|(ComponentFlags a, ComponentFlags b);
 inline ComponentFlags & operator&=(ComponentFlags &a, ComponentFlags b);
 inline ComponentFlags operator&(ComponentFlags a, ComponentFlags b);
 
+inline ExportFlags & operator|=(ExportFlags &a, ExportFlags b);
+inline ExportFlags operator|(ExportFlags a, ExportFlags b);
+inline ExportFlags & operator&=(ExportFlags &a, ExportFlags b);
+inline ExportFlags operator&(ExportFlags a, ExportFlags b);
+
 }
 
 #include "ecs_flags.inl"
@@ -66,4 +66,30 @@ inline ComponentFlags operator&(ComponentFlags a, ComponentFlags b)
     return a;
 }
 
+inline ExportFlags & operator|=(ExportFlags &a, ExportFlags b)
+{
+    a = ExportFlags(static_cast<uint32_t>(a) | static_cast<uint32_t>(b));
+    return a;
+}
+
+inline ExportFlags operator|(ExportFlags a, ExportFlags b)
+{
+    a |= b;
+
+    return a;
+}
+
+inline ExportFlags & operator&=(ExportFlags &a, ExportFlags b)
+{
+    a = ExportFlags(static_cast<uint32_t>(a) & static_cast<uint32_t>(b));
+    return a;
+}
+
+inline ExportFlags operator&(ExportFlags a, ExportFlags b)
+{
+    a &= b;
+
+    return a;
+}
+
 }
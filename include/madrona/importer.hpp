@@ -2,6 +2,7 @@
 
 #include <string>
 #include <madrona/dyn_array.hpp>
+#include <madrona/io.hpp>
 #include <madrona/math.hpp>
 #include <madrona/span.hpp>
 #include <madrona/optional.hpp>
@@ -80,8 +81,11 @@ public:
 
     Optional<SourceTexture> importImage(const char *path);
 
+    // num_threads == 0 decodes on every hardware thread. The handlers
+    // registered with addHandler must be thread safe when num_threads != 1.
     Span<SourceTexture> importImages(
-        StackAlloc &tmp_alloc, Span<const char * const> paths);
+        StackAlloc &tmp_alloc, Span<const char * const> paths,
+        CountT num_threads = 1);
 
     void deallocImportedImages(Span<SourceTexture> textures);
     
@@ -102,6 +106,10 @@ struct ImportedAssets {
         DynArray<DynArray<uint32_t>> faceCountArrays;
 
         DynArray<DynArray<SourceMesh>> meshArrays;
+
+        // Files that meshes point into directly instead of into the arrays
+        // above, see alias_glb_buffers
+        DynArray<MappedFile> mappedFiles;
     } geoData;
 
     DynArray<SourceObject> objects;
@@ -120,10 +128,22 @@ public:
 
     ImageImporter & imageImporter();
 
+    // With num_threads != 1 every asset is imported on its own thread
+    // (num_threads == 0 uses every hardware thread) and the results are
+    // merged in asset_paths order, so the output is identical to a serial
+    // import. A single large OBJ file is instead parsed in parallel chunks.
+    //
+    // With alias_glb_buffers, GLB files are kept mapped and mesh attributes
+    // that are already tightly packed float32 / uint32 data point straight
+    // into the mapping rather than being copied. The mapping is copy on
+    // write and is owned by the returned ImportedAssets, but the file must
+    // not be modified while they are alive.
     Optional<ImportedAssets> importFromDisk(
         Span<const char * const> asset_paths,
         Span<char> err_buf = { nullptr, 0 },
-        bool one_object_per_asset = false);
+        bool one_object_per_asset = false,
+        CountT num_threads = 1,
+        bool alias_glb_buffers = false);
 private:
     struct Impl;
     std::unique_ptr<Impl> impl_;
@@ -17,4 +17,33 @@ char * readBinaryFile(const char *path,
                       size_t buffer_alignment,
                       size_t *out_num_bytes);
 
+// Maps an entire file into memory instead of copying it into a buffer like
+// readBinaryFile. With copy_on_write the mapping is writable, but writes
+// only copy the touched pages and never reach the file.
+class MappedFile {
+public:
+    static Optional<MappedFile> map(const char *path,
+                                    bool copy_on_write = false);
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile(MappedFile &&o);
+    ~MappedFile();
+
+    MappedFile & operator=(const MappedFile &) = delete;
+    MappedFile & operator=(MappedFile &&o);
+
+    inline char * data() const { return data_; }
+    inline size_t numBytes() const { return numBytes_; }
+
+private:
+    inline MappedFile(char *data, size_t num_bytes)
+        : data_(data), numBytes_(num_bytes)
+    {}
+
+    void unmap();
+
+    char *data_;
+    size_t numBytes_;
+};
+
 }
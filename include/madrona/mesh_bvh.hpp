@@ -164,6 +164,15 @@ struct MeshBVH {
     static constexpr inline CountT nodeWidth = MADRONA_BVH_WIDTH;
     static constexpr inline int32_t sentinel = (int32_t)0xFFFF'FFFF;
 
+    // A depth first traversal leaves at most nodeWidth - 1 siblings on the
+    // stack per level. The builder rejects trees that would need more than
+    // maxTraversalStackSize entries, so stacks of that size always fit.
+    static constexpr inline CountT maxTraversalStackSize = 64;
+    static constexpr inline CountT traversalStackSize(uint32_t max_depth)
+    {
+        return (nodeWidth - 1) * (CountT)max_depth + 1;
+    }
+
     struct BVHMaterial{
         int32_t matIDX;
     };
@@ -211,6 +220,7 @@ struct MeshBVH {
     template <typename Fn>
     void findOverlaps(const math::AABB &aabb, Fn &&fn) const;
 
+    // stack needs room for maxTraversalStackSize entries past stack_size
     inline bool traceRay(math::Vector3 ray_o,
                          math::Vector3 ray_d,
                          HitInfo *out_hit_info,
@@ -300,6 +310,8 @@ struct MeshBVH {
     uint32_t numNodes;
     uint32_t numLeaves;
     uint32_t numVerts;
+    // Levels of internal nodes, 1 when the root only has leaves
+    uint32_t maxDepth;
 
     int32_t materialIDX;
 
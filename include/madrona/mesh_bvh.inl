@@ -20,7 +20,7 @@ void MeshBVH::findOverlaps(const math::AABB &aabb, Fn &&fn) const
 {
     using namespace madrona::math;
 
-    int32_t stack[32];
+    int32_t stack[maxTraversalStackSize];
     stack[0] = 0;
     CountT stack_size = 1;
 
@@ -68,7 +68,7 @@ void MeshBVH::findOverlaps(const math::AABB &aabb, Fn &&fn) const
                         fn(a, b, c);
                     }
                 } else {
-                    // assert(stack_size < 32);
+                    assert(stack_size < maxTraversalStackSize);
                     stack[stack_size++] = node.childrenIdx[i];
                 }
             }
@@ -152,7 +152,8 @@ bool MeshBVH::traceRay(math::Vector3 ray_o,
                         t_max = hit_info->tHit;
                     }
                 } else {
-                    // stack->push(node.children[i]);
+                    assert(stack_size - previous_stack_size <
+                           maxTraversalStackSize);
                     stack[stack_size++] = node.childrenIdx[i];
                 }
             }
@@ -697,7 +698,7 @@ float MeshBVH::sphereCast(math::Vector3 ray_o,
 
     Diag3x3 inv_d = Diag3x3::fromVec(ray_d).inv();
 
-    int32_t stack[32];
+    int32_t stack[maxTraversalStackSize];
     stack[0] = 0;
     CountT stack_size = 1;
 
@@ -747,7 +748,7 @@ float MeshBVH::sphereCast(math::Vector3 ray_o,
                         closest_hit_normal = leaf_hit_normal;
                     }
                 } else {
-                    // assert(stack_size < 32);
+                    assert(stack_size < maxTraversalStackSize);
                     stack[stack_size++] = node.childrenIdx[i];
                 }
             }
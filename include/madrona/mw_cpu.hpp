@@ -10,12 +10,24 @@
 #include <madrona/taskgraph_builder.hpp>
 #include <madrona/importer.hpp>
 #include <madrona/registry.hpp>
+#include <madrona/node_profiler.hpp>
 
 namespace madrona {
 
 // Base class for TaskGraphExecutor below, don't use directly
 class ThreadPoolExecutor {
 public:
+    // Order in which the (world, node) pairs of a step are executed
+    enum class Schedule : uint32_t {
+        // Each world's taskgraph runs start to finish as one job
+        WorldMajor,
+        // Node N runs for all worlds before any world starts node N + 1,
+        // like the GPU megakernel. Keeps each system's code and the data
+        // it shares across worlds (physics assets etc) hot in cache, at
+        // the cost of one synchronization point per node.
+        NodeMajor,
+    };
+
     struct Config {
         // Batch size for the backend
         uint32_t numWorlds;
@@ -23,6 +35,34 @@ public:
         uint32_t numExportedBuffers;
         // Number of worker threads
         uint32_t numWorkers = 0;
+        // Schedule the nodes of each world's taskgraph individually instead
+        // of running every world's graph as one job: nodes that don't
+        // depend on each other can run concurrently and large
+        // ParallelForNodes are split into sub-jobs across worker threads.
+        // Helps when numWorlds is small relative to the number of cores.
+        // Only enable if taskgraph dependencies fully describe the data
+        // shared between nodes, and systems in ParallelForNodes with more
+        // than minRowsPerSubJob rows don't create / destroy entities
+        // or temporaries.
+        bool intraWorldParallelism = false;
+        // Minimum number of rows processed by each sub-job when splitting
+        // a ParallelForNode in intraWorldParallelism mode
+        uint32_t minRowsPerSubJob = 1024;
+        // See Schedule above. NodeMajor can be combined with
+        // intraWorldParallelism to also split large ParallelForNodes.
+        Schedule schedule = Schedule::WorldMajor;
+        // Time every node of every world on one out of this many taskgraph
+        // runs, see NodeProfiler. 0 disables profiling.
+        uint32_t profileSampleInterval = 0;
+        // Capacity of each worker's profiling ring buffer, in events
+        uint32_t profileEventsPerWorker = 1 << 16;
+        // Construct each world (its Context, WorldT and initial entities)
+        // on a worker thread instead of serially on the calling thread.
+        // Worlds are statically placed on the NUMA node of the workers that
+        // step them, so this makes their storage first touched, and
+        // therefore allocated, on that node. WorldT constructors must be
+        // safe to run concurrently for different worlds.
+        bool parallelWorldInit = false;
     };
 
     struct Job {
@@ -40,7 +80,29 @@ public:
     // ECSRegister::exportColumn
     void * getExported(CountT slot) const;
 
+    // nullptr unless Config::profileSampleInterval is set
+    NodeProfiler * nodeProfiler() const;
+
 protected:
+    struct TaskGraphJob {
+        Context *ctx;
+        TaskGraph taskgraph;
+    };
+
+    // Same as run(), but jobs[i] runs world i, so world i's exported
+    // columns are copied in at the start of its job rather than in a
+    // separate pass over all worlds. If graph_jobs is set, jobs[i] runs
+    // graph_jobs[i] and sampled steps run its nodes one at a time instead
+    // so they can be profiled.
+    void runWorldJobs(Job *jobs, CountT num_worlds,
+                      TaskGraphJob *graph_jobs = nullptr,
+                      uint32_t taskgraph_idx = 0);
+
+    // Run the taskgraphs in jobs node by node, according to
+    // Config::schedule and Config::intraWorldParallelism
+    void runTaskGraphs(TaskGraphJob *jobs, CountT num_jobs,
+                       uint32_t taskgraph_idx = 0);
+
     void initializeContexts(
         Context & (*init_fn)(void *, const WorkerInit &, CountT),
         void *init_data, CountT num_worlds);
@@ -91,22 +153,20 @@ public:
     // ECSRegister::exportColumn
     using ThreadPoolExecutor::getExported;
 
+    using ThreadPoolExecutor::nodeProfiler;
+
     // Get a reference to the per world data class
     inline WorldT & getWorldData(CountT world_idx);
 
     inline ContextT & getWorldContext(CountT idx);
 
 private:
-    struct JobData {
-        Context *ctx;
-        TaskGraph taskgraph;
-    };
-
     HeapArray<ContextT> contexts_;
     HeapArray<WorldT> world_datas_;
-    HeapArray<JobData> job_datas_;
+    HeapArray<TaskGraphJob> job_datas_;
     HeapArray<Job> jobs_;
     uint32_t num_taskgraphs_;
+    bool schedule_nodes_;
 };
 
 }
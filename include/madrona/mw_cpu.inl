@@ -13,7 +13,9 @@ TaskGraphExecutor<ContextT, WorldT, ConfigT, InitT>::TaskGraphExecutor(
       world_datas_(cfg.numWorlds),
       job_datas_((CountT)cfg.numWorlds * num_taskgraphs),
       jobs_((CountT)cfg.numWorlds * num_taskgraphs),
-      num_taskgraphs_((uint32_t)num_taskgraphs)
+      num_taskgraphs_((uint32_t)num_taskgraphs),
+      schedule_nodes_(cfg.intraWorldParallelism ||
+                      cfg.schedule == Schedule::NodeMajor)
 {
     auto ecs_reg = getECSRegistry();
     WorldT::registerTypes(ecs_reg, user_cfg);
@@ -27,6 +29,9 @@ TaskGraphExecutor<ContextT, WorldT, ConfigT, InitT>::TaskGraphExecutor(
 
         taskgraph_mgrs.emplace(world_idx, num_taskgraphs, worker_init);
 
+        world_datas_.emplace(world_idx, contexts_[world_idx],
+                             user_cfg, user_inits[world_idx]);
+
         return contexts_[world_idx];
     };
 
@@ -37,12 +42,6 @@ TaskGraphExecutor<ContextT, WorldT, ConfigT, InitT>::TaskGraphExecutor(
         return (*(CBPtrT)ptr_raw)(worker_init, world_idx);
     }, &ctx_init_cb, cfg.numWorlds);
 
-    for (CountT world_idx = 0; world_idx < (CountT)cfg.numWorlds;
-         world_idx++) {
-        world_datas_.emplace(world_idx, contexts_[world_idx],
-                             user_cfg, user_inits[world_idx]);
-    }
-
     HeapArray<HeapArray<TaskGraph>> built_graphs(cfg.numWorlds);
     for (CountT world_idx = 0; world_idx < (CountT)cfg.numWorlds;
          world_idx++) {
@@ -58,13 +57,13 @@ TaskGraphExecutor<ContextT, WorldT, ConfigT, InitT>::TaskGraphExecutor(
              world_idx++) {
             CountT job_idx = taskgraph_idx * cfg.numWorlds + world_idx;
 
-            job_datas_.emplace(job_idx, JobData {
+            job_datas_.emplace(job_idx, TaskGraphJob {
                 .ctx = &contexts_[world_idx],
                 .taskgraph = std::move(built_graphs[world_idx][taskgraph_idx]),
             });
 
             jobs_[job_idx].fn = [](void *ptr) {
-                auto job_data = (JobData *)ptr;
+                auto job_data = (TaskGraphJob *)ptr;
                 job_data->taskgraph.run(job_data->ctx);
             };
             jobs_[job_idx].data = &job_datas_[job_idx];
@@ -85,7 +84,14 @@ template <typename ContextT, typename WorldT, typename ConfigT, typename InitT>
 void TaskGraphExecutor<ContextT, WorldT, ConfigT, InitT>::runTaskGraph(uint32_t taskgraph_idx)
 {
     CountT offset = taskgraph_idx * world_datas_.size();
-    ThreadPoolExecutor::run(jobs_.data() + offset, world_datas_.size());
+
+    if (schedule_nodes_) {
+        runTaskGraphs(job_datas_.data() + offset, world_datas_.size(),
+                      taskgraph_idx);
+    } else {
+        runWorldJobs(jobs_.data() + offset, world_datas_.size(),
+                     job_datas_.data() + offset, taskgraph_idx);
+    }
 }
 
 template <typename ContextT, typename WorldT, typename ConfigT, typename InitT>
@@ -23,10 +23,23 @@ struct Navmesh {
         uint32_t alias;
     };
 
+    // Uniform grid over the XY bounds of the mesh for findPoly. The
+    // triangles overlapping cell i are
+    // cellTris[cellOffsets[i]] .. cellTris[cellOffsets[i + 1] - 1].
+    struct PolyGrid {
+        math::Vector2 origin;
+        float invCellSize;
+        uint32_t dimX;
+        uint32_t dimY;
+        uint32_t *cellOffsets;
+        uint32_t *cellTris;
+    };
+
     math::Vector3 *vertices;
     uint32_t *triIndices;
     uint32_t *triAdjacency;
     AliasEntry *triSampleAliasTable;
+    PolyGrid polyGrid;
     uint32_t numVerts;
     uint32_t numTris;
 
@@ -63,6 +76,58 @@ struct Navmesh {
         DijkstrasState dijkstras_state,
         Fn &&fn);
 
+    // Shared edge of two adjacent triangles as seen when crossing from
+    // from_poly into to_poly
+    inline void getPortal(uint32_t from_poly,
+                          uint32_t to_poly,
+                          math::Vector3 *out_left,
+                          math::Vector3 *out_right);
+
+    // Triangle under or above pos (Z is up), picking the one closest in
+    // height where several overlap. Returns sentinel if pos is outside the
+    // mesh.
+    inline uint32_t findPoly(math::Vector3 pos);
+
+    // Scratch for findPolyPath, every array needs numTris entries.
+    // visitGenerations must be zeroed before the first search, after that
+    // a search only resets the triangles it touches. One per concurrent
+    // caller.
+    struct PathFindState {
+        float *costs;
+        float *estimates;
+        math::Vector3 *entryPoints;
+        uint32_t *parents;
+        uint32_t *heap;
+        uint32_t *heapIndex;
+        uint32_t *visitGenerations;
+        uint32_t generation;
+    };
+
+    // A* from start_pos in start_poly to goal_pos in goal_poly, stopping as
+    // soon as goal_poly is reached. Writes the corridor of triangles from
+    // start_poly to goal_poly to out_polys and returns its length, or 0 if
+    // goal_poly can't be reached or the corridor is longer than max_polys.
+    inline CountT findPolyPath(
+        uint32_t start_poly,
+        math::Vector3 start_pos,
+        uint32_t goal_poly,
+        math::Vector3 goal_pos,
+        PathFindState &path_state,
+        uint32_t *out_polys,
+        CountT max_polys);
+
+    // Shortest path through the portals of a findPolyPath corridor
+    // (string pulling with the simple stupid funnel algorithm). Writes
+    // start_pos, the corners of the path and goal_pos to out_points and
+    // returns the number of points, stopping early after max_points.
+    inline CountT funnelPath(
+        const uint32_t *polys,
+        CountT num_polys,
+        math::Vector3 start_pos,
+        math::Vector3 goal_pos,
+        math::Vector3 *out_points,
+        CountT max_points);
+
     static Navmesh initFromPolygons(
         math::Vector3 *poly_vertices,
         uint32_t *poly_idxs,
@@ -74,6 +139,36 @@ struct Navmesh {
     static constexpr inline uint32_t sentinel = 0xFFFF'FFFF;
 };
 
+// Shortest path distance and next hop between every pair of triangles of
+// a Navmesh, built once by NavmeshDistanceTableBuilder and shared read-only
+// by every world. Paths run between triangle centroids through shared edge
+// midpoints. Takes 2.25 bytes per pair, so this is meant for meshes of up
+// to a few thousand triangles.
+struct NavmeshDistanceTable {
+    // Indexed by [to_poly][from_poly], so queries towards the same goal
+    // read the same row. Distances are in units of distanceScale.
+    uint16_t *distances;
+    // Adjacency slot of from_poly's next triangle towards to_poly, packed
+    // four to a byte in rows of nextHopRowBytes()
+    uint8_t *nextHops;
+    float distanceScale;
+    uint32_t numTris;
+
+    // FLT_MAX if to_poly can't be reached from from_poly
+    inline float distance(uint32_t from_poly, uint32_t to_poly) const;
+
+    // Neighbor of from_poly to move to next on the way to to_poly, or
+    // Navmesh::sentinel if from_poly == to_poly or to_poly is unreachable
+    inline uint32_t nextHop(const Navmesh &navmesh,
+                            uint32_t from_poly,
+                            uint32_t to_poly) const;
+
+    inline CountT nextHopRowBytes() const;
+
+    static constexpr inline uint16_t unreachableDistance = 0xFFFF;
+    static constexpr inline uint8_t noNextHop = 3;
+};
+
 }
 
 #include "navmesh.inl"
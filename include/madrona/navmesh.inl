@@ -49,6 +49,356 @@ void Navmesh::getTriangleVertices(uint32_t tri_idx,
     *out_c = vertices[triIndices[3 * tri_idx + 2]];
 }
 
+void Navmesh::getPortal(uint32_t from_poly,
+                        uint32_t to_poly,
+                        math::Vector3 *out_left,
+                        math::Vector3 *out_right)
+{
+    using namespace math;
+
+    Vector3 tri_verts[3];
+    getTriangleVertices(from_poly, &tri_verts[0], &tri_verts[1],
+                        &tri_verts[2]);
+
+    // Triangles aren't consistently wound, so check which way this one
+    // goes around in the XY plane
+    Vector3 ab = tri_verts[1] - tri_verts[0];
+    Vector3 ac = tri_verts[2] - tri_verts[0];
+    bool ccw = ab.x * ac.y - ab.y * ac.x >= 0.f;
+
+    MADRONA_UNROLL
+    for (CountT i = 0; i < 3; i++) {
+        if (triAdjacency[3 * from_poly + i] != to_poly) {
+            continue;
+        }
+
+        Vector3 edge_a = tri_verts[i];
+        Vector3 edge_b = tri_verts[(i + 1) % 3];
+
+        if (ccw) {
+            *out_left = edge_b;
+            *out_right = edge_a;
+        } else {
+            *out_left = edge_a;
+            *out_right = edge_b;
+        }
+
+        return;
+    }
+
+    assert(false);
+}
+
+uint32_t Navmesh::findPoly(math::Vector3 pos)
+{
+    using namespace math;
+
+    float cell_x = (pos.x - polyGrid.origin.x) * polyGrid.invCellSize;
+    float cell_y = (pos.y - polyGrid.origin.y) * polyGrid.invCellSize;
+
+    if (cell_x < 0.f || cell_y < 0.f ||
+            cell_x >= (float)polyGrid.dimX || cell_y >= (float)polyGrid.dimY) {
+        return sentinel;
+    }
+
+    uint32_t cell_idx = (uint32_t)cell_y * polyGrid.dimX + (uint32_t)cell_x;
+
+    uint32_t closest_poly = sentinel;
+    float closest_dist = FLT_MAX;
+
+    uint32_t cell_end = polyGrid.cellOffsets[cell_idx + 1];
+    for (uint32_t i = polyGrid.cellOffsets[cell_idx]; i < cell_end; i++) {
+        uint32_t tri_idx = polyGrid.cellTris[i];
+
+        Vector3 a, b, c;
+        getTriangleVertices(tri_idx, &a, &b, &c);
+
+        float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        if (area == 0.f) {
+            continue;
+        }
+
+        // Barycentric coordinates of pos in the XY plane
+        float inv_area = 1.f / area;
+        float u = ((b.x - pos.x) * (c.y - pos.y) -
+                   (b.y - pos.y) * (c.x - pos.x)) * inv_area;
+        float v = ((c.x - pos.x) * (a.y - pos.y) -
+                   (c.y - pos.y) * (a.x - pos.x)) * inv_area;
+        float w = 1.f - u - v;
+
+        constexpr float edge_eps = -1e-5f;
+        if (u < edge_eps || v < edge_eps || w < edge_eps) {
+            continue;
+        }
+
+        float dist = fabsf(u * a.z + v * b.z + w * c.z - pos.z);
+        if (dist < closest_dist) {
+            closest_poly = tri_idx;
+            closest_dist = dist;
+        }
+    }
+
+    return closest_poly;
+}
+
+CountT Navmesh::findPolyPath(uint32_t start_poly,
+                             math::Vector3 start_pos,
+                             uint32_t goal_poly,
+                             math::Vector3 goal_pos,
+                             PathFindState &path_state,
+                             uint32_t *out_polys,
+                             CountT max_polys)
+{
+    using namespace math;
+
+    if (max_polys == 0) {
+        return 0;
+    }
+
+    if (start_poly == goal_poly) {
+        out_polys[0] = start_poly;
+        return 1;
+    }
+
+    uint32_t generation = ++path_state.generation;
+    if (generation == 0) {
+        utils::zeroN<uint32_t>(path_state.visitGenerations, numTris);
+        generation = path_state.generation = 1;
+    }
+
+    float *costs = path_state.costs;
+    float *estimates = path_state.estimates;
+    Vector3 *entry_points = path_state.entryPoints;
+    uint32_t *parents = path_state.parents;
+    uint32_t *visit_generations = path_state.visitGenerations;
+
+    PathFindQueue prio_queue {
+        .costs = estimates,
+        .heap = path_state.heap,
+        .heapIndex = path_state.heapIndex,
+        .heapSize = 0,
+    };
+
+    auto visitPoly = [&](uint32_t poly) {
+        if (visit_generations[poly] == generation) {
+            return;
+        }
+
+        visit_generations[poly] = generation;
+        costs[poly] = FLT_MAX;
+        estimates[poly] = FLT_MAX;
+        prio_queue.heapIndex[poly] = sentinel;
+    };
+
+    visitPoly(start_poly);
+    costs[start_poly] = 0.f;
+    entry_points[start_poly] = start_pos;
+    parents[start_poly] = sentinel;
+    prio_queue.add(start_poly, start_pos.distance(goal_pos));
+
+    bool found_goal = false;
+    while (prio_queue.heapSize > 0) {
+        uint32_t min_poly = prio_queue.removeMin();
+        if (min_poly == goal_poly) {
+            found_goal = true;
+            break;
+        }
+
+        Vector3 cur_pos = entry_points[min_poly];
+        float cost_so_far = costs[min_poly];
+
+        Vector3 tri_verts[3];
+        getTriangleVertices(min_poly, &tri_verts[0], &tri_verts[1],
+                            &tri_verts[2]);
+
+        MADRONA_UNROLL
+        for (CountT i = 0; i < 3; i++) {
+            uint32_t adjacent = triAdjacency[3 * min_poly + i];
+            if (adjacent == sentinel) {
+                continue;
+            }
+
+            // Enter the next triangle where the straight line to the goal
+            // crosses the shared edge in the XY plane, clamped to the edge.
+            // Much closer to the smoothed path length than edge midpoints.
+            Vector3 edge_a = tri_verts[i];
+            Vector3 edge_b = tri_verts[(i + 1) % 3];
+            Vector3 edge = edge_b - edge_a;
+            Vector3 to_goal = goal_pos - cur_pos;
+            Vector3 to_edge = edge_a - cur_pos;
+
+            float denom = edge.x * to_goal.y - edge.y * to_goal.x;
+            float edge_t = 0.5f;
+            if (denom != 0.f) {
+                edge_t = (to_goal.x * to_edge.y - to_goal.y * to_edge.x) /
+                    denom;
+                edge_t = fminf(fmaxf(edge_t, 0.f), 1.f);
+            }
+
+            Vector3 entry_point = edge_a + edge_t * edge;
+
+            float new_cost = cost_so_far + cur_pos.distance(entry_point);
+            float new_estimate = new_cost + entry_point.distance(goal_pos);
+
+            visitPoly(adjacent);
+
+            // Already expanded. Entry points depend on the path taken, so
+            // reopening these could only shave off rounding error.
+            if (prio_queue.heapIndex[adjacent] == sentinel &&
+                    estimates[adjacent] != FLT_MAX) {
+                continue;
+            }
+
+            // For the same reason open triangles keep the entry with the
+            // lowest estimate rather than the lowest cost
+            if (new_estimate >= estimates[adjacent]) {
+                continue;
+            }
+
+            costs[adjacent] = new_cost;
+            entry_points[adjacent] = entry_point;
+            parents[adjacent] = min_poly;
+
+            if (prio_queue.heapIndex[adjacent] == sentinel) {
+                prio_queue.add(adjacent, new_estimate);
+            } else {
+                prio_queue.decreaseCost(adjacent, new_estimate);
+            }
+        }
+    }
+
+    if (!found_goal) {
+        return 0;
+    }
+
+    CountT num_path_polys = 0;
+    for (uint32_t poly = goal_poly; poly != sentinel; poly = parents[poly]) {
+        num_path_polys++;
+    }
+
+    if (num_path_polys > max_polys) {
+        return 0;
+    }
+
+    CountT out_idx = num_path_polys;
+    for (uint32_t poly = goal_poly; poly != sentinel; poly = parents[poly]) {
+        out_polys[--out_idx] = poly;
+    }
+
+    return num_path_polys;
+}
+
+CountT Navmesh::funnelPath(const uint32_t *polys,
+                           CountT num_polys,
+                           math::Vector3 start_pos,
+                           math::Vector3 goal_pos,
+                           math::Vector3 *out_points,
+                           CountT max_points)
+{
+    using namespace math;
+
+    if (max_points == 0) {
+        return 0;
+    }
+
+    // Positive when c is left of a -> b in the XY plane
+    auto triArea2 = [](Vector3 a, Vector3 b, Vector3 c) {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    };
+
+    auto samePoint = [](Vector3 a, Vector3 b) {
+        constexpr float eps = 1e-3f;
+        return a.distance2(b) < eps * eps;
+    };
+
+    CountT num_points = 0;
+    out_points[num_points++] = start_pos;
+
+    Vector3 apex = start_pos;
+    Vector3 funnel_left = start_pos;
+    Vector3 funnel_right = start_pos;
+    CountT apex_idx = 0;
+    CountT left_idx = 0;
+    CountT right_idx = 0;
+
+    // Portal i is the edge from polys[i - 1] into polys[i], the last
+    // portal is the goal itself
+    for (CountT i = 1; i <= num_polys; i++) {
+        Vector3 left, right;
+        if (i < num_polys) {
+            getPortal(polys[i - 1], polys[i], &left, &right);
+        } else {
+            left = goal_pos;
+            right = goal_pos;
+        }
+
+        // Narrow the right side of the funnel, or if it crosses over the
+        // left side the left side becomes a corner of the path. Sides that
+        // are only collinear haven't crossed, which happens when the apex
+        // is on a portal.
+        if (triArea2(apex, funnel_right, right) >= 0.f) {
+            if (samePoint(apex, funnel_right) ||
+                    triArea2(apex, funnel_left, right) <= 0.f) {
+                funnel_right = right;
+                right_idx = i;
+            } else {
+                apex = funnel_left;
+                apex_idx = left_idx;
+
+                if (!samePoint(out_points[num_points - 1], apex)) {
+                    if (num_points == max_points) {
+                        return num_points;
+                    }
+
+                    out_points[num_points++] = apex;
+                }
+
+                funnel_left = apex;
+                funnel_right = apex;
+                left_idx = apex_idx;
+                right_idx = apex_idx;
+
+                i = apex_idx;
+                continue;
+            }
+        }
+
+        if (triArea2(apex, funnel_left, left) <= 0.f) {
+            if (samePoint(apex, funnel_left) ||
+                    triArea2(apex, funnel_right, left) >= 0.f) {
+                funnel_left = left;
+                left_idx = i;
+            } else {
+                apex = funnel_right;
+                apex_idx = right_idx;
+
+                if (!samePoint(out_points[num_points - 1], apex)) {
+                    if (num_points == max_points) {
+                        return num_points;
+                    }
+
+                    out_points[num_points++] = apex;
+                }
+
+                funnel_left = apex;
+                funnel_right = apex;
+                left_idx = apex_idx;
+                right_idx = apex_idx;
+
+                i = apex_idx;
+                continue;
+            }
+        }
+    }
+
+    if (num_points < max_points &&
+            !samePoint(out_points[num_points - 1], goal_pos)) {
+        out_points[num_points++] = goal_pos;
+    }
+
+    return num_points;
+}
+
 template <typename Fn>
 void Navmesh::bfsFromPoly(uint32_t start_poly,
                           BFSState bfs_state,
@@ -153,4 +503,35 @@ inline void Navmesh::dijkstrasFromPoly(
     }
 }
 
+float NavmeshDistanceTable::distance(uint32_t from_poly,
+                                     uint32_t to_poly) const
+{
+    uint16_t quantized = distances[(CountT)to_poly * numTris + from_poly];
+    if (quantized == unreachableDistance) {
+        return FLT_MAX;
+    }
+
+    return float(quantized) * distanceScale;
+}
+
+uint32_t NavmeshDistanceTable::nextHop(const Navmesh &navmesh,
+                                       uint32_t from_poly,
+                                       uint32_t to_poly) const
+{
+    uint8_t packed =
+        nextHops[(CountT)to_poly * nextHopRowBytes() + from_poly / 4];
+    uint32_t slot = (packed >> (2 * (from_poly % 4))) & 3;
+
+    if (slot == noNextHop) {
+        return Navmesh::sentinel;
+    }
+
+    return navmesh.triAdjacency[3 * from_poly + slot];
+}
+
+CountT NavmeshDistanceTable::nextHopRowBytes() const
+{
+    return ((CountT)numTris + 3) / 4;
+}
+
 }
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <madrona/navmesh.hpp>
+#include <madrona/asset_cache.hpp>
+
+namespace madrona {
+
+struct NavmeshDistanceTableBuilder {
+    // Runs a Dijkstra search towards every triangle, split across
+    // num_threads threads (<= 0 uses every hardware thread). The table is
+    // a single rawAlloc allocation starting at distances.
+    static NavmeshDistanceTable build(const Navmesh &navmesh,
+                                      CountT num_threads = 0);
+
+    // Frees a table returned by build, not ones loaded from a cache
+    static void free(NavmeshDistanceTable &tbl);
+
+    // Hash of the navmesh geometry and connectivity, used to key the
+    // on-disk cache below.
+    static uint64_t hashSources(const Navmesh &navmesh);
+
+    static bool writeCache(const char *path,
+                           uint64_t source_hash,
+                           const NavmeshDistanceTable &tbl);
+
+    // Maps a cache written by writeCache if it was built from the same
+    // navmesh. out_tbl points into the returned mapping, which must be
+    // kept alive as long as the table is used.
+    static Optional<MappedAssetCache> loadCache(
+        const char *path,
+        uint64_t source_hash,
+        NavmeshDistanceTable *out_tbl);
+};
+
+}
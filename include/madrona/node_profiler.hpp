@@ -0,0 +1,140 @@
+/*
+ * Copyright 2021-2023 Brennan Shacklett and contributors
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+#pragma once
+
+#include <madrona/heap_array.hpp>
+#include <madrona/macros.hpp>
+#include <madrona/tracing.hpp>
+
+#include <chrono>
+#include <cstdio>
+
+namespace madrona {
+
+// One execution of a taskgraph node (or of one sub-job of a split
+// ParallelForNode) on a worker thread
+struct NodeProfileEvent {
+    // NodeProfiler::timestamp() ticks
+    uint64_t start;
+    uint64_t end;
+    // Index of the sampled step, counted across all taskgraphs
+    uint32_t step;
+    uint32_t taskgraph;
+    // Topologically sorted node index, see TaskGraph::numNodes()
+    uint32_t node;
+    uint32_t world;
+    uint32_t worker;
+    // Rows processed by ParallelForNodes, 1 for other nodes
+    uint32_t numRows;
+};
+
+// Per node statistics over every sampled step and world. Sub-jobs of a
+// split node are summed, so each sample is one node in one world.
+struct NodeProfileSummary {
+    uint32_t taskgraph;
+    uint32_t node;
+    uint32_t numSamples;
+    uint64_t numRows;
+    double p50Us;
+    double p99Us;
+    double maxUs;
+    double totalMs;
+};
+
+// Per node timings for the CPU backend, enabled through
+// ThreadPoolExecutor::Config::profileSampleInterval. Each worker appends
+// to its own preallocated ring buffer (oldest events are overwritten), so
+// recording never locks or allocates; unsampled steps cost one branch per
+// node. None of the functions below record() may be called while the
+// executor is running a step.
+class NodeProfiler {
+public:
+    NodeProfiler(CountT num_workers,
+                 uint32_t sample_interval,
+                 uint32_t num_events_per_worker);
+
+    // Called by the executor at the start of each taskgraph run. Returns
+    // true if the nodes of this run should be recorded.
+    inline bool beginStep(uint32_t taskgraph_idx);
+
+    inline void record(CountT worker_idx, uint32_t world_idx,
+                       uint32_t node_idx, uint32_t num_rows,
+                       uint64_t start, uint64_t end);
+
+    static inline uint64_t timestamp();
+
+    // Events still in the ring buffers, grouped by worker in the order
+    // they were recorded
+    HeapArray<NodeProfileEvent> events() const;
+
+    HeapArray<NodeProfileSummary> summarize() const;
+    void printSummary(FILE *file = stdout) const;
+
+    // chrome://tracing / ui.perfetto.dev JSON
+    bool writeChromeTrace(const char *path) const;
+    // Perfetto protobuf trace, one track per worker
+    bool writePerfettoTrace(const char *path) const;
+
+    void clear();
+
+private:
+    struct alignas(MADRONA_CACHE_LINE) WorkerRing {
+        HeapArray<NodeProfileEvent> events;
+        uint64_t numRecorded;
+    };
+
+    double nsPerTick() const;
+
+    HeapArray<WorkerRing> rings_;
+    uint32_t ring_mask_;
+    uint32_t sample_interval_;
+    uint32_t num_steps_;
+    uint32_t num_sampled_steps_;
+    uint32_t cur_taskgraph_;
+    uint64_t base_timestamp_;
+    std::chrono::steady_clock::time_point base_time_;
+};
+
+bool NodeProfiler::beginStep(uint32_t taskgraph_idx)
+{
+    if (num_steps_++ % sample_interval_ != 0) {
+        return false;
+    }
+
+    num_sampled_steps_++;
+    cur_taskgraph_ = taskgraph_idx;
+
+    return true;
+}
+
+void NodeProfiler::record(CountT worker_idx, uint32_t world_idx,
+                          uint32_t node_idx, uint32_t num_rows,
+                          uint64_t start, uint64_t end)
+{
+    WorkerRing &ring = rings_[worker_idx];
+
+    ring.events[ring.numRecorded & ring_mask_] = NodeProfileEvent {
+        .start = start,
+        .end = end,
+        .step = num_sampled_steps_ - 1,
+        .taskgraph = cur_taskgraph_,
+        .node = node_idx,
+        .world = world_idx,
+        .worker = uint32_t(worker_idx),
+        .numRows = num_rows,
+    };
+
+    ring.numRecorded++;
+}
+
+uint64_t NodeProfiler::timestamp()
+{
+    return GetTimeStamp();
+}
+
+}
@@ -7,6 +7,7 @@
 
 #include <madrona/broadphase.hpp>
 #include <madrona/geo.hpp>
+#include <madrona/mesh_bvh.hpp>
 
 namespace madrona::phys {
 
@@ -33,6 +34,21 @@ struct Velocity {
     math::Vector3 angular;
 };
 
+// Dynamic bodies in an island (bodies connected through contacts or
+// joints) that has been at rest for long enough are put to sleep. Sleeping
+// bodies aren't integrated, their BVH leaves aren't updated and they aren't
+// checked for contacts against other sleeping or static bodies. A sleeping
+// body wakes up, along with the rest of its island, when it is moved,
+// given a velocity or external force, or touched by an awake body.
+// PhysicsSystem::registerEntity resets this to awake.
+struct SleepState {
+    // Seconds the body has stayed below the sleep velocity thresholds
+    float restTime;
+    bool asleep;
+    // Island the body fell asleep in, only valid while asleep
+    int32_t island;
+};
+
 struct SolverBundleAlias {};
 
 struct RigidBody : Bundle<
@@ -42,6 +58,7 @@ struct RigidBody : Bundle<
     Velocity, 
     ExternalForce,
     ExternalTorque,
+    SleepState,
     SolverBundleAlias
 > {};
 
@@ -122,6 +139,7 @@ struct CollisionPrimitive {
         Sphere = 1 << 0,
         Hull = 1 << 1,
         Plane = 1 << 2,
+        TriangleMesh = 1 << 3,
     };
 
     struct Sphere {
@@ -134,11 +152,18 @@ struct CollisionPrimitive {
 
     struct Plane {};
 
+    // Concave triangle soup, only supported on static bodies. Triangles
+    // are one-sided: bodies behind a triangle don't collide with it.
+    struct TriangleMesh {
+        MeshBVH bvh;
+    };
+
     Type type;
     union {
         Sphere sphere;
         Plane plane;
         Hull hull;
+        TriangleMesh triMesh;
     };
 };
 
@@ -170,6 +195,10 @@ namespace PhysicsSystem {
               CountT max_dynamic_objects,
               Solver solver = Solver::XPBD);
 
+    // Frees the buffers allocated by init. Call when tearing down the
+    // world, e.g. from the WorldT destructor (its Context outlives it).
+    void shutdown(Context &ctx);
+
     void reset(Context &ctx);
     broadphase::LeafID registerEntity(Context &ctx,
                                       Entity e,
@@ -4,6 +4,7 @@
 #include <madrona/importer.hpp>
 #include <madrona/stack_alloc.hpp>
 #include <madrona/mesh_bvh.hpp>
+#include <madrona/asset_cache.hpp>
 
 #include <madrona/geo.hpp>
 
@@ -14,11 +15,20 @@ struct SourceCollisionPrimitive {
         uint32_t hullIDX;
     };
 
+    // Triangulated meshes merged into one MeshBVH. Must stay alive until
+    // processRigidBodyAssets returns. Only supported on static objects,
+    // and not by the CUDA backend.
+    struct TriangleMeshInput {
+        const imp::SourceMesh *meshes;
+        uint32_t numMeshes;
+    };
+
     CollisionPrimitive::Type type;
     union {
         CollisionPrimitive::Sphere sphere;
         CollisionPrimitive::Plane plane;
         HullInput hullInput;
+        TriangleMeshInput triMeshInput;
     };
 };
 
@@ -40,6 +50,15 @@ struct RigidBodyAssets {
         uint32_t numVerts;
     } hullData;
 
+    // MeshBVH storage of every TriangleMesh primitive
+    struct TriangleMeshData {
+        QBVHNode *nodes;
+        MeshBVH::BVHVertex *vertices;
+
+        uint32_t numNodes;
+        uint32_t numVerts;
+    } triMeshData;
+
     // Per Primitive Data
     CollisionPrimitive *primitives;
     math::AABB *primitiveAABBs;
@@ -61,6 +80,29 @@ struct RigidBodyAssets {
         StackAlloc &tmp_alloc,
         RigidBodyAssets *out_assets,
         CountT *out_num_bytes);
+
+    // Hash of every input processRigidBodyAssets consumes, used to key
+    // the on-disk cache below.
+    static uint64_t hashSources(
+        Span<const imp::SourceMesh> convex_hull_meshes,
+        Span<const SourceCollisionObject> collision_objs,
+        bool build_convex_hulls);
+
+    // Writes the buffer returned by processRigidBodyAssets to path, with
+    // all internal pointers stored as offsets into the buffer.
+    static bool writeCache(const char *path,
+                           uint64_t source_hash,
+                           const RigidBodyAssets &assets,
+                           const void *buffer,
+                           CountT num_bytes);
+
+    // Maps a cache written by writeCache if it was built from the same
+    // sources. out_assets points into the returned mapping, which must
+    // be kept alive until the assets have been loaded.
+    static Optional<MappedAssetCache> loadCache(
+        const char *path,
+        uint64_t source_hash,
+        RigidBodyAssets *out_assets);
 };
 
 
@@ -15,6 +15,14 @@ public:
 
     CountT loadRigidBodies(const RigidBodyAssets &assets);
 
+    // Runs RigidBodyAssets::processRigidBodyAssets and loads the result.
+    // With a cache_path, the processed assets are mapped from that file
+    // if it was built from the same sources, and written to it otherwise.
+    CountT loadRigidBodies(Span<const imp::SourceMesh> convex_hull_meshes,
+                           Span<const SourceCollisionObject> collision_objs,
+                           bool build_convex_hulls,
+                           const char *cache_path = nullptr);
+
     ObjectManager & getObjectManager();
 
 private:
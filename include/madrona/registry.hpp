@@ -56,18 +56,32 @@ public:
     // GPU backend's getExported() function by passing the same value of 'slot'
     // as used in this call. Make sure the the numExportedBuffers config
     // parameter is set appropriately for the backend to ensure there are
-    // enough slots!
+    // enough slots! Pass ExportFlags::ReadOnly / WriteOnly for columns
+    // that only flow one way, so the CPU backend skips the other copy.
     template <typename ArchetypeT, typename ComponentT>
-    void exportColumn(int32_t slot);
+    void exportColumn(int32_t slot,
+                      ExportFlags flags = ExportFlags::ReadWrite);
 
     // Same as exportColumn, directly export the SingletonT component.
     template <typename SingletonT>
     void exportSingleton(int32_t slot);
 
+#ifdef MADRONA_MW_MODE
+    // CPU backend only: export one ExportedRowRange per world, giving
+    // where that world's rows of ArchetypeT are in the archetype's
+    // exported columns. Updated after every step.
+    template <typename ArchetypeT>
+    void exportRowRanges(int32_t slot);
+#endif
+
     template <typename ArchetypeT, typename ComponentT, EnumType EnumT>
-    void exportColumn(EnumT slot);
+    void exportColumn(EnumT slot, ExportFlags flags = ExportFlags::ReadWrite);
     template <typename SingletonT, EnumType EnumT>
     void exportSingleton(EnumT slot);
+#ifdef MADRONA_MW_MODE
+    template <typename ArchetypeT, EnumType EnumT>
+    void exportRowRanges(EnumT slot);
+#endif
 
 private:
     StateManager *state_mgr_;
@@ -44,9 +44,10 @@ void ECSRegistry::registerSingleton()
 }
 
 template <typename ArchetypeT, typename ComponentT>
-void ECSRegistry::exportColumn(int32_t slot)
+void ECSRegistry::exportColumn(int32_t slot, ExportFlags flags)
 {
-    export_ptrs_[slot] = state_mgr_->exportColumn<ArchetypeT, ComponentT>();
+    export_ptrs_[slot] =
+        state_mgr_->exportColumn<ArchetypeT, ComponentT>(flags);
 }
 
 template <typename SingletonT>
@@ -55,10 +56,18 @@ void ECSRegistry::exportSingleton(int32_t slot)
     export_ptrs_[slot] = state_mgr_->exportSingleton<SingletonT>();
 }
 
+#ifdef MADRONA_MW_MODE
+template <typename ArchetypeT>
+void ECSRegistry::exportRowRanges(int32_t slot)
+{
+    export_ptrs_[slot] = state_mgr_->exportRowRanges<ArchetypeT>();
+}
+#endif
+
 template <typename ArchetypeT, typename ComponentT, EnumType EnumT>
-void ECSRegistry::exportColumn(EnumT slot)
+void ECSRegistry::exportColumn(EnumT slot, ExportFlags flags)
 {
-    exportColumn<ArchetypeT, ComponentT>(static_cast<uint32_t>(slot));
+    exportColumn<ArchetypeT, ComponentT>(static_cast<uint32_t>(slot), flags);
 }
 
 template <typename SingletonT, EnumType EnumT>
@@ -67,4 +76,12 @@ void ECSRegistry::exportSingleton(EnumT slot)
     exportSingleton<SingletonT>(static_cast<uint32_t>(slot));
 }
 
+#ifdef MADRONA_MW_MODE
+template <typename ArchetypeT, EnumType EnumT>
+void ECSRegistry::exportRowRanges(EnumT slot)
+{
+    exportRowRanges<ArchetypeT>(static_cast<uint32_t>(slot));
+}
+#endif
+
 }
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <madrona/mesh_bvh.hpp>
+#include <madrona/render/ecs.hpp>
+
+// CPU port of the CUDA batch raytracer (src/mw/device/bvh_raycast.cpp):
+// each world gets a top level BVH over its InstanceData rows, traversed
+// down into the instances' MeshBVHs with packets of FloatN::width rays.
+// RenderingSystem sets this up when given a CPURaycastConfig, the
+// functions below are only needed to use the raytracer directly.
+
+#ifdef MADRONA_GPU_MODE
+#error "cpu_raycast.hpp is not supported on the GPU"
+#endif
+
+namespace madrona::render {
+
+// Tightly packed R8G8B8A8 texture
+struct CPURaycastTexture {
+    const uint8_t *pixels;
+    uint32_t width;
+    uint32_t height;
+};
+
+// CPU backend version of CudaBatchRenderConfig. When passed to
+// RenderingSystem::registerTypes and init, every view attached with
+// attachEntityToView gets a RaycastOutputArchetype entity (referenced by
+// the view's RenderOutputRef) whose RGBOutputBuffer and DepthOutputBuffer
+// are rendered each step by the nodes added in RenderingSystem::setupTasks.
+// The config is copied, but everything it points to must outlive the
+// worlds.
+struct CPURaycastConfig {
+    enum class RenderMode : uint32_t {
+        RGBD,
+        Depth,
+    };
+
+    RenderMode renderMode;
+
+    // Indexed by ObjectID
+    const MeshBVH *bvhs;
+    uint32_t numBVHs;
+
+    // Indexed by the MeshBVH material indices and InstanceData::matID
+    const Material *materials;
+    // Indexed by Material::textureIdx
+    const CPURaycastTexture *textures;
+
+    // The outputs are renderResolution x renderResolution. RGB is 4 bytes
+    // per pixel (the alpha is always 255) and depth is a float per pixel,
+    // 0 where nothing was hit.
+    uint32_t renderResolution = 0;
+
+    // Hits closer than nearPlane are ignored. farPlane defaults to the
+    // GPU raytracer's maximum distance if 0.
+    float nearPlane = 0.f;
+    float farPlane = 0.f;
+};
+
+// Top level BVH over the instances of one world. The buffers are grown
+// as needed and reused between builds, until freeTLAS.
+struct CPURaycastTLAS {
+    QBVHNode *nodes = nullptr;
+    uint32_t numNodes = 0;
+    uint32_t nodeCapacity = 0;
+
+    // Build scratch
+    uint32_t *instanceIdxs = nullptr;
+    math::AABB *instanceAABBs = nullptr;
+    uint32_t instanceCapacity = 0;
+};
+
+// Everything a view of a world is traced against
+struct CPURaycastWorld {
+    const CPURaycastTLAS *tlas;
+    const InstanceData *instances;
+    const LightDesc *lights;
+    uint32_t numLights;
+};
+
+namespace CPURaycaster {
+
+// Instances with a scale of 0 are left out like on the GPU. bvhs is
+// indexed by InstanceData::objectID.
+void buildTLAS(CPURaycastTLAS &tlas,
+               const MeshBVH *bvhs,
+               const InstanceData *instances,
+               CountT num_instances);
+
+// Frees the buffers allocated by buildTLAS and resets tlas to empty
+void freeTLAS(CPURaycastTLAS &tlas);
+
+// Renders pixels [pixel_offset, pixel_offset + num_pixels) of a view, in
+// row major order. rgb_out and depth_out point to the start of the
+// view's outputs, rgb_out is ignored in RenderMode::Depth.
+void renderPixels(const CPURaycastConfig &cfg,
+                  const CPURaycastWorld &world,
+                  const PerspectiveCameraData &view,
+                  uint32_t pixel_offset,
+                  uint32_t num_pixels,
+                  uint8_t *rgb_out,
+                  float *depth_out);
+
+}
+
+}
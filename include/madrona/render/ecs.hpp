@@ -179,10 +179,15 @@ struct RaycastOutputArchetype : public Archetype<
 > {};
 
 struct RenderECSBridge;
+struct CPURaycastConfig;
 
 namespace RenderingSystem {
+    // raycast_cfg enables the CPU raytracer (see cpu_raycast.hpp) and is
+    // ignored on the GPU backend. registerTypes sizes the raycast outputs
+    // from it, so each world's init must get the same config.
     void registerTypes(ECSRegistry &registry,
-                       const RenderECSBridge *bridge);
+                       const RenderECSBridge *bridge,
+                       const CPURaycastConfig *raycast_cfg = nullptr);
 
     TaskGraphNodeID setupTasks(
         TaskGraphBuilder &builder,
@@ -190,7 +195,12 @@ namespace RenderingSystem {
         bool update_visual_properties = false);
 
     void init(Context &ctx,
-              const RenderECSBridge *bridge);
+              const RenderECSBridge *bridge,
+              const CPURaycastConfig *raycast_cfg = nullptr);
+
+    // Frees the world's CPU raytracer state. Call when tearing down the
+    // world, e.g. from the WorldT destructor (its Context outlives it).
+    void shutdown(Context &ctx);
 
     uint32_t * getVoxelPtr(Context &ctx);
 
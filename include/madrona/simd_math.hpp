@@ -0,0 +1,252 @@
+#pragma once
+
+#include <madrona/math.hpp>
+
+// Structure of arrays versions of the math.hpp types for systems that
+// process many rows at once. Every value holds FloatN::width lanes, one
+// per row, and lane i of each operation matches the scalar math.hpp
+// operation on row i.
+//
+// The lane width follows the target ISA: 16 with AVX-512, 8 with AVX / AVX2,
+// 4 with SSE or NEON and 1 (plain floats) otherwise. Define
+// MADRONA_SIMD_FORCE_SCALAR to use the scalar fallback everywhere. CPU
+// only, GPU code is already one row per thread.
+
+#ifdef MADRONA_GPU_MODE
+#error "simd_math.hpp is not supported on the GPU"
+#endif
+
+#if defined(MADRONA_SIMD_FORCE_SCALAR)
+#define MADRONA_SIMD_SCALAR (1)
+#elif defined(MADRONA_X64)
+#include <immintrin.h>
+#if defined(__AVX512F__)
+#define MADRONA_SIMD_AVX512 (1)
+#elif defined(__AVX__)
+#define MADRONA_SIMD_AVX (1)
+#else
+#define MADRONA_SIMD_SSE (1)
+#endif
+#elif defined(MADRONA_ARM) && (defined(__ARM_NEON) || defined(_M_ARM64))
+#define MADRONA_SIMD_NEON (1)
+#include <arm_neon.h>
+#else
+#define MADRONA_SIMD_SCALAR (1)
+#endif
+
+namespace madrona::math {
+
+// Per lane booleans, produced by comparisons
+struct MaskN {
+#if defined(MADRONA_SIMD_AVX512)
+    __mmask16 m;
+#elif defined(MADRONA_SIMD_AVX)
+    __m256 m;
+#elif defined(MADRONA_SIMD_SSE)
+    __m128 m;
+#elif defined(MADRONA_SIMD_NEON)
+    uint32x4_t m;
+#else
+    bool m;
+#endif
+
+    // Bit i is set if lane i is true
+    inline uint32_t bits() const;
+    inline bool any() const;
+    inline bool all() const;
+
+    // Lanes < num_lanes are true
+    static inline MaskN firstLanes(CountT num_lanes);
+
+    friend inline MaskN operator&(MaskN a, MaskN b);
+    friend inline MaskN operator|(MaskN a, MaskN b);
+    friend inline MaskN operator~(MaskN a);
+};
+
+struct FloatN {
+#if defined(MADRONA_SIMD_AVX512)
+    static constexpr inline CountT width = 16;
+    __m512 v;
+#elif defined(MADRONA_SIMD_AVX)
+    static constexpr inline CountT width = 8;
+    __m256 v;
+#elif defined(MADRONA_SIMD_SSE)
+    static constexpr inline CountT width = 4;
+    __m128 v;
+#elif defined(MADRONA_SIMD_NEON)
+    static constexpr inline CountT width = 4;
+    float32x4_t v;
+#else
+    static constexpr inline CountT width = 1;
+    float v;
+#endif
+
+    static inline FloatN splat(float f);
+    static inline FloatN zero();
+
+    // Unaligned loads / stores of width consecutive floats
+    static inline FloatN load(const float *ptr);
+    inline void store(float *ptr) const;
+
+    // Only touch the first num_lanes floats, the other lanes are fill
+    static inline FloatN loadPartial(const float *ptr, CountT num_lanes,
+                                     float fill = 0.f);
+    inline void storePartial(float *ptr, CountT num_lanes) const;
+
+    inline float operator[](CountT lane) const;
+
+    inline FloatN & operator+=(FloatN o);
+    inline FloatN & operator-=(FloatN o);
+    inline FloatN & operator*=(FloatN o);
+    inline FloatN & operator/=(FloatN o);
+
+    friend inline FloatN operator+(FloatN a, FloatN b);
+    friend inline FloatN operator-(FloatN a, FloatN b);
+    friend inline FloatN operator*(FloatN a, FloatN b);
+    friend inline FloatN operator/(FloatN a, FloatN b);
+    friend inline FloatN operator-(FloatN a);
+
+    friend inline FloatN operator+(FloatN a, float b);
+    friend inline FloatN operator-(FloatN a, float b);
+    friend inline FloatN operator*(FloatN a, float b);
+    friend inline FloatN operator*(float a, FloatN b);
+    friend inline FloatN operator/(FloatN a, float b);
+
+    friend inline MaskN operator<(FloatN a, FloatN b);
+    friend inline MaskN operator<=(FloatN a, FloatN b);
+    friend inline MaskN operator>(FloatN a, FloatN b);
+    friend inline MaskN operator>=(FloatN a, FloatN b);
+    friend inline MaskN operator==(FloatN a, FloatN b);
+    friend inline MaskN operator!=(FloatN a, FloatN b);
+};
+
+inline FloatN min(FloatN a, FloatN b);
+inline FloatN max(FloatN a, FloatN b);
+inline FloatN abs(FloatN a);
+inline FloatN sqrt(FloatN a);
+// a * b + c, fused where the ISA has FMA
+inline FloatN fmadd(FloatN a, FloatN b, FloatN c);
+// Lanes where mask is set come from a, the others from b
+inline FloatN select(MaskN mask, FloatN a, FloatN b);
+
+struct Vector3N {
+    FloatN x;
+    FloatN y;
+    FloatN z;
+
+    static inline Vector3N splat(Vector3 v);
+    static inline Vector3N zero();
+
+    // Transposes rows of Vector3s (e.g. a Position column) to and from
+    // SoA. Lanes >= num_lanes are zero when loading and not written when
+    // storing.
+    static inline Vector3N loadAoS(const Vector3 *ptr,
+                                   CountT num_lanes = FloatN::width);
+    static inline Vector3N loadAoS(const Diag3x3 *ptr,
+                                   CountT num_lanes = FloatN::width);
+    inline void storeAoS(Vector3 *ptr,
+                         CountT num_lanes = FloatN::width) const;
+
+    // Same as loadAoS / storeAoS for a Vector3 field of a larger struct,
+    // lane i is at (char *)ptr + i * stride
+    static inline Vector3N loadStrided(const Vector3 *ptr, CountT stride,
+                                       CountT num_lanes = FloatN::width);
+    inline void storeStrided(Vector3 *ptr, CountT stride,
+                             CountT num_lanes = FloatN::width) const;
+
+    inline Vector3 lane(CountT lane) const;
+
+    inline FloatN & operator[](CountT i);
+    inline FloatN operator[](CountT i) const;
+
+    inline FloatN dot(const Vector3N &o) const;
+    inline FloatN length2() const;
+    inline FloatN length() const;
+    inline Vector3N normalize() const;
+
+    inline Vector3N & operator+=(const Vector3N &o);
+    inline Vector3N & operator-=(const Vector3N &o);
+    inline Vector3N & operator*=(FloatN o);
+
+    friend inline Vector3N operator+(const Vector3N &a, const Vector3N &b);
+    friend inline Vector3N operator-(const Vector3N &a, const Vector3N &b);
+    friend inline Vector3N operator-(const Vector3N &a);
+    friend inline Vector3N operator*(const Vector3N &a, FloatN b);
+    friend inline Vector3N operator*(FloatN a, const Vector3N &b);
+    friend inline Vector3N operator/(const Vector3N &a, FloatN b);
+    friend inline Vector3N operator*(const Vector3N &a, float b);
+    friend inline Vector3N operator*(float a, const Vector3N &b);
+};
+
+inline FloatN dot(const Vector3N &a, const Vector3N &b);
+inline Vector3N cross(const Vector3N &a, const Vector3N &b);
+// Componentwise product, like multDiag / Diag3x3 * Vector3
+inline Vector3N mul(const Vector3N &a, const Vector3N &b);
+inline Vector3N min(const Vector3N &a, const Vector3N &b);
+inline Vector3N max(const Vector3N &a, const Vector3N &b);
+inline Vector3N select(MaskN mask, const Vector3N &a, const Vector3N &b);
+
+struct QuatN {
+    FloatN w;
+    FloatN x;
+    FloatN y;
+    FloatN z;
+
+    static inline QuatN splat(Quat q);
+    static inline QuatN identity();
+    static inline QuatN fromAngularVec(const Vector3N &v);
+
+    static inline QuatN loadAoS(const Quat *ptr,
+                                CountT num_lanes = FloatN::width);
+    inline void storeAoS(Quat *ptr, CountT num_lanes = FloatN::width) const;
+
+    static inline QuatN loadStrided(const Quat *ptr, CountT stride,
+                                    CountT num_lanes = FloatN::width);
+    inline void storeStrided(Quat *ptr, CountT stride,
+                             CountT num_lanes = FloatN::width) const;
+
+    inline Quat lane(CountT lane) const;
+
+    inline FloatN length2() const;
+    inline QuatN normalize() const;
+    inline QuatN inv() const;
+    inline Vector3N rotateVec(const Vector3N &v) const;
+
+    inline QuatN & operator+=(const QuatN &o);
+
+    friend inline QuatN operator+(const QuatN &a, const QuatN &b);
+    friend inline QuatN operator*(const QuatN &a, const QuatN &b);
+    friend inline QuatN operator*(const QuatN &a, FloatN b);
+    friend inline QuatN operator*(const QuatN &a, float b);
+};
+
+inline QuatN select(MaskN mask, const QuatN &a, const QuatN &b);
+
+// Rotation + nonuniform scale, column major like Mat3x3
+struct Mat3x3N {
+    Vector3N cols[3];
+
+    static inline Mat3x3N fromRS(const QuatN &r, const Vector3N &s);
+
+    inline Vector3N operator*(const Vector3N &v) const;
+};
+
+struct AABBN {
+    Vector3N pMin;
+    Vector3N pMax;
+
+    static inline AABBN loadAoS(const AABB *ptr,
+                                CountT num_lanes = FloatN::width);
+    inline void storeAoS(AABB *ptr, CountT num_lanes = FloatN::width) const;
+
+    // Same as AABB::applyTRS
+    inline AABBN applyTRS(const Vector3N &translation,
+                          const QuatN &rotation,
+                          const Vector3N &scale) const;
+
+    static inline AABBN merge(const AABBN &a, const AABBN &b);
+};
+
+}
+
+#include "simd_math.inl"
@@ -0,0 +1,1163 @@
+#include <algorithm>
+#include <cstring>
+
+namespace madrona::math {
+
+namespace simd_detail {
+
+#if defined(MADRONA_SIMD_SSE) || defined(MADRONA_SIMD_AVX) || \
+    defined(MADRONA_SIMD_AVX512)
+
+// x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3 -> x0 x1 x2 x3 | y.. | z..
+inline void deinterleave3x4(const float *ptr,
+                            __m128 *out_x, __m128 *out_y, __m128 *out_z)
+{
+    __m128 m0 = _mm_loadu_ps(ptr);
+    __m128 m1 = _mm_loadu_ps(ptr + 4);
+    __m128 m2 = _mm_loadu_ps(ptr + 8);
+
+    __m128 x23 = _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(1, 0, 3, 2));
+    *out_x = _mm_shuffle_ps(m0, x23, _MM_SHUFFLE(3, 0, 3, 0));
+
+    __m128 y01 = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(0, 0, 1, 1));
+    __m128 y23 = _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 2, 3, 3));
+    *out_y = _mm_shuffle_ps(y01, y23, _MM_SHUFFLE(2, 0, 2, 0));
+
+    __m128 z01 = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 1, 2, 2));
+    __m128 z23 = _mm_shuffle_ps(m2, m2, _MM_SHUFFLE(3, 3, 0, 0));
+    *out_z = _mm_shuffle_ps(z01, z23, _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+inline void interleave3x4(__m128 x, __m128 y, __m128 z, float *ptr)
+{
+    __m128 xy_lo = _mm_unpacklo_ps(x, y);
+    __m128 xy_hi = _mm_unpackhi_ps(x, y);
+
+    __m128 z0x1 = _mm_shuffle_ps(z, xy_lo, _MM_SHUFFLE(2, 2, 0, 0));
+    __m128 y1z1 = _mm_shuffle_ps(xy_lo, z, _MM_SHUFFLE(1, 1, 3, 3));
+    __m128 z2x3 = _mm_shuffle_ps(z, xy_hi, _MM_SHUFFLE(2, 2, 2, 2));
+    __m128 y3z3 = _mm_shuffle_ps(xy_hi, z, _MM_SHUFFLE(3, 3, 3, 3));
+
+    _mm_storeu_ps(ptr,
+        _mm_shuffle_ps(xy_lo, z0x1, _MM_SHUFFLE(2, 0, 1, 0)));
+    _mm_storeu_ps(ptr + 4,
+        _mm_shuffle_ps(y1z1, xy_hi, _MM_SHUFFLE(1, 0, 2, 0)));
+    _mm_storeu_ps(ptr + 8,
+        _mm_shuffle_ps(z2x3, y3z3, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+inline void deinterleave4x4(const float *ptr, __m128 *out_w, __m128 *out_x,
+                            __m128 *out_y, __m128 *out_z)
+{
+    __m128 r0 = _mm_loadu_ps(ptr);
+    __m128 r1 = _mm_loadu_ps(ptr + 4);
+    __m128 r2 = _mm_loadu_ps(ptr + 8);
+    __m128 r3 = _mm_loadu_ps(ptr + 12);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+    *out_w = r0;
+    *out_x = r1;
+    *out_y = r2;
+    *out_z = r3;
+}
+
+inline void interleave4x4(__m128 w, __m128 x, __m128 y, __m128 z, float *ptr)
+{
+    _MM_TRANSPOSE4_PS(w, x, y, z);
+    _mm_storeu_ps(ptr, w);
+    _mm_storeu_ps(ptr + 4, x);
+    _mm_storeu_ps(ptr + 8, y);
+    _mm_storeu_ps(ptr + 12, z);
+}
+
+// FloatN <-> groups of 4 lanes
+inline FloatN fromQuarters(const __m128 *q)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    __m512 v = _mm512_castps128_ps512(q[0]);
+    v = _mm512_insertf32x4(v, q[1], 1);
+    v = _mm512_insertf32x4(v, q[2], 2);
+    v = _mm512_insertf32x4(v, q[3], 3);
+    return FloatN { v };
+#elif defined(MADRONA_SIMD_AVX)
+    return FloatN { _mm256_insertf128_ps(_mm256_castps128_ps256(q[0]),
+                                         q[1], 1) };
+#else
+    return FloatN { q[0] };
+#endif
+}
+
+inline void toQuarters(FloatN f, __m128 *q)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    q[0] = _mm512_castps512_ps128(f.v);
+    q[1] = _mm512_extractf32x4_ps(f.v, 1);
+    q[2] = _mm512_extractf32x4_ps(f.v, 2);
+    q[3] = _mm512_extractf32x4_ps(f.v, 3);
+#elif defined(MADRONA_SIMD_AVX)
+    q[0] = _mm256_castps256_ps128(f.v);
+    q[1] = _mm256_extractf128_ps(f.v, 1);
+#else
+    q[0] = f.v;
+#endif
+}
+
+inline constexpr CountT numQuarters = FloatN::width / 4;
+
+#endif
+
+// Full width AoS loads / stores of num_components floats per lane
+inline void deinterleave(const float *ptr, CountT num_components,
+                         FloatN *out)
+{
+#if defined(MADRONA_SIMD_SSE) || defined(MADRONA_SIMD_AVX) || \
+    defined(MADRONA_SIMD_AVX512)
+    if (num_components == 3) {
+        __m128 x[numQuarters], y[numQuarters], z[numQuarters];
+        for (CountT i = 0; i < numQuarters; i++) {
+            deinterleave3x4(ptr + 12 * i, &x[i], &y[i], &z[i]);
+        }
+
+        out[0] = fromQuarters(x);
+        out[1] = fromQuarters(y);
+        out[2] = fromQuarters(z);
+        return;
+    } else if (num_components == 4) {
+        __m128 w[numQuarters], x[numQuarters], y[numQuarters],
+            z[numQuarters];
+        for (CountT i = 0; i < numQuarters; i++) {
+            deinterleave4x4(ptr + 16 * i, &w[i], &x[i], &y[i], &z[i]);
+        }
+
+        out[0] = fromQuarters(w);
+        out[1] = fromQuarters(x);
+        out[2] = fromQuarters(y);
+        out[3] = fromQuarters(z);
+        return;
+    }
+#elif defined(MADRONA_SIMD_NEON)
+    if (num_components == 3) {
+        float32x4x3_t v = vld3q_f32(ptr);
+        out[0] = FloatN { v.val[0] };
+        out[1] = FloatN { v.val[1] };
+        out[2] = FloatN { v.val[2] };
+        return;
+    } else if (num_components == 4) {
+        float32x4x4_t v = vld4q_f32(ptr);
+        out[0] = FloatN { v.val[0] };
+        out[1] = FloatN { v.val[1] };
+        out[2] = FloatN { v.val[2] };
+        out[3] = FloatN { v.val[3] };
+        return;
+    }
+#endif
+
+    for (CountT c = 0; c < num_components; c++) {
+        alignas(64) float lanes[FloatN::width];
+        for (CountT i = 0; i < FloatN::width; i++) {
+            lanes[i] = ptr[i * num_components + c];
+        }
+
+        out[c] = FloatN::load(lanes);
+    }
+}
+
+inline void interleave(const FloatN *in, CountT num_components, float *ptr)
+{
+#if defined(MADRONA_SIMD_SSE) || defined(MADRONA_SIMD_AVX) || \
+    defined(MADRONA_SIMD_AVX512)
+    if (num_components == 3) {
+        __m128 x[numQuarters], y[numQuarters], z[numQuarters];
+        toQuarters(in[0], x);
+        toQuarters(in[1], y);
+        toQuarters(in[2], z);
+
+        for (CountT i = 0; i < numQuarters; i++) {
+            interleave3x4(x[i], y[i], z[i], ptr + 12 * i);
+        }
+        return;
+    } else if (num_components == 4) {
+        __m128 w[numQuarters], x[numQuarters], y[numQuarters],
+            z[numQuarters];
+        toQuarters(in[0], w);
+        toQuarters(in[1], x);
+        toQuarters(in[2], y);
+        toQuarters(in[3], z);
+
+        for (CountT i = 0; i < numQuarters; i++) {
+            interleave4x4(w[i], x[i], y[i], z[i], ptr + 16 * i);
+        }
+        return;
+    }
+#elif defined(MADRONA_SIMD_NEON)
+    if (num_components == 3) {
+        vst3q_f32(ptr, float32x4x3_t {{ in[0].v, in[1].v, in[2].v }});
+        return;
+    } else if (num_components == 4) {
+        vst4q_f32(ptr,
+            float32x4x4_t {{ in[0].v, in[1].v, in[2].v, in[3].v }});
+        return;
+    }
+#endif
+
+    for (CountT c = 0; c < num_components; c++) {
+        alignas(64) float lanes[FloatN::width];
+        in[c].store(lanes);
+
+        for (CountT i = 0; i < FloatN::width; i++) {
+            ptr[i * num_components + c] = lanes[i];
+        }
+    }
+}
+
+// Partial loads / stores go through a full width staging buffer so the
+// transposes above never touch rows past num_lanes
+template <CountT num_components>
+inline void loadAoS(const void *ptr, CountT num_lanes, FloatN *out)
+{
+    if (num_lanes >= FloatN::width) {
+        deinterleave((const float *)ptr, num_components, out);
+        return;
+    }
+
+    alignas(64) float staging[num_components * FloatN::width] = {};
+    memcpy(staging, ptr, sizeof(float) * num_components * num_lanes);
+    deinterleave(staging, num_components, out);
+}
+
+template <CountT num_components>
+inline void storeAoS(const FloatN *in, CountT num_lanes, void *ptr)
+{
+    if (num_lanes >= FloatN::width) {
+        interleave(in, num_components, (float *)ptr);
+        return;
+    }
+
+    alignas(64) float staging[num_components * FloatN::width];
+    interleave(in, num_components, staging);
+    memcpy(ptr, staging, sizeof(float) * num_components * num_lanes);
+}
+
+template <CountT num_components>
+inline void loadStrided(const void *ptr, CountT stride, CountT num_lanes,
+                        FloatN *out)
+{
+    if (stride == sizeof(float) * num_components) {
+        loadAoS<num_components>(ptr, num_lanes, out);
+        return;
+    }
+
+    alignas(64) float staging[num_components * FloatN::width] = {};
+    for (CountT i = 0; i < std::min(num_lanes, FloatN::width); i++) {
+        memcpy(&staging[i * num_components], (const char *)ptr + i * stride,
+               sizeof(float) * num_components);
+    }
+    deinterleave(staging, num_components, out);
+}
+
+template <CountT num_components>
+inline void storeStrided(const FloatN *in, CountT stride, CountT num_lanes,
+                         void *ptr)
+{
+    if (stride == sizeof(float) * num_components) {
+        storeAoS<num_components>(in, num_lanes, ptr);
+        return;
+    }
+
+    alignas(64) float staging[num_components * FloatN::width];
+    interleave(in, num_components, staging);
+    for (CountT i = 0; i < std::min(num_lanes, FloatN::width); i++) {
+        memcpy((char *)ptr + i * stride, &staging[i * num_components],
+               sizeof(float) * num_components);
+    }
+}
+
+}
+
+uint32_t MaskN::bits() const
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return m;
+#elif defined(MADRONA_SIMD_AVX)
+    return (uint32_t)_mm256_movemask_ps(m);
+#elif defined(MADRONA_SIMD_SSE)
+    return (uint32_t)_mm_movemask_ps(m);
+#elif defined(MADRONA_SIMD_NEON)
+    const uint32x4_t lane_bits = { 1, 2, 4, 8 };
+    return vaddvq_u32(vandq_u32(m, lane_bits));
+#else
+    return m ? 1 : 0;
+#endif
+}
+
+bool MaskN::any() const
+{
+    return bits() != 0;
+}
+
+bool MaskN::all() const
+{
+    return bits() == (1u << FloatN::width) - 1u;
+}
+
+MaskN MaskN::firstLanes(CountT num_lanes)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return MaskN { num_lanes >= 16 ? (__mmask16)0xFFFF :
+        (__mmask16)((1u << num_lanes) - 1u) };
+#elif defined(MADRONA_SIMD_AVX)
+    return MaskN { _mm256_cmp_ps(
+        _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7),
+        _mm256_set1_ps((float)num_lanes), _CMP_LT_OQ) };
+#elif defined(MADRONA_SIMD_SSE)
+    return MaskN { _mm_cmplt_ps(_mm_setr_ps(0, 1, 2, 3),
+                                _mm_set1_ps((float)num_lanes)) };
+#elif defined(MADRONA_SIMD_NEON)
+    const uint32x4_t lane_idxs = { 0, 1, 2, 3 };
+    return MaskN { vcltq_u32(lane_idxs,
+        vdupq_n_u32((uint32_t)std::min(num_lanes, (CountT)4))) };
+#else
+    return MaskN { num_lanes > 0 };
+#endif
+}
+
+MaskN operator&(MaskN a, MaskN b)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return MaskN { (__mmask16)(a.m & b.m) };
+#elif defined(MADRONA_SIMD_AVX)
+    return MaskN { _mm256_and_ps(a.m, b.m) };
+#elif defined(MADRONA_SIMD_SSE)
+    return MaskN { _mm_and_ps(a.m, b.m) };
+#elif defined(MADRONA_SIMD_NEON)
+    return MaskN { vandq_u32(a.m, b.m) };
+#else
+    return MaskN { a.m && b.m };
+#endif
+}
+
+MaskN operator|(MaskN a, MaskN b)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return MaskN { (__mmask16)(a.m | b.m) };
+#elif defined(MADRONA_SIMD_AVX)
+    return MaskN { _mm256_or_ps(a.m, b.m) };
+#elif defined(MADRONA_SIMD_SSE)
+    return MaskN { _mm_or_ps(a.m, b.m) };
+#elif defined(MADRONA_SIMD_NEON)
+    return MaskN { vorrq_u32(a.m, b.m) };
+#else
+    return MaskN { a.m || b.m };
+#endif
+}
+
+MaskN operator~(MaskN a)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return MaskN { (__mmask16)~a.m };
+#elif defined(MADRONA_SIMD_AVX)
+    return MaskN { _mm256_xor_ps(a.m,
+        _mm256_castsi256_ps(_mm256_set1_epi32(-1))) };
+#elif defined(MADRONA_SIMD_SSE)
+    return MaskN { _mm_xor_ps(a.m, _mm_castsi128_ps(_mm_set1_epi32(-1))) };
+#elif defined(MADRONA_SIMD_NEON)
+    return MaskN { vmvnq_u32(a.m) };
+#else
+    return MaskN { !a.m };
+#endif
+}
+
+FloatN FloatN::splat(float f)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return FloatN { _mm512_set1_ps(f) };
+#elif defined(MADRONA_SIMD_AVX)
+    return FloatN { _mm256_set1_ps(f) };
+#elif defined(MADRONA_SIMD_SSE)
+    return FloatN { _mm_set1_ps(f) };
+#elif defined(MADRONA_SIMD_NEON)
+    return FloatN { vdupq_n_f32(f) };
+#else
+    return FloatN { f };
+#endif
+}
+
+FloatN FloatN::zero()
+{
+    return splat(0.f);
+}
+
+FloatN FloatN::load(const float *ptr)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return FloatN { _mm512_loadu_ps(ptr) };
+#elif defined(MADRONA_SIMD_AVX)
+    return FloatN { _mm256_loadu_ps(ptr) };
+#elif defined(MADRONA_SIMD_SSE)
+    return FloatN { _mm_loadu_ps(ptr) };
+#elif defined(MADRONA_SIMD_NEON)
+    return FloatN { vld1q_f32(ptr) };
+#else
+    return FloatN { *ptr };
+#endif
+}
+
+void FloatN::store(float *ptr) const
+{
+#if defined(MADRONA_SIMD_AVX512)
+    _mm512_storeu_ps(ptr, v);
+#elif defined(MADRONA_SIMD_AVX)
+    _mm256_storeu_ps(ptr, v);
+#elif defined(MADRONA_SIMD_SSE)
+    _mm_storeu_ps(ptr, v);
+#elif defined(MADRONA_SIMD_NEON)
+    vst1q_f32(ptr, v);
+#else
+    *ptr = v;
+#endif
+}
+
+FloatN FloatN::loadPartial(const float *ptr, CountT num_lanes, float fill)
+{
+    if (num_lanes >= width) {
+        return load(ptr);
+    }
+
+#if defined(MADRONA_SIMD_AVX512)
+    __mmask16 lanes = MaskN::firstLanes(num_lanes).m;
+    return FloatN { _mm512_mask_loadu_ps(_mm512_set1_ps(fill), lanes, ptr) };
+#else
+    alignas(64) float staging[width];
+    for (CountT i = 0; i < width; i++) {
+        staging[i] = i < num_lanes ? ptr[i] : fill;
+    }
+
+    return load(staging);
+#endif
+}
+
+void FloatN::storePartial(float *ptr, CountT num_lanes) const
+{
+    if (num_lanes >= width) {
+        store(ptr);
+        return;
+    }
+
+#if defined(MADRONA_SIMD_AVX512)
+    _mm512_mask_storeu_ps(ptr, MaskN::firstLanes(num_lanes).m, v);
+#else
+    alignas(64) float staging[width];
+    store(staging);
+    for (CountT i = 0; i < num_lanes; i++) {
+        ptr[i] = staging[i];
+    }
+#endif
+}
+
+float FloatN::operator[](CountT lane) const
+{
+    alignas(64) float staging[width];
+    store(staging);
+
+    return staging[lane];
+}
+
+FloatN & FloatN::operator+=(FloatN o)
+{
+    return *this = *this + o;
+}
+
+FloatN & FloatN::operator-=(FloatN o)
+{
+    return *this = *this - o;
+}
+
+FloatN & FloatN::operator*=(FloatN o)
+{
+    return *this = *this * o;
+}
+
+FloatN & FloatN::operator/=(FloatN o)
+{
+    return *this = *this / o;
+}
+
+FloatN operator+(FloatN a, FloatN b)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return FloatN { _mm512_add_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_AVX)
+    return FloatN { _mm256_add_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_SSE)
+    return FloatN { _mm_add_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_NEON)
+    return FloatN { vaddq_f32(a.v, b.v) };
+#else
+    return FloatN { a.v + b.v };
+#endif
+}
+
+FloatN operator-(FloatN a, FloatN b)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return FloatN { _mm512_sub_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_AVX)
+    return FloatN { _mm256_sub_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_SSE)
+    return FloatN { _mm_sub_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_NEON)
+    return FloatN { vsubq_f32(a.v, b.v) };
+#else
+    return FloatN { a.v - b.v };
+#endif
+}
+
+FloatN operator*(FloatN a, FloatN b)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return FloatN { _mm512_mul_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_AVX)
+    return FloatN { _mm256_mul_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_SSE)
+    return FloatN { _mm_mul_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_NEON)
+    return FloatN { vmulq_f32(a.v, b.v) };
+#else
+    return FloatN { a.v * b.v };
+#endif
+}
+
+FloatN operator/(FloatN a, FloatN b)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return FloatN { _mm512_div_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_AVX)
+    return FloatN { _mm256_div_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_SSE)
+    return FloatN { _mm_div_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_NEON)
+    return FloatN { vdivq_f32(a.v, b.v) };
+#else
+    return FloatN { a.v / b.v };
+#endif
+}
+
+FloatN operator-(FloatN a)
+{
+    return FloatN::splat(-0.f) - a;
+}
+
+FloatN operator+(FloatN a, float b)
+{
+    return a + FloatN::splat(b);
+}
+
+FloatN operator-(FloatN a, float b)
+{
+    return a - FloatN::splat(b);
+}
+
+FloatN operator*(FloatN a, float b)
+{
+    return a * FloatN::splat(b);
+}
+
+FloatN operator*(float a, FloatN b)
+{
+    return FloatN::splat(a) * b;
+}
+
+FloatN operator/(FloatN a, float b)
+{
+    return a / FloatN::splat(b);
+}
+
+// Comparisons are ordered (false for NaN) except for !=, like C++
+#if defined(MADRONA_SIMD_AVX512)
+#define MADRONA_SIMD_CMP(op, avx_pred, sse_fn, neon_fn)              \
+    MaskN operator op(FloatN a, FloatN b)                           \
+    {                                                               \
+        return MaskN { _mm512_cmp_ps_mask(a.v, b.v, avx_pred) };    \
+    }
+#elif defined(MADRONA_SIMD_AVX)
+#define MADRONA_SIMD_CMP(op, avx_pred, sse_fn, neon_fn)              \
+    MaskN operator op(FloatN a, FloatN b)                           \
+    {                                                               \
+        return MaskN { _mm256_cmp_ps(a.v, b.v, avx_pred) };         \
+    }
+#elif defined(MADRONA_SIMD_SSE)
+#define MADRONA_SIMD_CMP(op, avx_pred, sse_fn, neon_fn)              \
+    MaskN operator op(FloatN a, FloatN b)                           \
+    {                                                               \
+        return MaskN { sse_fn(a.v, b.v) };                          \
+    }
+#elif defined(MADRONA_SIMD_NEON)
+#define MADRONA_SIMD_CMP(op, avx_pred, sse_fn, neon_fn)              \
+    MaskN operator op(FloatN a, FloatN b)                           \
+    {                                                               \
+        return MaskN { neon_fn(a.v, b.v) };                         \
+    }
+#else
+#define MADRONA_SIMD_CMP(op, avx_pred, sse_fn, neon_fn)              \
+    MaskN operator op(FloatN a, FloatN b)                           \
+    {                                                               \
+        return MaskN { a.v op b.v };                                \
+    }
+#endif
+
+MADRONA_SIMD_CMP(<, _CMP_LT_OQ, _mm_cmplt_ps, vcltq_f32)
+MADRONA_SIMD_CMP(<=, _CMP_LE_OQ, _mm_cmple_ps, vcleq_f32)
+MADRONA_SIMD_CMP(>, _CMP_GT_OQ, _mm_cmpgt_ps, vcgtq_f32)
+MADRONA_SIMD_CMP(>=, _CMP_GE_OQ, _mm_cmpge_ps, vcgeq_f32)
+MADRONA_SIMD_CMP(==, _CMP_EQ_OQ, _mm_cmpeq_ps, vceqq_f32)
+
+#undef MADRONA_SIMD_CMP
+
+MaskN operator!=(FloatN a, FloatN b)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return MaskN { _mm512_cmp_ps_mask(a.v, b.v, _CMP_NEQ_UQ) };
+#elif defined(MADRONA_SIMD_AVX)
+    return MaskN { _mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ) };
+#elif defined(MADRONA_SIMD_SSE)
+    return MaskN { _mm_cmpneq_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_NEON)
+    return MaskN { vmvnq_u32(vceqq_f32(a.v, b.v)) };
+#else
+    return MaskN { a.v != b.v };
+#endif
+}
+
+FloatN min(FloatN a, FloatN b)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return FloatN { _mm512_min_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_AVX)
+    return FloatN { _mm256_min_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_SSE)
+    return FloatN { _mm_min_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_NEON)
+    return FloatN { vminq_f32(a.v, b.v) };
+#else
+    return FloatN { fminf(a.v, b.v) };
+#endif
+}
+
+FloatN max(FloatN a, FloatN b)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return FloatN { _mm512_max_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_AVX)
+    return FloatN { _mm256_max_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_SSE)
+    return FloatN { _mm_max_ps(a.v, b.v) };
+#elif defined(MADRONA_SIMD_NEON)
+    return FloatN { vmaxq_f32(a.v, b.v) };
+#else
+    return FloatN { fmaxf(a.v, b.v) };
+#endif
+}
+
+FloatN abs(FloatN a)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return FloatN { _mm512_abs_ps(a.v) };
+#elif defined(MADRONA_SIMD_AVX)
+    return FloatN { _mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v) };
+#elif defined(MADRONA_SIMD_SSE)
+    return FloatN { _mm_andnot_ps(_mm_set1_ps(-0.f), a.v) };
+#elif defined(MADRONA_SIMD_NEON)
+    return FloatN { vabsq_f32(a.v) };
+#else
+    return FloatN { fabsf(a.v) };
+#endif
+}
+
+FloatN sqrt(FloatN a)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return FloatN { _mm512_sqrt_ps(a.v) };
+#elif defined(MADRONA_SIMD_AVX)
+    return FloatN { _mm256_sqrt_ps(a.v) };
+#elif defined(MADRONA_SIMD_SSE)
+    return FloatN { _mm_sqrt_ps(a.v) };
+#elif defined(MADRONA_SIMD_NEON)
+    return FloatN { vsqrtq_f32(a.v) };
+#else
+    return FloatN { sqrtf(a.v) };
+#endif
+}
+
+FloatN fmadd(FloatN a, FloatN b, FloatN c)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return FloatN { _mm512_fmadd_ps(a.v, b.v, c.v) };
+#elif defined(MADRONA_SIMD_AVX) && defined(__FMA__)
+    return FloatN { _mm256_fmadd_ps(a.v, b.v, c.v) };
+#elif defined(MADRONA_SIMD_SSE) && defined(__FMA__)
+    return FloatN { _mm_fmadd_ps(a.v, b.v, c.v) };
+#elif defined(MADRONA_SIMD_NEON)
+    return FloatN { vfmaq_f32(c.v, a.v, b.v) };
+#else
+    return a * b + c;
+#endif
+}
+
+FloatN select(MaskN mask, FloatN a, FloatN b)
+{
+#if defined(MADRONA_SIMD_AVX512)
+    return FloatN { _mm512_mask_blend_ps(mask.m, b.v, a.v) };
+#elif defined(MADRONA_SIMD_AVX)
+    return FloatN { _mm256_blendv_ps(b.v, a.v, mask.m) };
+#elif defined(MADRONA_SIMD_SSE) && defined(__SSE4_1__)
+    return FloatN { _mm_blendv_ps(b.v, a.v, mask.m) };
+#elif defined(MADRONA_SIMD_SSE)
+    return FloatN { _mm_or_ps(_mm_and_ps(mask.m, a.v),
+                              _mm_andnot_ps(mask.m, b.v)) };
+#elif defined(MADRONA_SIMD_NEON)
+    return FloatN { vbslq_f32(mask.m, a.v, b.v) };
+#else
+    return mask.m ? a : b;
+#endif
+}
+
+Vector3N Vector3N::splat(Vector3 v)
+{
+    return Vector3N {
+        FloatN::splat(v.x),
+        FloatN::splat(v.y),
+        FloatN::splat(v.z),
+    };
+}
+
+Vector3N Vector3N::zero()
+{
+    return splat(Vector3::zero());
+}
+
+Vector3N Vector3N::loadAoS(const Vector3 *ptr, CountT num_lanes)
+{
+    static_assert(sizeof(Vector3) == 3 * sizeof(float));
+
+    FloatN c[3];
+    simd_detail::loadAoS<3>(ptr, num_lanes, c);
+
+    return Vector3N { c[0], c[1], c[2] };
+}
+
+Vector3N Vector3N::loadAoS(const Diag3x3 *ptr, CountT num_lanes)
+{
+    static_assert(sizeof(Diag3x3) == 3 * sizeof(float));
+
+    FloatN c[3];
+    simd_detail::loadAoS<3>(ptr, num_lanes, c);
+
+    return Vector3N { c[0], c[1], c[2] };
+}
+
+void Vector3N::storeAoS(Vector3 *ptr, CountT num_lanes) const
+{
+    const FloatN c[3] { x, y, z };
+    simd_detail::storeAoS<3>(c, num_lanes, ptr);
+}
+
+Vector3N Vector3N::loadStrided(const Vector3 *ptr, CountT stride,
+                               CountT num_lanes)
+{
+    FloatN c[3];
+    simd_detail::loadStrided<3>(ptr, stride, num_lanes, c);
+
+    return Vector3N { c[0], c[1], c[2] };
+}
+
+void Vector3N::storeStrided(Vector3 *ptr, CountT stride,
+                            CountT num_lanes) const
+{
+    const FloatN c[3] { x, y, z };
+    simd_detail::storeStrided<3>(c, stride, num_lanes, ptr);
+}
+
+Vector3 Vector3N::lane(CountT lane) const
+{
+    return Vector3 { x[lane], y[lane], z[lane] };
+}
+
+FloatN & Vector3N::operator[](CountT i)
+{
+    switch (i) {
+        case 0:
+            return x;
+        case 1:
+            return y;
+        case 2:
+            return z;
+        default:
+            MADRONA_UNREACHABLE();
+    }
+}
+
+FloatN Vector3N::operator[](CountT i) const
+{
+    switch (i) {
+        case 0:
+            return x;
+        case 1:
+            return y;
+        case 2:
+            return z;
+        default:
+            MADRONA_UNREACHABLE();
+    }
+}
+
+FloatN Vector3N::dot(const Vector3N &o) const
+{
+    return x * o.x + y * o.y + z * o.z;
+}
+
+FloatN Vector3N::length2() const
+{
+    return dot(*this);
+}
+
+FloatN Vector3N::length() const
+{
+    return sqrt(length2());
+}
+
+Vector3N Vector3N::normalize() const
+{
+    return *this * (FloatN::splat(1.f) / length());
+}
+
+Vector3N & Vector3N::operator+=(const Vector3N &o)
+{
+    x += o.x;
+    y += o.y;
+    z += o.z;
+
+    return *this;
+}
+
+Vector3N & Vector3N::operator-=(const Vector3N &o)
+{
+    x -= o.x;
+    y -= o.y;
+    z -= o.z;
+
+    return *this;
+}
+
+Vector3N & Vector3N::operator*=(FloatN o)
+{
+    x *= o;
+    y *= o;
+    z *= o;
+
+    return *this;
+}
+
+Vector3N operator+(const Vector3N &a, const Vector3N &b)
+{
+    return Vector3N { a.x + b.x, a.y + b.y, a.z + b.z };
+}
+
+Vector3N operator-(const Vector3N &a, const Vector3N &b)
+{
+    return Vector3N { a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+Vector3N operator-(const Vector3N &a)
+{
+    return Vector3N { -a.x, -a.y, -a.z };
+}
+
+Vector3N operator*(const Vector3N &a, FloatN b)
+{
+    return Vector3N { a.x * b, a.y * b, a.z * b };
+}
+
+Vector3N operator*(FloatN a, const Vector3N &b)
+{
+    return b * a;
+}
+
+Vector3N operator/(const Vector3N &a, FloatN b)
+{
+    return Vector3N { a.x / b, a.y / b, a.z / b };
+}
+
+Vector3N operator*(const Vector3N &a, float b)
+{
+    return a * FloatN::splat(b);
+}
+
+Vector3N operator*(float a, const Vector3N &b)
+{
+    return b * FloatN::splat(a);
+}
+
+FloatN dot(const Vector3N &a, const Vector3N &b)
+{
+    return a.dot(b);
+}
+
+Vector3N cross(const Vector3N &a, const Vector3N &b)
+{
+    return Vector3N {
+        a.y * b.z - a.z * b.y,
+        a.z * b.x - a.x * b.z,
+        a.x * b.y - a.y * b.x,
+    };
+}
+
+Vector3N mul(const Vector3N &a, const Vector3N &b)
+{
+    return Vector3N { a.x * b.x, a.y * b.y, a.z * b.z };
+}
+
+Vector3N min(const Vector3N &a, const Vector3N &b)
+{
+    return Vector3N { min(a.x, b.x), min(a.y, b.y), min(a.z, b.z) };
+}
+
+Vector3N max(const Vector3N &a, const Vector3N &b)
+{
+    return Vector3N { max(a.x, b.x), max(a.y, b.y), max(a.z, b.z) };
+}
+
+Vector3N select(MaskN mask, const Vector3N &a, const Vector3N &b)
+{
+    return Vector3N {
+        select(mask, a.x, b.x),
+        select(mask, a.y, b.y),
+        select(mask, a.z, b.z),
+    };
+}
+
+QuatN QuatN::splat(Quat q)
+{
+    return QuatN {
+        FloatN::splat(q.w),
+        FloatN::splat(q.x),
+        FloatN::splat(q.y),
+        FloatN::splat(q.z),
+    };
+}
+
+QuatN QuatN::identity()
+{
+    return splat(Quat { 1, 0, 0, 0 });
+}
+
+QuatN QuatN::fromAngularVec(const Vector3N &v)
+{
+    return QuatN { FloatN::zero(), v.x, v.y, v.z };
+}
+
+QuatN QuatN::loadAoS(const Quat *ptr, CountT num_lanes)
+{
+    static_assert(sizeof(Quat) == 4 * sizeof(float));
+
+    FloatN c[4];
+    simd_detail::loadAoS<4>(ptr, num_lanes, c);
+
+    return QuatN { c[0], c[1], c[2], c[3] };
+}
+
+void QuatN::storeAoS(Quat *ptr, CountT num_lanes) const
+{
+    const FloatN c[4] { w, x, y, z };
+    simd_detail::storeAoS<4>(c, num_lanes, ptr);
+}
+
+QuatN QuatN::loadStrided(const Quat *ptr, CountT stride, CountT num_lanes)
+{
+    FloatN c[4];
+    simd_detail::loadStrided<4>(ptr, stride, num_lanes, c);
+
+    return QuatN { c[0], c[1], c[2], c[3] };
+}
+
+void QuatN::storeStrided(Quat *ptr, CountT stride, CountT num_lanes) const
+{
+    const FloatN c[4] { w, x, y, z };
+    simd_detail::storeStrided<4>(c, stride, num_lanes, ptr);
+}
+
+Quat QuatN::lane(CountT lane) const
+{
+    return Quat { w[lane], x[lane], y[lane], z[lane] };
+}
+
+FloatN QuatN::length2() const
+{
+    return w * w + x * x + y * y + z * z;
+}
+
+QuatN QuatN::normalize() const
+{
+    FloatN inv_length = FloatN::splat(1.f) / sqrt(length2());
+
+    return QuatN {
+        w * inv_length,
+        x * inv_length,
+        y * inv_length,
+        z * inv_length,
+    };
+}
+
+QuatN QuatN::inv() const
+{
+    return QuatN { w, -x, -y, -z };
+}
+
+Vector3N QuatN::rotateVec(const Vector3N &v) const
+{
+    Vector3N pure { x, y, z };
+
+    Vector3N pure_x_v = cross(pure, v);
+    Vector3N pure_x_pure_x_v = cross(pure, pure_x_v);
+
+    return v + 2.f * (pure_x_v * w + pure_x_pure_x_v);
+}
+
+QuatN & QuatN::operator+=(const QuatN &o)
+{
+    w += o.w;
+    x += o.x;
+    y += o.y;
+    z += o.z;
+
+    return *this;
+}
+
+QuatN operator+(const QuatN &a, const QuatN &b)
+{
+    return QuatN { a.w + b.w, a.x + b.x, a.y + b.y, a.z + b.z };
+}
+
+QuatN operator*(const QuatN &a, const QuatN &b)
+{
+    return QuatN {
+        (a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z),
+        (a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y),
+        (a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x),
+        (a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w),
+    };
+}
+
+QuatN operator*(const QuatN &a, FloatN b)
+{
+    return QuatN { a.w * b, a.x * b, a.y * b, a.z * b };
+}
+
+QuatN operator*(const QuatN &a, float b)
+{
+    return a * FloatN::splat(b);
+}
+
+QuatN select(MaskN mask, const QuatN &a, const QuatN &b)
+{
+    return QuatN {
+        select(mask, a.w, b.w),
+        select(mask, a.x, b.x),
+        select(mask, a.y, b.y),
+        select(mask, a.z, b.z),
+    };
+}
+
+Mat3x3N Mat3x3N::fromRS(const QuatN &r, const Vector3N &s)
+{
+    FloatN x2 = r.x * r.x;
+    FloatN y2 = r.y * r.y;
+    FloatN z2 = r.z * r.z;
+    FloatN xz = r.x * r.z;
+    FloatN xy = r.x * r.y;
+    FloatN yz = r.y * r.z;
+    FloatN wx = r.w * r.x;
+    FloatN wy = r.w * r.y;
+    FloatN wz = r.w * r.z;
+
+    Vector3N ds = 2.f * s;
+
+    return Mat3x3N {{
+        {
+            s.x - ds.x * (y2 + z2),
+            ds.x * (xy + wz),
+            ds.x * (xz - wy),
+        },
+        {
+            ds.y * (xy - wz),
+            s.y - ds.y * (x2 + z2),
+            ds.y * (yz + wx),
+        },
+        {
+            ds.z * (xz + wy),
+            ds.z * (yz - wx),
+            s.z - ds.z * (x2 + y2),
+        },
+    }};
+}
+
+Vector3N Mat3x3N::operator*(const Vector3N &v) const
+{
+    return cols[0] * v.x + cols[1] * v.y + cols[2] * v.z;
+}
+
+AABBN AABBN::loadAoS(const AABB *ptr, CountT num_lanes)
+{
+    static_assert(sizeof(AABB) == 6 * sizeof(float));
+
+    FloatN c[6];
+    simd_detail::loadAoS<6>(ptr, num_lanes, c);
+
+    return AABBN {
+        { c[0], c[1], c[2] },
+        { c[3], c[4], c[5] },
+    };
+}
+
+void AABBN::storeAoS(AABB *ptr, CountT num_lanes) const
+{
+    const FloatN c[6] {
+        pMin.x, pMin.y, pMin.z,
+        pMax.x, pMax.y, pMax.z,
+    };
+    simd_detail::storeAoS<6>(c, num_lanes, ptr);
+}
+
+AABBN AABBN::applyTRS(const Vector3N &translation,
+                      const QuatN &rotation,
+                      const Vector3N &scale) const
+{
+    Mat3x3N rot_mat = Mat3x3N::fromRS(rotation, scale);
+
+    // RTCD page 86, the e < f branch becomes a min / max per term
+    AABBN txfmed { translation, translation };
+
+MADRONA_UNROLL
+    for (CountT i = 0; i < 3; i++) {
+MADRONA_UNROLL
+        for (CountT j = 0; j < 3; j++) {
+            // Flipped because rot_mat is column major
+            FloatN e = rot_mat.cols[j][i] * pMin[j];
+            FloatN f = rot_mat.cols[j][i] * pMax[j];
+
+            txfmed.pMin[i] += min(e, f);
+            txfmed.pMax[i] += max(e, f);
+        }
+    }
+
+    return txfmed;
+}
+
+AABBN AABBN::merge(const AABBN &a, const AABBN &b)
+{
+    return AABBN {
+        min(a.pMin, b.pMin),
+        max(a.pMax, b.pMax),
+    };
+}
+
+}
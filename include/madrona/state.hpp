@@ -93,10 +93,24 @@ friend class StateManager;
 };
 
 
+#ifdef MADRONA_MW_MODE
+// Location of one world's rows in the exported columns of an archetype.
+// offset is 64 bit since zero copy exports space worlds
+// zeroCopyMaxRowsPerWorld rows apart, which passes INT32_MAX at 2048
+// worlds.
+struct ExportedRowRange {
+    int64_t offset;
+    int32_t numRows;
+};
+#endif
+
 class StateManager {
 public:
 #ifdef MADRONA_MW_MODE
     StateManager(CountT num_worlds);
+
+    // Per world row limit of ArchetypeFlags::ZeroCopyExport archetypes
+    static constexpr CountT zeroCopyMaxRowsPerWorld = 1 << 20;
 #else
     StateManager();
 #endif
@@ -120,7 +134,7 @@ public:
     void registerBundleAlias();
 
     template <typename ArchetypeT, typename ComponentT>
-    ComponentT * exportColumn();
+    ComponentT * exportColumn(ExportFlags flags = ExportFlags::ReadWrite);
 
     template <typename SingletonT>
     SingletonT * exportSingleton();
@@ -128,6 +142,24 @@ public:
     void copyInExportedColumns();
     void copyOutExportedColumns();
 
+#ifdef MADRONA_MW_MODE
+    // One ExportedRowRange per world for ArchetypeT, updated by
+    // prepareCopyOut()
+    template <typename ArchetypeT>
+    ExportedRowRange * exportRowRanges();
+
+    // Per world versions of the above, so the copies can be spread across
+    // threads. Different worlds can be copied concurrently, but
+    // prepareCopyOut() must be called once after each step and before
+    // copyOutExportedColumns(world_id), since it lays out every world's
+    // rows in the export buffers (and updates the exported row ranges).
+    bool hasCopyInColumns() const;
+    bool hasCopyOutColumns() const;
+    void copyInExportedColumns(uint32_t world_id);
+    void prepareCopyOut();
+    void copyOutExportedColumns(uint32_t world_id);
+#endif
+
     template <typename SingletonT>
     SingletonT & getSingleton(MADRONA_MW_COND(uint32_t world_id));
 
@@ -171,6 +203,30 @@ public:
     inline void iterateQuery(MADRONA_MW_COND(uint32_t world_id,)
                                 const Query<ComponentTs...> &query, Fn &&fn);
 
+    // Total number of rows across all archetypes matching query
+    template <typename... ComponentTs>
+    inline CountT numMatchingEntities(MADRONA_MW_COND(uint32_t world_id,)
+                                      const Query<ComponentTs...> &query);
+
+    // Same as iterateQuery, but only visits the rows in
+    // [offset, offset + num_rows) of the concatenation of all matching
+    // archetypes' tables. Used to split one query across threads.
+    template <typename... ComponentTs, typename Fn>
+    inline void iterateQueryRange(MADRONA_MW_COND(uint32_t world_id,)
+                                  const Query<ComponentTs...> &query,
+                                  CountT offset, CountT num_rows, Fn &&fn);
+
+    // Column level version of iterateQueryRange: calls
+    // fn(num_rows, ComponentTs *...) once for the part of each matching
+    // archetype that overlaps [offset, offset + num_rows), with the
+    // pointers starting at the first overlapping row. Archetypes with no
+    // overlapping rows are skipped.
+    template <typename... ComponentTs, typename Fn>
+    inline void iterateArchetypesRange(MADRONA_MW_COND(uint32_t world_id,)
+                                       const Query<ComponentTs...> &query,
+                                       CountT offset, CountT num_rows,
+                                       Fn &&fn);
+
     Transaction makeTransaction();
     void commitTransaction(Transaction &&txn);
 
@@ -205,6 +261,16 @@ public:
     inline void clear(MADRONA_MW_COND(uint32_t world_id,) StateCache &cache,
                       bool is_temporary);
 
+    // Reorders the rows of ArchetypeT in world_id so ComponentT, read as an
+    // unsigned 32 bit key, is ascending. Entity locations are updated to
+    // match. Sorting by WorldID is a no-op: tables are already per world.
+    template <typename ArchetypeT, typename ComponentT>
+    inline void sortArchetype(MADRONA_MW_COND(uint32_t world_id));
+
+    void sortArchetype(MADRONA_MW_COND(uint32_t world_id,)
+                       uint32_t archetype_id,
+                       uint32_t component_id);
+
 #ifdef MADRONA_MW_MODE
     inline uint32_t numWorlds() const;
 #endif
@@ -234,10 +300,17 @@ private:
             Fixed fixed;
         };
         CountT maxNumPerWorld;
+        // Memory of each column of tbls, shared by all worlds with one
+        // slot per world. Empty for fixed size archetypes.
+        HeapArray<VirtualRegion> columnRegions;
+        // ArchetypeFlags::ZeroCopyExport: the slots are
+        // zeroCopyMaxRowsPerWorld rows apart and exported in place.
+        bool zeroCopy;
 
         inline TableStorage(Span<TypeInfo> types,
                             CountT num_worlds,
-                            CountT max_num_per_world);
+                            CountT max_num_per_world,
+                            ArchetypeFlags archetype_flags);
         ~TableStorage();
 #else
         inline TableStorage(Span<TypeInfo> types);
@@ -284,10 +357,20 @@ private:
         uint32_t archetypeIdx;
         uint32_t columnIdx;
         uint32_t numBytesPerRow;
+        ExportFlags flags;
 
         uint32_t numMappedChunks;
 
         VirtualRegion mem;
+
+        // Offset of each world's first row in mem, plus the total
+        // number of rows. Updated by prepareCopyOut().
+        HeapArray<uint32_t> worldOffsets;
+    };
+
+    struct RowRangeExport {
+        uint32_t archetypeIdx;
+        HeapArray<ExportedRowRange> ranges;
     };
 #endif
 
@@ -312,7 +395,11 @@ private:
                         const uint32_t *components,
                         CountT num_components);
 
-    void * exportColumn(uint32_t archetype_id, uint32_t component_id);
+    void * exportColumn(uint32_t archetype_id, uint32_t component_id,
+                        ExportFlags flags);
+#ifdef MADRONA_MW_MODE
+    ExportedRowRange * exportRowRanges(uint32_t archetype_id);
+#endif
 
     void clear(MADRONA_MW_COND(uint32_t world_id,) StateCache &cache,
                uint32_t archetype_id, bool is_temporary);
@@ -327,6 +414,7 @@ private:
 
 #ifdef MADRONA_MW_MODE
     DynArray<ExportJob> export_jobs_;
+    DynArray<RowRangeExport> row_range_exports_;
 #endif
 
     // FIXME: TmpAllocator doesn't belong here should be per CPU worker
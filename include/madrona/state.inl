@@ -9,6 +9,7 @@
 
 #include <madrona/utils.hpp>
 
+#include <algorithm>
 #include <array>
 #include <mutex>
 
@@ -241,13 +242,22 @@ void StateManager::registerBundleAlias()
 }
 
 template <typename ArchetypeT, typename ComponentT>
-ComponentT * StateManager::exportColumn()
+ComponentT * StateManager::exportColumn(ExportFlags flags)
 {
     return (ComponentT *)exportColumn(
         archetypeID<ArchetypeT>().id,
-        componentID<ComponentT>().id);
+        componentID<ComponentT>().id,
+        flags);
 }
 
+#ifdef MADRONA_MW_MODE
+template <typename ArchetypeT>
+ExportedRowRange * StateManager::exportRowRanges()
+{
+    return exportRowRanges(archetypeID<ArchetypeT>().id);
+}
+#endif
+
 template <typename SingletonT>
 SingletonT * StateManager::exportSingleton()
 {
@@ -432,6 +442,56 @@ void StateManager::iterateQuery(MADRONA_MW_COND(uint32_t world_id,)
     });
 }
 
+template <typename... ComponentTs>
+CountT StateManager::numMatchingEntities(MADRONA_MW_COND(uint32_t world_id,)
+                                         const Query<ComponentTs...> &query)
+{
+    CountT num_entities = 0;
+    iterateArchetypes(MADRONA_MW_COND(world_id,) query,
+            [&num_entities](int num_rows, auto ...) {
+        num_entities += num_rows;
+    });
+
+    return num_entities;
+}
+
+template <typename... ComponentTs, typename Fn>
+void StateManager::iterateQueryRange(MADRONA_MW_COND(uint32_t world_id,)
+                                     const Query<ComponentTs...> &query,
+                                     CountT offset, CountT num_rows, Fn &&fn)
+{
+    iterateArchetypesRange(MADRONA_MW_COND(world_id,) query,
+            offset, num_rows, [&fn](CountT chunk_rows, auto ...ptrs) {
+        for (CountT i = 0; i < chunk_rows; i++) {
+            fn(ptrs[i] ...);
+        }
+    });
+}
+
+template <typename... ComponentTs, typename Fn>
+void StateManager::iterateArchetypesRange(MADRONA_MW_COND(uint32_t world_id,)
+                                          const Query<ComponentTs...> &query,
+                                          CountT offset, CountT num_rows,
+                                          Fn &&fn)
+{
+    CountT archetype_start = 0;
+    CountT range_end = offset + num_rows;
+
+    iterateArchetypes(MADRONA_MW_COND(world_id,) query,
+            [&](int archetype_rows, auto ...ptrs) {
+        CountT archetype_end = archetype_start + archetype_rows;
+
+        CountT start = std::max(offset, archetype_start) - archetype_start;
+        CountT end = std::min(range_end, archetype_end) - archetype_start;
+
+        if (start < end) {
+            fn(end - start, (ptrs + start) ...);
+        }
+
+        archetype_start = archetype_end;
+    });
+}
+
 template <typename ArchetypeT, typename... Args>
 Entity StateManager::makeEntityNow(MADRONA_MW_COND(uint32_t world_id,)
                                    StateCache &cache, Args && ...args)
@@ -512,6 +572,11 @@ Loc StateManager::makeTemporary(MADRONA_MW_COND(uint32_t world_id,)
     CountT new_row = archetype.tblStorage.addRow(
         MADRONA_MW_COND(world_id));
 
+    // Temporaries have no ID, sortArchetype relies on this to skip them
+    // when updating entity locations.
+    archetype.tblStorage.column<Entity>(MADRONA_MW_COND(world_id,) 0)[
+        new_row] = Entity::none();
+
     return Loc {
         archetype_id,
         int32_t(new_row),
@@ -526,6 +591,16 @@ void StateManager::clear(MADRONA_MW_COND(uint32_t world_id,) StateCache &cache,
           is_temporary);
 }
 
+template <typename ArchetypeT, typename ComponentT>
+void StateManager::sortArchetype(MADRONA_MW_COND(uint32_t world_id))
+{
+    static_assert(sizeof(ComponentT) == sizeof(uint32_t),
+        "Sort keys must be 32 bits, matching the GPU backend");
+
+    sortArchetype(MADRONA_MW_COND(world_id,) archetypeID<ArchetypeT>().id,
+                  componentID<ComponentT>().id);
+}
+
 #ifdef MADRONA_MW_MODE
 uint32_t StateManager::numWorlds() const
 {
@@ -11,6 +11,7 @@
 #include <madrona/heap_array.hpp>
 #include <madrona/inline_array.hpp>
 #include <madrona/virtual.hpp>
+#include <madrona/optional.hpp>
 #include <madrona/ecs.hpp>
 
 #include <array>
@@ -24,9 +25,29 @@ struct TypeInfo {
 
 class Table {
 public:
+    // Reserves address space for max_num_rows rows of every column in one
+    // virtual region owned by the table. Rows are committed as the table
+    // grows, so growth only moves existing rows if the table outgrows its
+    // reservation (see addRow). Each column starts at a different cache
+    // line offset from its page boundary so the columns of a table (and
+    // the same column across tables) don't all map to the same cache sets.
     Table(const TypeInfo *component_types, CountT num_components,
-          CountT init_num_rows);
+          CountT init_num_rows, CountT max_num_rows);
 
+    // Places column i of this table in slot row_slot of
+    // column_regions[i] (see columnSlotBytes), so the regions can be
+    // shared between tables using different slots. Memory is committed
+    // as the table grows instead of reallocated.
+    // With offset_columns, columns start at varying cache line offsets
+    // into their slots like above, otherwise at the start of the slot.
+    // With fixed_columns, column pointers never change and can be handed
+    // out directly, so rows are limited to max_num_rows.
+    Table(const TypeInfo *component_types, CountT num_components,
+          VirtualRegion *column_regions, CountT row_slot,
+          CountT max_num_rows, bool offset_columns, bool fixed_columns);
+
+    // Past max_num_rows, tables without fixed_columns move their rows to a
+    // larger region owned by the table, which changes the column pointers.
     uint32_t addRow();
     bool removeRow(uint32_t row);
     void copyRow(uint32_t dst, uint32_t src);
@@ -39,17 +60,32 @@ public:
 
     inline uint32_t numRows() const { return num_rows_; }
 
-    // Drops all rows in the table and frees memory
+    // Drops all rows in the table. Committed memory is kept for reuse.
     void clear();
 
     static constexpr uint32_t maxColumns = 128;
+    static constexpr uint32_t maxRows = 1u << 28u;
+
+    // Size in bytes of each table's slot in a shared column region. A
+    // multiple of 64KiB, so slots start on a page boundary on any platform.
+    static uint64_t columnSlotBytes(uint32_t bytes_per_row,
+                                    CountT max_num_rows,
+                                    bool offset_columns);
 
 private:
+    void commitRows(uint32_t num_committed_rows, uint32_t num_new_rows);
+    void relocate(uint32_t new_max_rows);
+
     uint32_t num_rows_;
     uint32_t num_allocated_rows_;
     uint32_t num_components_;
     InlineArray<void *, maxColumns> columns_;
     InlineArray<uint32_t, maxColumns> bytes_per_column_;
+    // nullptr unless the columns live in shared virtual regions
+    VirtualRegion *column_regions_;
+    Optional<VirtualRegion> owned_region_;
+    uint32_t max_num_rows_;
+    bool fixed_columns_;
 };
 
 }
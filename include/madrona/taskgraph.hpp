@@ -24,8 +24,16 @@ private:
 
     struct Node {
         void (*fn)(NodeBase *, Context *, TaskGraph *);
+        // Only set for nodes whose work can be split into independent
+        // invocations (ParallelForNode), nullptr otherwise.
+        uint32_t (*numInvocationsFn)(NodeBase *, TaskGraph *);
+        void (*rangeFn)(NodeBase *, Context *, TaskGraph *,
+                        uint32_t offset, uint32_t num_invocations);
         uint32_t dataIDX;
         uint32_t numChildren;
+        uint32_t numDependencies;
+        uint32_t dependentsOffset;
+        uint32_t numDependents;
     };
 
 public:
@@ -33,7 +41,8 @@ public:
               StateCache *state_cache,
               MADRONA_MW_COND(uint32_t world_id,) 
               HeapArray<Node> &&sorted_nodes,
-              HeapArray<NodeData> &&node_datas);
+              HeapArray<NodeData> &&node_datas,
+              HeapArray<uint32_t> &&node_dependents);
     TaskGraph(const TaskGraph &) = delete;
     TaskGraph(TaskGraph &&) = default;
 
@@ -42,8 +51,27 @@ public:
 
     void run(Context *ctx);
 
+    // The functions below expose the individual nodes of the graph so
+    // a backend can schedule them itself rather than calling run()
+    // (see ThreadPoolExecutor::Config::intraWorldParallelism).
+    // Node indices are in topologically sorted order.
+    inline CountT numNodes() const;
+    inline uint32_t numNodeDependencies(CountT node_idx) const;
+    inline Span<const uint32_t> nodeDependents(CountT node_idx) const;
+    inline bool isNodeSplittable(CountT node_idx) const;
+
+    // Number of independent invocations (rows) the node will process
+    // if run now. Always 1 for nodes that can't be split.
+    inline uint32_t numNodeInvocations(CountT node_idx);
+
+    inline void runNode(CountT node_idx, Context *ctx);
+    inline void runNodeRange(CountT node_idx, Context *ctx,
+                             uint32_t offset, uint32_t num_invocations);
+
     template <typename ArchetypeT>
     void clearTemporaries();
+    template <typename ArchetypeT, typename ComponentT>
+    void sortArchetype();
     void resetTmpAlloc();
 
     template <typename ContextT, typename Fn, typename ...ComponentTs>
@@ -51,6 +79,35 @@ public:
                       Query<ComponentTs...> &query,
                       Fn &&fn);
 
+    template <typename ContextT, typename Fn, typename ...ComponentTs>
+    void iterateQueryRange(ContextT &ctx,
+                           Query<ComponentTs...> &query,
+                           uint32_t offset,
+                           uint32_t num_rows,
+                           Fn &&fn);
+
+    // Calls fn(ctx, num_rows, ComponentTs *...) with contiguous column
+    // spans instead of once per row (see ParallelForChunkNode)
+    template <typename ContextT, typename Fn, typename ...ComponentTs>
+    void iterateQueryChunks(ContextT &ctx,
+                            Query<ComponentTs...> &query,
+                            Fn &&fn);
+
+    template <typename ContextT, typename Fn, typename ...ComponentTs>
+    void iterateQueryChunksRange(ContextT &ctx,
+                                 Query<ComponentTs...> &query,
+                                 uint32_t offset,
+                                 uint32_t num_rows,
+                                 Fn &&fn);
+
+    template <typename ...ComponentTs>
+    uint32_t numMatchingEntities(Query<ComponentTs...> &query);
+
+    // The current world's SingletonT, for nodes whose number of
+    // invocations depends on per world state
+    template <typename SingletonT>
+    SingletonT & singleton();
+
 private:
     StateManager *state_mgr_;
     StateCache *state_cache_;
@@ -59,6 +116,7 @@ private:
 #endif
     HeapArray<Node> sorted_nodes_;
     HeapArray<NodeData> node_datas_;
+    HeapArray<uint32_t> node_dependents_;
 
 friend class TaskGraphBuilder;
 };
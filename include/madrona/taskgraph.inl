@@ -9,6 +9,13 @@ void TaskGraph::clearTemporaries()
                                   *state_cache_, true);
 }
 
+template <typename ArchetypeT, typename ComponentT>
+void TaskGraph::sortArchetype()
+{
+    state_mgr_->sortArchetype<ArchetypeT, ComponentT>(
+        MADRONA_MW_COND(cur_world_id_));
+}
+
 template <typename ContextT, typename Fn, typename ...ComponentTs>
 void TaskGraph::iterateQuery(ContextT &ctx,
                              Query<ComponentTs...> &query,
@@ -20,4 +27,104 @@ void TaskGraph::iterateQuery(ContextT &ctx,
         });
 }
 
+template <typename ContextT, typename Fn, typename ...ComponentTs>
+void TaskGraph::iterateQueryRange(ContextT &ctx,
+                                  Query<ComponentTs...> &query,
+                                  uint32_t offset,
+                                  uint32_t num_rows,
+                                  Fn &&fn)
+{
+    state_mgr_->iterateQueryRange(MADRONA_MW_COND(cur_world_id_,) query,
+        offset, num_rows, [&](auto &...refs) {
+            fn(ctx, refs...);
+        });
+}
+
+template <typename ContextT, typename Fn, typename ...ComponentTs>
+void TaskGraph::iterateQueryChunks(ContextT &ctx,
+                                   Query<ComponentTs...> &query,
+                                   Fn &&fn)
+{
+    state_mgr_->iterateArchetypes(MADRONA_MW_COND(cur_world_id_,) query,
+        [&](int num_rows, auto ...ptrs) {
+            if (num_rows > 0) {
+                fn(ctx, (CountT)num_rows, ptrs...);
+            }
+        });
+}
+
+template <typename ContextT, typename Fn, typename ...ComponentTs>
+void TaskGraph::iterateQueryChunksRange(ContextT &ctx,
+                                        Query<ComponentTs...> &query,
+                                        uint32_t offset,
+                                        uint32_t num_rows,
+                                        Fn &&fn)
+{
+    state_mgr_->iterateArchetypesRange(MADRONA_MW_COND(cur_world_id_,) query,
+        offset, num_rows, [&](CountT chunk_rows, auto ...ptrs) {
+            fn(ctx, chunk_rows, ptrs...);
+        });
+}
+
+template <typename ...ComponentTs>
+uint32_t TaskGraph::numMatchingEntities(Query<ComponentTs...> &query)
+{
+    return (uint32_t)state_mgr_->numMatchingEntities(
+        MADRONA_MW_COND(cur_world_id_,) query);
+}
+
+template <typename SingletonT>
+SingletonT & TaskGraph::singleton()
+{
+    return state_mgr_->getSingleton<SingletonT>(
+        MADRONA_MW_COND(cur_world_id_));
+}
+
+CountT TaskGraph::numNodes() const
+{
+    return sorted_nodes_.size();
+}
+
+uint32_t TaskGraph::numNodeDependencies(CountT node_idx) const
+{
+    return sorted_nodes_[node_idx].numDependencies;
+}
+
+Span<const uint32_t> TaskGraph::nodeDependents(CountT node_idx) const
+{
+    const Node &node = sorted_nodes_[node_idx];
+    return Span<const uint32_t>(
+        node_dependents_.data() + node.dependentsOffset, node.numDependents);
+}
+
+bool TaskGraph::isNodeSplittable(CountT node_idx) const
+{
+    return sorted_nodes_[node_idx].rangeFn != nullptr;
+}
+
+uint32_t TaskGraph::numNodeInvocations(CountT node_idx)
+{
+    const Node &node = sorted_nodes_[node_idx];
+    if (node.numInvocationsFn == nullptr) {
+        return 1;
+    }
+
+    return node.numInvocationsFn(
+        (NodeBase *)(&node_datas_[node.dataIDX].userData[0]), this);
+}
+
+void TaskGraph::runNode(CountT node_idx, Context *ctx)
+{
+    const Node &node = sorted_nodes_[node_idx];
+    node.fn((NodeBase *)(&node_datas_[node.dataIDX].userData[0]), ctx, this);
+}
+
+void TaskGraph::runNodeRange(CountT node_idx, Context *ctx,
+                             uint32_t offset, uint32_t num_invocations)
+{
+    const Node &node = sorted_nodes_[node_idx];
+    node.rangeFn((NodeBase *)(&node_datas_[node.dataIDX].userData[0]),
+                 ctx, this, offset, num_invocations);
+}
+
 }
@@ -52,6 +52,20 @@ public:
                               Optional<TaskGraphNodeID> parent_node =
                                   Optional<TaskGraphNodeID>::none());
 
+    // Same as addNodeFn, but additionally registers entry points that let
+    // the backend split the node's work into independent invocations.
+    // num_invocations_fn(NodeT *, TaskGraph &) returns the number of
+    // invocations and range_fn(NodeT *, Context &, TaskGraph &, offset, num)
+    // runs the invocations in [offset, offset + num).
+    template <auto fn, auto num_invocations_fn, auto range_fn,
+              typename NodeT>
+    TaskGraphNodeID addSplittableNodeFn(
+        TypedDataID<NodeT> data,
+        Span<const TaskGraphNodeID> dependencies);
+
+    // Adds a node that runs NodeT::run. If NodeT also provides
+    // numInvocations and runRange (see ParallelForNode) the node is
+    // registered as splittable.
     template <typename NodeT, typename... Args>
     TaskGraphNodeID addDefaultNode(Span<const TaskGraphNodeID> dependencies,
                                    Args && ...args);
@@ -68,7 +82,10 @@ private:
     TaskGraphNodeID registerNode(uint32_t data_idx,
         void (*fn)(NodeBase *, Context *, TaskGraph *),
         Span<const TaskGraphNodeID> dependencies,
-        Optional<TaskGraphNodeID> parent_node);
+        Optional<TaskGraphNodeID> parent_node,
+        uint32_t (*num_invocations_fn)(NodeBase *, TaskGraph *) = nullptr,
+        void (*range_fn)(NodeBase *, Context *, TaskGraph *,
+                         uint32_t, uint32_t) = nullptr);
 
     struct StagedNode {
         TaskGraph::Node node;
@@ -126,6 +143,47 @@ public:
 
     inline void run(Context &ctx_base, TaskGraph &taskgraph);
 
+    // Used by the backend to split the node across threads
+    inline uint32_t numInvocations(TaskGraph &taskgraph);
+    inline void runRange(Context &ctx_base, TaskGraph &taskgraph,
+                         uint32_t offset, uint32_t num_invocations);
+
+    static TaskGraphNodeID addToGraph(
+        StateManager &state_mgr,
+        TaskGraphBuilder &builder,
+        Span<const TaskGraphNodeID> dependencies);
+
+private:
+    Query<ComponentTs...> query_;
+};
+
+// Same as ParallelForNode, but Fn is called with a row count and pointers
+// to contiguous runs of each component column instead of once per row, so
+// the system can loop over the rows itself (e.g. with the FloatN types in
+// simd_math.hpp). Given:
+//     void mySystem(MyContext &ctx,
+//                   CountT num_rows,
+//                   Position *positions,
+//                   Rotation *rotations);
+//
+// the node is:
+//     ParallelForChunkNode<MyContext, mySystem, Position, Rotation>
+//
+// Each call covers part of one archetype. Large archetypes are split
+// across worker threads like ParallelForNode, so Fn must not assume a
+// call sees every row of an archetype. On the GPU, Fn is called with a
+// single row per thread.
+template <typename ContextT, auto Fn, typename ...ComponentTs>
+class ParallelForChunkNode : public NodeBase {
+public:
+    ParallelForChunkNode(Query<ComponentTs...> &&query);
+
+    inline void run(Context &ctx_base, TaskGraph &taskgraph);
+
+    inline uint32_t numInvocations(TaskGraph &taskgraph);
+    inline void runRange(Context &ctx_base, TaskGraph &taskgraph,
+                         uint32_t offset, uint32_t num_invocations);
+
     static TaskGraphNodeID addToGraph(
         StateManager &state_mgr,
         TaskGraphBuilder &builder,
@@ -159,6 +217,36 @@ public:
         Span<const TaskGraphNodeID> dependencies);
 };
 
+// Sorts the rows of ArchetypeT by ComponentT (a 32 bit key) with an LSD
+// radix sort, so later ParallelForNodes visit them in key order. Useful
+// for grouping rows that touch the same data, e.g. constraints by body.
+// Sorting by WorldID does nothing on the CPU, each world has its own
+// table, but keeps the graph identical to the GPU backend where it's
+// required.
+template <typename ArchetypeT, typename ComponentT>
+class SortArchetypeNode : public NodeBase {
+public:
+    inline void run(Context &ctx, TaskGraph &taskgraph);
+
+    static TaskGraphNodeID addToGraph(
+        StateManager &,
+        TaskGraphBuilder &builder,
+        Span<const TaskGraphNodeID> dependencies);
+};
+
+// Removes the holes left by deleted rows of ArchetypeT on the GPU. CPU
+// tables move the last row into the hole on deletion and are always
+// dense, so this node only exists for parity with the GPU backend.
+template <typename ArchetypeT>
+class CompactArchetypeNode : public NodeBase {
+public:
+    inline void run(Context &ctx, TaskGraph &taskgraph);
+
+    static TaskGraphNodeID addToGraph(
+        StateManager &,
+        TaskGraphBuilder &builder,
+        Span<const TaskGraphNodeID> dependencies);
+};
 
 }
 
@@ -39,6 +39,29 @@ TaskGraphNodeID TaskGraphBuilder::addNodeFn(
         parent_node);
 }
 
+template <auto fn, auto num_invocations_fn, auto range_fn, typename NodeT>
+TaskGraphNodeID TaskGraphBuilder::addSplittableNodeFn(
+        TypedDataID<NodeT> data,
+        Span<const TaskGraphNodeID> dependencies)
+{
+    return registerNode(uint32_t(data.id), [](NodeBase *node_data,
+                                              Context *ctx,
+                                              TaskGraph *task_graph) {
+            std::invoke(fn, ((NodeT *)node_data), *ctx, *task_graph);
+        },
+        dependencies,
+        Optional<TaskGraphNodeID>::none(),
+        [](NodeBase *node_data, TaskGraph *task_graph) -> uint32_t {
+            return std::invoke(num_invocations_fn, ((NodeT *)node_data),
+                               *task_graph);
+        },
+        [](NodeBase *node_data, Context *ctx, TaskGraph *task_graph,
+           uint32_t offset, uint32_t num_invocations) {
+            std::invoke(range_fn, ((NodeT *)node_data), *ctx, *task_graph,
+                        offset, num_invocations);
+        });
+}
+
 template <typename NodeT, typename... Args>
 TaskGraphNodeID TaskGraphBuilder::addDefaultNode(
     Span<const TaskGraphNodeID> dependencies,
@@ -46,8 +69,17 @@ TaskGraphNodeID TaskGraphBuilder::addDefaultNode(
 {
     auto data_id = constructNodeData<NodeT>(
         std::forward<Args>(args)...);
-    return addNodeFn<&NodeT::run>(data_id, dependencies,
-                                  Optional<TaskGraphNodeID>::none());
+
+    if constexpr (requires {
+            &NodeT::numInvocations;
+            &NodeT::runRange;
+        }) {
+        return addSplittableNodeFn<&NodeT::run, &NodeT::numInvocations,
+                                   &NodeT::runRange>(data_id, dependencies);
+    } else {
+        return addNodeFn<&NodeT::run>(data_id, dependencies,
+                                      Optional<TaskGraphNodeID>::none());
+    }
 }
 
 template <typename NodeT>
@@ -76,6 +108,22 @@ void ParallelForNode<ContextT, Fn, ComponentTs...>::run(
     taskgraph.iterateQuery(ctx, query_, Fn); 
 }
 
+template <typename ContextT, auto Fn, typename ...ComponentTs>
+uint32_t ParallelForNode<ContextT, Fn, ComponentTs...>::numInvocations(
+    TaskGraph &taskgraph)
+{
+    return taskgraph.numMatchingEntities(query_);
+}
+
+template <typename ContextT, auto Fn, typename ...ComponentTs>
+void ParallelForNode<ContextT, Fn, ComponentTs...>::runRange(
+    Context &ctx_base, TaskGraph &taskgraph,
+    uint32_t offset, uint32_t num_invocations)
+{
+    ContextT &ctx = static_cast<ContextT &>(ctx_base);
+    taskgraph.iterateQueryRange(ctx, query_, offset, num_invocations, Fn);
+}
+
 template <typename ContextT, auto Fn, typename ...ComponentTs>
 TaskGraphNodeID
 ParallelForNode<ContextT, Fn, ComponentTs...>::addToGraph(
@@ -89,6 +137,50 @@ ParallelForNode<ContextT, Fn, ComponentTs...>::addToGraph(
     return builder.addDefaultNode<NodeT>(dependencies, std::move(query));
 }
 
+template <typename ContextT, auto Fn, typename ...ComponentTs>
+ParallelForChunkNode<ContextT, Fn, ComponentTs...>::ParallelForChunkNode(
+        Query<ComponentTs...> &&query)
+    : query_(std::move(query))
+{}
+
+template <typename ContextT, auto Fn, typename ...ComponentTs>
+void ParallelForChunkNode<ContextT, Fn, ComponentTs...>::run(
+    Context &ctx_base, TaskGraph &taskgraph)
+{
+    ContextT &ctx = static_cast<ContextT &>(ctx_base);
+    taskgraph.iterateQueryChunks(ctx, query_, Fn);
+}
+
+template <typename ContextT, auto Fn, typename ...ComponentTs>
+uint32_t ParallelForChunkNode<ContextT, Fn, ComponentTs...>::numInvocations(
+    TaskGraph &taskgraph)
+{
+    return taskgraph.numMatchingEntities(query_);
+}
+
+template <typename ContextT, auto Fn, typename ...ComponentTs>
+void ParallelForChunkNode<ContextT, Fn, ComponentTs...>::runRange(
+    Context &ctx_base, TaskGraph &taskgraph,
+    uint32_t offset, uint32_t num_invocations)
+{
+    ContextT &ctx = static_cast<ContextT &>(ctx_base);
+    taskgraph.iterateQueryChunksRange(ctx, query_, offset, num_invocations,
+                                      Fn);
+}
+
+template <typename ContextT, auto Fn, typename ...ComponentTs>
+TaskGraphNodeID
+ParallelForChunkNode<ContextT, Fn, ComponentTs...>::addToGraph(
+    StateManager &state_mgr,
+    TaskGraphBuilder &builder,
+    Span<const TaskGraphNodeID> dependencies)
+{
+    using NodeT = ParallelForChunkNode<ContextT, Fn, ComponentTs...>;
+
+    auto query = state_mgr.query<ComponentTs...>();
+    return builder.addDefaultNode<NodeT>(dependencies, std::move(query));
+}
+
 void ResetTmpAllocNode::run(Context &, TaskGraph &taskgraph)
 {
     taskgraph.resetTmpAlloc();
@@ -109,4 +201,33 @@ TaskGraphNodeID ClearTmpNode<ArchetypeT>::addToGraph(
     return builder.addDefaultNode<ClearTmpNode>(dependencies);
 }
 
+template <typename ArchetypeT, typename ComponentT>
+void SortArchetypeNode<ArchetypeT, ComponentT>::run(Context &,
+                                                     TaskGraph &taskgraph)
+{
+    taskgraph.sortArchetype<ArchetypeT, ComponentT>();
+}
+
+template <typename ArchetypeT, typename ComponentT>
+TaskGraphNodeID SortArchetypeNode<ArchetypeT, ComponentT>::addToGraph(
+    StateManager &,
+    TaskGraphBuilder &builder,
+    Span<const TaskGraphNodeID> dependencies)
+{
+    return builder.addDefaultNode<SortArchetypeNode>(dependencies);
+}
+
+template <typename ArchetypeT>
+void CompactArchetypeNode<ArchetypeT>::run(Context &, TaskGraph &)
+{}
+
+template <typename ArchetypeT>
+TaskGraphNodeID CompactArchetypeNode<ArchetypeT>::addToGraph(
+    StateManager &,
+    TaskGraphBuilder &builder,
+    Span<const TaskGraphNodeID> dependencies)
+{
+    return builder.addDefaultNode<CompactArchetypeNode>(dependencies);
+}
+
 }
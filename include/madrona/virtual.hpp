@@ -18,8 +18,14 @@ namespace madrona {
 
 class VirtualRegion {
 public:
+    // With lazy_backing, the whole region is mapped readable and writable
+    // up front on platforms that only back anonymous memory once it is
+    // touched (Linux and macOS). The region then stays a single mapping
+    // however much of it is used, instead of one per committed range, but
+    // accesses past the used part are no longer caught.
     VirtualRegion(uint64_t max_bytes, uint64_t chunk_shift,
-                  uint64_t alignment, uint64_t init_chunks = 0);
+                  uint64_t alignment, uint64_t init_chunks = 0,
+                  bool lazy_backing = false);
     VirtualRegion(const VirtualRegion &) = delete;
     VirtualRegion(VirtualRegion &&o);
 
@@ -27,9 +33,17 @@ public:
 
 
     inline void *ptr() const { return aligned_; }
+
+    // False if the region was mapped with lazy_backing, in which case
+    // commitChunks must not be called.
+    inline bool needsCommit() const { return !lazy_backing_; }
     void commitChunks(uint64_t start_chunk, uint64_t num_chunks);
     void decommitChunks(uint64_t start_chunk, uint64_t num_chunks);
 
+    // Hint that committed chunks should be backed by transparent huge
+    // pages. Only has an effect on Linux.
+    void adviseHugePages(uint64_t start_chunk, uint64_t num_chunks);
+
     inline uint64_t chunkSize() const { return 1_u64 << chunk_shift_; }
 
 private:
@@ -40,6 +54,7 @@ private:
     char * aligned_;
     uint64_t chunk_shift_;
     uint64_t total_size_;
+    bool lazy_backing_;
 };
 
 class VirtualStore {
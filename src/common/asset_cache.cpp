@@ -0,0 +1,198 @@
+/*
+ * Copyright 2021-2022 Brennan Shacklett and contributors
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+#include <madrona/asset_cache.hpp>
+#include <madrona/crash.hpp>
+#include <madrona/utils.hpp>
+
+#if defined(__linux__) or defined(__APPLE__)
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace madrona {
+
+namespace {
+
+// Bump whenever the header layout changes. Layout changes of the cached
+// types themselves are caught by the callers folding sizeof / build flags
+// into the source hash.
+constexpr uint32_t cacheMagic = 0x4341444d; // "MDAC"
+constexpr uint32_t cacheFormatVersion = 1;
+
+struct CacheFileHeader {
+    uint32_t magic;
+    uint32_t formatVersion;
+    uint32_t cacheKind;
+    uint32_t pad;
+    uint64_t sourceHash;
+    uint64_t payloadOffset;
+    uint64_t numPayloadBytes;
+};
+
+static_assert(sizeof(CacheFileHeader) <= assetCachePayloadAlignment);
+
+constexpr uint64_t hashMul1 = 0x87c3'7b91'1142'53d5ull;
+constexpr uint64_t hashMul2 = 0x4cf5'ad43'2745'937full;
+
+inline uint64_t rotl64(uint64_t x, int32_t r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t mixWord(uint64_t h, uint64_t w)
+{
+    w *= hashMul1;
+    w = rotl64(w, 31);
+    w *= hashMul2;
+
+    h ^= w;
+    h = rotl64(h, 27);
+    return h * 5 + 0x52dc'e729;
+}
+
+}
+
+AssetHasher::AssetHasher(uint64_t seed)
+    : state_(seed ^ 0x9e37'79b9'7f4a'7c15ull),
+      numBytes_(0)
+{}
+
+void AssetHasher::addBytes(const void *data, size_t num_bytes)
+{
+    // Word at a time rather than bytewise FNV: source meshes can be hundreds
+    // of MB and this runs on every startup, cache hit or not.
+    const char *ptr = (const char *)data;
+    size_t num_words = num_bytes / sizeof(uint64_t);
+
+    uint64_t h = state_;
+    for (size_t i = 0; i < num_words; i++) {
+        uint64_t w;
+        memcpy(&w, ptr + i * sizeof(uint64_t), sizeof(uint64_t));
+        h = mixWord(h, w);
+    }
+
+    size_t num_tail_bytes = num_bytes - num_words * sizeof(uint64_t);
+    if (num_tail_bytes > 0) {
+        uint64_t w = 0;
+        memcpy(&w, ptr + num_words * sizeof(uint64_t), num_tail_bytes);
+        h = mixWord(h, w ^ ((uint64_t)num_tail_bytes << 56));
+    }
+
+    state_ = h;
+    numBytes_ += num_bytes;
+}
+
+uint64_t AssetHasher::finish() const
+{
+    uint64_t h = state_ ^ numBytes_;
+    h ^= h >> 33;
+    h *= 0xff51'afd7'ed55'8ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ce'b9fe'1a85'ec53ull;
+    h ^= h >> 33;
+
+    return h;
+}
+
+Optional<MappedAssetCache> MappedAssetCache::map(const char *path,
+                                                 uint32_t cache_kind,
+                                                 uint64_t source_hash)
+{
+    Optional<MappedFile> file = MappedFile::map(path, true);
+    if (!file.has_value() || file->numBytes() < sizeof(CacheFileHeader)) {
+        return Optional<MappedAssetCache>::none();
+    }
+
+    CacheFileHeader hdr;
+    memcpy(&hdr, file->data(), sizeof(CacheFileHeader));
+
+    if (hdr.magic != cacheMagic ||
+            hdr.formatVersion != cacheFormatVersion ||
+            hdr.cacheKind != cache_kind ||
+            hdr.sourceHash != source_hash ||
+            hdr.payloadOffset < sizeof(CacheFileHeader) ||
+            hdr.payloadOffset % assetCachePayloadAlignment != 0 ||
+            hdr.payloadOffset + hdr.numPayloadBytes > file->numBytes()) {
+        return Optional<MappedAssetCache>::none();
+    }
+
+    char *payload = file->data() + hdr.payloadOffset;
+
+    return Optional<MappedAssetCache>::make(MappedAssetCache(
+        std::move(*file), payload, hdr.numPayloadBytes));
+}
+
+bool writeAssetCache(const char *path,
+                     uint32_t cache_kind,
+                     uint64_t source_hash,
+                     const void *payload,
+                     size_t num_payload_bytes)
+{
+    uint64_t payload_offset = utils::roundUp(
+        (uint64_t)sizeof(CacheFileHeader),
+        (uint64_t)assetCachePayloadAlignment);
+
+    CacheFileHeader hdr {
+        .magic = cacheMagic,
+        .formatVersion = cacheFormatVersion,
+        .cacheKind = cache_kind,
+        .pad = 0,
+        .sourceHash = source_hash,
+        .payloadOffset = payload_offset,
+        .numPayloadBytes = num_payload_bytes,
+    };
+
+    uint32_t pid =
+#ifdef _WIN32
+        GetCurrentProcessId()
+#else
+        getpid()
+#endif
+        ;
+
+    std::string tmp_path = std::string(path) + "." + std::to_string(pid) +
+        ".tmp";
+
+    FILE *file = fopen(tmp_path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    char header_block[assetCachePayloadAlignment] = {};
+    memcpy(header_block, &hdr, sizeof(CacheFileHeader));
+
+    bool success =
+        fwrite(header_block, 1, payload_offset, file) == payload_offset &&
+        fwrite(payload, 1, num_payload_bytes, file) == num_payload_bytes;
+    success = (fclose(file) == 0) && success;
+
+    if (!success) {
+        remove(tmp_path.c_str());
+        return false;
+    }
+
+#ifdef _WIN32
+    success = MoveFileExA(tmp_path.c_str(), path,
+                          MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    success = rename(tmp_path.c_str(), path) == 0;
+#endif
+
+    if (!success) {
+        remove(tmp_path.c_str());
+    }
+
+    return success;
+}
+
+}
@@ -10,6 +10,15 @@
 #include <madrona/crash.hpp>
 #include <madrona/memory.hpp>
 
+#if defined(__linux__) or defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
 #include <fstream>
 
 namespace madrona {
@@ -46,4 +55,115 @@ char * readBinaryFile(const char *path,
     return data;
 }
 
+Optional<MappedFile> MappedFile::map(const char *path, bool copy_on_write)
+{
+#if defined(__linux__) or defined(__APPLE__)
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        return Optional<MappedFile>::none();
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        return Optional<MappedFile>::none();
+    }
+
+    size_t num_bytes = (size_t)file_stat.st_size;
+
+    // mmap rejects empty ranges, an empty file is just an empty mapping
+    if (num_bytes == 0) {
+        close(fd);
+        return Optional<MappedFile>::make(MappedFile(nullptr, 0));
+    }
+
+    int prot = copy_on_write ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void *mapping = mmap(nullptr, num_bytes, prot, MAP_PRIVATE, fd, 0);
+
+    // The mapping holds its own reference to the file
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        return Optional<MappedFile>::none();
+    }
+#elif defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return Optional<MappedFile>::none();
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        return Optional<MappedFile>::none();
+    }
+
+    size_t num_bytes = (size_t)file_size.QuadPart;
+
+    if (num_bytes == 0) {
+        CloseHandle(file);
+        return Optional<MappedFile>::make(MappedFile(nullptr, 0));
+    }
+
+    HANDLE file_mapping = CreateFileMappingA(file, nullptr,
+        copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (file_mapping == nullptr) {
+        return Optional<MappedFile>::none();
+    }
+
+    void *mapping = MapViewOfFile(file_mapping,
+        copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(file_mapping);
+    if (mapping == nullptr) {
+        return Optional<MappedFile>::none();
+    }
+#else
+    STATIC_UNIMPLEMENTED();
+#endif
+
+    return Optional<MappedFile>::make(MappedFile((char *)mapping, num_bytes));
+}
+
+MappedFile::MappedFile(MappedFile &&o)
+    : data_(o.data_),
+      numBytes_(o.numBytes_)
+{
+    o.data_ = nullptr;
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+MappedFile & MappedFile::operator=(MappedFile &&o)
+{
+    unmap();
+
+    data_ = o.data_;
+    numBytes_ = o.numBytes_;
+    o.data_ = nullptr;
+
+    return *this;
+}
+
+void MappedFile::unmap()
+{
+    if (data_ == nullptr) {
+        return;
+    }
+
+#if defined(__linux__) or defined(__APPLE__)
+    munmap(data_, numBytes_);
+#elif defined(_WIN32)
+    UnmapViewOfFile(data_);
+#else
+    STATIC_UNIMPLEMENTED();
+#endif
+
+    data_ = nullptr;
+}
+
 }
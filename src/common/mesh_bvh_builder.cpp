@@ -214,6 +214,29 @@ static void splitPrimitive(const RTCBuildPrimitive* prim,
     (&rprim->lower_x)[dim] = pos;
 }
 
+static uint32_t computeMaxDepth(const DynArray<QBVHNode> &nodes)
+{
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    stack.push_back({ 0, 1 });
+
+    uint32_t max_depth = 0;
+    while (!stack.empty()) {
+        auto [node_idx, depth] = stack.back();
+        stack.pop_back();
+
+        max_depth = std::max(max_depth, depth);
+
+        const QBVHNode &node = nodes[node_idx];
+        for (int i = 0; i < QBVHNode::NodeWidth; i++) {
+            if (node.hasChild(i) && !node.isLeaf(i)) {
+                stack.push_back({ node.childrenIdx[i], depth + 1 });
+            }
+        }
+    }
+
+    return max_depth;
+}
+
 MeshBVH MeshBVHBuilder::build(
         Span<const imp::SourceMesh> src_meshes)
 {
@@ -730,6 +753,13 @@ MeshBVH MeshBVHBuilder::build(
     bvh_out.numNodes = nodes.size();
     bvh_out.numLeaves = leafNodes.size();
     bvh_out.numVerts = verticesPtr->size();
+    bvh_out.maxDepth = computeMaxDepth(nodes);
+
+    if (MeshBVH::traversalStackSize(bvh_out.maxDepth) >
+            MeshBVH::maxTraversalStackSize) {
+        FATAL("MeshBVH is too deep to traverse: %u levels",
+              bvh_out.maxDepth);
+    }
 
     bvh_out.nodes = nodes.retrieve_ptr();
     bvh_out.leafMats = leaf_materials.retrieve_ptr();
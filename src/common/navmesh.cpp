@@ -2,6 +2,8 @@
 #include <madrona/utils.hpp>
 #include <madrona/memory.hpp>
 
+#include <algorithm>
+
 namespace madrona {
 
 using namespace math;
@@ -120,6 +122,99 @@ static inline uint32_t hashNavmeshEdge(uint32_t a, uint32_t b)
     return b;
 }
 
+static Navmesh::PolyGrid buildPolyGrid(const Vector3 *vertices,
+                                       const uint32_t *tri_indices,
+                                       uint32_t num_verts,
+                                       uint32_t num_tris)
+{
+    Vector2 grid_min { FLT_MAX, FLT_MAX };
+    Vector2 grid_max { -FLT_MAX, -FLT_MAX };
+    for (uint32_t i = 0; i < num_verts; i++) {
+        Vector3 v = vertices[i];
+        grid_min.x = fminf(grid_min.x, v.x);
+        grid_min.y = fminf(grid_min.y, v.y);
+        grid_max.x = fmaxf(grid_max.x, v.x);
+        grid_max.y = fmaxf(grid_max.y, v.y);
+    }
+
+    // Roughly one cell per triangle
+    float extent_x = grid_max.x - grid_min.x;
+    float extent_y = grid_max.y - grid_min.y;
+    float cell_size = sqrtf(extent_x * extent_y / float(num_tris));
+    cell_size = fmaxf(cell_size, 1e-3f * fmaxf(extent_x, extent_y));
+    cell_size = fmaxf(cell_size, 1e-6f);
+
+    float inv_cell_size = 1.f / cell_size;
+    uint32_t dim_x = uint32_t(extent_x * inv_cell_size) + 1;
+    uint32_t dim_y = uint32_t(extent_y * inv_cell_size) + 1;
+    uint32_t num_cells = dim_x * dim_y;
+
+    auto triCellRange = [&](uint32_t tri_idx,
+                            uint32_t *min_x, uint32_t *min_y,
+                            uint32_t *max_x, uint32_t *max_y) {
+        Vector3 a = vertices[tri_indices[3 * tri_idx]];
+        Vector3 b = vertices[tri_indices[3 * tri_idx + 1]];
+        Vector3 c = vertices[tri_indices[3 * tri_idx + 2]];
+
+        auto toCell = [&](float v, float origin, uint32_t dim) {
+            float cell = (v - origin) * inv_cell_size;
+            return std::min(uint32_t(fmaxf(cell, 0.f)), dim - 1);
+        };
+
+        *min_x = toCell(fminf(fminf(a.x, b.x), c.x), grid_min.x, dim_x);
+        *min_y = toCell(fminf(fminf(a.y, b.y), c.y), grid_min.y, dim_y);
+        *max_x = toCell(fmaxf(fmaxf(a.x, b.x), c.x), grid_min.x, dim_x);
+        *max_y = toCell(fmaxf(fmaxf(a.y, b.y), c.y), grid_min.y, dim_y);
+    };
+
+    uint32_t *cell_offsets =
+        (uint32_t *)rawAlloc(sizeof(uint32_t) * (num_cells + 1));
+    utils::zeroN<uint32_t>(cell_offsets, num_cells + 1);
+
+    for (uint32_t tri_idx = 0; tri_idx < num_tris; tri_idx++) {
+        uint32_t min_x, min_y, max_x, max_y;
+        triCellRange(tri_idx, &min_x, &min_y, &max_x, &max_y);
+
+        for (uint32_t y = min_y; y <= max_y; y++) {
+            for (uint32_t x = min_x; x <= max_x; x++) {
+                cell_offsets[y * dim_x + x + 1] += 1;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < num_cells; i++) {
+        cell_offsets[i + 1] += cell_offsets[i];
+    }
+
+    uint32_t *cell_tris =
+        (uint32_t *)rawAlloc(sizeof(uint32_t) * cell_offsets[num_cells]);
+    uint32_t *cell_fill =
+        (uint32_t *)rawAlloc(sizeof(uint32_t) * num_cells);
+    utils::copyN<uint32_t>(cell_fill, cell_offsets, num_cells);
+
+    for (uint32_t tri_idx = 0; tri_idx < num_tris; tri_idx++) {
+        uint32_t min_x, min_y, max_x, max_y;
+        triCellRange(tri_idx, &min_x, &min_y, &max_x, &max_y);
+
+        for (uint32_t y = min_y; y <= max_y; y++) {
+            for (uint32_t x = min_x; x <= max_x; x++) {
+                cell_tris[cell_fill[y * dim_x + x]++] = tri_idx;
+            }
+        }
+    }
+
+    rawDealloc(cell_fill);
+
+    return Navmesh::PolyGrid {
+        .origin = grid_min,
+        .invCellSize = inv_cell_size,
+        .dimX = dim_x,
+        .dimY = dim_y,
+        .cellOffsets = cell_offsets,
+        .cellTris = cell_tris,
+    };
+}
+
 Navmesh Navmesh::initFromPolygons(
     Vector3 *poly_vertices,
     uint32_t *poly_idxs,
@@ -310,6 +405,8 @@ Navmesh Navmesh::initFromPolygons(
         .triIndices = tri_indices,
         .triAdjacency = tri_adjacency,
         .triSampleAliasTable = alias_tbl,
+        .polyGrid = buildPolyGrid(out_vertices, tri_indices,
+                                  num_verts, num_tris),
         .numVerts = num_verts,
         .numTris = num_tris,
     };
@@ -0,0 +1,353 @@
+#include <madrona/navmesh_distances.hpp>
+#include <madrona/heap_array.hpp>
+#include <madrona/memory.hpp>
+#include <madrona/utils.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace madrona {
+
+using namespace math;
+
+namespace {
+
+// Cache kind tag for navmesh distance tables ("NAVD"). Bump
+// navmeshDistanceCacheVersion when the search changes.
+constexpr uint32_t navmeshDistanceCacheKind = 0x4456414e;
+constexpr uint32_t navmeshDistanceCacheVersion = 1;
+
+// Sits at the start of the cache payload, followed by the table buffer at
+// cachedTableOffset
+struct CachedDistanceTable {
+    float distanceScale;
+    uint32_t numTris;
+    uint64_t numTableBytes;
+};
+
+constexpr uint64_t cachedTableOffset = utils::roundUp(
+    (uint64_t)sizeof(CachedDistanceTable),
+    (uint64_t)assetCachePayloadAlignment);
+
+// Per thread Dijkstra scratch
+struct DistanceSearch {
+    HeapArray<float> costs;
+    HeapArray<uint32_t> heap;
+    HeapArray<uint32_t> heapIndex;
+    HeapArray<uint8_t> parentSlots;
+
+    DistanceSearch(CountT num_tris)
+        : costs(num_tris),
+          heap(num_tris),
+          heapIndex(num_tris),
+          parentSlots(num_tris)
+    {}
+};
+
+}
+
+static inline CountT distanceTableBytes(CountT num_tris,
+                                        CountT *out_next_hops_offset)
+{
+    CountT distances_bytes = sizeof(uint16_t) * num_tris * num_tris;
+    CountT next_hops_offset = utils::roundUp(distances_bytes, (CountT)64);
+    CountT next_hops_bytes = num_tris * ((num_tris + 3) / 4);
+
+    *out_next_hops_offset = next_hops_offset;
+    return next_hops_offset + next_hops_bytes;
+}
+
+static inline Vector3 triCentroid(const Navmesh &navmesh, uint32_t tri_idx)
+{
+    Vector3 a = navmesh.vertices[navmesh.triIndices[3 * tri_idx]];
+    Vector3 b = navmesh.vertices[navmesh.triIndices[3 * tri_idx + 1]];
+    Vector3 c = navmesh.vertices[navmesh.triIndices[3 * tri_idx + 2]];
+
+    return (a + b + c) / 3.f;
+}
+
+// Fixed cost of stepping from tri_idx through adjacency slot i: centroid
+// to edge midpoint to the neighbor's centroid. Symmetric, so searching
+// from the goal gives next hops towards it.
+static inline float stepCost(const Navmesh &navmesh,
+                             const Vector3 *centroids,
+                             uint32_t tri_idx,
+                             CountT i)
+{
+    uint32_t adjacent = navmesh.triAdjacency[3 * tri_idx + i];
+
+    Vector3 edge_a = navmesh.vertices[navmesh.triIndices[3 * tri_idx + i]];
+    Vector3 edge_b =
+        navmesh.vertices[navmesh.triIndices[3 * tri_idx + (i + 1) % 3]];
+    Vector3 edge_midpoint = (edge_a + edge_b) / 2.f;
+
+    return centroids[tri_idx].distance(edge_midpoint) +
+        edge_midpoint.distance(centroids[adjacent]);
+}
+
+static void searchToPoly(const Navmesh &navmesh,
+                         const float *step_costs,
+                         const uint8_t *twin_slots,
+                         uint32_t goal_poly,
+                         DistanceSearch &search)
+{
+    const uint32_t num_tris = navmesh.numTris;
+
+    Navmesh::PathFindQueue prio_queue {
+        .costs = search.costs.data(),
+        .heap = search.heap.data(),
+        .heapIndex = search.heapIndex.data(),
+        .heapSize = 0,
+    };
+    utils::fillN<uint32_t>(prio_queue.heapIndex, Navmesh::sentinel,
+                           num_tris);
+    utils::fillN<float>(search.costs.data(), FLT_MAX, num_tris);
+    utils::fillN<uint8_t>(search.parentSlots.data(),
+                          NavmeshDistanceTable::noNextHop, num_tris);
+
+    prio_queue.add(goal_poly, 0.f);
+    while (prio_queue.heapSize > 0) {
+        uint32_t min_poly = prio_queue.removeMin();
+        float cost_so_far = search.costs[min_poly];
+
+        for (CountT i = 0; i < 3; i++) {
+            uint32_t adjacent = navmesh.triAdjacency[3 * min_poly + i];
+            if (adjacent == Navmesh::sentinel) {
+                continue;
+            }
+
+            float new_cost = cost_so_far + step_costs[3 * min_poly + i];
+            if (new_cost >= search.costs[adjacent]) {
+                continue;
+            }
+
+            search.parentSlots[adjacent] = twin_slots[3 * min_poly + i];
+
+            if (prio_queue.heapIndex[adjacent] == Navmesh::sentinel) {
+                prio_queue.add(adjacent, new_cost);
+            } else {
+                prio_queue.decreaseCost(adjacent, new_cost);
+            }
+        }
+    }
+}
+
+NavmeshDistanceTable NavmeshDistanceTableBuilder::build(
+    const Navmesh &navmesh,
+    CountT num_threads)
+{
+    const uint32_t num_tris = navmesh.numTris;
+
+    HeapArray<Vector3> centroids(num_tris);
+    for (uint32_t i = 0; i < num_tris; i++) {
+        centroids[i] = triCentroid(navmesh, i);
+    }
+
+    // Cost of each adjacency slot, and the slot of the neighbor that
+    // leads back
+    HeapArray<float> step_costs(3 * num_tris);
+    HeapArray<uint8_t> twin_slots(3 * num_tris);
+    for (uint32_t tri_idx = 0; tri_idx < num_tris; tri_idx++) {
+        for (CountT i = 0; i < 3; i++) {
+            uint32_t adjacent = navmesh.triAdjacency[3 * tri_idx + i];
+            if (adjacent == Navmesh::sentinel) {
+                step_costs[3 * tri_idx + i] = FLT_MAX;
+                twin_slots[3 * tri_idx + i] = NavmeshDistanceTable::noNextHop;
+                continue;
+            }
+
+            step_costs[3 * tri_idx + i] =
+                stepCost(navmesh, centroids.data(), tri_idx, i);
+
+            for (CountT j = 0; j < 3; j++) {
+                if (navmesh.triAdjacency[3 * adjacent + j] == tri_idx) {
+                    twin_slots[3 * tri_idx + i] = (uint8_t)j;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (num_threads <= 0) {
+        num_threads = (CountT)std::thread::hardware_concurrency();
+    }
+    num_threads = std::max(std::min(num_threads, (CountT)num_tris),
+                           (CountT)1);
+
+    // Exact distances are needed to pick the quantization scale, so the
+    // searches write floats first and the table is quantized afterwards
+    HeapArray<float> exact_distances((CountT)num_tris * num_tris);
+
+    CountT next_hops_offset;
+    CountT num_table_bytes = distanceTableBytes(num_tris, &next_hops_offset);
+    char *table_buffer = (char *)rawAlloc(num_table_bytes);
+
+    NavmeshDistanceTable tbl {
+        .distances = (uint16_t *)table_buffer,
+        .nextHops = (uint8_t *)(table_buffer + next_hops_offset),
+        .distanceScale = 0.f,
+        .numTris = num_tris,
+    };
+
+    const CountT next_hop_row_bytes = tbl.nextHopRowBytes();
+
+    std::atomic<uint32_t> next_goal = 0;
+    auto threadLoop = [&]() {
+        DistanceSearch search(num_tris);
+
+        uint32_t goal_poly;
+        while ((goal_poly = next_goal.fetch_add(
+                1, std::memory_order_relaxed)) < num_tris) {
+            searchToPoly(navmesh, step_costs.data(), twin_slots.data(),
+                         goal_poly, search);
+
+            utils::copyN<float>(
+                exact_distances.data() + (CountT)goal_poly * num_tris,
+                search.costs.data(), num_tris);
+
+            uint8_t *hop_row =
+                tbl.nextHops + (CountT)goal_poly * next_hop_row_bytes;
+            utils::zeroN<uint8_t>(hop_row, next_hop_row_bytes);
+
+            for (uint32_t i = 0; i < num_tris; i++) {
+                hop_row[i / 4] |= search.parentSlots[i] << (2 * (i % 4));
+            }
+        }
+    };
+
+    HeapArray<std::thread> threads(num_threads - 1);
+    for (CountT i = 0; i < threads.size(); i++) {
+        threads.emplace(i, threadLoop);
+    }
+
+    threadLoop();
+
+    for (std::thread &t : threads) {
+        t.join();
+    }
+
+    float max_distance = 0.f;
+    for (float d : exact_distances) {
+        if (d != FLT_MAX) {
+            max_distance = std::max(max_distance, d);
+        }
+    }
+
+    constexpr float max_quantized =
+        float(NavmeshDistanceTable::unreachableDistance - 1);
+    tbl.distanceScale = max_distance > 0.f ?
+        max_distance / max_quantized : 1.f;
+    float inv_scale = 1.f / tbl.distanceScale;
+
+    for (CountT i = 0; i < exact_distances.size(); i++) {
+        float d = exact_distances[i];
+        if (d == FLT_MAX) {
+            tbl.distances[i] = NavmeshDistanceTable::unreachableDistance;
+        } else {
+            tbl.distances[i] = (uint16_t)std::min(
+                d * inv_scale + 0.5f, max_quantized);
+        }
+    }
+
+    return tbl;
+}
+
+void NavmeshDistanceTableBuilder::free(NavmeshDistanceTable &tbl)
+{
+    rawDealloc(tbl.distances);
+}
+
+uint64_t NavmeshDistanceTableBuilder::hashSources(const Navmesh &navmesh)
+{
+    AssetHasher hasher(navmeshDistanceCacheVersion);
+
+    hasher.addArray(navmesh.vertices, navmesh.numVerts);
+    hasher.addArray(navmesh.triIndices, 3 * navmesh.numTris);
+    hasher.addArray(navmesh.triAdjacency, 3 * navmesh.numTris);
+
+    return hasher.finish();
+}
+
+bool NavmeshDistanceTableBuilder::writeCache(const char *path,
+                                             uint64_t source_hash,
+                                             const NavmeshDistanceTable &tbl)
+{
+    CountT next_hops_offset;
+    CountT num_table_bytes =
+        distanceTableBytes(tbl.numTris, &next_hops_offset);
+
+    CachedDistanceTable cached {
+        .distanceScale = tbl.distanceScale,
+        .numTris = tbl.numTris,
+        .numTableBytes = (uint64_t)num_table_bytes,
+    };
+
+    uint64_t num_payload_bytes = cachedTableOffset + num_table_bytes;
+    char *payload = (char *)malloc(num_payload_bytes);
+    if (payload == nullptr) {
+        return false;
+    }
+
+    memset(payload, 0, cachedTableOffset);
+    memcpy(payload, &cached, sizeof(CachedDistanceTable));
+
+    // Tables loaded from a cache may not be a single allocation, so copy
+    // the two arrays separately
+    char *table_copy = payload + cachedTableOffset;
+    memset(table_copy, 0, num_table_bytes);
+    memcpy(table_copy, tbl.distances,
+           sizeof(uint16_t) * tbl.numTris * tbl.numTris);
+    memcpy(table_copy + next_hops_offset, tbl.nextHops,
+           tbl.numTris * tbl.nextHopRowBytes());
+
+    bool success = writeAssetCache(path, navmeshDistanceCacheKind,
+        source_hash, payload, num_payload_bytes);
+
+    ::free(payload);
+
+    return success;
+}
+
+Optional<MappedAssetCache> NavmeshDistanceTableBuilder::loadCache(
+    const char *path,
+    uint64_t source_hash,
+    NavmeshDistanceTable *out_tbl)
+{
+    Optional<MappedAssetCache> mapped = MappedAssetCache::map(
+        path, navmeshDistanceCacheKind, source_hash);
+
+    if (!mapped.has_value()) {
+        return mapped;
+    }
+
+    if (mapped->numBytes() < cachedTableOffset) {
+        return Optional<MappedAssetCache>::none();
+    }
+
+    CachedDistanceTable cached;
+    memcpy(&cached, mapped->data(), sizeof(CachedDistanceTable));
+
+    CountT next_hops_offset;
+    CountT num_table_bytes =
+        distanceTableBytes(cached.numTris, &next_hops_offset);
+
+    if ((uint64_t)num_table_bytes != cached.numTableBytes ||
+            mapped->numBytes() < cachedTableOffset + num_table_bytes) {
+        return Optional<MappedAssetCache>::none();
+    }
+
+    char *table = mapped->data() + cachedTableOffset;
+
+    *out_tbl = NavmeshDistanceTable {
+        .distances = (uint16_t *)table,
+        .nextHops = (uint8_t *)(table + next_hops_offset),
+        .distanceScale = cached.distanceScale,
+        .numTris = cached.numTris,
+    };
+
+    return mapped;
+}
+
+}
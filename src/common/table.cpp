@@ -6,41 +6,214 @@
  * https://opensource.org/licenses/MIT.
  */
 #include <madrona/table.hpp>
+#include <madrona/crash.hpp>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
 #include <cstring>
 #include <type_traits>
 
 namespace madrona {
 
 namespace ICfg {
-inline constexpr uint32_t maxRowsPerTable = 1u << 28u;
+inline constexpr uint64_t columnSlotAlignment = 64 * 1024;
+inline constexpr uint32_t numColumnStartOffsets = 64;
+// Room left for columnStartOffset in shared column slots
+inline constexpr uint64_t maxColumnStartOffset = 4096;
+// Column start offsets are kept modulo this when a table is relocated
+inline constexpr uint64_t pageOffsetAlignment = 4096;
+inline constexpr uint64_t hugePageBytes = 2 * 1024 * 1024;
+}
+
+// Advanced by every table so the same column of different tables also
+// starts at different cache line offsets
+static std::atomic_uint32_t nextColumnStartSalt = 0;
+
+static uint64_t columnStartOffset(uint32_t salt, int column_idx,
+                                  uint32_t alignment)
+{
+    uint64_t offset = uint64_t((salt + (uint32_t)column_idx) %
+        ICfg::numColumnStartOffsets) * MADRONA_CACHE_LINE;
+
+    return utils::roundUp(offset, (uint64_t)alignment);
 }
 
 Table::Table(const TypeInfo *component_types, CountT num_components,
-             CountT init_num_rows)
+             CountT init_num_rows, CountT max_num_rows)
     : num_rows_(init_num_rows),
-      num_allocated_rows_(std::max(uint32_t(init_num_rows), 1_u32)),
+      num_allocated_rows_(0),
+      num_components_(num_components),
+      columns_(),
+      bytes_per_column_(),
+      column_regions_(nullptr),
+      owned_region_(Optional<VirtualRegion>::none()),
+      max_num_rows_(uint32_t(std::max(max_num_rows, init_num_rows))),
+      fixed_columns_(false)
+{
+    uint32_t salt = nextColumnStartSalt.fetch_add(
+        (uint32_t)num_components, std::memory_order_relaxed);
+
+    std::array<uint64_t, maxColumns> column_offsets;
+    uint64_t total_bytes = 0;
+
+    for (int i = 0; i < (int)num_components; i++) {
+        const TypeInfo &type = component_types[i];
+
+        uint64_t start_offset = columnStartOffset(salt, i, type.alignment);
+        column_offsets[i] = total_bytes + start_offset;
+
+        total_bytes += utils::roundUp(start_offset +
+            (uint64_t)type.numBytes * (uint64_t)max_num_rows_,
+            ICfg::columnSlotAlignment);
+
+        bytes_per_column_[i] = type.numBytes;
+    }
+
+    VirtualRegion &region = owned_region_.emplace(total_bytes, 0, 1);
+
+    for (int i = 0; i < (int)num_components; i++) {
+        columns_[i] = (char *)region.ptr() + column_offsets[i];
+    }
+
+    uint32_t num_init_allocated = std::max(uint32_t(init_num_rows), 1_u32);
+    commitRows(0, num_init_allocated);
+    num_allocated_rows_ = num_init_allocated;
+}
+
+Table::Table(const TypeInfo *component_types, CountT num_components,
+             VirtualRegion *column_regions, CountT row_slot,
+             CountT max_num_rows, bool offset_columns,
+             bool fixed_columns)
+    : num_rows_(0),
+      num_allocated_rows_(0),
       num_components_(num_components),
       columns_(),
-      bytes_per_column_()
+      bytes_per_column_(),
+      column_regions_(column_regions),
+      owned_region_(Optional<VirtualRegion>::none()),
+      max_num_rows_(uint32_t(max_num_rows)),
+      fixed_columns_(fixed_columns)
 {
+    uint32_t salt = 0;
+    if (offset_columns) {
+        salt = nextColumnStartSalt.fetch_add(
+            (uint32_t)num_components, std::memory_order_relaxed);
+    }
+
     for (int i = 0; i < (int)num_components; i++) {
         const TypeInfo &type = component_types[i];
 
-#if 0
-        // 3rd argument is offsetting the start from the page aligned boundary
-        // to avoid everything mapping to the same cache sets. Should revisit -
-        // maybe add a random offset for each Table as well?
-        columns_.emplace_back(type.numBytes, type.alignment,
-            MADRONA_CACHE_LINE * (i + 1), ICfg::maxRowsPerTable);
+        uint64_t slot_bytes =
+            columnSlotBytes(type.numBytes, max_num_rows, offset_columns);
+
+        uint64_t start_offset = 0;
+        if (offset_columns) {
+            start_offset = columnStartOffset(salt, i, type.alignment);
+            assert(start_offset <= ICfg::maxColumnStartOffset);
+        }
+
+        columns_[i] = (char *)column_regions[i].ptr() +
+            (uint64_t)row_slot * slot_bytes + start_offset;
+        bytes_per_column_[i] = type.numBytes;
+    }
+
+    commitRows(0, 1);
+    num_allocated_rows_ = 1;
+}
+
+uint64_t Table::columnSlotBytes(uint32_t bytes_per_row,
+                                CountT max_num_rows,
+                                bool offset_columns)
+{
+    uint64_t num_bytes = (uint64_t)bytes_per_row * (uint64_t)max_num_rows;
+    if (offset_columns) {
+        num_bytes += ICfg::maxColumnStartOffset;
+    }
+
+    return utils::roundUp(num_bytes, ICfg::columnSlotAlignment);
+}
+
+void Table::commitRows(uint32_t num_committed_rows, uint32_t num_new_rows)
+{
+    for (int i = 0; i < (int)num_components_; i++) {
+        VirtualRegion &region = column_regions_ != nullptr ?
+            column_regions_[i] : *owned_region_;
+        uint64_t chunk_size = region.chunkSize();
+        uint64_t column_offset =
+            (uint64_t)((char *)columns_[i] - (char *)region.ptr());
+
+        // Columns in an owned region start partway into their first chunk
+        uint64_t start_chunk = column_offset / chunk_size;
+        uint64_t start_pad = column_offset - start_chunk * chunk_size;
+
+        uint64_t committed_chunks = num_committed_rows == 0 ? 0 :
+            utils::divideRoundUp(start_pad +
+                uint64_t(num_committed_rows) * bytes_per_column_[i],
+                chunk_size);
+        uint64_t needed_chunks = utils::divideRoundUp(start_pad +
+            uint64_t(num_new_rows) * bytes_per_column_[i], chunk_size);
+
+        // Lazily backed regions are usable as soon as they're mapped
+        if (needed_chunks > committed_chunks && region.needsCommit()) {
+            region.commitChunks(start_chunk + committed_chunks,
+                                needed_chunks - committed_chunks);
+        }
+
+#ifdef MADRONA_HUGE_PAGE_TABLES
+        // Small columns stay on regular pages, otherwise every tiny
+        // per-world table would pin a full huge page per column. Shared
+        // regions are advised as a whole by their owner instead, advising
+        // each table's range would split the region's mapping.
+        if (column_regions_ == nullptr && needed_chunks > committed_chunks &&
+                needed_chunks * chunk_size >= ICfg::hugePageBytes) {
+            region.adviseHugePages(start_chunk, needed_chunks);
+        }
 #endif
+    }
+}
+
+// Moves the rows into a new region owned by the table, reserved like in
+// the first constructor. Columns keep their offset from the page boundary,
+// which also keeps them aligned. A shared slot that is left behind stays
+// committed until its region is destroyed.
+void Table::relocate(uint32_t new_max_rows)
+{
+    std::array<uint64_t, maxColumns> column_offsets;
+    uint64_t total_bytes = 0;
+
+    for (int i = 0; i < (int)num_components_; i++) {
+        uint64_t start_offset =
+            (uint64_t)(uintptr_t)columns_[i] % ICfg::pageOffsetAlignment;
+        column_offsets[i] = total_bytes + start_offset;
 
-        size_t column_bytes_per_row = (size_t)type.numBytes;
-        columns_[i] = malloc(
-            (size_t)column_bytes_per_row * (size_t)num_allocated_rows_);
-        bytes_per_column_[i] = column_bytes_per_row;
+        total_bytes += utils::roundUp(start_offset +
+            (uint64_t)bytes_per_column_[i] * (uint64_t)new_max_rows,
+            ICfg::columnSlotAlignment);
     }
+
+    // Keeps the old region mapped until the rows are copied out of it
+    Optional<VirtualRegion> old_region = std::move(owned_region_);
+    std::array<void *, maxColumns> old_columns;
+    for (int i = 0; i < (int)num_components_; i++) {
+        old_columns[i] = columns_[i];
+    }
+
+    VirtualRegion &region = owned_region_.emplace(total_bytes, 0, 1);
+    for (int i = 0; i < (int)num_components_; i++) {
+        columns_[i] = (char *)region.ptr() + column_offsets[i];
+    }
+    column_regions_ = nullptr;
+
+    commitRows(0, num_allocated_rows_);
+
+    for (int i = 0; i < (int)num_components_; i++) {
+        memcpy(columns_[i], old_columns[i],
+               uint64_t(num_allocated_rows_) * bytes_per_column_[i]);
+    }
+
+    max_num_rows_ = new_max_rows;
 }
 
 uint32_t Table::addRow()
@@ -48,14 +221,20 @@ uint32_t Table::addRow()
     uint32_t idx = num_rows_++;
 
     if (idx >= num_allocated_rows_) {
-        uint32_t new_num_rows =
-            std::max(std::max(10_u32, uint32_t(num_allocated_rows_ * 2)), idx);
+        if (idx >= max_num_rows_) [[unlikely]] {
+            if (fixed_columns_ || idx >= maxRows) {
+                FATAL("Table exceeded its limit of %u rows", max_num_rows_);
+            }
 
-        for (int i = 0; i < (int)num_components_; i++) {
-            columns_[i] = realloc(columns_[i],
-                uint64_t(new_num_rows) * uint64_t(bytes_per_column_[i]));
+            relocate(uint32_t(std::min(uint64_t(max_num_rows_) * 2,
+                                       uint64_t(maxRows))));
         }
 
+        uint32_t new_num_rows =
+            std::max(std::max(10_u32, uint32_t(num_allocated_rows_ * 2)), idx);
+        new_num_rows = std::min(new_num_rows, max_num_rows_);
+
+        commitRows(num_allocated_rows_, new_num_rows);
         num_allocated_rows_ = new_num_rows;
     }
 
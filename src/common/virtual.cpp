@@ -45,9 +45,11 @@ struct VirtualRegion::Init {
     uint64_t chunkShift;
     uint64_t totalSize;
     uint64_t initChunks;
+    bool lazyBacking;
 
     static inline Init make(uint64_t max_bytes, uint64_t chunk_shift,
-                            uint64_t alignment, uint64_t init_chunks)
+                            uint64_t alignment, uint64_t init_chunks,
+                            bool lazy_backing)
     {
         uint32_t page_size, alloc_granularity;
         getVirtualMemProperties(&page_size, &alloc_granularity);
@@ -87,14 +89,23 @@ struct VirtualRegion::Init {
         constexpr int mmap_init_flags = MAP_PRIVATE | MAP_ANON;
 #endif
     
-        void *base =
-            mmap(nullptr, overalign_size, PROT_NONE, mmap_init_flags, -1, 0);
+        int mmap_init_prot = PROT_NONE;
+        if (lazy_backing) {
+            mmap_init_prot = PROT_READ | PROT_WRITE;
+        }
+
+        void *base = mmap(nullptr, overalign_size, mmap_init_prot,
+                          mmap_init_flags, -1, 0);
     
         if (base == MAP_FAILED) [[unlikely]] {
             FATAL("Failed to allocate %lu bytes of virtual address space",
                   overalign_size);
         }
 #elif _WIN32
+        // Committed memory counts against the commit limit whether or not
+        // it is touched, so Windows regions are always committed in chunks
+        lazy_backing = false;
+
         void *base = VirtualAlloc(nullptr, overalign_size, MEM_RESERVE,
                                   PAGE_NOACCESS);
 
@@ -118,22 +129,26 @@ struct VirtualRegion::Init {
             .chunkShift = chunk_shift,
             .totalSize = overalign_size,
             .initChunks = init_chunks,
+            .lazyBacking = lazy_backing,
         };
     }
 };
 
 VirtualRegion::VirtualRegion(uint64_t max_bytes, uint64_t chunk_shift,
-                             uint64_t alignment, uint64_t init_chunks)
-    : VirtualRegion(Init::make(max_bytes, chunk_shift, alignment, init_chunks))
+                             uint64_t alignment, uint64_t init_chunks,
+                             bool lazy_backing)
+    : VirtualRegion(Init::make(max_bytes, chunk_shift, alignment, init_chunks,
+                               lazy_backing))
 {}
 
 VirtualRegion::VirtualRegion(Init init)
     : base_(init.base),
       aligned_(init.aligned),
       chunk_shift_(init.chunkShift),
-      total_size_(init.totalSize)
+      total_size_(init.totalSize),
+      lazy_backing_(init.lazyBacking)
 {
-    if (init.initChunks > 0) {
+    if (init.initChunks > 0 && !lazy_backing_) {
         commitChunks(0, init.initChunks);
     }
 }
@@ -142,7 +157,8 @@ VirtualRegion::VirtualRegion(VirtualRegion &&o)
     : base_(o.base_),
       aligned_(o.aligned_),
       chunk_shift_(o.chunk_shift_),
-      total_size_(o.total_size_)
+      total_size_(o.total_size_),
+      lazy_backing_(o.lazy_backing_)
 {
     o.base_ = nullptr;
 }
@@ -210,6 +226,20 @@ void VirtualRegion::decommitChunks(uint64_t start_chunk, uint64_t num_chunks)
     }
 }
 
+void VirtualRegion::adviseHugePages(uint64_t start_chunk, uint64_t num_chunks)
+{
+#ifdef MADRONA_LINUX
+    void *start = base_ + (start_chunk << chunk_shift_);
+    uint64_t num_bytes = num_chunks << chunk_shift_;
+
+    // Not fatal: fails when the kernel is built without THP support
+    madvise(start, num_bytes, MADV_HUGEPAGE);
+#else
+    (void)start_chunk;
+    (void)num_chunks;
+#endif
+}
+
 static uint64_t computeChunkShift(uint32_t bytes_per_item)
 {
     static constexpr uint64_t min_chunk_shift = 14;
@@ -28,6 +28,29 @@ namespace madrona {
 
 namespace ICfg {
 static constexpr uint32_t maxQueryOffsets = 100'000;
+// Address space reserved for the tables of one dynamically sized
+// archetype, split evenly between worlds. Kept well below the 128TiB
+// user address space on x86-64 even with many archetypes and worlds.
+static constexpr uint64_t dynamicTableReservationBytes = 128_u64 << 30;
+static constexpr uint64_t minTableReservationBytes = 16_u64 << 20;
+}
+
+// Tables reserve their capacity up front (see Table), so the rows each
+// dynamically sized table gets in place are bounded by the address space
+// it is given. Tables that grow past this move to their own reservation.
+static CountT dynamicTableMaxRows(Span<TypeInfo> types, CountT num_worlds)
+{
+    uint64_t bytes_per_row = 0;
+    for (const TypeInfo &type : types) {
+        bytes_per_row += type.numBytes;
+    }
+
+    uint64_t reservation_bytes = std::max(
+        ICfg::dynamicTableReservationBytes / (uint64_t)num_worlds,
+        ICfg::minTableReservationBytes);
+
+    return (CountT)std::min(reservation_bytes / bytes_per_row,
+                            (uint64_t)Table::maxRows);
 }
 
 ECSRegistry::ECSRegistry(StateManager *state_mgr, void **export_ptrs)
@@ -139,6 +162,7 @@ StateManager::StateManager(CountT num_worlds)
       bundle_components_(0),
       bundle_infos_(0),
       export_jobs_(0),
+      row_range_exports_(0),
       tmp_allocators_(num_worlds),
       num_worlds_(num_worlds),
       register_lock_()
@@ -211,19 +235,53 @@ void StateManager::destroyEntityNow(MADRONA_MW_COND(uint32_t world_id,)
 #ifdef MADRONA_MW_MODE
 StateManager::TableStorage::TableStorage(Span<TypeInfo> types,
                                          CountT num_worlds,
-                                         CountT max_num_per_world)
+                                         CountT max_num_per_world,
+                                         ArchetypeFlags archetype_flags)
+    : columnRegions(0)
 {
     maxNumPerWorld = max_num_per_world;
 
+    bool zero_copy = max_num_per_world == 0 &&
+        (archetype_flags & ArchetypeFlags::ZeroCopyExport) ==
+            ArchetypeFlags::ZeroCopyExport;
+    zeroCopy = zero_copy;
+
     if (max_num_per_world == 0) {
+        // Every world's table is a slot in one region per column, shared
+        // by all worlds. The regions are lazily backed, so the number of
+        // mappings doesn't grow with the number of worlds (per world
+        // regions ran into vm.max_map_count with thousands of worlds).
+        // Zero copy exports need the columns at a fixed stride per world.
+        CountT max_rows_per_world = zero_copy ? zeroCopyMaxRowsPerWorld :
+            dynamicTableMaxRows(types, num_worlds);
+        bool offset_columns = !zero_copy;
+
+        columnRegions = HeapArray<VirtualRegion>(types.size());
+
+        for (CountT i = 0; i < types.size(); i++) {
+            uint64_t slot_bytes = Table::columnSlotBytes(
+                types[i].numBytes, max_rows_per_world, offset_columns);
+
+            columnRegions.emplace(i, slot_bytes * num_worlds, 0, 1, 0, true);
+
+#ifdef MADRONA_HUGE_PAGE_TABLES
+            if (slot_bytes >= (2_u64 << 20)) {
+                columnRegions[i].adviseHugePages(0, utils::divideRoundUp(
+                    slot_bytes * num_worlds, columnRegions[i].chunkSize()));
+            }
+#endif
+        }
+
         new (&tbls) HeapArray<Table>(num_worlds);
 
         for (CountT i = 0; i < num_worlds; i++) {
-            tbls.emplace(i, types.data(), types.size(), 0);
+            tbls.emplace(i, types.data(), types.size(), columnRegions.data(),
+                         i, max_rows_per_world, offset_columns, zero_copy);
         }
     } else {
         new (&fixed) Fixed {
             Table(types.data(), types.size(),
+                  max_num_per_world * num_worlds,
                   max_num_per_world * num_worlds),
             HeapArray<int32_t>(num_worlds),
         };
@@ -245,7 +303,7 @@ StateManager::TableStorage::~TableStorage()
 
 #else
 StateManager::TableStorage::TableStorage(Span<TypeInfo> types)
-    : tbl(types.data(), types.size(), 0)
+    : tbl(types.data(), types.size(), 0, dynamicTableMaxRows(types, 1))
 {}
 #endif
 
@@ -258,6 +316,7 @@ struct StateManager::ArchetypeStore::Init {
     CountT maxNumEntitiesPerWorld;
 #ifdef MADRONA_MW_MODE
     CountT numWorlds;
+    ArchetypeFlags archetypeFlags;
 #endif
 };
 
@@ -265,7 +324,8 @@ StateManager::ArchetypeStore::ArchetypeStore(Init &&init)
     : componentOffset(init.componentOffset),
       numComponents(init.numComponents),
       tblStorage(init.types
-          MADRONA_MW_COND(, init.numWorlds, init.maxNumEntitiesPerWorld)),
+          MADRONA_MW_COND(, init.numWorlds, init.maxNumEntitiesPerWorld,
+                          init.archetypeFlags)),
       columnLookup(init.lookupInputs.data(), init.lookupInputs.size())
 {}
 
@@ -464,7 +524,7 @@ void StateManager::registerArchetype(uint32_t id,
         Span(type_infos.data(), num_total_components),
         Span(lookup_input.data(), num_total_user_components),
         max_num_entities_per_world,
-        MADRONA_MW_COND(num_worlds_,)
+        MADRONA_MW_COND(num_worlds_, archetype_flags,)
     });
 }
 
@@ -509,7 +569,8 @@ void StateManager::registerBundle(uint32_t id,
     };
 }
 
-void * StateManager::exportColumn(uint32_t archetype_id, uint32_t component_id)
+void * StateManager::exportColumn(uint32_t archetype_id, uint32_t component_id,
+                                  ExportFlags flags)
 {
     auto &archetype = *archetype_stores_[archetype_id];
     uint32_t col_idx;
@@ -527,7 +588,10 @@ void * StateManager::exportColumn(uint32_t archetype_id, uint32_t component_id)
     }
 
 #ifdef MADRONA_MW_MODE
-    if (archetype.tblStorage.maxNumPerWorld == 0) {
+    if (archetype.tblStorage.zeroCopy) {
+        (void)flags;
+        return archetype.tblStorage.columnRegions[col_idx].ptr();
+    } else if (archetype.tblStorage.maxNumPerWorld == 0) {
 
         uint32_t num_bytes_per_row = component_infos_[component_id]->numBytes;
         uint64_t map_size = 1'000'000'000 * num_bytes_per_row;
@@ -535,12 +599,20 @@ void * StateManager::exportColumn(uint32_t archetype_id, uint32_t component_id)
         VirtualRegion mem(map_size, 0, 1);
         void *export_buffer = mem.ptr();
 
+        CountT num_worlds = archetype.tblStorage.tbls.size();
+        HeapArray<uint32_t> world_offsets(num_worlds + 1);
+        for (CountT i = 0; i <= num_worlds; i++) {
+            world_offsets[i] = 0;
+        }
+
         export_jobs_.push_back(ExportJob {
             .archetypeIdx = archetype_id,
             .columnIdx = col_idx,
             .numBytesPerRow = num_bytes_per_row,
+            .flags = flags,
             .numMappedChunks = 0,
             .mem = std::move(mem),
+            .worldOffsets = std::move(world_offsets),
         });
 
         return export_buffer;
@@ -548,33 +620,42 @@ void * StateManager::exportColumn(uint32_t archetype_id, uint32_t component_id)
         return archetype.tblStorage.fixed.tbl.data(col_idx);
     }
 #else
+    (void)flags;
     return archetype.tblStorage.tbl.data(col_idx);
 #endif
 }
 
-void StateManager::copyInExportedColumns()
-{
 #ifdef MADRONA_MW_MODE
-    for (ExportJob &export_job : export_jobs_) {
-        auto &archetype = *archetype_stores_[export_job.archetypeIdx];
+ExportedRowRange * StateManager::exportRowRanges(uint32_t archetype_id)
+{
+    HeapArray<ExportedRowRange> ranges(num_worlds_);
+    for (CountT i = 0; i < num_worlds_; i++) {
+        ranges[i] = ExportedRowRange {
+            .offset = 0,
+            .numRows = 0,
+        };
+    }
 
-        CountT cumulative_copied_rows = 0;
-        for (Table &tbl : archetype.tblStorage.tbls) {
-            CountT num_rows = tbl.numRows();
+    ExportedRowRange *ranges_ptr = ranges.data();
 
-            if (num_rows == 0) {
-                continue;
-            }
+    row_range_exports_.push_back(RowRangeExport {
+        .archetypeIdx = archetype_id,
+        .ranges = std::move(ranges),
+    });
 
-            CountT tbl_start = cumulative_copied_rows;
+    return ranges_ptr;
+}
+#endif
 
-            cumulative_copied_rows += num_rows;
+void StateManager::copyInExportedColumns()
+{
+#ifdef MADRONA_MW_MODE
+    if (!hasCopyInColumns()) {
+        return;
+    }
 
-            memcpy(tbl.data(export_job.columnIdx),
-                   (char *)export_job.mem.ptr() +
-                       tbl_start * export_job.numBytesPerRow,
-                   export_job.numBytesPerRow * num_rows);
-        }
+    for (CountT i = 0; i < num_worlds_; i++) {
+        copyInExportedColumns(uint32_t(i));
     }
 #endif
 }
@@ -582,48 +663,166 @@ void StateManager::copyInExportedColumns()
 void StateManager::copyOutExportedColumns()
 {
 #ifdef MADRONA_MW_MODE
+    prepareCopyOut();
+
+    if (!hasCopyOutColumns()) {
+        return;
+    }
+
+    for (CountT i = 0; i < num_worlds_; i++) {
+        copyOutExportedColumns(uint32_t(i));
+    }
+#endif
+}
+
+#ifdef MADRONA_MW_MODE
+bool StateManager::hasCopyInColumns() const
+{
+    for (const ExportJob &export_job : export_jobs_) {
+        if ((export_job.flags & ExportFlags::WriteOnly) ==
+                ExportFlags::WriteOnly) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool StateManager::hasCopyOutColumns() const
+{
+    for (const ExportJob &export_job : export_jobs_) {
+        if ((export_job.flags & ExportFlags::ReadOnly) ==
+                ExportFlags::ReadOnly) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Tables aren't modified between the end of one step and the start of the
+// next, so the layout computed by the last prepareCopyOut() still matches
+// the rows of each world.
+void StateManager::copyInExportedColumns(uint32_t world_id)
+{
     for (ExportJob &export_job : export_jobs_) {
+        if ((export_job.flags & ExportFlags::WriteOnly) !=
+                ExportFlags::WriteOnly) {
+            continue;
+        }
+
         auto &archetype = *archetype_stores_[export_job.archetypeIdx];
+        Table &tbl = archetype.tblStorage.tbls[world_id];
 
-        CountT cumulative_copied_rows = 0;
-        for (Table &tbl : archetype.tblStorage.tbls) {
-            CountT num_rows = tbl.numRows();
+        uint32_t tbl_start = export_job.worldOffsets[world_id];
+        CountT num_rows = std::min(CountT(tbl.numRows()),
+            CountT(export_job.worldOffsets[world_id + 1] - tbl_start));
 
-            if (num_rows == 0) {
-                continue;
-            }
+        if (num_rows == 0) {
+            continue;
+        }
+
+        memcpy(tbl.data(export_job.columnIdx),
+               (char *)export_job.mem.ptr() +
+                   (uint64_t)tbl_start * export_job.numBytesPerRow,
+               export_job.numBytesPerRow * num_rows);
+    }
+}
 
-            CountT tbl_start = cumulative_copied_rows;
-            cumulative_copied_rows += num_rows;
+void StateManager::prepareCopyOut()
+{
+    for (ExportJob &export_job : export_jobs_) {
+        auto &archetype = *archetype_stores_[export_job.archetypeIdx];
 
-            uint64_t num_mapped_chunks = export_job.numMappedChunks;
-            uint64_t num_mapped_bytes =
-                 num_mapped_chunks * export_job.mem.chunkSize();
+        uint32_t cumulative_rows = 0;
+        for (CountT i = 0; i < num_worlds_; i++) {
+            export_job.worldOffsets[i] = cumulative_rows;
+            cumulative_rows += uint32_t(archetype.tblStorage.tbls[i].numRows());
+        }
+        export_job.worldOffsets[num_worlds_] = cumulative_rows;
 
-            uint64_t num_needed_bytes = (uint64_t)cumulative_copied_rows *
-                (uint64_t)export_job.numBytesPerRow;
+        uint64_t num_mapped_chunks = export_job.numMappedChunks;
+        uint64_t num_mapped_bytes =
+             num_mapped_chunks * export_job.mem.chunkSize();
 
-            if (num_needed_bytes > num_mapped_bytes) {
-                uint64_t new_num_mapped_bytes =
-                    std::max(num_mapped_bytes * 2, num_needed_bytes);
+        uint64_t num_needed_bytes = (uint64_t)cumulative_rows *
+            (uint64_t)export_job.numBytesPerRow;
 
-                uint64_t new_num_chunks = utils::divideRoundUp(
-                    new_num_mapped_bytes, export_job.mem.chunkSize());
+        if (num_needed_bytes > num_mapped_bytes) {
+            uint64_t new_num_mapped_bytes =
+                std::max(num_mapped_bytes * 2, num_needed_bytes);
 
-                export_job.mem.commitChunks(num_mapped_chunks,
-                    new_num_chunks - num_mapped_chunks);
-                export_job.numMappedChunks = new_num_chunks;
+            uint64_t new_num_chunks = utils::divideRoundUp(
+                new_num_mapped_bytes, export_job.mem.chunkSize());
+
+            export_job.mem.commitChunks(num_mapped_chunks,
+                new_num_chunks - num_mapped_chunks);
+            export_job.numMappedChunks = new_num_chunks;
+        }
+    }
+
+    for (RowRangeExport &row_range_export : row_range_exports_) {
+        auto &tbl_storage =
+            archetype_stores_[row_range_export.archetypeIdx]->tblStorage;
+        ExportedRowRange *ranges = row_range_export.ranges.data();
+
+        // Must match the layout of exportColumn() for this archetype
+        if (tbl_storage.zeroCopy) {
+            for (CountT i = 0; i < num_worlds_; i++) {
+                ranges[i] = ExportedRowRange {
+                    .offset = int64_t(i * zeroCopyMaxRowsPerWorld),
+                    .numRows = int32_t(tbl_storage.tbls[i].numRows()),
+                };
             }
+        } else if (tbl_storage.maxNumPerWorld == 0) {
+            int64_t cumulative_rows = 0;
+            for (CountT i = 0; i < num_worlds_; i++) {
+                int32_t num_rows = int32_t(tbl_storage.tbls[i].numRows());
+
+                ranges[i] = ExportedRowRange {
+                    .offset = cumulative_rows,
+                    .numRows = num_rows,
+                };
 
-            memcpy((char *)export_job.mem.ptr() +
-                       tbl_start * export_job.numBytesPerRow,
-                   tbl.data(export_job.columnIdx),
-                   export_job.numBytesPerRow * num_rows);
+                cumulative_rows += num_rows;
+            }
+        } else {
+            for (CountT i = 0; i < num_worlds_; i++) {
+                ranges[i] = ExportedRowRange {
+                    .offset = int64_t(i * tbl_storage.maxNumPerWorld),
+                    .numRows = tbl_storage.fixed.activeRows[i],
+                };
+            }
         }
     }
-#endif
 }
 
+void StateManager::copyOutExportedColumns(uint32_t world_id)
+{
+    for (ExportJob &export_job : export_jobs_) {
+        if ((export_job.flags & ExportFlags::ReadOnly) !=
+                ExportFlags::ReadOnly) {
+            continue;
+        }
+
+        auto &archetype = *archetype_stores_[export_job.archetypeIdx];
+        Table &tbl = archetype.tblStorage.tbls[world_id];
+
+        uint32_t tbl_start = export_job.worldOffsets[world_id];
+        CountT num_rows = export_job.worldOffsets[world_id + 1] - tbl_start;
+
+        if (num_rows == 0) {
+            continue;
+        }
+
+        memcpy((char *)export_job.mem.ptr() +
+                   (uint64_t)tbl_start * export_job.numBytesPerRow,
+               tbl.data(export_job.columnIdx),
+               export_job.numBytesPerRow * num_rows);
+    }
+}
+#endif
+
 void StateManager::clear(MADRONA_MW_COND(uint32_t world_id,)
                          StateCache &cache, uint32_t archetype_id,
                          bool is_temporary)
@@ -642,6 +841,177 @@ void StateManager::clear(MADRONA_MW_COND(uint32_t world_id,)
     archetype.tblStorage.clear(MADRONA_MW_COND(world_id));
 }
 
+namespace {
+
+// Scratch memory for StateManager::sortArchetype. Per thread so worlds
+// being sorted concurrently on different workers never share it, and
+// grown rather than freed so the steady state doesn't allocate.
+struct ArchetypeSortScratch {
+    char *data = nullptr;
+    uint64_t numBytes = 0;
+
+    ~ArchetypeSortScratch()
+    {
+        rawDealloc(data);
+    }
+
+    char * reserve(uint64_t num_bytes)
+    {
+        if (num_bytes > numBytes) {
+            rawDealloc(data);
+            data = (char *)rawAlloc(num_bytes);
+            numBytes = num_bytes;
+        }
+
+        return data;
+    }
+};
+
+thread_local ArchetypeSortScratch archetypeSortScratch;
+
+}
+
+void StateManager::sortArchetype(MADRONA_MW_COND(uint32_t world_id,)
+                                 uint32_t archetype_id,
+                                 uint32_t component_id)
+{
+#ifdef MADRONA_MW_MODE
+    if (component_id == componentID<WorldID>().id) {
+        return;
+    }
+#endif
+
+    ArchetypeStore &archetype = *archetype_stores_[archetype_id];
+    TableStorage &tbl_storage = archetype.tblStorage;
+
+    const uint32_t num_rows =
+        (uint32_t)tbl_storage.numRows(MADRONA_MW_COND(world_id));
+    if (num_rows <= 1) {
+        return;
+    }
+
+    uint32_t key_col = *archetype.columnLookup.lookup(component_id);
+
+    const CountT num_columns =
+        user_component_offset_ + archetype.numComponents;
+
+    auto columnNumBytes = [&](CountT col_idx) {
+        uint32_t col_component_id;
+        if (col_idx == 0) {
+            col_component_id = 0;
+#ifdef MADRONA_MW_MODE
+        } else if (col_idx == 1) {
+            col_component_id = componentID<WorldID>().id;
+#endif
+        } else {
+            col_component_id = archetype_components_[archetype.componentOffset +
+                col_idx - user_component_offset_].id;
+        }
+
+        return (uint64_t)component_infos_[col_component_id]->numBytes;
+    };
+
+    uint64_t max_column_bytes = 0;
+    for (CountT i = 0; i < num_columns; i++) {
+        max_column_bytes = std::max(max_column_bytes, columnNumBytes(i));
+    }
+
+    // Key and row index ping-pong buffers, followed by a staging row for
+    // permuting the columns
+    uint64_t num_idx_bytes = sizeof(uint32_t) * (uint64_t)num_rows;
+    char *scratch = archetypeSortScratch.reserve(
+        4 * num_idx_bytes + max_column_bytes * num_rows);
+
+    uint32_t *keys = (uint32_t *)scratch;
+    uint32_t *alt_keys = (uint32_t *)(scratch + num_idx_bytes);
+    uint32_t *rows = (uint32_t *)(scratch + 2 * num_idx_bytes);
+    uint32_t *alt_rows = (uint32_t *)(scratch + 3 * num_idx_bytes);
+    char *staging = scratch + 4 * num_idx_bytes;
+
+    constexpr int32_t num_passes = 4;
+    constexpr uint32_t num_radix_bins = 256;
+    uint32_t bin_counts[num_passes][num_radix_bins] = {};
+
+    // Histogram every digit in one read of the keys
+    const char *key_column =
+        tbl_storage.column<char>(MADRONA_MW_COND(world_id,) key_col);
+    uint64_t key_stride = columnNumBytes(key_col);
+
+    bool already_sorted = true;
+    uint32_t prev_key = 0;
+    for (uint32_t i = 0; i < num_rows; i++) {
+        uint32_t key;
+        memcpy(&key, key_column + key_stride * i, sizeof(uint32_t));
+
+        keys[i] = key;
+        rows[i] = i;
+
+        already_sorted = already_sorted && key >= prev_key;
+        prev_key = key;
+
+        for (int32_t pass = 0; pass < num_passes; pass++) {
+            bin_counts[pass][(key >> (8 * pass)) & 0xFF] += 1;
+        }
+    }
+
+    // Common when the rows were sorted last step and nothing moved
+    if (already_sorted) {
+        return;
+    }
+
+    for (int32_t pass = 0; pass < num_passes; pass++) {
+        uint32_t shift = 8 * pass;
+        uint32_t *counts = bin_counts[pass];
+
+        // Every key shares this digit, the pass wouldn't move anything.
+        // Small keys (body or object indices) skip the high passes.
+        if (counts[(keys[0] >> shift) & 0xFF] == num_rows) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t bin = 0; bin < num_radix_bins; bin++) {
+            uint32_t count = counts[bin];
+            counts[bin] = offset;
+            offset += count;
+        }
+
+        for (uint32_t i = 0; i < num_rows; i++) {
+            uint32_t key = keys[i];
+            uint32_t dst = counts[(key >> shift) & 0xFF]++;
+
+            alt_keys[dst] = key;
+            alt_rows[dst] = rows[i];
+        }
+
+        std::swap(keys, alt_keys);
+        std::swap(rows, alt_rows);
+    }
+
+    // Gather each column into staging in sorted order and copy it back.
+    for (CountT col_idx = 0; col_idx < num_columns; col_idx++) {
+        char *col = tbl_storage.column<char>(
+            MADRONA_MW_COND(world_id,) col_idx);
+        uint64_t num_bytes = columnNumBytes(col_idx);
+
+        for (uint32_t i = 0; i < num_rows; i++) {
+            memcpy(staging + num_bytes * i, col + num_bytes * rows[i],
+                   num_bytes);
+        }
+
+        memcpy(col, staging, num_bytes * num_rows);
+    }
+
+    Entity *entities =
+        tbl_storage.column<Entity>(MADRONA_MW_COND(world_id,) 0);
+    for (uint32_t i = 0; i < num_rows; i++) {
+        Entity e = entities[i];
+        if (e != Entity::none()) {
+            entity_store_.setRow(e, i);
+        }
+    }
+}
+
 
 void * StateManager::tmpAlloc(MADRONA_MW_COND(uint32_t world_id,)
                               uint64_t num_bytes)
@@ -26,7 +26,9 @@ TaskGraphNodeID TaskGraphBuilder::registerNode(
     uint32_t data_idx,
     void (*fn)(NodeBase *, Context *, TaskGraph *),
     Span<const TaskGraphNodeID> dependencies,
-    Optional<TaskGraphNodeID> parent_node)
+    Optional<TaskGraphNodeID> parent_node,
+    uint32_t (*num_invocations_fn)(NodeBase *, TaskGraph *),
+    void (*range_fn)(NodeBase *, Context *, TaskGraph *, uint32_t, uint32_t))
 {
     CountT dependency_offset = all_dependencies_.size();
 
@@ -37,8 +39,13 @@ TaskGraphNodeID TaskGraphBuilder::registerNode(
     staged_.push_back(StagedNode {
         .node = {
             .fn = fn,
+            .numInvocationsFn = num_invocations_fn,
+            .rangeFn = range_fn,
             .dataIDX = data_idx,
             .numChildren = 0,
+            .numDependencies = uint32_t(dependencies.size()),
+            .dependentsOffset = 0,
+            .numDependents = 0,
         },
         .parentID = parent_node.has_value() ? int32_t(parent_node->id) : -1,
         .dependencyOffset = uint32_t(dependency_offset),
@@ -57,13 +64,16 @@ TaskGraph TaskGraphBuilder::build()
     HeapArray<TaskGraph::Node> sorted_nodes(staged_.size());
     HeapArray<bool> queued(staged_.size());
     HeapArray<int32_t> num_children(staged_.size());
+    HeapArray<uint32_t> sorted_indices(staged_.size());
 
     int32_t sorted_idx = 0;
-    auto enqueueInSorted = [&](const TaskGraph::Node &node) {
-        new (&sorted_nodes[sorted_idx++]) TaskGraph::Node(node);
+    auto enqueueInSorted = [&](CountT staged_idx) {
+        sorted_indices[staged_idx] = sorted_idx;
+        new (&sorted_nodes[sorted_idx++]) TaskGraph::Node(
+            staged_[staged_idx].node);
     };
 
-    enqueueInSorted(staged_[0].node);
+    enqueueInSorted(0);
 
     queued[0] = true;
 
@@ -103,17 +113,53 @@ TaskGraph TaskGraphBuilder::build()
 
         if (dependencies_satisfied) {
             queued[cur_node_idx] = true;
-            enqueueInSorted(cur_staged.node);
+            enqueueInSorted(cur_node_idx);
             num_remaining_nodes--;
         }
     }
 
+    // Invert the dependency lists so each sorted node knows which nodes
+    // are waiting on it. Used by backends that schedule nodes individually.
+    for (CountT i = 0; i < staged_.size(); i++) {
+        const StagedNode &staged = staged_[i];
+        for (CountT dep_offset = 0;
+             dep_offset < (CountT)staged.numDependencies; dep_offset++) {
+            uint32_t dep_node_idx =
+                all_dependencies_[staged.dependencyOffset + dep_offset].id;
+            sorted_nodes[sorted_indices[dep_node_idx]].numDependents += 1;
+        }
+    }
+
+    uint32_t num_total_dependents = 0;
+    for (CountT i = 0; i < sorted_nodes.size(); i++) {
+        TaskGraph::Node &node = sorted_nodes[i];
+        node.dependentsOffset = num_total_dependents;
+        num_total_dependents += node.numDependents;
+        node.numDependents = 0;
+    }
+
+    HeapArray<uint32_t> node_dependents(num_total_dependents);
+    for (CountT i = 0; i < staged_.size(); i++) {
+        const StagedNode &staged = staged_[i];
+        for (CountT dep_offset = 0;
+             dep_offset < (CountT)staged.numDependencies; dep_offset++) {
+            uint32_t dep_node_idx =
+                all_dependencies_[staged.dependencyOffset + dep_offset].id;
+            TaskGraph::Node &dep_node =
+                sorted_nodes[sorted_indices[dep_node_idx]];
+
+            node_dependents[dep_node.dependentsOffset +
+                dep_node.numDependents++] = sorted_indices[i];
+        }
+    }
+
     HeapArray<TaskGraph::NodeData> data_cpy(node_datas_.size());
     memcpy(data_cpy.data(), node_datas_.data(),
            node_datas_.size() * sizeof(TaskGraph::NodeData));
 
     return TaskGraph(state_mgr_, state_cache_, MADRONA_MW_COND(world_id_,)
-        std::move(sorted_nodes), std::move(data_cpy));
+        std::move(sorted_nodes), std::move(data_cpy),
+        std::move(node_dependents));
 }
 
 struct TaskGraphManager::Impl {
@@ -152,14 +198,16 @@ TaskGraph::TaskGraph(StateManager *state_mgr,
                      StateCache *state_cache,
                      MADRONA_MW_COND(uint32_t world_id,) 
                      HeapArray<Node> &&sorted_nodes,
-                     HeapArray<NodeData> &&node_datas)
+                     HeapArray<NodeData> &&node_datas,
+                     HeapArray<uint32_t> &&node_dependents)
     : state_mgr_(state_mgr),
       state_cache_(state_cache),
 #ifdef MADRONA_MW_MODE
       cur_world_id_(world_id),
 #endif
       sorted_nodes_(std::move(sorted_nodes)),
-      node_datas_(std::move(node_datas))
+      node_datas_(std::move(node_datas)),
+      node_dependents_(std::move(node_dependents))
 {}
 
 void TaskGraph::run(Context *ctx)
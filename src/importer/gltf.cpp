@@ -1,6 +1,7 @@
 #include "gltf.hpp"
 
 #include <madrona/crash.hpp>
+#include <madrona/io.hpp>
 #include <madrona/json.hpp>
 #include <madrona/math.hpp>
 #include <madrona/optional.hpp>
@@ -10,7 +11,6 @@
 #include <filesystem>
 #include <string_view>
 #include <vector>
-#include <fstream>
 
 using std::string;
 using std::string_view;
@@ -50,6 +50,7 @@ public:
     const T *data() const { return fromRaw(raw_data_); }
 
     constexpr size_t size() const { return num_elems_; }
+    constexpr size_t byteStride() const { return byte_stride_; }
 
     template <typename U>
     class IterBase {
@@ -327,9 +328,13 @@ struct GLTFLoader::Impl {
     const char *curFileName;
     std::filesystem::path sceneDirectory;
 
+    // The whole GLB file, buffers without a URI point into its bin chunk
+    Optional<MappedFile> glbFile;
+    bool aliasGLBBuffers;
+    bool meshesAliasGLB;
+
     // Scene data filled when loading a GLTF file
     std::string sceneName;
-    DynArray<uint8_t> internalData;
     DynArray<GLTFBuffer> buffers;
     DynArray<GLTFBufferView> bufferViews;
     DynArray<GLTFAccessor> accessors;
@@ -444,30 +449,47 @@ static bool gltfLoad(const char *gltf_filename,
     bool binary = suffix == ".glb";
 
     ondemand::document json_doc;
+    const uint8_t *bin_chunk = nullptr;
     if (binary) {
-        std::ifstream binary_file(gltf_path.string(),
-                                  std::ios::in | std::ios::binary);
+        // Mapped rather than read so the bin chunk isn't copied. Meshes
+        // that alias the mapping stay writable through copy on write.
+        loader.glbFile = MappedFile::map(gltf_filename,
+                                         loader.aliasGLBBuffers);
 
-        if (!binary_file.is_open() || !binary_file.good()) {
+        if (!loader.glbFile.has_value()) {
             loader.recordError("Could not open.");
             return false;
         }
 
+        const char *glb_data = loader.glbFile->data();
+        size_t glb_num_bytes = loader.glbFile->numBytes();
+
+        if (glb_num_bytes < sizeof(GLBHeader) + sizeof(ChunkHeader)) {
+            loader.recordError("Truncated GLB header.");
+            return false;
+        }
+
         GLBHeader glb_header;
-        binary_file.read(reinterpret_cast<char *>(&glb_header),
-                         sizeof(GLBHeader));
+        memcpy(&glb_header, glb_data, sizeof(GLBHeader));
 
         uint32_t total_length = glb_header.length;
 
         ChunkHeader json_header;
-        binary_file.read(reinterpret_cast<char *>(&json_header),
-                         sizeof(ChunkHeader));
+        memcpy(&json_header, glb_data + sizeof(GLBHeader),
+               sizeof(ChunkHeader));
+
+        size_t json_offset = sizeof(GLBHeader) + sizeof(ChunkHeader);
+        if (json_offset + json_header.chunkLength > glb_num_bytes) {
+            loader.recordError("Truncated JSON chunk.");
+            return false;
+        }
 
+        // simdjson needs padding past the end of the JSON
         loader.jsonBuf.resize(json_header.chunkLength + SIMDJSON_PADDING,
                               [](auto *) {});
 
-        binary_file.read(reinterpret_cast<char *>(loader.jsonBuf.data()),
-                         json_header.chunkLength);
+        memcpy(loader.jsonBuf.data(), glb_data + json_offset,
+               json_header.chunkLength);
 
         auto err = loader.jsonParser.iterate(loader.jsonBuf.data(),
             json_header.chunkLength, loader.jsonBuf.size()).get(json_doc);
@@ -478,21 +500,26 @@ static bool gltfLoad(const char *gltf_filename,
         }
 
         if (json_header.chunkLength < total_length) {
-            ChunkHeader bin_header;
-            binary_file.read(reinterpret_cast<char *>(&bin_header),
-                             sizeof(ChunkHeader));
+            size_t bin_header_offset = json_offset + json_header.chunkLength;
 
-            if (bin_header.chunkType != 0x004E4942) {
+            ChunkHeader bin_header;
+            if (bin_header_offset + sizeof(ChunkHeader) > glb_num_bytes) {
                 loader.recordError("Invalid bin chunk.");
                 return false;
             }
 
-            loader.internalData.resize(bin_header.chunkLength,
-                                       [](uint8_t *) {});
+            memcpy(&bin_header, glb_data + bin_header_offset,
+                   sizeof(ChunkHeader));
+
+            size_t bin_offset = bin_header_offset + sizeof(ChunkHeader);
 
-            binary_file.read(
-                reinterpret_cast<char *>(loader.internalData.data()),
-                bin_header.chunkLength);
+            if (bin_header.chunkType != 0x004E4942 ||
+                    bin_offset + bin_header.chunkLength > glb_num_bytes) {
+                loader.recordError("Invalid bin chunk.");
+                return false;
+            }
+
+            bin_chunk = (const uint8_t *)glb_data + bin_offset;
         }
     } else {
         auto json_data = padded_string::load(gltf_filename);
@@ -524,7 +551,7 @@ static bool gltfLoad(const char *gltf_filename,
         if (!uri_elem.error()) {
             uri = uri_elem.value_unsafe();
         } else {
-            data_ptr = loader.internalData.data();
+            data_ptr = bin_chunk;
         }
         loader.buffers.push_back(GLTFBuffer {
             data_ptr,
@@ -1320,11 +1347,68 @@ static Optional<GLTFStridedSpan<T>> getGLTFAccessorView(
                                 accessor.numElems);
 }
 
+// Returns the accessor's data when the mesh can point straight into the
+// mapped GLB instead of a copy: tightly packed, aligned, and (for float
+// attributes) free of the NaN / inf components the copy would zero out.
+template <typename T>
+static T * aliasGLTFAccessor(const LoaderData &loader,
+                             const GLTFStridedSpan<const T> &accessor,
+                             uint32_t num_elems)
+{
+    if (!loader.aliasGLBBuffers || !loader.glbFile.has_value()) {
+        return nullptr;
+    }
+
+    if (accessor.byteStride() != sizeof(T) ||
+            (uintptr_t)accessor.data() % alignof(T) != 0) {
+        return nullptr;
+    }
+
+    if constexpr (!is_same_v<T, uint32_t>) {
+        const float *components = (const float *)accessor.data();
+        CountT num_components = num_elems * (sizeof(T) / sizeof(float));
+
+        for (CountT i = 0; i < num_components; i++) {
+            if (isnan(components[i]) || isinf(components[i])) {
+                return nullptr;
+            }
+        }
+    }
+
+    // The mapping is copy on write, so handing out a mutable pointer
+    // doesn't touch the file
+    return const_cast<T *>(accessor.data());
+}
+
+template <typename T>
+static DynArray<T> copyGLTFVertexAttr(
+    const GLTFStridedSpan<const T> &accessor,
+    uint32_t num_elems)
+{
+    constexpr CountT num_components = sizeof(T) / sizeof(float);
+
+    DynArray<T> out(num_elems);
+    for (uint32_t i = 0; i < num_elems; i++) {
+        T v = accessor[i];
+
+        for (CountT c = 0; c < num_components; c++) {
+            if (isnan(v[c]) || isinf(v[c])) {
+                v[c] = 0;
+            }
+        }
+
+        out.push_back(v);
+    }
+
+    return out;
+}
+
 // GLTF Mesh = Madrona Object, Primitive = Madrona Mesh
 static bool gltfParseMesh(
     CountT mesh_idx,
     const LoaderData &loader, 
-    ImportedAssets &imported)
+    ImportedAssets &imported,
+    bool *aliased_glb)
 {
     const GLTFMesh &gltf_mesh = loader.meshes[mesh_idx];
 
@@ -1369,6 +1453,8 @@ static bool gltfParseMesh(
         uint32_t max_idx = 0;
 
         DynArray<uint32_t> indices(0);
+        uint32_t *aliased_indices = nullptr;
+        CountT num_indices = 0;
         if (prim.indicesIdx != ~0u) {
             auto index_type = loader.accessors[prim.indicesIdx].type;
 
@@ -1379,15 +1465,24 @@ static bool gltfParseMesh(
                     return false;
                 }
 
-                indices.reserve(idx_accessor->size());
+                aliased_indices = aliasGLTFAccessor(
+                    loader, *idx_accessor, idx_accessor->size());
+
+                if (aliased_indices == nullptr) {
+                    indices.reserve(idx_accessor->size());
+                }
 
                 for (uint32_t idx : *idx_accessor) {
                     if (idx > max_idx) {
                         max_idx = idx;
                     }
 
-                    indices.push_back(idx);
+                    if (aliased_indices == nullptr) {
+                        indices.push_back(idx);
+                    }
                 }
+
+                num_indices = idx_accessor->size();
             } else if (index_type == GLTFComponentType::UINT16) {
                 auto idx_accessor = getGLTFAccessorView<const uint16_t>(
                     loader, prim.indicesIdx);
@@ -1404,6 +1499,8 @@ static bool gltfParseMesh(
 
                     indices.push_back(idx);
                 }
+
+                num_indices = indices.size();
             } else if (index_type == GLTFComponentType::UINT8) {
                 auto idx_accessor = getGLTFAccessorView<const uint8_t>(
                     loader, prim.indicesIdx);
@@ -1420,6 +1517,8 @@ static bool gltfParseMesh(
 
                     indices.push_back(idx);
                 }
+
+                num_indices = indices.size();
             } else {
                 loader.recordError(
                     "GLTF loading failed: unsupported index type");
@@ -1433,103 +1532,78 @@ static bool gltfParseMesh(
             }
 
             max_idx = position_accessor->size() - 1;
+            num_indices = indices.size();
         }
 
-        uint32_t num_faces = indices.size() / 3;
-        if (num_faces * 3 != indices.size()) {
+        uint32_t num_faces = num_indices / 3;
+        if (num_faces * 3 != num_indices) {
             loader.recordError("Non-triangular GLTF not supported");
             return false;
         }
 
         uint32_t num_vertices = max_idx + 1;
 
-        DynArray<math::Vector3> positions(num_vertices);
-        auto normals = Optional<DynArray<math::Vector3>>::none();
-        auto uvs = Optional<DynArray<math::Vector2>>::none();
-
-        if (normal_accessor.has_value()) {
-            if (normal_accessor->size() != position_accessor->size()) {
-                loader.recordError("Fewer normals than positions in mesh %d",
-                                   mesh_idx);
-                return false;
-            }
-            normals.emplace(num_vertices);
+        if (normal_accessor.has_value() &&
+                normal_accessor->size() != position_accessor->size()) {
+            loader.recordError("Fewer normals than positions in mesh %d",
+                               mesh_idx);
+            return false;
         }
 
-        if (uv_accessor.has_value()) {
-            if (uv_accessor->size() != position_accessor->size()) {
-                loader.recordError("Fewer UVs than positions in mesh %d",
-                                   mesh_idx);
-                return false;
-            }
-            uvs.emplace(num_vertices);
+        if (uv_accessor.has_value() &&
+                uv_accessor->size() != position_accessor->size()) {
+            loader.recordError("Fewer UVs than positions in mesh %d",
+                               mesh_idx);
+            return false;
         }
 
-        for (uint32_t vert_idx = 0; vert_idx < num_vertices; vert_idx++) {
-            math::Vector3 pos = (*position_accessor)[vert_idx];
-            if (isnan(pos.x) || isinf(pos.x)) {
-                pos.x = 0;
-            }
-
-            if (isnan(pos.y) || isinf(pos.y)) {
-                pos.y = 0;
-            }
-
-            if (isnan(pos.z) || isinf(pos.z)) {
-                pos.z = 0;
-            }
-            positions.push_back(pos);
-
-            if (normal_accessor.has_value()) {
-                math::Vector3 normal = (*normal_accessor)[vert_idx];
-
-                if (isnan(normal.x) || isinf(normal.x)) {
-                    normal.x = 0;
-                }
-
-                if (isnan(normal.y) || isinf(normal.y)) {
-                    normal.y = 0;
-                }
-
-                if (isnan(normal.z) || isinf(normal.z)) {
-                    normal.z = 0;
-                }
-
-                normals->push_back(normal);
-            }
-
-            if (uv_accessor.has_value()) {
-                math::Vector2 uv = (*uv_accessor)[vert_idx];
-
-                if (isnan(uv.x) || isinf(uv.x)) {
-                    uv.x = 0;
-                }
-
-                if (isnan(uv.y) || isinf(uv.y)) {
-                    uv.y = 0;
-                }
-
-                uvs->push_back(uv);
-            }
+        math::Vector3 *position_ptr = aliasGLTFAccessor(
+            loader, *position_accessor, num_vertices);
+        if (position_ptr == nullptr) {
+            DynArray<math::Vector3> positions =
+                copyGLTFVertexAttr(*position_accessor, num_vertices);
+            position_ptr = positions.data();
+            imported.geoData.positionArrays.emplace_back(
+                std::move(positions));
+        } else {
+            *aliased_glb = true;
         }
 
-        math::Vector3 *position_ptr = positions.data();
-        imported.geoData.positionArrays.emplace_back(std::move(positions));
-
         math::Vector3 *normal_ptr = nullptr;
-        if (normals.has_value()) {
-            normal_ptr = normals->data();
-            imported.geoData.normalArrays.emplace_back(std::move(*normals));
+        if (normal_accessor.has_value()) {
+            normal_ptr = aliasGLTFAccessor(
+                loader, *normal_accessor, num_vertices);
+            if (normal_ptr == nullptr) {
+                DynArray<math::Vector3> normals =
+                    copyGLTFVertexAttr(*normal_accessor, num_vertices);
+                normal_ptr = normals.data();
+                imported.geoData.normalArrays.emplace_back(
+                    std::move(normals));
+            } else {
+                *aliased_glb = true;
+            }
         }
 
         math::Vector2 *uv_ptr = nullptr;
-        if (uvs.has_value()) {
-            uv_ptr = uvs->data();
-            imported.geoData.uvArrays.emplace_back(std::move(*uvs));
+        if (uv_accessor.has_value()) {
+            uv_ptr = aliasGLTFAccessor(loader, *uv_accessor, num_vertices);
+            if (uv_ptr == nullptr) {
+                DynArray<math::Vector2> uvs =
+                    copyGLTFVertexAttr(*uv_accessor, num_vertices);
+                uv_ptr = uvs.data();
+                imported.geoData.uvArrays.emplace_back(std::move(uvs));
+            } else {
+                *aliased_glb = true;
+            }
         }
 
-        uint32_t *idx_ptr = indices.data();
-        imported.geoData.indexArrays.emplace_back(std::move(indices));
+        uint32_t *idx_ptr = aliased_indices;
+        if (idx_ptr == nullptr) {
+            idx_ptr = indices.data();
+            imported.geoData.indexArrays.emplace_back(std::move(indices));
+        } else {
+            *aliased_glb = true;
+        }
 
         // Create the materials.
         DynArray<uint32_t> face_mats(num_faces);
@@ -1618,7 +1692,8 @@ static bool gltfImportAssets(LoaderData &loader,
 
     for (CountT mesh_idx = 0; mesh_idx < loader.meshes.size();
          mesh_idx++) {
-        bool mesh_valid = gltfParseMesh(mesh_idx, loader, imported);
+        bool mesh_valid = gltfParseMesh(mesh_idx, loader, imported,
+                                        &loader.meshesAliasGLB);
         if (!mesh_valid) {
             return false;
         }
@@ -1835,8 +1910,10 @@ GLTFLoader::Impl::Impl(ImageImporter &img_import, Span<char> err_buf)
       jsonParser(),
       curFileName(nullptr),
       sceneDirectory(),
+      glbFile(Optional<MappedFile>::none()),
+      aliasGLBBuffers(false),
+      meshesAliasGLB(false),
       sceneName(),
-      internalData(0),
       buffers(0),
       bufferViews(0),
       accessors(0),
@@ -1894,8 +1971,13 @@ GLTFLoader::~GLTFLoader() {}
 bool GLTFLoader::load(const char *path, 
                       ImportedAssets &imported_assets,
                       bool merge_and_flatten,
-                      ImageImporter &img_importer)
+                      ImageImporter &img_importer,
+                      bool alias_glb_buffers)
 {
+    impl_->glbFile.reset();
+    impl_->aliasGLBBuffers = alias_glb_buffers;
+    impl_->meshesAliasGLB = false;
+
     bool json_parsed = gltfLoad(path, *impl_);
     if (!json_parsed) {
         return false;
@@ -1908,8 +1990,15 @@ bool GLTFLoader::load(const char *path,
         return false;
     }
 
+    // Meshes pointing into the GLB keep it mapped for as long as the
+    // imported assets live
+    if (impl_->meshesAliasGLB) {
+        imported_assets.geoData.mappedFiles.emplace_back(
+            std::move(*impl_->glbFile));
+    }
+    impl_->glbFile.reset();
+
     // Clear tmp buffers
-    impl_->internalData.clear();
     impl_->buffers.clear();
     impl_->bufferViews.clear();
     impl_->accessors.clear();
@@ -15,10 +15,12 @@ struct GLTFLoader {
 
     std::unique_ptr<Impl> impl_;
 
+    // alias_glb_buffers: see AssetImporter::importFromDisk
     bool load(const char *path,
               ImportedAssets &imported_assets,
               bool merge_and_flatten,
-              ImageImporter &img_importer);
+              ImageImporter &img_importer,
+              bool alias_glb_buffers = false);
 };
 
 }
@@ -1,6 +1,8 @@
 #include <madrona/importer.hpp>
 #include <madrona/io.hpp>
 
+#include "parallel.hpp"
+
 #include <filesystem>
 #include <string>
 #include <unordered_map>
@@ -118,30 +120,44 @@ Optional<SourceTexture> ImageImporter::importImage(const char *path)
         return Optional<SourceTexture>::none();
     }
 
-    size_t num_bytes;
-    char *file_data = readBinaryFile(path, 1, &num_bytes);
-
-    Optional<SourceTexture> img = importImage(file_data, num_bytes, type_code);
-
-    rawDeallocAligned(file_data);
+    // Decoders only read the encoded bytes once, no point copying them
+    Optional<MappedFile> file_data = MappedFile::map(path);
+    if (!file_data.has_value()) {
+        return Optional<SourceTexture>::none();
+    }
 
-    return img;
+    return importImage(file_data->data(), file_data->numBytes(), type_code);
 }
 
 Span<SourceTexture> ImageImporter::importImages(
     StackAlloc &tmp_alloc,
-    Span<const char * const> paths)
+    Span<const char * const> paths,
+    CountT num_threads)
 {
     SourceTexture *out_textures = tmp_alloc.allocN<SourceTexture>(paths.size());
-
     for (CountT i = 0; i < paths.size(); i++) {
-        const char *path = paths[i];
-        Optional<SourceTexture> tex = importImage(path);
-        if (!tex.has_value()) {
-            return Span<SourceTexture>(nullptr, 0);
+        out_textures[i].data = nullptr;
+    }
+
+    // Each decode writes its own slot, so the output order matches paths
+    // regardless of which thread finishes first.
+    bool success = parallelImport(paths.size(), num_threads,
+        [&](CountT i, CountT) {
+            Optional<SourceTexture> tex = importImage(paths[i]);
+            if (!tex.has_value()) {
+                return false;
+            }
+
+            out_textures[i] = *tex;
+            return true;
+        });
+
+    if (!success) {
+        for (CountT i = 0; i < paths.size(); i++) {
+            free(out_textures[i].data);
         }
 
-        out_textures[i] = *tex;
+        return Span<SourceTexture>(nullptr, 0);
     }
 
     return Span(out_textures, paths.size());
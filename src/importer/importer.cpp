@@ -10,6 +10,7 @@
 #include <meshoptimizer.h>
 
 #include "obj.hpp"
+#include "parallel.hpp"
 
 #ifdef MADRONA_GLTF_SUPPORT
 #include "gltf.hpp"
@@ -27,9 +28,11 @@ namespace madrona::imp {
 
 using namespace math;
 
-struct AssetImporter::Impl {
-    ImageImporter imgImporter;
+namespace {
 
+// Format loaders keep scratch buffers between files, so each import
+// thread gets its own set.
+struct FileLoaders {
     Optional<OBJLoader> objLoader;
 
 #ifdef MADRONA_GLTF_SUPPORT
@@ -40,24 +43,41 @@ struct AssetImporter::Impl {
     Optional<USDLoader> usdLoader;
 #endif
 
+    inline FileLoaders()
+        : objLoader(Optional<OBJLoader>::none())
+#ifdef MADRONA_GLTF_SUPPORT
+          , gltfLoader(Optional<GLTFLoader>::none())
+#endif
+#ifdef MADRONA_USD_SUPPORT
+          , usdLoader(Optional<USDLoader>::none())
+#endif
+    {}
+};
+
+}
+
+struct AssetImporter::Impl {
+    ImageImporter imgImporter;
+    FileLoaders loaders;
+
     static inline Impl * make(ImageImporter &&img_importer);
 
     inline Optional<ImportedAssets> importFromDisk(
         Span<const char * const> asset_paths,
-        Span<char> err_buf, bool one_object_per_asset);
+        Span<char> err_buf, bool one_object_per_asset,
+        CountT num_file_threads, bool alias_glb_buffers);
+
+    inline Optional<ImportedAssets> importFromDiskParallel(
+        Span<const char * const> asset_paths,
+        Span<char> err_buf, bool one_object_per_asset,
+        CountT num_threads, bool alias_glb_buffers);
 };
 
 AssetImporter::Impl * AssetImporter::Impl::make(ImageImporter &&img_importer)
 {
     return new Impl {
         .imgImporter = std::move(img_importer),
-        .objLoader = Optional<OBJLoader>::none(),
-#ifdef MADRONA_GLTF_SUPPORT
-        .gltfLoader = Optional<GLTFLoader>::none(),
-#endif
-#ifdef MADRONA_USD_SUPPORT
-        .usdLoader = Optional<USDLoader>::none(),
-#endif
+        .loaders = FileLoaders(),
     };
 }
 
@@ -66,11 +86,9 @@ ImageImporter & AssetImporter::imageImporter()
     return impl_->imgImporter;
 }
 
-Optional<ImportedAssets> AssetImporter::Impl::importFromDisk(
-    Span<const char * const> asset_paths,
-    Span<char> err_buf, bool one_object_per_asset)
+static ImportedAssets makeEmptyImportedAssets()
 {
-    ImportedAssets imported {
+    return ImportedAssets {
         .geoData = ImportedAssets::GeometryData {
             .positionArrays { 0 },
             .normalArrays { 0 },
@@ -79,71 +97,245 @@ Optional<ImportedAssets> AssetImporter::Impl::importFromDisk(
             .indexArrays { 0 },
             .faceCountArrays { 0 },
             .meshArrays { 0 },
+            .mappedFiles { 0 },
         },
         .objects { 0 },
         .materials { 0 },
         .instances { 0 },
         .textures { 0 },
     };
+}
 
-    bool load_success = false;
-    for (const char *path : asset_paths) {
-        std::string_view path_view(path);
+static bool importFile(const char *path,
+                       ImportedAssets &imported,
+                       FileLoaders &loaders,
+                       ImageImporter &img_importer,
+                       Span<char> err_buf,
+                       bool one_object_per_asset,
+                       CountT num_file_threads,
+                       bool alias_glb_buffers)
+{
+    std::string_view path_view(path);
 
-        auto extension_pos = path_view.rfind('.');
-        if (extension_pos == path_view.npos) {
-            return Optional<ImportedAssets>::none();
-        }
-        auto extension = path_view.substr(extension_pos + 1);
+    auto extension_pos = path_view.rfind('.');
+    if (extension_pos == path_view.npos) {
+        snprintf(err_buf.data(), err_buf.size(),
+                 "Missing file extension: %s", path);
+        return false;
+    }
+    auto extension = path_view.substr(extension_pos + 1);
 
-        if (extension == "obj") {
-            if (!objLoader.has_value()) {
-                objLoader.emplace(err_buf);
-            }
+    if (extension == "obj") {
+        if (!loaders.objLoader.has_value()) {
+            loaders.objLoader.emplace(err_buf);
+        }
 
-            load_success = objLoader->load(path, imported);
-        } else if (extension == "gltf" || extension == "glb") {
+        return loaders.objLoader->load(path, imported, num_file_threads);
+    } else if (extension == "gltf" || extension == "glb") {
 #ifdef MADRONA_GLTF_SUPPORT
-            if (!gltfLoader.has_value()) {
-                gltfLoader.emplace(imgImporter, err_buf);
-            }
+        if (!loaders.gltfLoader.has_value()) {
+            loaders.gltfLoader.emplace(img_importer, err_buf);
+        }
 
-            load_success = gltfLoader->load(
-                path, imported, one_object_per_asset, imgImporter);
+        return loaders.gltfLoader->load(
+            path, imported, one_object_per_asset, img_importer,
+            alias_glb_buffers);
 #else
-            load_success = false;
-            snprintf(err_buf.data(), err_buf.size(),
-                     "Madrona not compiled with glTF support");
+        (void)one_object_per_asset;
+        (void)img_importer;
+        (void)alias_glb_buffers;
+        snprintf(err_buf.data(), err_buf.size(),
+                 "Madrona not compiled with glTF support");
+        return false;
 #endif
-        } else if (extension == "usd" ||
-                   extension == "usda" ||
-                   extension == "usdc" ||
-                   extension == "usdz") {
+    } else if (extension == "usd" ||
+               extension == "usda" ||
+               extension == "usdc" ||
+               extension == "usdz") {
 #ifdef MADRONA_USD_SUPPORT
-            if (!usdLoader.has_value()) {
-                usdLoader.emplace(imgImporter, err_buf);
-            }
+        if (!loaders.usdLoader.has_value()) {
+            loaders.usdLoader.emplace(img_importer, err_buf);
+        }
 
-            load_success = usdLoader->load(
-                path, imported, one_object_per_asset, imgImporter);
+        return loaders.usdLoader->load(
+            path, imported, one_object_per_asset, img_importer);
 #else
-            load_success = false;
-            snprintf(err_buf.data(), err_buf.size(),
-                     "Madrona not compiled with USD support");
+        snprintf(err_buf.data(), err_buf.size(),
+                 "Madrona not compiled with USD support");
+        return false;
 #endif
+    }
+
+    snprintf(err_buf.data(), err_buf.size(),
+             "Unsupported asset type: %s", path);
+    return false;
+}
+
+// Appends an asset imported on its own to dst, rebasing every index into
+// dst's arrays so the result matches importing it directly into dst.
+static void mergeImportedAssets(ImportedAssets &dst,
+                                ImportedAssets &&src,
+                                bool rebase_mesh_materials)
+{
+    uint32_t obj_offset = (uint32_t)dst.objects.size();
+    uint32_t mat_offset = (uint32_t)dst.materials.size();
+    int32_t tex_offset = (int32_t)dst.textures.size();
+
+    // Only the flattened glTF path offsets mesh materials by the number of
+    // materials already imported, the others leave materialIDX untouched.
+    if (rebase_mesh_materials) {
+        for (DynArray<SourceMesh> &meshes : src.geoData.meshArrays) {
+            for (SourceMesh &mesh : meshes) {
+                mesh.materialIDX += mat_offset;
+            }
+        }
+    }
+
+    for (SourceInstance &inst : src.instances) {
+        inst.objIDX += obj_offset;
+    }
+
+    for (SourceMaterial &mat : src.materials) {
+        if (mat.textureIdx != -1) {
+            mat.textureIdx += tex_offset;
+        }
+    }
+
+    // Moving the arrays keeps their heap storage, so the SourceMesh and
+    // SourceObject pointers into them stay valid.
+    auto appendArrays = [](auto &dst_arrs, auto &src_arrs) {
+        for (auto &arr : src_arrs) {
+            dst_arrs.emplace_back(std::move(arr));
         }
+    };
+
+    appendArrays(dst.geoData.positionArrays, src.geoData.positionArrays);
+    appendArrays(dst.geoData.normalArrays, src.geoData.normalArrays);
+    appendArrays(dst.geoData.tangentAndSignArrays,
+                 src.geoData.tangentAndSignArrays);
+    appendArrays(dst.geoData.uvArrays, src.geoData.uvArrays);
+    appendArrays(dst.geoData.indexArrays, src.geoData.indexArrays);
+    appendArrays(dst.geoData.faceCountArrays, src.geoData.faceCountArrays);
+    appendArrays(dst.geoData.meshArrays, src.geoData.meshArrays);
+    appendArrays(dst.geoData.mappedFiles, src.geoData.mappedFiles);
+
+    for (const SourceObject &obj : src.objects) {
+        dst.objects.push_back(obj);
+    }
+
+    for (const SourceMaterial &mat : src.materials) {
+        dst.materials.push_back(mat);
+    }
+
+    for (const SourceInstance &inst : src.instances) {
+        dst.instances.push_back(inst);
+    }
+
+    for (const SourceTexture &tex : src.textures) {
+        dst.textures.push_back(tex);
+    }
+}
+
+Optional<ImportedAssets> AssetImporter::Impl::importFromDisk(
+    Span<const char * const> asset_paths,
+    Span<char> err_buf, bool one_object_per_asset,
+    CountT num_file_threads, bool alias_glb_buffers)
+{
+    ImportedAssets imported = makeEmptyImportedAssets();
+
+    for (const char *path : asset_paths) {
+        bool load_success = importFile(path, imported, loaders, imgImporter,
+                                       err_buf, one_object_per_asset,
+                                       num_file_threads, alias_glb_buffers);
 
         if (!load_success) {
             printf("Load failed\n");
-            break;
+            return Optional<ImportedAssets>::none();
         }
     }
 
-    if (!load_success) {
-        return Optional<ImportedAssets>::none();
+    return imported;
+}
+
+Optional<ImportedAssets> AssetImporter::Impl::importFromDiskParallel(
+    Span<const char * const> asset_paths,
+    Span<char> err_buf, bool one_object_per_asset,
+    CountT num_threads, bool alias_glb_buffers)
+{
+    const CountT num_assets = asset_paths.size();
+    num_threads = resolveNumImportThreads(num_threads, num_assets);
+
+    // Loaders hold on to the error buffer they were created with, so every
+    // thread gets fresh loaders writing to a private error buffer. The
+    // error reported is the one from the first failing asset in path order.
+    HeapArray<FileLoaders> thread_loaders(num_threads);
+    for (CountT i = 0; i < thread_loaders.size(); i++) {
+        thread_loaders.emplace(i);
     }
 
-    return imported;
+    const CountT err_buf_size = err_buf.data() == nullptr ?
+        0 : err_buf.size();
+    HeapArray<char> thread_err_bufs(err_buf_size * num_threads);
+    HeapArray<char> asset_errs(err_buf_size * num_assets);
+
+    HeapArray<Optional<ImportedAssets>> per_asset(num_assets);
+    for (CountT i = 0; i < num_assets; i++) {
+        per_asset.emplace(i, Optional<ImportedAssets>::none());
+    }
+
+    parallelImport(num_assets, num_threads,
+        [&](CountT asset_idx, CountT thread_idx) {
+            FileLoaders &cur_loaders = thread_loaders[thread_idx];
+
+            Span<char> thread_err_buf(err_buf_size == 0 ? nullptr :
+                thread_err_bufs.data() + thread_idx * err_buf_size,
+                err_buf_size);
+
+            if (err_buf_size > 0) {
+                thread_err_buf[0] = '\0';
+            }
+
+            ImportedAssets imported = makeEmptyImportedAssets();
+            bool load_success = importFile(asset_paths[asset_idx], imported,
+                cur_loaders, imgImporter, thread_err_buf,
+                one_object_per_asset, 1, alias_glb_buffers);
+
+            if (!load_success) {
+                if (err_buf_size > 0) {
+                    memcpy(asset_errs.data() + asset_idx * err_buf_size,
+                           thread_err_buf.data(), err_buf_size);
+                }
+
+                return false;
+            }
+
+            per_asset[asset_idx].emplace(std::move(imported));
+            return true;
+        });
+
+    ImportedAssets merged = makeEmptyImportedAssets();
+
+    for (CountT asset_idx = 0; asset_idx < num_assets; asset_idx++) {
+        if (!per_asset[asset_idx].has_value()) {
+            if (err_buf_size > 0) {
+                memcpy(err_buf.data(),
+                       asset_errs.data() + asset_idx * err_buf_size,
+                       err_buf_size);
+            }
+
+            printf("Load failed\n");
+            return Optional<ImportedAssets>::none();
+        }
+
+        std::string_view path_view(asset_paths[asset_idx]);
+        bool is_gltf = path_view.ends_with(".gltf") ||
+            path_view.ends_with(".glb");
+
+        mergeImportedAssets(merged, std::move(*per_asset[asset_idx]),
+                            one_object_per_asset && is_gltf);
+    }
+
+    return merged;
 }
 
 AssetImporter::AssetImporter()
@@ -159,9 +351,17 @@ AssetImporter::~AssetImporter() = default;
 
 Optional<ImportedAssets> AssetImporter::importFromDisk(
     Span<const char * const> paths, Span<char> err_buf,
-    bool one_object_per_asset)
+    bool one_object_per_asset, CountT num_threads, bool alias_glb_buffers)
 {
-    return impl_->importFromDisk(paths, err_buf, one_object_per_asset);
+    // A single file gets all the threads to itself
+    if (num_threads == 1 || paths.size() <= 1) {
+        return impl_->importFromDisk(paths, err_buf, one_object_per_asset,
+                                     num_threads, alias_glb_buffers);
+    }
+
+    return impl_->importFromDiskParallel(paths, err_buf,
+                                         one_object_per_asset, num_threads,
+                                         alias_glb_buffers);
 }
 
 }
@@ -1,15 +1,16 @@
 #include "obj.hpp"
+#include "parallel.hpp"
 
 #include <cstdarg>
+#include <cstring>
 #include <charconv>
 #include <fast_float/fast_float.h>
-#include <fstream>
-#include <string>
+#include <string_view>
 #include <inttypes.h>
 
-#include <meshoptimizer.h>
-
 #include <madrona/heap_array.hpp>
+#include <madrona/io.hpp>
+#include <madrona/utils.hpp>
 
 namespace madrona::imp {
 
@@ -23,48 +24,126 @@ struct ObjIDX {
     uint32_t uvIdx;
 };
 
+// Position of an 'o' line: everything parsed before it belongs to the
+// previous mesh. Counts are relative to the chunk until the chunks are
+// merged.
+struct MeshSplit {
+    int64_t numIndices;
+    int64_t numFaces;
+    int64_t numPositions;
+    int64_t numNormals;
+    int64_t numUVs;
+    const char *line;
+    int64_t lineLen;
+    int64_t lineIdx;
+};
+
+// Output of parsing one line aligned range of the file
+struct OBJChunk {
+    DynArray<math::Vector3> positions;
+    DynArray<math::Vector3> normals;
+    DynArray<math::Vector2> uvs;
+    DynArray<ObjIDX> indices;
+    DynArray<uint32_t> faceCounts;
+    DynArray<MeshSplit> meshSplits;
+    int64_t numLines;
+
+    // Line and message of the first error in the chunk
+    bool failed;
+    const char *errLine;
+    int64_t errLineLen;
+    int64_t errLineIdx;
+    char errMsg[256];
+
+    // Current line for error reporting
+    const char *curLine;
+    int64_t curLineLen;
+    int64_t curLineIdx;
+
+    OBJChunk();
+
+    void recordError(const char *fmt_string, ...);
+};
+
+// Attributes of a vertex after de-indexing, absent attributes are zero.
+// Vertices are welded when all attributes are bitwise identical.
+struct WeldVertex {
+    math::Vector3 position;
+    math::Vector3 normal;
+    math::Vector2 uv;
+};
+
+static_assert(sizeof(WeldVertex) == 8 * sizeof(uint32_t));
+
 }
 
 struct OBJLoader::Impl {
     DynArray<SourceMesh> objMeshes;
 
-    // These buffers are iteratively filled while parsing the OBJ
-    DynArray<math::Vector3> curPositions;
-    DynArray<math::Vector3> curNormals;
-    DynArray<math::Vector2> curUVs;
-    DynArray<ObjIDX> curIndices;
-    DynArray<uint32_t> curFaceCounts;
-
     // Temporary buffers kept around to avoid reallocations
-    DynArray<math::Vector3> unindexedPositions;
-    DynArray<math::Vector3> unindexedNormals;
-    DynArray<math::Vector2> unindexedUVs;
-    DynArray<uint32_t> fakeIndices;
-    DynArray<uint32_t> vertexRemap;
+    DynArray<WeldVertex> weldVertices;
+    DynArray<uint32_t> weldTable;
 
     // Extra data for error reporting
     Span<char> errBuf;
     const char *filePath;
     const char *curSrcLine;
+    int64_t curSrcLineLen;
     int64_t curSrcLineIdx;
 
     Impl(Span<char> err_buf);
 
-    void setLine(const char *src_line, int64_t line_idx);
+    void setLine(const char *src_line, int64_t line_len, int64_t line_idx);
 
     void recordError(const char *fmt_string, ...) const;
 
-    bool commitMesh(ImportedAssets &out_assets);
+    bool commitMesh(const OBJChunk &file_data,
+                    const MeshSplit &mesh_start,
+                    const MeshSplit &mesh_end,
+                    ImportedAssets &out_assets);
 
-    bool load(const char *path, ImportedAssets &imported_assets);
+    bool load(const char *path, ImportedAssets &imported_assets,
+              CountT num_threads);
 
     static constexpr inline CountT reserve_elems = 128;
+    // Files are only split for parallel parsing once they are larger than
+    // this
+    static constexpr inline CountT parse_chunk_bytes = 4 * 1024 * 1024;
 };
 
-using LoaderData = OBJLoader::Impl;
-
 namespace {
 
+OBJChunk::OBJChunk()
+    : positions(OBJLoader::Impl::reserve_elems),
+      normals(OBJLoader::Impl::reserve_elems),
+      uvs(OBJLoader::Impl::reserve_elems),
+      indices(OBJLoader::Impl::reserve_elems),
+      faceCounts(OBJLoader::Impl::reserve_elems),
+      meshSplits(1),
+      numLines(0),
+      failed(false),
+      errLine(nullptr),
+      errLineLen(0),
+      errLineIdx(-1),
+      errMsg {},
+      curLine(nullptr),
+      curLineLen(0),
+      curLineIdx(-1)
+{}
+
+void OBJChunk::recordError(const char *fmt_string, ...)
+{
+    failed = true;
+    errLine = curLine;
+    errLineLen = curLineLen;
+    errLineIdx = curLineIdx;
+
+    va_list args;
+    va_start(args, fmt_string);
+    vsnprintf(errMsg, sizeof(errMsg), fmt_string, args);
+    va_end(args);
+}
+
 inline fast_float::from_chars_result fromCharsFloat(
     const char *first,
     const char *last,
@@ -83,14 +162,15 @@ inline std::from_chars_result fromCharsU32(
     return std::from_chars(first, last, value, base);
 }
 
+// Lines point into the mapped file, so none of these can read past end
 inline bool parseVec2(std::string_view str,
                       math::Vector2 *out,
-                      const LoaderData &loader)
+                      OBJChunk &chunk)
 {
     const char *start = str.data();
     const char *end = start + str.size();
 
-    while (*start == ' ' && start < end) {
+    while (start < end && *start == ' ') {
         start += 1;
     }
 
@@ -98,13 +178,13 @@ inline bool parseVec2(std::string_view str,
     auto res = fromCharsFloat(start, end, x);
 
     if (res.ptr == start) {
-        loader.recordError("Failed to read x component.");
+        chunk.recordError("Failed to read x component.");
         return false;
     }
 
     start = res.ptr;
 
-    while (*start == ' ' && start < end) {
+    while (start < end && *start == ' ') {
         start += 1;
     }
 
@@ -112,7 +192,7 @@ inline bool parseVec2(std::string_view str,
     res = fromCharsFloat(start, end, y);
 
     if (res.ptr == start) {
-        loader.recordError("Failed to read y component.");
+        chunk.recordError("Failed to read y component.");
         return false;
     }
 
@@ -123,12 +203,12 @@ inline bool parseVec2(std::string_view str,
 
 inline bool parseVec3(std::string_view str,
                       math::Vector3 *out,
-                      const LoaderData &loader)
+                      OBJChunk &chunk)
 {
     const char *start = str.data();
     const char *end = start + str.size();
 
-    while (*start == ' ' && start < end) {
+    while (start < end && *start == ' ') {
         start += 1;
     }
 
@@ -136,13 +216,13 @@ inline bool parseVec3(std::string_view str,
     auto res = fromCharsFloat(start, end, x);
 
     if (res.ptr == start) {
-        loader.recordError("Failed to read x component.");
+        chunk.recordError("Failed to read x component.");
         return false;
     }
 
     start = res.ptr;
 
-    while (*start == ' ' && start < end) {
+    while (start < end && *start == ' ') {
         start += 1;
     }
 
@@ -150,13 +230,13 @@ inline bool parseVec3(std::string_view str,
     res = fromCharsFloat(start, end, y);
 
     if (res.ptr == start) {
-        loader.recordError("Failed to read y component.");
+        chunk.recordError("Failed to read y component.");
         return false;
     }
 
     start = res.ptr;
 
-    while (*start == ' ' && start < end) {
+    while (start < end && *start == ' ') {
         start += 1;
     }
 
@@ -164,7 +244,7 @@ inline bool parseVec3(std::string_view str,
     res = fromCharsFloat(start, end, z);
 
     if (res.ptr == start) {
-        loader.recordError("Failed to read z component.");
+        chunk.recordError("Failed to read z component.");
         return false;
     }
 
@@ -174,13 +254,14 @@ inline bool parseVec3(std::string_view str,
 
 inline bool parseIdxTriple(const char *start, const char *end,
                            ObjIDX *idx_triple, const char **next,
-                           const LoaderData &loader)
+                           OBJChunk &chunk)
 {
     uint32_t pos_idx;
     auto res = fromCharsU32(start, end, pos_idx);
 
     if (res.ptr == start) {
-        loader.recordError("Failed to read position idx: %s.", start);
+        chunk.recordError("Failed to read position idx: %.*s.",
+                          int(end - start), start);
         return false;
     }
 
@@ -201,13 +282,13 @@ inline bool parseIdxTriple(const char *start, const char *end,
 
     uint32_t uv_idx;
 
-    if (start[0] == '/') {
+    if (start < end && start[0] == '/') {
         uv_idx = 0;
     } else {
         res = fromCharsU32(start, end, uv_idx);
 
         if (res.ptr == start) {
-            loader.recordError("Failed to read UV idx.");
+            chunk.recordError("Failed to read UV idx.");
             return false;
         }
 
@@ -231,7 +312,7 @@ inline bool parseIdxTriple(const char *start, const char *end,
     res = fromCharsU32(start, end, normal_idx);
 
     if (res.ptr == start) {
-        loader.recordError("Failed to read normal idx");
+        chunk.recordError("Failed to read normal idx");
         return false;
     }
 
@@ -246,29 +327,221 @@ inline bool parseIdxTriple(const char *start, const char *end,
     return true;
 };
 
+bool parseChunk(const char *chunk_start, const char *chunk_end,
+                OBJChunk &chunk)
+{
+    using std::string_view;
+
+    int64_t line_idx = 0;
+    const char *line_start = chunk_start;
+    while (line_start < chunk_end) {
+        const char *line_end = (const char *)memchr(
+            line_start, '\n', chunk_end - line_start);
+        const char *next_line;
+        if (line_end == nullptr) {
+            line_end = chunk_end;
+            next_line = chunk_end;
+        } else {
+            next_line = line_end + 1;
+        }
+
+        if (line_end > line_start && line_end[-1] == '\r') {
+            line_end -= 1;
+        }
+
+        string_view line(line_start, line_end - line_start);
+
+        chunk.curLine = line_start;
+        chunk.curLineLen = line.size();
+        chunk.curLineIdx = line_idx++;
+
+        line_start = next_line;
+
+        if (line.size() == 0) continue;
+
+        if (line[0] == '#') continue;
+
+        if (line[0] == 'o') {
+            chunk.meshSplits.push_back({
+                .numIndices = chunk.indices.size(),
+                .numFaces = chunk.faceCounts.size(),
+                .numPositions = chunk.positions.size(),
+                .numNormals = chunk.normals.size(),
+                .numUVs = chunk.uvs.size(),
+                .line = chunk.curLine,
+                .lineLen = chunk.curLineLen,
+                .lineIdx = chunk.curLineIdx,
+            });
+
+            continue;
+        }
+
+        if (line[0] == 's') continue;
+
+        if (line[0] == 'v' && line.size() > 1) {
+            if (line[1] == ' ') {
+                math::Vector3 pos;
+                bool valid = parseVec3(line.substr(1), &pos, chunk);
+                if (!valid) return false;
+
+                chunk.positions.push_back(pos);
+            } else if (line[1] == 'n') {
+                math::Vector3 normal;
+                bool valid = parseVec3(line.substr(2), &normal, chunk);
+                if (!valid) return false;
+
+                chunk.normals.push_back(normal);
+            } else if (line[1] == 't') {
+                math::Vector2 uv;
+                bool valid = parseVec2(line.substr(2), &uv, chunk);
+                if (!valid) return false;
+
+                chunk.uvs.push_back(uv);
+            }
+        }
+
+        if (line[0] == 'f') {
+            const char *start = line.data() + 1;
+            const char *end = line.data() + line.size();
+
+            int64_t face_count = 0;
+            while (true) {
+                while (start < end && (*start == ' ' || *start == '\r')) {
+                    start += 1;
+                }
+
+                if (start == end) {
+                    break;
+                }
+
+                ObjIDX idx;
+                const char *next;
+                bool valid = parseIdxTriple(start, end, &idx, &next, chunk);
+                if (!valid) return false;
+
+                start = next;
+
+                chunk.indices.push_back(idx);
+
+                face_count++;
+            }
+
+            if (face_count == 0) {
+                chunk.recordError("Face with no indices.");
+                return false;
+            }
+
+            chunk.faceCounts.push_back(face_count);
+        }
+    }
+
+    chunk.numLines = line_idx;
+
+    return true;
+}
+
+template <typename T>
+void appendArray(DynArray<T> &dst, const DynArray<T> &src)
+{
+    CountT offset = dst.size();
+    dst.resize(offset + src.size(), [](T *) {});
+    utils::copyN<T>(dst.data() + offset, src.data(), src.size());
+}
+
+// Appends every chunk's output to the first one. OBJ indices are relative
+// to the start of the file, so only the mesh splits need to be offset.
+void mergeChunks(HeapArray<OBJChunk> &chunks)
+{
+    OBJChunk &merged = chunks[0];
+
+    CountT num_positions = 0, num_normals = 0, num_uvs = 0,
+           num_indices = 0, num_faces = 0, num_splits = 0;
+    for (const OBJChunk &chunk : chunks) {
+        num_positions += chunk.positions.size();
+        num_normals += chunk.normals.size();
+        num_uvs += chunk.uvs.size();
+        num_indices += chunk.indices.size();
+        num_faces += chunk.faceCounts.size();
+        num_splits += chunk.meshSplits.size();
+    }
+
+    merged.positions.reserve(num_positions);
+    merged.normals.reserve(num_normals);
+    merged.uvs.reserve(num_uvs);
+    merged.indices.reserve(num_indices);
+    merged.faceCounts.reserve(num_faces);
+    merged.meshSplits.reserve(num_splits);
+
+    int64_t line_offset = merged.numLines;
+    for (CountT i = 1; i < chunks.size(); i++) {
+        OBJChunk &chunk = chunks[i];
+
+        for (const MeshSplit &split : chunk.meshSplits) {
+            merged.meshSplits.push_back({
+                .numIndices = merged.indices.size() + split.numIndices,
+                .numFaces = merged.faceCounts.size() + split.numFaces,
+                .numPositions = merged.positions.size() + split.numPositions,
+                .numNormals = merged.normals.size() + split.numNormals,
+                .numUVs = merged.uvs.size() + split.numUVs,
+                .line = split.line,
+                .lineLen = split.lineLen,
+                .lineIdx = line_offset + split.lineIdx,
+            });
+        }
+
+        appendArray(merged.positions, chunk.positions);
+        appendArray(merged.normals, chunk.normals);
+        appendArray(merged.uvs, chunk.uvs);
+        appendArray(merged.indices, chunk.indices);
+        appendArray(merged.faceCounts, chunk.faceCounts);
+
+        line_offset += chunk.numLines;
+
+        chunk.positions.release();
+        chunk.normals.release();
+        chunk.uvs.release();
+        chunk.indices.release();
+        chunk.faceCounts.release();
+    }
+
+    merged.numLines = line_offset;
+}
+
+inline uint32_t hashWeldVertex(const WeldVertex &v)
+{
+    uint32_t words[8];
+    memcpy(words, &v, sizeof(WeldVertex));
+
+    uint64_t hash = 0xcbf2'9ce4'8422'2325;
+    for (uint32_t w : words) {
+        hash = (hash ^ w) * 0x100'0000'01b3;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xff51'afd7'ed55'8ccd;
+    hash ^= hash >> 33;
+
+    return uint32_t(hash);
+}
+
 }
 
 OBJLoader::Impl::Impl(Span<char> err_buf)
     : objMeshes(1),
-      curPositions(reserve_elems),
-      curNormals(reserve_elems),
-      curUVs(reserve_elems),
-      curIndices(reserve_elems),
-      curFaceCounts(reserve_elems),
-      unindexedPositions(reserve_elems),
-      unindexedNormals(reserve_elems),
-      unindexedUVs(reserve_elems),
-      fakeIndices(reserve_elems),
-      vertexRemap(reserve_elems),
+      weldVertices(reserve_elems),
+      weldTable(reserve_elems),
       errBuf(err_buf),
       filePath(nullptr),
       curSrcLine(nullptr),
+      curSrcLineLen(0),
       curSrcLineIdx(-1)
 {}
 
-void OBJLoader::Impl::setLine(const char *src_line, int64_t line_idx)
+void OBJLoader::Impl::setLine(const char *src_line, int64_t line_len,
+                              int64_t line_idx)
 {
     curSrcLine = src_line;
+    curSrcLineLen = line_len;
     curSrcLineIdx = line_idx;
 }
 
@@ -285,8 +558,8 @@ void OBJLoader::Impl::recordError(const char *fmt_string, ...) const
             "Invalid OBJ File %s: ", filePath);
     } else {
         prefix_chars_written = snprintf(errBuf.data(), errBuf.size(),
-            "Invalid OBJ File %s, line %" PRIi64 "\n%s\n", filePath,
-            curSrcLineIdx, curSrcLine);
+            "Invalid OBJ File %s, line %" PRIi64 "\n%.*s\n", filePath,
+            curSrcLineIdx, int(curSrcLineLen), curSrcLine);
     }
 
     if (prefix_chars_written < errBuf.size()) {
@@ -299,11 +572,21 @@ void OBJLoader::Impl::recordError(const char *fmt_string, ...) const
     }
 }
 
-bool OBJLoader::Impl::commitMesh(ImportedAssets &out_assets)
+// Commits the faces between mesh_start and mesh_end. Attribute counts in
+// mesh_end are the ones parsed so far, faces can't reference attributes
+// that appear later in the file.
+bool OBJLoader::Impl::commitMesh(const OBJChunk &file_data,
+                                 const MeshSplit &mesh_start,
+                                 const MeshSplit &mesh_end,
+                                 ImportedAssets &out_assets)
 {
-    if (curIndices.size() == 0) {
-        if (curPositions.size() > 0 || curNormals.size() > 0 ||
-                curUVs.size() > 0) {
+    const CountT num_corners = mesh_end.numIndices - mesh_start.numIndices;
+    const CountT num_faces = mesh_end.numFaces - mesh_start.numFaces;
+
+    if (num_corners == 0) {
+        if (mesh_end.numPositions > mesh_start.numPositions ||
+                mesh_end.numNormals > mesh_start.numNormals ||
+                mesh_end.numUVs > mesh_start.numUVs) {
             recordError("Unindexed meshes not supported");
             return false;
         }
@@ -312,9 +595,28 @@ bool OBJLoader::Impl::commitMesh(ImportedAssets &out_assets)
         return true;
     }
 
-    // Unindex mesh
-    for (const ObjIDX &obj_idx : curIndices) {
-        fakeIndices.push_back(uint32_t(unindexedPositions.size()));
+    const ObjIDX *corners = file_data.indices.data() + mesh_start.numIndices;
+    const CountT num_positions = mesh_end.numPositions;
+    const CountT num_normals = mesh_end.numNormals;
+    const CountT num_uvs = mesh_end.numUVs;
+
+    // OBJ files have separate indices for each attribute. De-index each
+    // corner and weld identical vertices through a hash table so the mesh
+    // stays indexed with a single vertex stream. Vertices are numbered in
+    // order of first use.
+    CountT table_size = (CountT)utils::int64NextPow2(
+        uint64_t(num_corners + num_corners / 4));
+    uint32_t table_mask = uint32_t(table_size - 1);
+
+    weldTable.resize(table_size, [](uint32_t *) {});
+    utils::fillN<uint32_t>(weldTable.data(), 0xFFFF'FFFF, table_size);
+    weldVertices.clear();
+
+    DynArray<uint32_t> new_indices(0);
+    new_indices.resize(num_corners, [](uint32_t *) {});
+
+    for (CountT i = 0; i < num_corners; i++) {
+        const ObjIDX &obj_idx = corners[i];
 
         if (obj_idx.posIdx == 0) {
             recordError("Missing position index");
@@ -322,114 +624,101 @@ bool OBJLoader::Impl::commitMesh(ImportedAssets &out_assets)
         }
 
         int64_t pos_idx = obj_idx.posIdx - 1;
-        if (pos_idx >= curPositions.size()) {
+        if (pos_idx >= num_positions) {
             recordError("Out of range position index %" PRIi64 ".", pos_idx);
             return false;
         }
 
-        unindexedPositions.push_back(curPositions[pos_idx]);
+        WeldVertex vert {
+            .position = file_data.positions[pos_idx],
+            .normal = Vector3::zero(),
+            .uv = Vector2 { 0.f, 0.f },
+        };
 
         if (obj_idx.normalIdx > 0) {
             int64_t normal_idx = obj_idx.normalIdx - 1;
-            if (normal_idx >= curNormals.size() ) {
+            if (normal_idx >= num_normals) {
                 recordError("Out of range normal index %" PRIi64 ".",
                             normal_idx);
                 return false;
             }
 
-            unindexedNormals.push_back(curNormals[normal_idx]);
-        } else if (curNormals.size() > 0) {
+            vert.normal = file_data.normals[normal_idx];
+        } else if (num_normals > 0) {
             recordError("Missing normal index.");
             return false;
         }
 
         if (obj_idx.uvIdx > 0) {
             int64_t uv_idx = obj_idx.uvIdx - 1;
-            if (uv_idx >= curUVs.size()) {
+            if (uv_idx >= num_uvs) {
                 recordError("Out of range UV index %" PRIi64 ".",
                             uv_idx);
                 return false;
             }
 
-            unindexedUVs.push_back(curUVs[uv_idx]);
-        } else if (curUVs.size() > 0) {
+            vert.uv = file_data.uvs[uv_idx];
+        } else if (num_uvs > 0) {
             recordError("Missing UV index.");
             return false;
         }
-    }
 
-    std::array<meshopt_Stream, 3> vertex_streams;
-    vertex_streams[0] = {
-        .data = unindexedPositions.data(),
-        .size = sizeof(Vector3),
-        .stride = sizeof(Vector3),
-    };
+        // Triangular probing visits every bucket of a power of 2 table
+        uint32_t bucket = hashWeldVertex(vert) & table_mask;
+        for (uint32_t probe = 1; ; probe++) {
+            uint32_t vert_idx = weldTable[bucket];
 
-    int64_t num_vert_streams = 1;
+            if (vert_idx == 0xFFFF'FFFF) {
+                vert_idx = uint32_t(weldVertices.size());
+                weldVertices.push_back(vert);
+                weldTable[bucket] = vert_idx;
 
-    if (unindexedNormals.size() > 0) {
-        vertex_streams[num_vert_streams++] = {
-            .data = unindexedNormals.data(),
-            .size = sizeof(Vector3),
-            .stride = sizeof(Vector3),
-        };
-    }
+                new_indices[i] = vert_idx;
+                break;
+            }
 
-    if (unindexedUVs.size() > 0) {
-        vertex_streams[num_vert_streams++] = {
-            .data = unindexedUVs.data(),
-            .size = sizeof(Vector2),
-            .stride = sizeof(Vector2),
-        };
-    }
+            if (memcmp(&weldVertices[vert_idx], &vert,
+                       sizeof(WeldVertex)) == 0) {
+                new_indices[i] = vert_idx;
+                break;
+            }
 
-    // OBJ files have separate indices for each attribute. Use
-    // meshoptimizer to reindex the mesh into a single vertex stream.
-    vertexRemap.resize(unindexedPositions.size(), [](uint32_t *) {});
+            bucket = (bucket + probe) & table_mask;
+        }
+    }
 
-    CountT num_new_verts = meshopt_generateVertexRemapMulti(
-        vertexRemap.data(), nullptr, vertexRemap.size(), 
-        vertexRemap.size(), vertex_streams.data(), num_vert_streams);
+    const CountT num_new_verts = weldVertices.size();
 
     DynArray<Vector3> new_positions(0);
     new_positions.resize(num_new_verts, [](Vector3 *) {});
-    DynArray<uint32_t> new_indices(0);
-    new_indices.resize(fakeIndices.size(), [](uint32_t *) {});
     DynArray<Vector3> new_normals(0);
     DynArray<Vector2> new_uvs(0);
 
-    meshopt_remapVertexBuffer(new_positions.data(),
-                              unindexedPositions.data(),
-                              unindexedPositions.size(),
-                              sizeof(Vector3),
-                              vertexRemap.data());
-
-    meshopt_remapIndexBuffer(new_indices.data(), fakeIndices.data(),
-                             fakeIndices.size(), vertexRemap.data());
+    for (CountT i = 0; i < num_new_verts; i++) {
+        new_positions[i] = weldVertices[i].position;
+    }
 
-    if (unindexedNormals.size() > 0) {
+    if (num_normals > 0) {
         new_normals.resize(num_new_verts, [](Vector3 *) {});
-        meshopt_remapVertexBuffer(new_normals.data(),
-                                  unindexedNormals.data(),
-                                  unindexedNormals.size(),
-                                  sizeof(Vector3),
-                                  vertexRemap.data());
+
+        for (CountT i = 0; i < num_new_verts; i++) {
+            new_normals[i] = weldVertices[i].normal;
+        }
     }
 
-    if (unindexedUVs.size() > 0) {
+    if (num_uvs > 0) {
         new_uvs.resize(num_new_verts, [](Vector2 *) {});
 
-        meshopt_remapVertexBuffer(new_uvs.data(),
-                                  unindexedUVs.data(),
-                                  unindexedUVs.size(),
-                                  sizeof(Vector2),
-                                  vertexRemap.data());
+        for (CountT i = 0; i < num_new_verts; i++) {
+            new_uvs[i] = weldVertices[i].uv;
+        }
     }
 
-    DynArray<uint32_t> face_counts_copy(curFaceCounts.size());
+    DynArray<uint32_t> face_counts_copy(num_faces);
 
     bool fully_triangular = true;
-    for (uint32_t c : curFaceCounts) {
+    for (CountT i = 0; i < num_faces; i++) {
+        uint32_t c = file_data.faceCounts[mesh_start.numFaces + i];
         if (c != 3){
             fully_triangular = false;
         }
@@ -437,14 +726,6 @@ bool OBJLoader::Impl::commitMesh(ImportedAssets &out_assets)
         face_counts_copy.push_back(c);
     }
 
-    curIndices.clear();
-    curFaceCounts.clear();
-    unindexedPositions.clear();
-    unindexedNormals.clear();
-    unindexedUVs.clear();
-    fakeIndices.clear();
-    vertexRemap.clear();
-
     objMeshes.push_back({
         .positions = new_positions.data(),
         .normals = new_normals.data(),
@@ -475,103 +756,131 @@ bool OBJLoader::Impl::commitMesh(ImportedAssets &out_assets)
     return true;
 }
 
-bool OBJLoader::Impl::load(const char *path, ImportedAssets &imported_assets)
+bool OBJLoader::Impl::load(const char *path, ImportedAssets &imported_assets,
+                           CountT num_threads)
 {
-    using std::string_view;
-
-    // These arrays aren't cleared incrementally because OBJs are indexed
-    // from the start of the file. Only clear them here, at the start to make
-    // sure all indices correctly start at 1.
-    curPositions.clear();
-    curNormals.clear();
-    curUVs.clear();
-
     filePath = path;
+    // The previous file's last line is gone, don't report errors against it
+    setLine(nullptr, 0, -1);
 
-    std::ifstream file(path);
-    if (!file.is_open() || !file.good()) {
+    Optional<MappedFile> file = MappedFile::map(path);
+    if (!file.has_value()) {
         recordError("Could not open.");
         return false;
     }
 
-    std::string line;
-    int64_t line_idx = 1;
-    while (std::getline(file, line)) {
-        setLine(line.c_str(), line_idx++);
-
-        if (line[0] == '#') continue;
-
-        if (line[0] == 'o') {
-            bool valid = commitMesh(imported_assets);
-            if (!valid) {
-                return false;
-            }
-        }
-
-        if (line[0] == 's') continue;
+    const char *file_start = file->data();
+    const char *file_end = file_start + file->numBytes();
 
-        if (line[0] == 'v') {
-            if (line[1] == ' ') {
-                math::Vector3 pos;
-                bool valid = parseVec3(string_view(line).substr(1), &pos,
-                                       *this);
-                if (!valid) return false;
+    // Chunks start at the beginning of a line, so every chunk can be
+    // parsed independently. Small files are parsed in a single chunk.
+    CountT num_chunks = 1;
+    if (num_threads != 1) {
+        num_chunks = std::max(
+            CountT(file->numBytes() / parse_chunk_bytes), (CountT)1);
+    }
 
-                curPositions.push_back(pos);
-            } else if (line[1] == 'n') {
-                math::Vector3 normal;
-                bool valid = parseVec3(string_view(line).substr(2), &normal,
-                                       *this);
-                if (!valid) return false;
+    HeapArray<const char *> chunk_starts(num_chunks + 1);
+    chunk_starts[0] = file_start;
+    chunk_starts[num_chunks] = file_end;
+    for (CountT i = 1; i < num_chunks; i++) {
+        const char *split = file_start +
+            (file->numBytes() / num_chunks) * i;
+        split = std::max(split, chunk_starts[i - 1]);
+
+        const char *newline = (const char *)memchr(
+            split, '\n', file_end - split);
+        chunk_starts[i] = newline == nullptr ? file_end : newline + 1;
+    }
 
-                curNormals.push_back(normal);
-            } else if (line[1] == 't') {
-                math::Vector2 uv;
-                bool valid = parseVec2(string_view(line).substr(2), &uv,
-                                       *this);
-                if (!valid) return false;
+    HeapArray<OBJChunk> chunks(num_chunks);
+    for (CountT i = 0; i < num_chunks; i++) {
+        chunks.emplace(i);
+    }
 
-                curUVs.push_back(uv);
-            }
+    parallelImport(num_chunks, num_threads,
+        [&](CountT chunk_idx, CountT) {
+            return parseChunk(chunk_starts[chunk_idx],
+                              chunk_starts[chunk_idx + 1], chunks[chunk_idx]);
+        });
+
+    // Chunks are handed out in file order, so every chunk before the first
+    // failed one has been parsed and the error reported is the first one
+    // in the file.
+    int64_t line_offset = 1;
+    for (const OBJChunk &chunk : chunks) {
+        if (chunk.failed) {
+            setLine(chunk.errLine, chunk.errLineLen,
+                    line_offset + chunk.errLineIdx);
+            recordError("%s", chunk.errMsg);
+            return false;
         }
 
-        if (line[0] == 'f') {
-            const char *start = line.data() + 1;
-            const char *end = line.data() + line.size();
+        line_offset += chunk.numLines;
+    }
 
-            int64_t face_count = 0;
-            while (true) {
-                while (start < end && (*start == ' ' || *start == '\r')) {
-                    start += 1;
-                }
+    if (num_chunks > 1) {
+        mergeChunks(chunks);
+    }
 
-                if (start == end) {
-                    break;
-                }
+    const OBJChunk &file_data = chunks[0];
+
+    MeshSplit mesh_start {
+        .numIndices = 0,
+        .numFaces = 0,
+        .numPositions = 0,
+        .numNormals = 0,
+        .numUVs = 0,
+        .line = nullptr,
+        .lineLen = 0,
+        .lineIdx = 0,
+    };
 
-                ObjIDX idx;
-                const char *next;
-                bool valid = parseIdxTriple(start, end, &idx, &next,
-                                            *this);
-                if (!valid) return false;
+    for (const MeshSplit &split : file_data.meshSplits) {
+        setLine(split.line, split.lineLen, split.lineIdx + 1);
 
-                start = next;
+        if (!commitMesh(file_data, mesh_start, split, imported_assets)) {
+            return false;
+        }
 
-                curIndices.push_back(idx);
+        mesh_start = split;
+    }
 
-                face_count++;
-            }
+    // The last mesh ends at the end of the file, report errors against
+    // the last line
+    MeshSplit file_end_split {
+        .numIndices = file_data.indices.size(),
+        .numFaces = file_data.faceCounts.size(),
+        .numPositions = file_data.positions.size(),
+        .numNormals = file_data.normals.size(),
+        .numUVs = file_data.uvs.size(),
+        .line = nullptr,
+        .lineLen = 0,
+        .lineIdx = file_data.numLines - 1,
+    };
 
-            if (face_count == 0) {
-                recordError("Face with no indices.");
-                return false;
-            } 
+    if (file_data.numLines > 0) {
+        const char *last_line_end = file_end;
+        if (last_line_end > file_start && last_line_end[-1] == '\n') {
+            last_line_end -= 1;
+        }
+
+        const char *last_line = last_line_end;
+        while (last_line > file_start && last_line[-1] != '\n') {
+            last_line -= 1;
+        }
 
-            curFaceCounts.push_back(face_count);
+        if (last_line_end > last_line && last_line_end[-1] == '\r') {
+            last_line_end -= 1;
         }
+
+        setLine(last_line, last_line_end - last_line, file_data.numLines);
+    } else {
+        setLine(nullptr, 0, -1);
     }
 
-    if (!commitMesh(imported_assets)) {
+    if (!commitMesh(file_data, mesh_start, file_end_split,
+                    imported_assets)) {
         return false;
     }
 
@@ -591,9 +900,10 @@ OBJLoader::OBJLoader(Span<char> err_buf)
 
 OBJLoader::~OBJLoader() {}
 
-bool OBJLoader::load(const char *path, ImportedAssets &imported_assets)
+bool OBJLoader::load(const char *path, ImportedAssets &imported_assets,
+                     CountT num_threads)
 {
-    return impl_->load(path, imported_assets);
+    return impl_->load(path, imported_assets, num_threads);
 }
 
 }
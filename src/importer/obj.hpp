@@ -13,7 +13,10 @@ struct OBJLoader {
 
     std::unique_ptr<Impl> impl_;
 
-    bool load(const char *path, ImportedAssets &imported_assets);
+    // With num_threads != 1 large files are split into line aligned chunks
+    // parsed in parallel (num_threads == 0 uses every hardware thread).
+    bool load(const char *path, ImportedAssets &imported_assets,
+              CountT num_threads = 1);
 };
 
 }
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <madrona/heap_array.hpp>
+
+#include <atomic>
+#include <thread>
+
+namespace madrona::imp {
+
+inline CountT resolveNumImportThreads(CountT num_threads, CountT num_items)
+{
+    if (num_threads <= 0) {
+        num_threads = (CountT)std::thread::hardware_concurrency();
+    }
+
+    return std::max(std::min(num_threads, num_items), (CountT)1);
+}
+
+// Runs fn(item_idx, thread_idx) for every item, handing items out to
+// num_threads threads (the calling thread included) in index order. Once
+// any call returns false the remaining items are skipped.
+template <typename Fn>
+bool parallelImport(CountT num_items, CountT num_threads, Fn &&fn)
+{
+    num_threads = resolveNumImportThreads(num_threads, num_items);
+
+    std::atomic<CountT> next_item = 0;
+    std::atomic<bool> failed = false;
+
+    auto threadLoop = [&](CountT thread_idx) {
+        while (!failed.load(std::memory_order_relaxed)) {
+            CountT item_idx =
+                next_item.fetch_add(1, std::memory_order_relaxed);
+            if (item_idx >= num_items) {
+                break;
+            }
+
+            if (!fn(item_idx, thread_idx)) {
+                failed.store(true, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    HeapArray<std::thread> threads(num_threads - 1);
+    for (CountT i = 0; i < threads.size(); i++) {
+        threads.emplace(i, threadLoop, i + 1);
+    }
+
+    threadLoop(0);
+
+    for (std::thread &t : threads) {
+        t.join();
+    }
+
+    return !failed.load(std::memory_order_relaxed);
+}
+
+}
@@ -1,30 +1,216 @@
 #include <madrona/mw_cpu.hpp>
 #include "../core/worker_init.hpp"
 
-#if defined(MADRONA_LINUX) or defined(MADRONA_MACOS)
+#if defined(MADRONA_LINUX)
+#include <unistd.h>
+#include <dirent.h>
+#elif defined(MADRONA_MACOS)
 #include <unistd.h>
 #elif defined(MADRONA_WINDOWS)
 #include <windows.h>
 #endif
 
+#if defined(MADRONA_X64)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
 namespace madrona {
 
+namespace {
+
+// Values of ThreadPoolExecutor::Impl::workerWakeup
+enum WorkerCtrl : int32_t {
+    WorkerSleep = 0,
+    WorkerRunJobs = 1,
+    WorkerRunTaskGraphs = 2,
+    WorkerRunNodeMajor = 3,
+    WorkerExit = -1,
+};
+
+}
+
 struct ThreadPoolExecutor::Impl {
+    // Unit of work handed out through the worker queues. For run() this
+    // is the job range [jobIdx, jobIdx + numInvocations) and nodeIdx is
+    // unused; for taskgraphs it is a contiguous range of invocations of
+    // one node.
+    struct WorkItem {
+        uint32_t jobIdx;
+        uint32_t nodeIdx;
+        uint32_t offset;
+        uint32_t numInvocations;
+    };
+
+    // Per-worker deque. The owning worker pushes and pops at the back,
+    // other workers steal from the front.
+    struct alignas(MADRONA_CACHE_LINE) WorkerQueue {
+        SpinLock lock;
+        // Only written with lock held, read without it by thieves to
+        // skip empty queues
+        AtomicU32 numQueued;
+        uint32_t head;
+        DynArray<WorkItem> items;
+    };
+
+    struct NodeState {
+        AtomicI32 numPendingDependencies;
+        AtomicU32 numRemainingSubJobs;
+    };
+
+    // Node N of every world in the NodeMajor schedule
+    struct NodePhase {
+        AtomicU32 ready;
+        uint32_t numItems;
+        // Offset of the phase's items in phaseItems, or ~0u if item i
+        // simply runs node N of job i
+        uint32_t itemsOffset;
+        alignas(MADRONA_CACHE_LINE) AtomicU32 numFinished;
+    };
+
+    // The items of a NodePhase belonging to one NUMA node's worlds
+    struct alignas(MADRONA_CACHE_LINE) PhaseCursor {
+        AtomicU32 nextItem;
+        uint32_t end;
+    };
+
+    // Workers are pinned in NUMA node order, so each node runs a
+    // contiguous range of workers and, through the static job split in
+    // runJobPhase, a contiguous range of worlds
+    struct NumaNode {
+        uint32_t firstWorker;
+        uint32_t numWorkers;
+    };
+
+    // run() splits each worker's range of jobs into this many chunks
+    static constexpr uint32_t numJobChunksPerWorker = 8;
+
+    // What runJobs() does for job index i of the current phase
+    enum class JobType : uint32_t {
+        // Run currentJobs[i]
+        Job,
+        // Copy in world i's exported columns, then run currentJobs[i]
+        CopyInThenJob,
+        // Copy world i's exported columns in / out
+        CopyIn,
+        CopyOut,
+    };
+
     HeapArray<std::thread> workers;
+    HeapArray<WorkerQueue> workerQueues;
+    // -1 if there are more workers than CPUs
+    HeapArray<int32_t> workerCPUs;
+    HeapArray<uint32_t> workerNumaNodes;
+    HeapArray<NumaNode> numaNodes;
+    // Cleared while initializing worlds, so each world's storage is first
+    // touched by its own node
+    bool stealFromRemoteNodes;
+    bool parallelWorldInit;
     alignas(MADRONA_CACHE_LINE) AtomicI32 workerWakeup;
     alignas(MADRONA_CACHE_LINE) AtomicI32 mainWakeup;
+    alignas(MADRONA_CACHE_LINE) AtomicU32 numActiveWorkers;
+    // Advanced by startWorkers before workerWakeup is set for the run.
+    // Workers that are done with a run sleep on it until the next one.
+    alignas(MADRONA_CACHE_LINE) AtomicU32 runGeneration;
+    JobType currentJobType;
     ThreadPoolExecutor::Job *currentJobs;
     uint32_t numJobs;
-    alignas(MADRONA_CACHE_LINE) AtomicU32 nextJob;
     alignas(MADRONA_CACHE_LINE) AtomicU32 numFinished;
     StateManager stateMgr;
     HeapArray<StateCache> stateCaches;
     HeapArray<void *> exportPtrs;
 
+    // Node scheduling state (intraWorldParallelism / NodeMajor)
+    bool intraWorldParallelism;
+    Schedule schedule;
+    uint32_t minRowsPerSubJob;
+    TaskGraphJob *currentGraphJobs;
+    DynArray<uint32_t> graphNodeOffsets;
+    HeapArray<NodeState> nodeStates;
+    alignas(MADRONA_CACHE_LINE) AtomicU32 numRemainingNodes;
+    DynArray<WorkItem> phaseItems;
+    HeapArray<NodePhase> nodePhases;
+    // numaNodes.size() cursors per phase
+    HeapArray<PhaseCursor> phaseCursors;
+    uint32_t numPhases;
+
+    std::unique_ptr<NodeProfiler> profiler;
+    // Set by the main thread before the workers are woken for a step
+    bool profileStep;
+
     static Impl * make(const ThreadPoolExecutor::Config &cfg);
     ~Impl();
-    void run(Job *jobs, CountT num_jobs);
+    void run(Job *jobs, CountT num_jobs, bool jobs_are_worlds);
+    void runPerWorld(Job *jobs, CountT num_worlds);
+    void runTaskGraphs(TaskGraphJob *jobs, CountT num_jobs);
+    bool beginProfiledStep(uint32_t taskgraph_idx);
     void workerThread(CountT worker_id);
+
+    void startWorkers(WorkerCtrl ctrl);
+    void waitForWorkers();
+    void signalFinished();
+
+    void resetWorkerQueues();
+    bool popWorkItem(CountT queue_idx, WorkItem *item);
+    bool stealWorkItem(CountT thief_idx, WorkItem *item);
+    bool stealFromQueue(CountT queue_idx, WorkItem *item);
+
+    void runJobPhase(JobType job_type, Job *jobs, CountT num_jobs);
+    void copyInExportedColumns();
+    void copyOutExportedColumns();
+    uint32_t workerJobsStart(CountT worker_idx, CountT num_jobs) const;
+    void runJobs(CountT worker_id);
+    void runJob(CountT worker_id, uint32_t job_idx);
+
+    void runGraphNodes(CountT worker_id);
+    uint32_t subJobSize(uint32_t num_invocations) const;
+    void enqueueNode(CountT queue_idx, uint32_t job_idx, uint32_t node_idx);
+    void runNode(CountT worker_id, uint32_t job_idx, uint32_t node_idx);
+    void runSubJob(CountT worker_id, const WorkItem &sub_job);
+    uint32_t finishSubJob(CountT worker_id, const WorkItem &sub_job);
+
+    void setupNodeMajor();
+    void openPhase(uint32_t phase_idx);
+    void runPhaseItem(CountT worker_id, uint32_t phase_idx,
+                      uint32_t item_idx);
+    void runNodeMajor(CountT worker_id);
+};
+
+static inline void workerPause()
+{
+#if defined(MADRONA_X64)
+    _mm_pause();
+#elif defined(MADRONA_ARM)
+#if defined(MADRONA_GCC) or defined(MADRONA_CLANG)
+    asm volatile("yield");
+#elif defined(MADRONA_MSVC)
+    YieldProcessor();
+#endif
+#endif
+}
+
+// Spin for a while before falling back to yielding the core, in case
+// there are more workers than cores
+class WorkerBackoff {
+public:
+    inline void wait()
+    {
+        if (++num_spins_ < max_spins_before_yield_) {
+            workerPause();
+        } else {
+            std::this_thread::yield();
+            num_spins_ = 0;
+        }
+    }
+
+    inline void reset() { num_spins_ = 0; }
+
+private:
+    static constexpr uint32_t max_spins_before_yield_ = 64;
+    uint32_t num_spins_ = 0;
 };
 
 static CountT getNumCores()
@@ -55,35 +241,158 @@ static CountT getNumCores()
 #endif
 }
 
-static inline void pinThread([[maybe_unused]] CountT worker_id)
+// CPUs this process may run on, sorted by NUMA node
+struct CPUTopology {
+    HeapArray<int32_t> cpus;
+    // Node of each CPU in cpus, renumbered to 0 ... numNodes - 1
+    HeapArray<uint32_t> cpuNodes;
+    uint32_t numNodes;
+};
+
+#ifdef MADRONA_LINUX
+// Parses a sysfs CPU list ("0-23,48-71")
+template <typename Fn>
+static void parseCPUList(const char *list, Fn &&fn)
+{
+    const char *cur = list;
+    while (*cur != '\0' && *cur != '\n') {
+        char *end;
+        long range_start = strtol(cur, &end, 10);
+        if (end == cur) {
+            break;
+        }
+
+        long range_end = range_start;
+        if (*end == '-') {
+            cur = end + 1;
+            range_end = strtol(cur, &end, 10);
+        }
+
+        for (long cpu = range_start; cpu <= range_end; cpu++) {
+            fn(cpu);
+        }
+
+        cur = *end == ',' ? end + 1 : end;
+    }
+}
+#endif
+
+// Reads the node of each CPU from sysfs on Linux, no libnuma required.
+// Everything is treated as one node elsewhere or if sysfs isn't mounted.
+static CPUTopology getCPUTopology()
 {
 #ifdef MADRONA_LINUX
+    struct CPUInfo {
+        int32_t cpu;
+        int32_t node;
+    };
+
+    // Only CPUs in the current affinity mask are used, in case there
+    // was already cpu masking via a different call to setaffinity or via
+    // cgroup (SLURM)
     cpu_set_t cpu_set;
     pthread_getaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
 
-    const int max_threads = CPU_COUNT(&cpu_set);
-
-    if (worker_id > max_threads) [[unlikely]] {
-        FATAL("Tried setting thread affinity to %d when %d is max",
-              worker_id, max_threads);
+    HeapArray<int32_t> sys_cpu_nodes(CPU_SETSIZE);
+    for (CountT i = 0; i < sys_cpu_nodes.size(); i++) {
+        sys_cpu_nodes[i] = 0;
     }
 
-    cpu_set_t worker_set;
-    CPU_ZERO(&worker_set);
-    
-    // This is needed in case there was already cpu masking via
-    // a different call to setaffinity or via cgroup (SLURM)
-    for (CountT thread_idx = 0, available_threads = 0;
-         thread_idx < (CountT)CPU_SETSIZE; thread_idx++) {
-        if (CPU_ISSET(thread_idx, &cpu_set)) {
-            if ((available_threads++) == worker_id) {
-                CPU_SET(thread_idx, &worker_set);
+    const char *sys_node_dir = "/sys/devices/system/node";
+    if (DIR *dir = opendir(sys_node_dir); dir != nullptr) {
+        while (dirent *entry = readdir(dir)) {
+            int32_t node_id;
+            if (sscanf(entry->d_name, "node%d", &node_id) != 1) {
+                continue;
+            }
 
-                break;
+            char path[256];
+            snprintf(path, sizeof(path), "%s/%s/cpulist",
+                     sys_node_dir, entry->d_name);
+
+            FILE *file = fopen(path, "r");
+            if (file == nullptr) {
+                continue;
+            }
+
+            char cpu_list[4096];
+            if (fgets(cpu_list, sizeof(cpu_list), file) != nullptr) {
+                parseCPUList(cpu_list, [&](long cpu) {
+                    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                        sys_cpu_nodes[cpu] = node_id;
+                    }
+                });
             }
+
+            fclose(file);
+        }
+
+        closedir(dir);
+    }
+
+    DynArray<CPUInfo> allowed_cpus(CPU_COUNT(&cpu_set));
+    for (int32_t cpu = 0; cpu < (int32_t)CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &cpu_set)) {
+            allowed_cpus.push_back({ cpu, sys_cpu_nodes[cpu] });
+        }
+    }
+
+    if (allowed_cpus.size() == 0) {
+        FATAL("Failed to get number of concurrent threads");
+    }
+
+    std::sort(allowed_cpus.begin(), allowed_cpus.end(),
+              [](const CPUInfo &a, const CPUInfo &b) {
+        return a.node < b.node || (a.node == b.node && a.cpu < b.cpu);
+    });
+
+    CPUTopology topo {
+        .cpus = HeapArray<int32_t>(allowed_cpus.size()),
+        .cpuNodes = HeapArray<uint32_t>(allowed_cpus.size()),
+        .numNodes = 0,
+    };
+
+    for (CountT i = 0; i < allowed_cpus.size(); i++) {
+        if (i == 0 || allowed_cpus[i].node != allowed_cpus[i - 1].node) {
+            topo.numNodes++;
         }
+
+        topo.cpus[i] = allowed_cpus[i].cpu;
+        topo.cpuNodes[i] = topo.numNodes - 1;
+    }
+
+    return topo;
+#else
+    CountT num_cores = getNumCores();
+
+    CPUTopology topo {
+        .cpus = HeapArray<int32_t>(num_cores),
+        .cpuNodes = HeapArray<uint32_t>(num_cores),
+        .numNodes = 1,
+    };
+
+    for (CountT i = 0; i < num_cores; i++) {
+        topo.cpus[i] = int32_t(i);
+        topo.cpuNodes[i] = 0;
+    }
+
+    return topo;
+#endif
+}
+
+static inline void pinThread([[maybe_unused]] CountT worker_id,
+                             [[maybe_unused]] int32_t cpu)
+{
+#ifdef MADRONA_LINUX
+    if (cpu < 0) [[unlikely]] {
+        FATAL("Tried setting thread affinity for worker %d with only %d CPUs",
+              worker_id, getNumCores());
     }
 
+    cpu_set_t worker_set;
+    CPU_ZERO(&worker_set);
+    CPU_SET(cpu, &worker_set);
+
     int res = pthread_setaffinity_np(pthread_self(),
                                      sizeof(worker_set),
                                      &worker_set);
@@ -97,25 +406,92 @@ static inline void pinThread([[maybe_unused]] CountT worker_id)
 ThreadPoolExecutor::Impl * ThreadPoolExecutor::Impl::make(
     const ThreadPoolExecutor::Config &cfg)
 {
+    CPUTopology topo = getCPUTopology();
+
+    CountT num_workers =
+        cfg.numWorkers == 0 ? topo.cpus.size() : cfg.numWorkers;
+
     Impl *impl = new Impl {
-        .workers = HeapArray<std::thread>(
-            cfg.numWorkers == 0 ? getNumCores() : cfg.numWorkers),
+        .workers = HeapArray<std::thread>(num_workers),
+        .workerQueues = HeapArray<WorkerQueue>(num_workers),
+        .workerCPUs = HeapArray<int32_t>(num_workers),
+        .workerNumaNodes = HeapArray<uint32_t>(num_workers),
+        .numaNodes = HeapArray<NumaNode>(0),
+        .stealFromRemoteNodes = true,
+        .parallelWorldInit = cfg.parallelWorldInit,
         .workerWakeup = 0,
         .mainWakeup = 0,
+        .numActiveWorkers = 0,
+        .runGeneration = 0,
+        .currentJobType = JobType::Job,
         .currentJobs = nullptr,
         .numJobs = 0,
-        .nextJob = 0,
         .numFinished = 0,
         .stateMgr = StateManager(cfg.numWorlds),
         .stateCaches = HeapArray<StateCache>(cfg.numWorlds),
         .exportPtrs = HeapArray<void *>(cfg.numExportedBuffers),
+        .intraWorldParallelism = cfg.intraWorldParallelism,
+        .schedule = cfg.schedule,
+        .minRowsPerSubJob = std::max(cfg.minRowsPerSubJob, 1_u32),
+        .currentGraphJobs = nullptr,
+        .graphNodeOffsets = DynArray<uint32_t>(0),
+        .nodeStates = HeapArray<NodeState>(0),
+        .numRemainingNodes = 0,
+        .phaseItems = DynArray<WorkItem>(0),
+        .nodePhases = HeapArray<NodePhase>(0),
+        .phaseCursors = HeapArray<PhaseCursor>(0),
+        .numPhases = 0,
+        .profiler = nullptr,
+        .profileStep = false,
     };
 
+    if (cfg.profileSampleInterval > 0) {
+        impl->profiler = std::make_unique<NodeProfiler>(num_workers,
+            cfg.profileSampleInterval, cfg.profileEventsPerWorker);
+    }
+
     for (CountT i = 0; i < (CountT)cfg.numWorlds; i++) {
         impl->stateCaches.emplace(i);
     }
 
-    for (CountT i = 0; i < impl->workers.size(); i++) {
+    // Worker i is pinned to the i-th allowed CPU in node order. Workers
+    // beyond the number of CPUs (an error on Linux, see pinThread) are
+    // placed on the last node.
+    uint32_t num_worker_nodes = 0;
+    for (CountT i = 0; i < num_workers; i++) {
+        bool has_cpu = i < topo.cpus.size();
+
+        impl->workerCPUs[i] = has_cpu ? topo.cpus[i] : -1;
+        impl->workerNumaNodes[i] =
+            has_cpu ? topo.cpuNodes[i] : topo.numNodes - 1;
+
+        num_worker_nodes = impl->workerNumaNodes[i] + 1;
+    }
+
+    impl->numaNodes = HeapArray<NumaNode>(num_worker_nodes);
+    for (CountT i = 0; i < (CountT)num_worker_nodes; i++) {
+        impl->numaNodes[i] = NumaNode {
+            .firstWorker = 0,
+            .numWorkers = 0,
+        };
+    }
+
+    for (CountT i = num_workers - 1; i >= 0; i--) {
+        NumaNode &node = impl->numaNodes[impl->workerNumaNodes[i]];
+        node.firstWorker = uint32_t(i);
+        node.numWorkers++;
+    }
+
+    for (CountT i = 0; i < num_workers; i++) {
+        new (&impl->workerQueues[i]) WorkerQueue {
+            .lock = {},
+            .numQueued = 0,
+            .head = 0,
+            .items = DynArray<WorkItem>(0),
+        };
+    }
+
+    for (CountT i = 0; i < num_workers; i++) {
         impl->workers.emplace(i, [](Impl *impl, CountT i) {
             impl->workerThread(i);
         }, impl, i);
@@ -132,8 +508,12 @@ ThreadPoolExecutor::ThreadPoolExecutor(ThreadPoolExecutor &&o) = default;
 
 ThreadPoolExecutor::Impl::~Impl()
 {
-    workerWakeup.store_release(-1);
+    waitForWorkers();
+
+    workerWakeup.store<sync::seq_cst>(WorkerExit);
+    runGeneration.fetch_add<sync::seq_cst>(1);
     workerWakeup.notify_all();
+    runGeneration.notify_all();
 
     for (CountT i = 0; i < workers.size(); i++) {
         workers[i].join();
@@ -142,26 +522,635 @@ ThreadPoolExecutor::Impl::~Impl()
 
 ThreadPoolExecutor::~ThreadPoolExecutor() = default;
 
-void ThreadPoolExecutor::Impl::run(Job *jobs, CountT num_jobs)
+// Workers that woke up for the previous run may still be on their way out
+// of it. Wait for them before the shared scheduling state is reset.
+void ThreadPoolExecutor::Impl::waitForWorkers()
 {
-    stateMgr.copyInExportedColumns();
+    WorkerBackoff backoff;
+    while (numActiveWorkers.load<sync::seq_cst>() != 0) {
+        backoff.wait();
+    }
+}
 
-    currentJobs = jobs;
-    numJobs = uint32_t(num_jobs);
-    nextJob.store_relaxed(0);
-    numFinished.store_relaxed(0);
-    workerWakeup.store_release(1);
+void ThreadPoolExecutor::Impl::startWorkers(WorkerCtrl ctrl)
+{
+    runGeneration.fetch_add<sync::seq_cst>(1);
+    workerWakeup.store<sync::seq_cst>(ctrl);
     workerWakeup.notify_all();
+    runGeneration.notify_all();
 
     mainWakeup.wait<sync::acquire>(0);
     mainWakeup.store_relaxed(0);
+}
+
+void ThreadPoolExecutor::Impl::signalFinished()
+{
+    workerWakeup.store<sync::seq_cst>(WorkerSleep);
+    mainWakeup.store_release(1);
+    mainWakeup.notify_one();
+}
+
+void ThreadPoolExecutor::Impl::run(Job *jobs, CountT num_jobs,
+                                   bool jobs_are_worlds)
+{
+    // Only set by runWorldJobs() when it's running taskgraphs
+    if (!jobs_are_worlds) {
+        currentGraphJobs = nullptr;
+        profileStep = false;
+    }
+
+    if (jobs_are_worlds && num_jobs > 0) {
+        runJobPhase(stateMgr.hasCopyInColumns() ?
+                        JobType::CopyInThenJob : JobType::Job,
+                    jobs, num_jobs);
+    } else {
+        copyInExportedColumns();
+
+        if (num_jobs > 0) {
+            runJobPhase(JobType::Job, jobs, num_jobs);
+        }
+    }
+
+    copyOutExportedColumns();
+}
+
+// Runs jobs[i] on a worker of the NUMA node world i is placed on, without
+// the exported column copies done around steps
+void ThreadPoolExecutor::Impl::runPerWorld(Job *jobs, CountT num_worlds)
+{
+    currentGraphJobs = nullptr;
+    profileStep = false;
+
+    stealFromRemoteNodes = false;
+    runJobPhase(JobType::Job, jobs, num_worlds);
+    stealFromRemoteNodes = true;
+}
+
+void ThreadPoolExecutor::Impl::runJobPhase(JobType job_type, Job *jobs,
+                                           CountT num_jobs)
+{
+    waitForWorkers();
+
+    currentJobType = job_type;
+    currentJobs = jobs;
+    numJobs = uint32_t(num_jobs);
+    numFinished.store_relaxed(0);
+
+    resetWorkerQueues();
+
+    // Give each worker a contiguous range of jobs, split into chunks
+    // that idle workers can steal. Chunks are pushed in reverse so
+    // the owner, popping from the back, runs its range in order while
+    // thieves take from the far end.
+    CountT num_workers = workers.size();
+    for (CountT worker_idx = 0; worker_idx < num_workers; worker_idx++) {
+        uint32_t range_start = workerJobsStart(worker_idx, num_jobs);
+        uint32_t range_end = workerJobsStart(worker_idx + 1, num_jobs);
+        uint32_t range_size = range_end - range_start;
+
+        if (range_size == 0) {
+            continue;
+        }
+
+        uint32_t chunk_size = utils::divideRoundUp(range_size,
+                                                   numJobChunksPerWorker);
+        uint32_t num_chunks =
+            utils::divideRoundUp(range_size, chunk_size);
+
+        WorkerQueue &queue = workerQueues[worker_idx];
+        queue.items.resize(num_chunks, [](auto) {});
+
+        for (uint32_t i = 0; i < num_chunks; i++) {
+            uint32_t chunk_start = range_start + i * chunk_size;
+
+            queue.items[num_chunks - i - 1] = WorkItem {
+                .jobIdx = chunk_start,
+                .nodeIdx = 0,
+                .offset = 0,
+                .numInvocations =
+                    std::min(chunk_size, range_end - chunk_start),
+            };
+        }
+
+        queue.numQueued.store_relaxed(num_chunks);
+    }
+
+    startWorkers(WorkerRunJobs);
+}
+
+// Start of worker_idx's share of the jobs in run(). Also used to place
+// worlds on NUMA nodes, so a world is always initialized and stepped by
+// the same node's workers.
+uint32_t ThreadPoolExecutor::Impl::workerJobsStart(CountT worker_idx,
+                                                   CountT num_jobs) const
+{
+    return uint32_t(num_jobs * worker_idx / workers.size());
+}
+
+void ThreadPoolExecutor::Impl::copyInExportedColumns()
+{
+    if (stateMgr.hasCopyInColumns()) {
+        runJobPhase(JobType::CopyIn, nullptr, stateCaches.size());
+    }
+}
+
+// The export buffers pack every world's rows back to back, so the layout
+// depends on the row counts of all worlds. Compute it serially, then copy
+// the worlds in parallel.
+void ThreadPoolExecutor::Impl::copyOutExportedColumns()
+{
+    stateMgr.prepareCopyOut();
+
+    if (stateMgr.hasCopyOutColumns()) {
+        runJobPhase(JobType::CopyOut, nullptr, stateCaches.size());
+    }
+}
+
+bool ThreadPoolExecutor::Impl::beginProfiledStep(uint32_t taskgraph_idx)
+{
+    if (profiler == nullptr) {
+        return false;
+    }
+
+    return profiler->beginStep(taskgraph_idx);
+}
+
+void ThreadPoolExecutor::Impl::runTaskGraphs(TaskGraphJob *jobs,
+                                             CountT num_jobs)
+{
+    copyInExportedColumns();
+
+    waitForWorkers();
+
+    currentGraphJobs = jobs;
+    numJobs = uint32_t(num_jobs);
+
+    graphNodeOffsets.resize(num_jobs, [](auto) {});
+
+    CountT num_total_nodes = 0;
+    for (CountT job_idx = 0; job_idx < num_jobs; job_idx++) {
+        graphNodeOffsets[job_idx] = uint32_t(num_total_nodes);
+        num_total_nodes += jobs[job_idx].taskgraph.numNodes();
+    }
+
+    phaseItems.clear();
+
+    if (num_total_nodes == 0) {
+        copyOutExportedColumns();
+        return;
+    }
+
+    if (schedule == Schedule::NodeMajor) {
+        setupNodeMajor();
+        startWorkers(WorkerRunNodeMajor);
+
+        copyOutExportedColumns();
+        return;
+    }
+
+    if (num_total_nodes > nodeStates.size()) {
+        nodeStates = HeapArray<NodeState>(num_total_nodes);
+    }
+
+    for (CountT job_idx = 0; job_idx < num_jobs; job_idx++) {
+        TaskGraph &taskgraph = jobs[job_idx].taskgraph;
+        NodeState *job_states = &nodeStates[graphNodeOffsets[job_idx]];
+
+        for (CountT node_idx = 0; node_idx < taskgraph.numNodes();
+             node_idx++) {
+            new (&job_states[node_idx]) NodeState {
+                .numPendingDependencies =
+                    int32_t(taskgraph.numNodeDependencies(node_idx)),
+                .numRemainingSubJobs = 0,
+            };
+        }
+    }
+
+    numRemainingNodes.store_relaxed(uint32_t(num_total_nodes));
+
+    resetWorkerQueues();
+
+    // Seed the worker queues with every root node, keeping each worker on
+    // a contiguous range of worlds. Everything else is enqueued onto the
+    // queue of the worker that retires the node's last dependency.
+    CountT queue_idx = 0;
+    for (CountT job_idx = 0; job_idx < num_jobs; job_idx++) {
+        TaskGraph &taskgraph = jobs[job_idx].taskgraph;
+
+        while (job_idx >= workerJobsStart(queue_idx + 1, num_jobs)) {
+            queue_idx++;
+        }
+
+        for (CountT node_idx = 0; node_idx < taskgraph.numNodes();
+             node_idx++) {
+            if (taskgraph.numNodeDependencies(node_idx) == 0) {
+                enqueueNode(queue_idx, uint32_t(job_idx), uint32_t(node_idx));
+            }
+        }
+    }
+
+    startWorkers(WorkerRunTaskGraphs);
+
+    copyOutExportedColumns();
+}
+
+uint32_t ThreadPoolExecutor::Impl::subJobSize(uint32_t num_invocations) const
+{
+    return std::max(minRowsPerSubJob,
+        utils::divideRoundUp(num_invocations, uint32_t(workers.size())));
+}
+
+void ThreadPoolExecutor::Impl::resetWorkerQueues()
+{
+    for (CountT i = 0; i < workerQueues.size(); i++) {
+        WorkerQueue &queue = workerQueues[i];
+        queue.head = 0;
+        queue.items.clear();
+        queue.numQueued.store_relaxed(0);
+    }
+}
+
+bool ThreadPoolExecutor::Impl::popWorkItem(CountT queue_idx, WorkItem *item)
+{
+    WorkerQueue &queue = workerQueues[queue_idx];
+
+    if (queue.numQueued.load_relaxed() == 0) {
+        return false;
+    }
+
+    queue.lock.lock();
+
+    bool found = queue.head < uint32_t(queue.items.size());
+    if (found) {
+        *item = queue.items.back();
+        queue.items.pop_back();
+        queue.numQueued.store_relaxed(
+            uint32_t(queue.items.size()) - queue.head);
+    }
+
+    queue.lock.unlock();
+
+    return found;
+}
+
+// Idle workers steal from the other workers of their own NUMA node first,
+// so work (and the world data it touches) only crosses sockets once the
+// whole node has run dry.
+bool ThreadPoolExecutor::Impl::stealWorkItem(CountT thief_idx,
+                                             WorkItem *item)
+{
+    const NumaNode &node = numaNodes[workerNumaNodes[thief_idx]];
+    CountT node_offset = thief_idx - node.firstWorker;
+
+    for (CountT i = 1; i < (CountT)node.numWorkers; i++) {
+        CountT queue_idx =
+            node.firstWorker + (node_offset + i) % node.numWorkers;
+
+        if (stealFromQueue(queue_idx, item)) {
+            return true;
+        }
+    }
+
+    if (!stealFromRemoteNodes) {
+        return false;
+    }
+
+    CountT num_queues = workerQueues.size();
+    CountT num_remote = num_queues - node.numWorkers;
+    for (CountT i = 0; i < num_remote; i++) {
+        CountT queue_idx =
+            (node.firstWorker + node.numWorkers + i) % num_queues;
+
+        if (stealFromQueue(queue_idx, item)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ThreadPoolExecutor::Impl::stealFromQueue(CountT queue_idx,
+                                              WorkItem *item)
+{
+    WorkerQueue &queue = workerQueues[queue_idx];
+
+    if (queue.numQueued.load_relaxed() == 0) {
+        return false;
+    }
+
+    queue.lock.lock();
+
+    bool found = queue.head < uint32_t(queue.items.size());
+    if (found) {
+        *item = queue.items[queue.head++];
+        queue.numQueued.store_relaxed(
+            uint32_t(queue.items.size()) - queue.head);
+    }
+
+    queue.lock.unlock();
+
+    return found;
+}
+
+void ThreadPoolExecutor::Impl::enqueueNode(CountT queue_idx,
+                                           uint32_t job_idx,
+                                           uint32_t node_idx)
+{
+    TaskGraph &taskgraph = currentGraphJobs[job_idx].taskgraph;
+    NodeState &node_state = nodeStates[graphNodeOffsets[job_idx] + node_idx];
+
+    // The number of invocations is only fixed once all of the node's
+    // dependencies have run, so this is computed at enqueue time.
+    uint32_t num_invocations = taskgraph.numNodeInvocations(node_idx);
+
+    uint32_t invocations_per_sub_job = num_invocations;
+    uint32_t num_sub_jobs = 1;
+    if (taskgraph.isNodeSplittable(node_idx)) {
+        invocations_per_sub_job = subJobSize(num_invocations);
+        num_sub_jobs = std::max(1_u32,
+            utils::divideRoundUp(num_invocations, invocations_per_sub_job));
+    }
+
+    node_state.numRemainingSubJobs.store_relaxed(num_sub_jobs);
+
+    WorkerQueue &queue = workerQueues[queue_idx];
+
+    queue.lock.lock();
+
+    if (queue.head == uint32_t(queue.items.size())) {
+        queue.head = 0;
+        queue.items.clear();
+    }
+
+    // Pushed in reverse so the owner starts at the front of the node
+    for (uint32_t i = num_sub_jobs; i > 0; i--) {
+        uint32_t offset = (i - 1) * invocations_per_sub_job;
+
+        queue.items.push_back(WorkItem {
+            .jobIdx = job_idx,
+            .nodeIdx = node_idx,
+            .offset = offset,
+            .numInvocations = std::min(invocations_per_sub_job,
+                                       num_invocations - offset),
+        });
+    }
+
+    queue.numQueued.store_relaxed(uint32_t(queue.items.size()) - queue.head);
 
-    stateMgr.copyOutExportedColumns();
+    queue.lock.unlock();
+}
+
+// Runs all of node_idx in one job. Job indices are world indices for
+// taskgraph runs.
+void ThreadPoolExecutor::Impl::runNode(CountT worker_id, uint32_t job_idx,
+                                       uint32_t node_idx)
+{
+    TaskGraphJob &job = currentGraphJobs[job_idx];
+
+    if (!profileStep) [[likely]] {
+        job.taskgraph.runNode(node_idx, job.ctx);
+        return;
+    }
+
+    uint32_t num_rows = job.taskgraph.numNodeInvocations(node_idx);
+
+    uint64_t start = NodeProfiler::timestamp();
+    job.taskgraph.runNode(node_idx, job.ctx);
+    uint64_t end = NodeProfiler::timestamp();
+
+    profiler->record(worker_id, job_idx, node_idx, num_rows, start, end);
+}
+
+void ThreadPoolExecutor::Impl::runSubJob(CountT worker_id,
+                                         const WorkItem &sub_job)
+{
+    TaskGraphJob &job = currentGraphJobs[sub_job.jobIdx];
+
+    if (!job.taskgraph.isNodeSplittable(sub_job.nodeIdx)) {
+        runNode(worker_id, sub_job.jobIdx, sub_job.nodeIdx);
+        return;
+    }
+
+    uint64_t start = 0;
+    if (profileStep) [[unlikely]] {
+        start = NodeProfiler::timestamp();
+    }
+
+    job.taskgraph.runNodeRange(sub_job.nodeIdx, job.ctx,
+                               sub_job.offset,
+                               sub_job.numInvocations);
+
+    if (profileStep) [[unlikely]] {
+        profiler->record(worker_id, sub_job.jobIdx, sub_job.nodeIdx,
+                         sub_job.numInvocations, start,
+                         NodeProfiler::timestamp());
+    }
+}
+
+// Returns the number of nodes retired by this sub-job (0 or 1). The
+// caller batches these into numRemainingNodes.
+uint32_t ThreadPoolExecutor::Impl::finishSubJob(CountT worker_id,
+                                                const WorkItem &sub_job)
+{
+    TaskGraph &taskgraph = currentGraphJobs[sub_job.jobIdx].taskgraph;
+    NodeState *job_states = &nodeStates[graphNodeOffsets[sub_job.jobIdx]];
+
+    // acq_rel so the thread retiring the node has seen the effects of
+    // all the node's sub-jobs before releasing its dependents
+    uint32_t prev_remaining =
+        job_states[sub_job.nodeIdx].numRemainingSubJobs.fetch_sub_acq_rel(1);
+    if (prev_remaining != 1) {
+        return 0;
+    }
+
+    for (uint32_t dependent_idx : taskgraph.nodeDependents(sub_job.nodeIdx)) {
+        int32_t prev_pending = job_states[dependent_idx].
+            numPendingDependencies.fetch_sub_acq_rel(1);
+
+        if (prev_pending == 1) {
+            enqueueNode(worker_id, sub_job.jobIdx, dependent_idx);
+        }
+    }
+
+    return 1;
+}
+
+void ThreadPoolExecutor::Impl::setupNodeMajor()
+{
+    uint32_t max_num_nodes = 0;
+    for (CountT job_idx = 0; job_idx < (CountT)numJobs; job_idx++) {
+        max_num_nodes = std::max(max_num_nodes,
+            uint32_t(currentGraphJobs[job_idx].taskgraph.numNodes()));
+    }
+
+    if (max_num_nodes > nodePhases.size()) {
+        nodePhases = HeapArray<NodePhase>(max_num_nodes);
+        phaseCursors =
+            HeapArray<PhaseCursor>(max_num_nodes * numaNodes.size());
+    }
+    numPhases = max_num_nodes;
+
+    for (CountT phase_idx = 0; phase_idx < (CountT)numPhases; phase_idx++) {
+        NodePhase &phase = nodePhases[phase_idx];
+        phase.ready.store_relaxed(0);
+        phase.numItems = 0;
+        phase.itemsOffset = ~0u;
+        phase.numFinished.store_relaxed(0);
+    }
+
+    openPhase(0);
+}
+
+// Called by the main thread for the first phase and by the worker that
+// finishes the last item of phase_idx - 1 for the rest, so only one
+// thread ever writes a phase's items. Items are grouped by the NUMA node
+// their world is placed on, with one cursor per node.
+void ThreadPoolExecutor::Impl::openPhase(uint32_t phase_idx)
+{
+    NodePhase &phase = nodePhases[phase_idx];
+    PhaseCursor *cursors = &phaseCursors[phase_idx * numaNodes.size()];
+
+    uint32_t items_offset = uint32_t(phaseItems.size());
+
+    for (CountT numa_idx = 0; numa_idx < numaNodes.size(); numa_idx++) {
+        const NumaNode &numa_node = numaNodes[numa_idx];
+        uint32_t jobs_start = workerJobsStart(numa_node.firstWorker, numJobs);
+        uint32_t jobs_end = workerJobsStart(
+            numa_node.firstWorker + numa_node.numWorkers, numJobs);
+
+        if (!intraWorldParallelism) {
+            cursors[numa_idx].nextItem.store_relaxed(jobs_start);
+            cursors[numa_idx].end = jobs_end;
+
+            continue;
+        }
+
+        cursors[numa_idx].nextItem.store_relaxed(
+            uint32_t(phaseItems.size()) - items_offset);
+
+        for (uint32_t job_idx = jobs_start; job_idx < jobs_end; job_idx++) {
+            TaskGraph &taskgraph = currentGraphJobs[job_idx].taskgraph;
+            if (phase_idx >= taskgraph.numNodes()) {
+                continue;
+            }
+
+            uint32_t num_invocations = taskgraph.numNodeInvocations(phase_idx);
+            uint32_t invocations_per_sub_job = num_invocations;
+            if (taskgraph.isNodeSplittable(phase_idx)) {
+                invocations_per_sub_job = subJobSize(num_invocations);
+            }
+
+            uint32_t offset = 0;
+            do {
+                phaseItems.push_back(WorkItem {
+                    .jobIdx = job_idx,
+                    .nodeIdx = phase_idx,
+                    .offset = offset,
+                    .numInvocations = std::min(invocations_per_sub_job,
+                                               num_invocations - offset),
+                });
+
+                offset += invocations_per_sub_job;
+            } while (offset < num_invocations);
+        }
+
+        cursors[numa_idx].end = uint32_t(phaseItems.size()) - items_offset;
+    }
+
+    if (!intraWorldParallelism) {
+        phase.numItems = numJobs;
+        phase.itemsOffset = ~0u;
+    } else {
+        phase.numItems = uint32_t(phaseItems.size()) - items_offset;
+        phase.itemsOffset = items_offset;
+    }
+
+    phase.ready.store_release(1);
+}
+
+void ThreadPoolExecutor::Impl::runPhaseItem(CountT worker_id,
+                                            uint32_t phase_idx,
+                                            uint32_t item_idx)
+{
+    NodePhase &phase = nodePhases[phase_idx];
+
+    if (phase.itemsOffset == ~0u) {
+        TaskGraphJob &job = currentGraphJobs[item_idx];
+        if (phase_idx < job.taskgraph.numNodes()) {
+            runNode(worker_id, item_idx, phase_idx);
+        }
+    } else {
+        runSubJob(worker_id, phaseItems[phase.itemsOffset + item_idx]);
+    }
+
+    // acq_rel so the thread opening the next phase has seen the
+    // effects of every item in this one
+    uint32_t prev_finished = phase.numFinished.fetch_add_acq_rel(1);
+    if (prev_finished == phase.numItems - 1) {
+        if (phase_idx + 1 < numPhases) {
+            openPhase(phase_idx + 1);
+        } else {
+            signalFinished();
+        }
+    }
+}
+
+void ThreadPoolExecutor::Impl::runNodeMajor(CountT worker_id)
+{
+    WorkerBackoff backoff;
+
+    CountT num_numa_nodes = numaNodes.size();
+    CountT home_numa_idx = workerNumaNodes[worker_id];
+
+    for (uint32_t phase_idx = 0; phase_idx < numPhases; phase_idx++) {
+        NodePhase &phase = nodePhases[phase_idx];
+
+        while (phase.ready.load_acquire() == 0) {
+            backoff.wait();
+        }
+        backoff.reset();
+
+        PhaseCursor *cursors = &phaseCursors[phase_idx * num_numa_nodes];
+
+        // Drain this worker's own node first, then help the others
+        for (CountT i = 0; i < num_numa_nodes; i++) {
+            PhaseCursor &cursor =
+                cursors[(home_numa_idx + i) % num_numa_nodes];
+
+            while (true) {
+                uint32_t item_idx = cursor.nextItem.fetch_add_relaxed(1);
+                if (item_idx >= cursor.end) {
+                    break;
+                }
+
+                runPhaseItem(worker_id, phase_idx, item_idx);
+            }
+        }
+    }
 }
 
 void ThreadPoolExecutor::run(Job *jobs, CountT num_jobs)
 {
-    impl_->run(jobs, num_jobs);
+    impl_->run(jobs, num_jobs, false);
+}
+
+void ThreadPoolExecutor::runWorldJobs(Job *jobs, CountT num_worlds,
+                                      TaskGraphJob *graph_jobs,
+                                      uint32_t taskgraph_idx)
+{
+    impl_->profileStep = graph_jobs != nullptr &&
+        impl_->beginProfiledStep(taskgraph_idx);
+    impl_->currentGraphJobs = graph_jobs;
+
+    impl_->run(jobs, num_worlds, true);
+}
+
+void ThreadPoolExecutor::runTaskGraphs(TaskGraphJob *jobs, CountT num_jobs,
+                                       uint32_t taskgraph_idx)
+{
+    impl_->profileStep = impl_->beginProfiledStep(taskgraph_idx);
+
+    impl_->runTaskGraphs(jobs, num_jobs);
 }
 
 void * ThreadPoolExecutor::getExported(CountT slot) const
@@ -169,19 +1158,62 @@ void * ThreadPoolExecutor::getExported(CountT slot) const
     return impl_->exportPtrs[slot];
 }
 
+NodeProfiler * ThreadPoolExecutor::nodeProfiler() const
+{
+    return impl_->profiler.get();
+}
+
 void ThreadPoolExecutor::initializeContexts(
     Context & (*init_fn)(void *, const WorkerInit &, CountT),
     void *init_data, CountT num_worlds)
 {
-    for (CountT world_idx = 0; world_idx < num_worlds; world_idx++) {
+    struct WorldInit {
+        Context & (*initFn)(void *, const WorkerInit &, CountT);
+        void *initData;
+        Impl *impl;
+        CountT worldIdx;
+    };
+
+    auto initWorld = [](void *ptr) {
+        auto world_init = (WorldInit *)ptr;
+        CountT world_idx = world_init->worldIdx;
+
         WorkerInit worker_init {
-            &impl_->stateMgr,
-            &impl_->stateCaches[world_idx],
+            &world_init->impl->stateMgr,
+            &world_init->impl->stateCaches[world_idx],
             uint32_t(world_idx),
         };
 
-        init_fn(init_data, worker_init, world_idx);
+        world_init->initFn(world_init->initData, worker_init, world_idx);
+    };
+
+    HeapArray<WorldInit> world_inits(num_worlds);
+    for (CountT world_idx = 0; world_idx < num_worlds; world_idx++) {
+        world_inits[world_idx] = WorldInit {
+            .initFn = init_fn,
+            .initData = init_data,
+            .impl = impl_.get(),
+            .worldIdx = world_idx,
+        };
+    }
+
+    if (!impl_->parallelWorldInit) {
+        for (CountT world_idx = 0; world_idx < num_worlds; world_idx++) {
+            initWorld(&world_inits[world_idx]);
+        }
+
+        return;
     }
+
+    HeapArray<Job> jobs(num_worlds);
+    for (CountT world_idx = 0; world_idx < num_worlds; world_idx++) {
+        jobs[world_idx] = Job {
+            .fn = initWorld,
+            .data = &world_inits[world_idx],
+        };
+    }
+
+    impl_->runPerWorld(jobs.data(), num_worlds);
 }
 
 ECSRegistry ThreadPoolExecutor::getECSRegistry()
@@ -194,45 +1226,170 @@ void ThreadPoolExecutor::initExport()
     impl_->stateMgr.copyOutExportedColumns();
 }
 
-void ThreadPoolExecutor::Impl::workerThread(CountT worker_id)
+void ThreadPoolExecutor::Impl::runJobs(CountT worker_id)
 {
-    pinThread(worker_id);
+    // Completions are counted locally and only published to the shared
+    // counter when this worker runs out of its own work, rather than
+    // once per job.
+    uint32_t num_unpublished = 0;
 
     while (true) {
-        workerWakeup.wait<sync::relaxed>(0);
-        int32_t ctrl = workerWakeup.load_acquire();
+        WorkItem item;
+        if (!popWorkItem(worker_id, &item)) {
+            if (num_unpublished > 0) {
+                // This has to be acq_rel so the finishing thread has seen
+                // all the other threads' effects
+                uint32_t prev_finished =
+                    numFinished.fetch_add_acq_rel(num_unpublished);
 
-        if (ctrl == 0) {
-            continue;
-        } else if (ctrl == -1) {
-            break;
+                if (prev_finished + num_unpublished == numJobs) {
+                    signalFinished();
+                }
+
+                num_unpublished = 0;
+            }
+
+            // No new work is queued during run(), so once there is
+            // nothing left to steal this worker is done.
+            if (!stealWorkItem(worker_id, &item)) {
+                break;
+            }
         }
 
-        while (true) {
-            uint32_t job_idx = nextJob.fetch_add_relaxed(1);
+        for (uint32_t i = 0; i < item.numInvocations; i++) {
+            uint32_t job_idx = item.jobIdx + i;
 
-            if (job_idx == numJobs) {
-                workerWakeup.store_relaxed(0);
+            switch (currentJobType) {
+                case JobType::Job: {
+                    runJob(worker_id, job_idx);
+                } break;
+                case JobType::CopyInThenJob: {
+                    stateMgr.copyInExportedColumns(job_idx);
+                    runJob(worker_id, job_idx);
+                } break;
+                case JobType::CopyIn: {
+                    stateMgr.copyInExportedColumns(job_idx);
+                } break;
+                case JobType::CopyOut: {
+                    stateMgr.copyOutExportedColumns(job_idx);
+                } break;
+                default: MADRONA_UNREACHABLE();
             }
+        }
 
-            assert(job_idx < 0xFFFF'FFFF);
+        num_unpublished += item.numInvocations;
+    }
+}
 
-            if (job_idx >= numJobs) {
-                break;
+// On profiled steps a world's taskgraph is run here node by node rather
+// than through its job, so each node can be timed
+void ThreadPoolExecutor::Impl::runJob(CountT worker_id, uint32_t job_idx)
+{
+    if (!profileStep) [[likely]] {
+        currentJobs[job_idx].fn(currentJobs[job_idx].data);
+        return;
+    }
+
+    CountT num_nodes = currentGraphJobs[job_idx].taskgraph.numNodes();
+    for (CountT node_idx = 0; node_idx < num_nodes; node_idx++) {
+        runNode(worker_id, job_idx, uint32_t(node_idx));
+    }
+}
+
+void ThreadPoolExecutor::Impl::runGraphNodes(CountT worker_id)
+{
+    WorkerBackoff backoff;
+
+    // Retired nodes are batched the same way as completed jobs in
+    // runJobs()
+    uint32_t num_unpublished = 0;
+
+    while (true) {
+        WorkItem sub_job;
+        if (!popWorkItem(worker_id, &sub_job)) {
+            if (num_unpublished > 0) {
+                uint32_t prev_remaining =
+                    numRemainingNodes.fetch_sub_acq_rel(num_unpublished);
+
+                if (prev_remaining == num_unpublished) {
+                    signalFinished();
+                }
+
+                num_unpublished = 0;
+            }
+
+            if (!stealWorkItem(worker_id, &sub_job)) {
+                // Nothing queued: either every node is done or the
+                // remaining nodes are still waiting on in flight
+                // dependencies.
+                if (numRemainingNodes.load_acquire() == 0) {
+                    break;
+                }
+
+                backoff.wait();
+                continue;
             }
+        }
+
+        backoff.reset();
+
+        runSubJob(worker_id, sub_job);
+        num_unpublished += finishSubJob(worker_id, sub_job);
+    }
+}
+
+void ThreadPoolExecutor::Impl::workerThread(CountT worker_id)
+{
+    pinThread(worker_id, workerCPUs[worker_id]);
+
+    uint32_t last_generation = 0;
+    while (true) {
+        workerWakeup.wait<sync::relaxed>(WorkerSleep);
 
-            currentJobs[job_idx].fn(currentJobs[job_idx].data);
+        // Register as active before looking at the control word, so the
+        // main thread can't reset the scheduling state while this worker
+        // is still reading it (see waitForWorkers)
+        numActiveWorkers.fetch_add<sync::seq_cst>(1);
+        int32_t ctrl = workerWakeup.load<sync::seq_cst>();
+
+        if (ctrl == WorkerExit) {
+            numActiveWorkers.fetch_sub_release(1);
+            break;
+        }
 
-            // This has to be acq_rel so the finishing thread has seen
-            // all the other threads' effects
-            uint32_t prev_finished =
-                numFinished.fetch_add_acq_rel(1);
+        // Loaded after ctrl: the generation is advanced before ctrl is
+        // set, and the main thread can't start another run while this
+        // worker is active, so this is the generation ctrl belongs to
+        uint32_t generation = runGeneration.load<sync::seq_cst>();
 
-            if (prev_finished == numJobs - 1) {
-                mainWakeup.store_release(1);
-                mainWakeup.notify_one();
+        // Either spuriously woken, or already done with this run. In the
+        // latter case sleep until the next run starts rather than polling
+        // workerWakeup until the remaining workers finish this one.
+        if (ctrl == WorkerSleep || generation == last_generation) {
+            numActiveWorkers.fetch_sub_release(1);
+
+            if (ctrl != WorkerSleep) {
+                runGeneration.wait<sync::relaxed>(last_generation);
             }
+            continue;
+        }
+
+        last_generation = generation;
+
+        switch (ctrl) {
+            case WorkerRunJobs: {
+                runJobs(worker_id);
+            } break;
+            case WorkerRunTaskGraphs: {
+                runGraphNodes(worker_id);
+            } break;
+            case WorkerRunNodeMajor: {
+                runNodeMajor(worker_id);
+            } break;
+            default: MADRONA_UNREACHABLE();
         }
+
+        numActiveWorkers.fetch_sub_release(1);
     }
 }
 
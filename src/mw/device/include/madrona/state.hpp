@@ -172,9 +172,10 @@ public:
     inline void archetypeClearNeedsSort(uint32_t archetype_id);
     inline void archetypeSetNeedsSort(uint32_t archetype_id);
 
-    // Included for compatibility with ECSRegistry
+    // Included for compatibility with ECSRegistry. Columns are always
+    // exported in place on the GPU, so flags are ignored.
     template <typename ArchetypeT, typename ComponentT>
-    ComponentT * exportColumn();
+    ComponentT * exportColumn(ExportFlags flags = ExportFlags::ReadWrite);
     template <typename SingletonT>
     SingletonT * exportSingleton();
 
@@ -493,7 +493,7 @@ void StateManager::archetypeSetNeedsSort(uint32_t archetype_id)
 }
 
 template <typename ArchetypeT, typename ComponentT>
-ComponentT * StateManager::exportColumn()
+ComponentT * StateManager::exportColumn(ExportFlags)
 {
     return getArchetypeComponent<ArchetypeT, ComponentT>();
 }
@@ -227,6 +227,25 @@ template <typename ContextT, auto Fn, typename ...ComponentTs>
 using ParallelForNode =
     CustomParallelForNode<ContextT, Fn, 1, 1, ComponentTs...>;
 
+namespace mwGPU {
+
+// Every thread already handles a single row, so chunked systems are
+// called with num_rows = 1
+template <typename ContextT, auto Fn, typename ...ComponentTs>
+struct ChunkRowAdapter {
+    static inline void run(ContextT &ctx, ComponentTs &...components)
+    {
+        Fn(ctx, CountT(1), &components...);
+    }
+};
+
+}
+
+template <typename ContextT, auto Fn, typename ...ComponentTs>
+using ParallelForChunkNode = ParallelForNode<ContextT,
+    mwGPU::ChunkRowAdapter<ContextT, Fn, ComponentTs...>::run,
+    ComponentTs...>;
+
 struct ClearTmpNodeBase : NodeBase {
     ClearTmpNodeBase(uint32_t archetype_id);
 
@@ -0,0 +1,416 @@
+/*
+ * Copyright 2021-2023 Brennan Shacklett and contributors
+ *
+ * Use of this source code is governed by an MIT-style
+ * license that can be found in the LICENSE file or at
+ * https://opensource.org/licenses/MIT.
+ */
+#include <madrona/node_profiler.hpp>
+#include <madrona/dyn_array.hpp>
+#include <madrona/utils.hpp>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+
+namespace madrona {
+
+NodeProfiler::NodeProfiler(CountT num_workers,
+                           uint32_t sample_interval,
+                           uint32_t num_events_per_worker)
+    : rings_(num_workers),
+      ring_mask_(0),
+      sample_interval_(std::max(sample_interval, 1_u32)),
+      num_steps_(0),
+      num_sampled_steps_(0),
+      cur_taskgraph_(0),
+      base_timestamp_(timestamp()),
+      base_time_(std::chrono::steady_clock::now())
+{
+    uint32_t ring_size = utils::int32NextPow2(
+        std::max(num_events_per_worker, 1_u32));
+    ring_mask_ = ring_size - 1;
+
+    for (CountT i = 0; i < num_workers; i++) {
+        rings_.emplace(i, WorkerRing {
+            .events = HeapArray<NodeProfileEvent>(ring_size),
+            .numRecorded = 0,
+        });
+    }
+}
+
+// The timestamp counter's rate isn't known up front, measure it against
+// steady_clock over the profiler's lifetime so far.
+double NodeProfiler::nsPerTick() const
+{
+    uint64_t elapsed_ticks = timestamp() - base_timestamp_;
+    auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - base_time_).count();
+
+    if (elapsed_ticks == 0 || elapsed_ns <= 0) {
+        return 1.0;
+    }
+
+    return double(elapsed_ns) / double(elapsed_ticks);
+}
+
+HeapArray<NodeProfileEvent> NodeProfiler::events() const
+{
+    CountT num_events = 0;
+    for (const WorkerRing &ring : rings_) {
+        num_events += (CountT)std::min(ring.numRecorded,
+                                       uint64_t(ring_mask_) + 1);
+    }
+
+    HeapArray<NodeProfileEvent> out(num_events);
+
+    CountT out_idx = 0;
+    for (const WorkerRing &ring : rings_) {
+        uint64_t first = ring.numRecorded > ring_mask_ ?
+            ring.numRecorded - ring_mask_ - 1 : 0;
+
+        for (uint64_t i = first; i < ring.numRecorded; i++) {
+            out[out_idx++] = ring.events[i & ring_mask_];
+        }
+    }
+
+    return out;
+}
+
+HeapArray<NodeProfileSummary> NodeProfiler::summarize() const
+{
+    HeapArray<NodeProfileEvent> evts = events();
+
+    std::sort(evts.begin(), evts.end(),
+              [](const NodeProfileEvent &a, const NodeProfileEvent &b) {
+        if (a.taskgraph != b.taskgraph) {
+            return a.taskgraph < b.taskgraph;
+        }
+
+        if (a.node != b.node) {
+            return a.node < b.node;
+        }
+
+        if (a.step != b.step) {
+            return a.step < b.step;
+        }
+
+        return a.world < b.world;
+    });
+
+    const double us_per_tick = nsPerTick() / 1000.0;
+
+    DynArray<NodeProfileSummary> summaries(0);
+    DynArray<uint64_t> sample_ticks(0);
+
+    auto finishNode = [&](NodeProfileSummary &summary) {
+        std::sort(sample_ticks.begin(), sample_ticks.end());
+
+        // Nearest rank percentiles
+        auto percentile = [&](double p) {
+            CountT rank = (CountT)(p * sample_ticks.size() + 0.999999);
+            rank = std::clamp(rank, (CountT)1, sample_ticks.size());
+
+            return double(sample_ticks[rank - 1]) * us_per_tick;
+        };
+
+        uint64_t total_ticks = 0;
+        for (uint64_t ticks : sample_ticks) {
+            total_ticks += ticks;
+        }
+
+        summary.numSamples = (uint32_t)sample_ticks.size();
+        summary.p50Us = percentile(0.5);
+        summary.p99Us = percentile(0.99);
+        summary.maxUs = double(sample_ticks.back()) * us_per_tick;
+        summary.totalMs = double(total_ticks) * us_per_tick / 1000.0;
+
+        sample_ticks.clear();
+    };
+
+    CountT i = 0;
+    while (i < evts.size()) {
+        const NodeProfileEvent &first = evts[i];
+
+        // Sub-jobs of the same node in the same world and step form
+        // one sample
+        uint64_t ticks = 0;
+        uint64_t num_rows = 0;
+        CountT j = i;
+        for (; j < evts.size() &&
+                evts[j].taskgraph == first.taskgraph &&
+                evts[j].node == first.node &&
+                evts[j].step == first.step &&
+                evts[j].world == first.world; j++) {
+            ticks += evts[j].end - evts[j].start;
+            num_rows += evts[j].numRows;
+        }
+
+        if (summaries.size() == 0 ||
+                summaries.back().taskgraph != first.taskgraph ||
+                summaries.back().node != first.node) {
+            if (summaries.size() > 0) {
+                finishNode(summaries.back());
+            }
+
+            summaries.push_back(NodeProfileSummary {
+                .taskgraph = first.taskgraph,
+                .node = first.node,
+                .numSamples = 0,
+                .numRows = 0,
+                .p50Us = 0,
+                .p99Us = 0,
+                .maxUs = 0,
+                .totalMs = 0,
+            });
+        }
+
+        summaries.back().numRows += num_rows;
+        sample_ticks.push_back(ticks);
+
+        i = j;
+    }
+
+    if (summaries.size() > 0) {
+        finishNode(summaries.back());
+    }
+
+    HeapArray<NodeProfileSummary> out(summaries.size());
+    for (CountT k = 0; k < summaries.size(); k++) {
+        out[k] = summaries[k];
+    }
+
+    return out;
+}
+
+void NodeProfiler::printSummary(FILE *file) const
+{
+    HeapArray<NodeProfileSummary> summaries = summarize();
+
+    fprintf(file, "%5s %5s %8s %12s %10s %10s %10s %10s\n",
+            "graph", "node", "samples", "rows/sample",
+            "p50 (us)", "p99 (us)", "max (us)", "total (ms)");
+
+    for (const NodeProfileSummary &summary : summaries) {
+        fprintf(file, "%5u %5u %8u %12.1f %10.2f %10.2f %10.2f %10.3f\n",
+                summary.taskgraph, summary.node, summary.numSamples,
+                double(summary.numRows) / double(summary.numSamples),
+                summary.p50Us, summary.p99Us, summary.maxUs,
+                summary.totalMs);
+    }
+}
+
+bool NodeProfiler::writeChromeTrace(const char *path) const
+{
+    FILE *file = fopen(path, "w");
+    if (file == nullptr) {
+        return false;
+    }
+
+    HeapArray<NodeProfileEvent> evts = events();
+    const double us_per_tick = nsPerTick() / 1000.0;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    for (CountT i = 0; i < rings_.size(); i++) {
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\","
+                "\"pid\":0,\"tid\":%" PRId64 ",\"args\":{\"name\":"
+                "\"worker %" PRId64 "\"}}\n",
+                i > 0 ? "," : "", (int64_t)i, (int64_t)i);
+    }
+
+    for (const NodeProfileEvent &evt : evts) {
+        fprintf(file, ",{\"name\":\"graph %u node %u\",\"cat\":\"node\","
+                "\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,"
+                "\"dur\":%.3f,\"args\":{\"world\":%u,\"rows\":%u,"
+                "\"step\":%u}}\n",
+                evt.taskgraph, evt.node, evt.worker,
+                double(evt.start - base_timestamp_) * us_per_tick,
+                double(evt.end - evt.start) * us_per_tick,
+                evt.world, evt.numRows, evt.step);
+    }
+
+    fprintf(file, "]}\n");
+
+    return fclose(file) == 0;
+}
+
+namespace {
+
+// Just enough protobuf encoding for perfetto's Trace / TracePacket /
+// TrackEvent messages (perfetto/protos/perfetto/trace/)
+class ProtoWriter {
+public:
+    void varint(uint64_t v)
+    {
+        while (v >= 0x80) {
+            bytes_.push_back(uint8_t(v) | 0x80);
+            v >>= 7;
+        }
+        bytes_.push_back(uint8_t(v));
+    }
+
+    void uintField(uint32_t field, uint64_t v)
+    {
+        varint(field << 3);
+        varint(v);
+    }
+
+    void bytesField(uint32_t field, const void *data, CountT num_bytes)
+    {
+        varint((field << 3) | 2);
+        varint(num_bytes);
+
+        for (CountT i = 0; i < num_bytes; i++) {
+            bytes_.push_back(((const uint8_t *)data)[i]);
+        }
+    }
+
+    void stringField(uint32_t field, const char *str)
+    {
+        bytesField(field, str, strlen(str));
+    }
+
+    void messageField(uint32_t field, const ProtoWriter &msg)
+    {
+        bytesField(field, msg.bytes_.data(), msg.bytes_.size());
+    }
+
+    void clear() { bytes_.clear(); }
+
+    const uint8_t * data() const { return bytes_.data(); }
+    CountT size() const { return bytes_.size(); }
+
+private:
+    DynArray<uint8_t> bytes_ = DynArray<uint8_t>(0);
+};
+
+namespace perfetto {
+
+constexpr uint32_t tracePacket = 1;
+
+constexpr uint32_t packetTimestamp = 8;
+constexpr uint32_t packetSequenceID = 10;
+constexpr uint32_t packetTrackEvent = 11;
+constexpr uint32_t packetTrackDescriptor = 60;
+
+constexpr uint32_t trackDescUUID = 1;
+constexpr uint32_t trackDescThread = 4;
+constexpr uint32_t threadDescPID = 1;
+constexpr uint32_t threadDescTID = 2;
+constexpr uint32_t threadDescName = 5;
+
+constexpr uint32_t trackEventAnnotations = 4;
+constexpr uint32_t trackEventType = 9;
+constexpr uint32_t trackEventTrackUUID = 11;
+constexpr uint32_t trackEventName = 23;
+constexpr uint32_t sliceBegin = 1;
+constexpr uint32_t sliceEnd = 2;
+
+constexpr uint32_t annotationUint = 3;
+constexpr uint32_t annotationName = 10;
+
+}
+
+}
+
+bool NodeProfiler::writePerfettoTrace(const char *path) const
+{
+    using namespace perfetto;
+
+    FILE *file = fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    ProtoWriter packet, msg, sub_msg, framed;
+    bool success = true;
+
+    // Each TracePacket is written out as one field of the top level Trace
+    // message as soon as it's built
+    auto writePacket = [&]() {
+        framed.clear();
+        framed.messageField(tracePacket, packet);
+        packet.clear();
+
+        success = success && fwrite(framed.data(), 1, framed.size(), file) ==
+            (size_t)framed.size();
+    };
+
+    // One track (and packet sequence) per worker, so timestamps within a
+    // sequence are monotonic and slices on a track never overlap
+    for (CountT i = 0; i < rings_.size(); i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "worker %" PRId64, (int64_t)i);
+
+        sub_msg.clear();
+        sub_msg.uintField(threadDescPID, 1);
+        sub_msg.uintField(threadDescTID, i + 1);
+        sub_msg.stringField(threadDescName, name);
+
+        msg.clear();
+        msg.uintField(trackDescUUID, i + 1);
+        msg.messageField(trackDescThread, sub_msg);
+
+        packet.uintField(packetSequenceID, i + 1);
+        packet.messageField(packetTrackDescriptor, msg);
+        writePacket();
+    }
+
+    HeapArray<NodeProfileEvent> evts = events();
+    const double ns_per_tick = nsPerTick();
+
+    auto toNS = [&](uint64_t ticks) {
+        return uint64_t(double(ticks - base_timestamp_) * ns_per_tick);
+    };
+
+    auto addAnnotation = [&](const char *name, uint64_t v) {
+        sub_msg.clear();
+        sub_msg.stringField(annotationName, name);
+        sub_msg.uintField(annotationUint, v);
+        msg.messageField(trackEventAnnotations, sub_msg);
+    };
+
+    for (const NodeProfileEvent &evt : evts) {
+        char name[64];
+        snprintf(name, sizeof(name), "graph %u node %u",
+                 evt.taskgraph, evt.node);
+
+        msg.clear();
+        msg.uintField(trackEventType, sliceBegin);
+        msg.uintField(trackEventTrackUUID, evt.worker + 1);
+        msg.stringField(trackEventName, name);
+        addAnnotation("world", evt.world);
+        addAnnotation("rows", evt.numRows);
+        addAnnotation("step", evt.step);
+
+        packet.uintField(packetTimestamp, toNS(evt.start));
+        packet.uintField(packetSequenceID, evt.worker + 1);
+        packet.messageField(packetTrackEvent, msg);
+        writePacket();
+
+        msg.clear();
+        msg.uintField(trackEventType, sliceEnd);
+        msg.uintField(trackEventTrackUUID, evt.worker + 1);
+
+        // Keep the end at or after the begin once both are rounded to ns
+        packet.uintField(packetTimestamp,
+                         std::max(toNS(evt.end), toNS(evt.start)));
+        packet.uintField(packetSequenceID, evt.worker + 1);
+        packet.messageField(packetTrackEvent, msg);
+        writePacket();
+    }
+
+    return (fclose(file) == 0) && success;
+}
+
+void NodeProfiler::clear()
+{
+    for (WorkerRing &ring : rings_) {
+        ring.numRecorded = 0;
+    }
+
+    num_sampled_steps_ = 0;
+}
+
+}
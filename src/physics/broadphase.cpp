@@ -14,7 +14,8 @@ using namespace geo;
 BVH::BVH(const ObjectManager *obj_mgr,
          CountT max_leaves,
          float leaf_velocity_expansion,
-         float leaf_accel_expansion)
+         float leaf_accel_expansion,
+         float rebuild_cost_ratio)
     : nodes_((Node *)rawAlloc(sizeof(Node) *
                             numInternalNodes(max_leaves))),
       num_nodes_(0),
@@ -32,9 +33,22 @@ BVH::BVH(const ObjectManager *obj_mgr,
       num_allocated_leaves_(max_leaves),
       leaf_velocity_expansion_(leaf_velocity_expansion),
       leaf_accel_expansion_(leaf_accel_expansion),
+      rebuild_cost_ratio_(rebuild_cost_ratio),
+      built_sah_cost_(0.f),
       force_rebuild_(true)
 {}
 
+void BVH::destroy()
+{
+    rawDealloc(nodes_);
+    rawDealloc(leaf_entities_);
+    rawDealloc(leaf_obj_ids_);
+    rawDealloc(leaf_aabbs_);
+    rawDealloc(leaf_transforms_);
+    rawDealloc(leaf_parents_);
+    rawDealloc(sorted_leaves_);
+}
+
 CountT BVH::numInternalNodes(CountT num_leaves) const
 {
     return std::max(utils::divideRoundUp(num_leaves - 1, CountT(3)), CountT(1)) +
@@ -46,23 +60,34 @@ CountT BVH::numInternalNodes(CountT num_leaves) const
 
 void BVH::rebuild()
 {
-    int32_t num_internal_nodes = numInternalNodes(num_leaves_.load_relaxed());
-    num_nodes_ = num_internal_nodes;
-    assert(num_nodes_ <= num_allocated_nodes_);
+    int32_t num_leaves = num_leaves_.load_relaxed();
+    int32_t num_internal_nodes = numInternalNodes(num_leaves);
+    assert(num_internal_nodes <= num_allocated_nodes_);
+
+    // Not every leaf is updated each step (sleeping bodies are skipped),
+    // so the build order is reset here rather than in updateLeafPosition
+    for (int32_t i = 0; i < num_leaves; i++) {
+        sorted_leaves_[i] = i;
+    }
 
     struct StackEntry {
         int32_t nodeID;
         int32_t parentID;
         int32_t offset;
         int32_t numObjs;
+        int32_t depth;
     };
 
-    StackEntry stack[64];
+    // Each level of the tree holds its node's entry and up to 3 pending
+    // siblings on the stack
+    constexpr CountT max_stack_size = 4 * (maxTreeDepth_ + 1);
+    StackEntry stack[max_stack_size];
     stack[0] = StackEntry {
         sentinel_,
         sentinel_,
         0,
-        int32_t(num_leaves_.load_relaxed()),
+        num_leaves,
+        0,
     };
 
     int32_t cur_node_offset = 0;
@@ -114,101 +139,230 @@ void BVH::rebuild()
             }
             node.parentID = entry.parentID;
 
-            // midpoint sort items
-            auto midpoint_split = [this](
-                    int32_t base, int32_t num_elems) {
+            // Binned SAH split of sorted_leaves_[base, base + num_elems).
+            // Leaf centroids are binned along each axis and the range is
+            // partitioned at the bin boundary with the lowest
+            // count * surface area cost summed over both sides. Returns
+            // the number of leaves in the left half.
+            auto sah_split = [this](int32_t base, int32_t num_elems) {
+                if (num_elems < 2) {
+                    return num_elems / 2;
+                }
 
                 auto get_center = [this, base](int32_t offset) {
-                    AABB aabb = leaf_aabbs_[sorted_leaves_[base + offset]];
-
-                    return (aabb.pMin + aabb.pMax) / 2.f;
+                    return leaf_aabbs_[sorted_leaves_[base + offset]]
+                        .centroid();
                 };
 
-                Vector3 center_min {
-                    FLT_MAX,
-                    FLT_MAX,
-                    FLT_MAX,
+                AABB center_bounds = AABB::invalid();
+                for (int32_t i = 0; i < num_elems; i++) {
+                    center_bounds.expand(get_center(i));
+                }
+
+                struct Bin {
+                    AABB bounds;
+                    int32_t numLeaves;
                 };
 
-                Vector3 center_max {
-                    -FLT_MAX,
-                    -FLT_MAX,
-                    -FLT_MAX,
+                float best_cost = FLT_MAX;
+                int32_t best_axis = -1;
+                int32_t best_bin = 0;
+
+                for (int32_t axis = 0; axis < 3; axis++) {
+                    float center_min = center_bounds.pMin[axis];
+                    float extent = center_bounds.pMax[axis] - center_min;
+                    if (!(extent > 0.f)) {
+                        continue;
+                    }
+
+                    float bin_scale = float(numSAHBins_) / extent;
+
+                    Bin bins[numSAHBins_];
+                    for (int32_t b = 0; b < numSAHBins_; b++) {
+                        bins[b] = Bin { AABB::invalid(), 0 };
+                    }
+
+                    for (int32_t i = 0; i < num_elems; i++) {
+                        int32_t b = std::min(int32_t(
+                            (get_center(i)[axis] - center_min) * bin_scale),
+                            numSAHBins_ - 1);
+
+                        bins[b].bounds = AABB::merge(bins[b].bounds,
+                            leaf_aabbs_[sorted_leaves_[base + i]]);
+                        bins[b].numLeaves += 1;
+                    }
+
+                    // right_costs[b] is the cost of bins (b, numSAHBins_)
+                    float right_costs[numSAHBins_ - 1];
+                    AABB right_bounds = AABB::invalid();
+                    int32_t num_right = 0;
+                    for (int32_t b = numSAHBins_ - 1; b > 0; b--) {
+                        right_bounds =
+                            AABB::merge(right_bounds, bins[b].bounds);
+                        num_right += bins[b].numLeaves;
+                        right_costs[b - 1] = num_right == 0 ? 0.f :
+                            float(num_right) * right_bounds.surfaceArea();
+                    }
+
+                    AABB left_bounds = AABB::invalid();
+                    int32_t num_left = 0;
+                    for (int32_t b = 0; b < numSAHBins_ - 1; b++) {
+                        left_bounds = AABB::merge(left_bounds, bins[b].bounds);
+                        num_left += bins[b].numLeaves;
+
+                        if (num_left == 0 || num_left == num_elems) {
+                            continue;
+                        }
+
+                        float cost = float(num_left) *
+                            left_bounds.surfaceArea() + right_costs[b];
+
+                        if (cost < best_cost) {
+                            best_cost = cost;
+                            best_axis = axis;
+                            best_bin = b;
+                        }
+                    }
+                }
+
+                // All centroids coincide
+                if (best_axis == -1) {
+                    return num_elems / 2;
+                }
+
+                float center_min = center_bounds.pMin[best_axis];
+                float bin_scale = float(numSAHBins_) /
+                    (center_bounds.pMax[best_axis] - center_min);
+
+                auto in_left = [&](int32_t offset) {
+                    int32_t b = std::min(int32_t(
+                        (get_center(offset)[best_axis] - center_min) *
+                            bin_scale), numSAHBins_ - 1);
+                    return b <= best_bin;
                 };
 
-                for (int i = 0; i < num_elems; i++) {
-                    const Vector3 &center = get_center(i);
-                    center_min = Vector3::min(center_min, center);
-                    center_max = Vector3::max(center_max, center);
+                int32_t start = 0;
+                int32_t end = num_elems;
+
+                while (start < end) {
+                    while (start < end && in_left(start)) {
+                        ++start;
+                    }
+
+                    while (start < end && !in_left(end - 1)) {
+                        --end;
+                    }
+
+                    if (start < end) {
+                        std::swap(sorted_leaves_[base + start],
+                                  sorted_leaves_[base + end - 1]);
+                        ++start;
+                        --end;
+                    }
                 }
 
-                auto split = [&](auto get_component) {
-                    float split_val = 0.5f * (get_component(center_min) +
-                                              get_component(center_max));
+                if (start > 0 && start < num_elems) {
+                    return start;
+                } else {
+                    return num_elems / 2;
+                }
+            };
 
-                    int start = 0;
-                    int end = num_elems;
+            // Splits sorted_leaves_[base, base + num_elems) in half at the
+            // median centroid along the widest centroid axis. Each level
+            // of these quarters the leaves, so it bounds the depth of
+            // the subtree where SAH splits have gotten too unbalanced.
+            auto median_split = [this](int32_t base, int32_t num_elems) {
+                AABB center_bounds = AABB::invalid();
+                for (int32_t i = 0; i < num_elems; i++) {
+                    center_bounds.expand(
+                        leaf_aabbs_[sorted_leaves_[base + i]].centroid());
+                }
 
-                    while (start < end) {
-                        while (start < end &&
-                               get_component(get_center(start)) < split_val) {
-                            ++start;
+                Vector3 extent = center_bounds.pMax - center_bounds.pMin;
+                int32_t axis = 0;
+                if (extent.y > extent[axis]) {
+                    axis = 1;
+                }
+                if (extent.z > extent[axis]) {
+                    axis = 2;
+                }
+
+                auto key = [this, base, axis](int32_t offset) {
+                    return leaf_aabbs_[sorted_leaves_[base + offset]]
+                        .centroid()[axis];
+                };
+
+                // Quickselect, so the range is partitioned around mid
+                int32_t mid = num_elems / 2;
+                int32_t lo = 0;
+                int32_t hi = num_elems - 1;
+                while (lo < hi) {
+                    float pivot = key((lo + hi) / 2);
+
+                    int32_t i = lo;
+                    int32_t j = hi;
+                    while (i <= j) {
+                        while (key(i) < pivot) {
+                            ++i;
                         }
 
-                        while (start < end && get_component(
-                                get_center(end - 1)) >= split_val) {
-                            --end;
+                        while (key(j) > pivot) {
+                            --j;
                         }
 
-                        if (start < end) {
-                            std::swap(sorted_leaves_[base + start],
-                                      sorted_leaves_[base + end - 1]);
-                            ++start;
-                            --end;
+                        if (i <= j) {
+                            std::swap(sorted_leaves_[base + i],
+                                      sorted_leaves_[base + j]);
+                            ++i;
+                            --j;
                         }
                     }
 
-                    if (start > 0 && start < num_elems) {
-                        return start;
+                    if (mid <= j) {
+                        hi = j;
+                    } else if (mid >= i) {
+                        lo = i;
                     } else {
-                        return num_elems / 2;
+                        break;
                     }
-                };
+                }
+
+                return mid;
+            };
 
-                Vector3 center_diff = center_max - center_min;
-                if (center_diff.x > center_diff.y &&
-                    center_diff.x > center_diff.z) {
-                    return split([](Vector3 v) {
-                        return v.x;
-                    });
-                } else if (center_diff.y > center_diff.x &&
-                           center_diff.y > center_diff.z) {
-                    return split([](Vector3 v) {
-                        return v.y;
-                    });
+            auto split = [&](int32_t base, int32_t num_elems) {
+                if (entry.depth < maxSAHDepth_) {
+                    return sah_split(base, num_elems);
                 } else {
-                    return split([](Vector3 v) {
-                        return v.z;
-                    });
+                    return median_split(base, num_elems);
                 }
             };
 
-            int32_t second_split = midpoint_split(entry.offset, entry.numObjs);
+            int32_t second_split = split(entry.offset, entry.numObjs);
             int32_t num_h1 = second_split;
             int32_t num_h2 = entry.numObjs - second_split;
 
-            int32_t first_split = midpoint_split(entry.offset, num_h1);
-            int32_t third_split =
-                midpoint_split(entry.offset + second_split, num_h2);
+            int32_t first_split = split(entry.offset, num_h1);
+            int32_t third_split = split(entry.offset + second_split, num_h2);
+
+            // Only reachable if the median splits stop shrinking ranges
+            if (entry.depth >= maxTreeDepth_ ||
+                    stack_size + 4 > max_stack_size) {
+                FATAL("BVH::rebuild: tree exceeded the maximum depth of %d",
+                      (int)maxTreeDepth_);
+            }
 
             // Setup stack to recurse into fourths. Put fourths on stack in
             // reverse order to preserve left-right depth first ordering
+            int32_t child_depth = entry.depth + 1;
 
             stack[stack_size++] = {
                 -1,
                 entry.nodeID,
                 entry.offset + num_h1 + third_split,
                 num_h2 - third_split,
+                child_depth,
             };
 
             stack[stack_size++] = {
@@ -216,6 +370,7 @@ void BVH::rebuild()
                 entry.nodeID,
                 entry.offset + num_h1,
                 third_split,
+                child_depth,
             };
 
             stack[stack_size++] = {
@@ -223,6 +378,7 @@ void BVH::rebuild()
                 entry.nodeID,
                 entry.offset + first_split,
                 num_h1 - first_split,
+                child_depth,
             };
 
             stack[stack_size++] = {
@@ -230,6 +386,7 @@ void BVH::rebuild()
                 entry.nodeID,
                 entry.offset,
                 first_split,
+                child_depth,
             };
 
             // Don't finish processing this node until children are processed
@@ -284,6 +441,10 @@ void BVH::rebuild()
         parent.maxZ[child_offset] = combined_aabb.pMax.z;
     }
 
+    assert(cur_node_offset <= num_internal_nodes);
+    num_nodes_ = cur_node_offset;
+    built_sah_cost_ = sahCost();
+
 #if 0
     {
         // validate tree bottom up
@@ -437,6 +598,55 @@ void BVH::rebuild()
 #endif
 }
 
+float BVH::sahCost() const
+{
+    // Every child box costs its surface area relative to the root: the
+    // probability a query reaching the root also enters the child.
+    // Internal and leaf children are weighted equally, the cost is only
+    // compared against the cost of the same leaves after a rebuild.
+    AABB root_aabb = AABB::invalid();
+    float total_area = 0.f;
+    for (CountT node_idx = 0; node_idx < num_nodes_; node_idx++) {
+        const Node &node = nodes_[node_idx];
+        for (CountT i = 0; i < 4; i++) {
+            if (!node.hasChild(i)) {
+                continue;
+            }
+
+            AABB child_aabb {
+                /* .pMin = */ {
+                    node.minX[i],
+                    node.minY[i],
+                    node.minZ[i],
+                },
+                /* .pMax = */ {
+                    node.maxX[i],
+                    node.maxY[i],
+                    node.maxZ[i],
+                },
+            };
+
+            // The top down build can leave internal nodes with no
+            // leaves under them, these are never entered
+            if (child_aabb.pMin.x > child_aabb.pMax.x) {
+                continue;
+            }
+
+            total_area += child_aabb.surfaceArea();
+
+            if (node_idx == 0) {
+                root_aabb = AABB::merge(root_aabb, child_aabb);
+            }
+        }
+    }
+
+    if (num_nodes_ == 0 || !(root_aabb.surfaceArea() > 0.f)) {
+        return 0.f;
+    }
+
+    return 1.f + total_area / root_aabb.surfaceArea();
+}
+
 static inline AABB expandAABBWithMotion(
     AABB aabb,
     const Vector3 &linear_velocity,
@@ -481,9 +691,59 @@ void BVH::updateLeafPosition(LeafID leaf_id,
         rot,
         scale,
     };
-    sorted_leaves_[leaf_id.id] = leaf_id.id;
 }
 
+#ifndef MADRONA_GPU_MODE
+void BVH::updateLeafPositions(const LeafID *leaf_ids,
+                              const Vector3N &pos,
+                              const QuatN &rot,
+                              const Vector3N &scale,
+                              const Vector3N &linear_vel,
+                              const AABBN &obj_aabbs,
+                              uint32_t update_lanes)
+{
+    AABBN world_aabbs = obj_aabbs.applyTRS(pos, rot, scale);
+
+    // expandAABBWithMotion, the branches become a clamp to 0
+    Vector3N pos_delta = leaf_velocity_expansion_ * linear_vel;
+    FloatN accel_expansion = FloatN::splat(leaf_accel_expansion_);
+    Vector3N accel_delta {
+        accel_expansion,
+        accel_expansion,
+        accel_expansion,
+    };
+
+    world_aabbs.pMin +=
+        min(pos_delta - accel_delta, Vector3N::zero());
+    world_aabbs.pMax +=
+        max(pos_delta + accel_delta, Vector3N::zero());
+
+    AABB expanded_aabbs[FloatN::width];
+    Vector3 positions[FloatN::width];
+    Quat rotations[FloatN::width];
+    Vector3 scales[FloatN::width];
+
+    world_aabbs.storeAoS(expanded_aabbs);
+    pos.storeAoS(positions);
+    rot.storeAoS(rotations);
+    scale.storeAoS(scales);
+
+    for (CountT i = 0; i < FloatN::width; i++) {
+        if ((update_lanes & (1_u32 << i)) == 0) {
+            continue;
+        }
+
+        int32_t leaf_idx = leaf_ids[i].id;
+        leaf_aabbs_[leaf_idx] = expanded_aabbs[i];
+        leaf_transforms_[leaf_idx] = {
+            positions[i],
+            rotations[i],
+            Diag3x3::fromVec(scales[i]),
+        };
+    }
+}
+#endif
+
 AABB BVH::expandLeaf(LeafID leaf_id,
                      const math::Vector3 &linear_vel)
 {
@@ -651,8 +911,15 @@ void BVH::updateTree()
     if (force_rebuild_) {
         force_rebuild_ = false;
         rebuild();
+        return;
+    }
+
+    // refitLeaf only ever grows node bounds, so the tree degrades as
+    // leaves move away from where they were when it was built. Rebuild
+    // once the refit tree is sufficiently worse than a fresh build.
+    if (sahCost() > built_sah_cost_ * rebuild_cost_ratio_) {
+        rebuild();
     }
-    //rebuild();
 }
 
 Entity BVH::traceRay(Vector3 o,
@@ -665,53 +932,58 @@ Entity BVH::traceRay(Vector3 o,
 
     Diag3x3 inv_d = Diag3x3::fromVec(d).inv();
 
-    int32_t stack[32];
+    int32_t stack[traversalStackSize_];
     stack[0] = 0;
     CountT stack_size = 1;
 
     Entity closest_hit_entity = Entity::none();
     Vector3 closest_hit_normal;
 
+    // Children are tested against t_max as of the node test. Later hits
+    // can only shrink t_max, so at worst this visits a few extra children;
+    // leaves are still traced against the current t_max.
+    auto visitChild = [&](const Node &node, int32_t i) {
+        if (node.isLeaf(i)) {
+            int32_t leaf_idx = node.leafIDX(i);
+
+            float hit_t;
+            Vector3 leaf_hit_normal;
+            bool leaf_hit = traceRayIntoLeaf(
+                leaf_idx, o, d, 0.f, t_max, &hit_t, &leaf_hit_normal);
+
+            if (leaf_hit) {
+                t_max = hit_t;
+                closest_hit_entity = leaf_entities_[leaf_idx];
+                closest_hit_normal = leaf_hit_normal;
+            }
+        } else {
+            if (stack_size == traversalStackSize_) [[unlikely]] {
+                FATAL("BVH::traceRay: traversal stack overflow");
+            }
+            stack[stack_size++] = node.children[i];
+        }
+    };
+
     while (stack_size > 0) { 
-        int32_t node_idx = stack[--stack_size];
-        const Node &node = nodes_[node_idx];
-        for (int i = 0; i < 4; i++) {
-            if (!node.hasChild(i)) {
-                continue; // Technically this could be break?
-            };
+#ifdef MADRONA_BVH_AVX2
+        if (stack_size >= 2 && stack_size + 6 <= traversalStackSize_) {
+            const Node &a = nodes_[stack[--stack_size]];
+            const Node &b = nodes_[stack[--stack_size]];
 
-            madrona::math::AABB child_aabb {
-                /* .pMin = */ {
-                    node.minX[i],
-                    node.minY[i],
-                    node.minZ[i],
-                },
-                /* .pMax = */ {
-                    node.maxX[i],
-                    node.maxY[i],
-                    node.maxZ[i],
-                },
-            };
+            uint32_t mask = Node::rayIntersectMask2(a, b, o, inv_d,
+                                                    0.f, t_max);
+            forEachChild(a, mask & 0xF, visitChild);
+            forEachChild(b, mask >> 4, visitChild);
 
-            if (child_aabb.rayIntersects(o, inv_d, 0.f, t_max)) {
-                if (node.isLeaf(i)) {
-                    int32_t leaf_idx = node.leafIDX(i);
-                    
-                    float hit_t;
-                    Vector3 leaf_hit_normal;
-                    bool leaf_hit = traceRayIntoLeaf(
-                        leaf_idx, o, d, 0.f, t_max, &hit_t, &leaf_hit_normal);
-
-                    if (leaf_hit) {
-                        t_max = hit_t;
-                        closest_hit_entity = leaf_entities_[leaf_idx];
-                        closest_hit_normal = leaf_hit_normal;
-                    }
-                } else {
-                    stack[stack_size++] = node.children[i];
-                }
-            }
+            continue;
         }
+#endif
+
+        int32_t node_idx = stack[--stack_size];
+        const Node &node = nodes_[node_idx];
+
+        forEachChild(node, node.rayIntersectMask(o, inv_d, 0.f, t_max),
+                     visitChild);
     }
     
     if (closest_hit_entity == Entity::none()) {
@@ -871,6 +1143,20 @@ bool BVH::traceRayIntoLeaf(int32_t leaf_idx,
         case CollisionPrimitive::Type::Sphere: {
             assert(false);
         } break;
+        case CollisionPrimitive::Type::TriangleMesh: {
+            int32_t bvh_stack[MeshBVH::maxTraversalStackSize];
+            int32_t bvh_stack_size = 0;
+
+            MeshBVH::HitInfo bvh_hit;
+            hit_prim = prim->triMesh.bvh.traceRay(obj_ray_o, obj_ray_d,
+                &bvh_hit, bvh_stack, bvh_stack_size, t_max) &&
+                bvh_hit.tHit >= t_min;
+
+            if (hit_prim) {
+                *hit_t = bvh_hit.tHit;
+                obj_hit_normal = bvh_hit.normal.normalize();
+            }
+        } break;
         default: MADRONA_UNREACHABLE();
         }
 
@@ -889,6 +1175,11 @@ bool BVH::traceRayIntoLeaf(int32_t leaf_idx,
     }
 }
 
+// Sleeping bodies that haven't moved since their leaf was last updated are
+// skipped. Before the step, the only way a sleeping body can have moved is
+// by being placed directly, so it is woken up. After the step, the body
+// may have fallen asleep during the step and just needs its leaf updated.
+template <bool wake_moved>
 inline void updateLeafPositionsEntry(
     Context &ctx,
     const LeafID &leaf_id,
@@ -896,15 +1187,91 @@ inline void updateLeafPositionsEntry(
     const Rotation &rot,
     const Scale &scale,
     const ObjectID &obj_id,
-    const Velocity &vel)
+    const Velocity &vel,
+    SleepState &sleep_state)
 {
     BVH &bvh = ctx.singleton<BVH>();
+
+    if (sleep_state.asleep) {
+        if (bvh.leafTransformMatches(leaf_id, pos, rot, scale)) {
+            return;
+        }
+
+        if constexpr (wake_moved) {
+            sleep_state.restTime = 0.f;
+            sleep_state.asleep = false;
+        }
+    }
+
     ObjectManager &obj_mgr = *ctx.singleton<ObjectData>().mgr;
     AABB obj_aabb = obj_mgr.rigidBodyAABBs[obj_id.idx];
 
     bvh.updateLeafPosition(leaf_id, pos, rot, scale, vel.linear, obj_aabb);
 }
 
+#ifndef MADRONA_GPU_MODE
+// CPU version of updateLeafPositionsEntry. The sleep checks and object
+// AABB lookups are per row, the leaf AABB transforms are done
+// FloatN::width rows at a time by BVH::updateLeafPositions.
+template <bool wake_moved>
+inline void updateLeafPositionsChunk(
+    Context &ctx,
+    CountT num_rows,
+    const LeafID *leaf_ids,
+    const Position *positions,
+    const Rotation *rotations,
+    const Scale *scales,
+    const ObjectID *obj_ids,
+    const Velocity *velocities,
+    SleepState *sleep_states)
+{
+    BVH &bvh = ctx.singleton<BVH>();
+    ObjectManager &obj_mgr = *ctx.singleton<ObjectData>().mgr;
+
+    for (CountT base = 0; base < num_rows; base += FloatN::width) {
+        CountT num_lanes = std::min(FloatN::width, num_rows - base);
+
+        // Lanes past num_lanes keep an empty AABB, their results are
+        // never written
+        AABB obj_aabbs[FloatN::width] = {};
+        uint32_t update_lanes = 0;
+
+        for (CountT lane = 0; lane < num_lanes; lane++) {
+            CountT row = base + lane;
+            SleepState &sleep_state = sleep_states[row];
+
+            if (sleep_state.asleep) {
+                if (bvh.leafTransformMatches(leaf_ids[row], positions[row],
+                        rotations[row], scales[row])) {
+                    continue;
+                }
+
+                if constexpr (wake_moved) {
+                    sleep_state.restTime = 0.f;
+                    sleep_state.asleep = false;
+                }
+            }
+
+            obj_aabbs[lane] = obj_mgr.rigidBodyAABBs[obj_ids[row].idx];
+            update_lanes |= 1_u32 << lane;
+        }
+
+        if (update_lanes == 0) {
+            continue;
+        }
+
+        bvh.updateLeafPositions(leaf_ids + base,
+            Vector3N::loadAoS(positions + base, num_lanes),
+            QuatN::loadAoS(rotations + base, num_lanes),
+            Vector3N::loadAoS(scales + base, num_lanes),
+            Vector3N::loadStrided(&velocities[base].linear,
+                                  sizeof(Velocity), num_lanes),
+            AABBN::loadAoS(obj_aabbs),
+            update_lanes);
+    }
+}
+#endif
+
 // FIXME currently unused
 inline void expandLeavesEntry(
     Context &ctx,
@@ -942,6 +1309,10 @@ inline void findIntersectingEntry(
         ctx.getDirect<ResponseType>(RGDCols::ResponseType, a_loc) ==
         ResponseType::Static;
 
+    bool a_is_inactive = sleep::isInactive(
+        ctx.getDirect<ResponseType>(RGDCols::ResponseType, a_loc),
+        ctx.getDirect<SleepState>(RGDCols::SleepState, a_loc));
+
     ObjectID a_obj = ctx.getDirect<ObjectID>(RGDCols::ObjectID, a_loc);
 
     CountT a_num_prims = obj_mgr.rigidBodyPrimitiveCounts[a_obj.idx];
@@ -958,6 +1329,14 @@ inline void findIntersectingEntry(
                 return;
             }
 
+            // Sleeping bodies resting on each other or on static geometry
+            // skip the narrowphase entirely
+            if (a_is_inactive && sleep::isInactive(
+                    ctx.getDirect<ResponseType>(RGDCols::ResponseType, b_loc),
+                    ctx.getDirect<SleepState>(RGDCols::SleepState, b_loc))) {
+                return;
+            }
+
             // We don't expand the primitive AABBs by movement (only object
             // AABBs) so we just unconditionally emit narrowphase checks
             // between each pair of primitives in the entity. Narrowphase
@@ -987,6 +1366,9 @@ inline void findIntersectingEntry(
                 candidate.b = b_loc;
                 candidate.aPrim = a_prim_idx;
                 candidate.bPrim = b_prim_idx;
+
+                ctx.getDirect<CachedManifold>(
+                    RGDCols::CachedManifold, candidate_loc).numPoints = 0;
             }
         }
     });
@@ -996,14 +1378,29 @@ TaskGraphNodeID setupBVHTasks(
     TaskGraphBuilder &builder,
     Span<const TaskGraphNodeID> deps)
 {
+#ifdef MADRONA_GPU_MODE
     auto update_leaves =
-        builder.addToGraph<ParallelForNode<Context, updateLeafPositionsEntry,
+        builder.addToGraph<ParallelForNode<Context,
+            updateLeafPositionsEntry<true>,
             LeafID, 
             Position,
             Rotation,
             Scale,
             ObjectID,
-            Velocity>>(deps);
+            Velocity,
+            SleepState>>(deps);
+#else
+    auto update_leaves =
+        builder.addToGraph<ParallelForChunkNode<Context,
+            updateLeafPositionsChunk<true>,
+            LeafID,
+            Position,
+            Rotation,
+            Scale,
+            ObjectID,
+            Velocity,
+            SleepState>>(deps);
+#endif
 
     auto bvh_update = builder.addToGraph<ParallelForNode<Context,
         broadphase::updateBVHEntry, broadphase::BVH>>({update_leaves});
@@ -1036,14 +1433,29 @@ TaskGraphNodeID setupPostIntegrationTasks(
 #endif
 
     // FIXME: can we avoid doing a full tree refit here?
+#ifdef MADRONA_GPU_MODE
     auto update_leaves =
-        builder.addToGraph<ParallelForNode<Context, updateLeafPositionsEntry,
+        builder.addToGraph<ParallelForNode<Context,
+            updateLeafPositionsEntry<false>,
             LeafID, 
             Position,
             Rotation,
             Scale,
             ObjectID,
-            Velocity>>(deps);
+            Velocity,
+            SleepState>>(deps);
+#else
+    auto update_leaves =
+        builder.addToGraph<ParallelForChunkNode<Context,
+            updateLeafPositionsChunk<false>,
+            LeafID,
+            Position,
+            Rotation,
+            Scale,
+            ObjectID,
+            Velocity,
+            SleepState>>(deps);
+#endif
 
     auto refit = builder.addToGraph<ParallelForNode<Context,
         broadphase::refitEntry, broadphase::LeafID>>({update_leaves});
@@ -100,6 +100,10 @@ enum class NarrowphaseTest : uint32_t {
     PlanePlane = 4,
     SpherePlane = 5,
     HullPlane = 6,
+    TriangleMeshTriangleMesh = 8,
+    SphereTriangleMesh = 9,
+    HullTriangleMesh = 10,
+    PlaneTriangleMesh = 12,
 };
 
 struct FaceQuery {
@@ -698,11 +702,21 @@ static inline SATResult doSAT(MADRONA_GPU_COND(int32_t mwgpu_lane_id,)
 
     PROF_START(sat_finish_ctr, narrowphaseSATFinishClocks);
 
-    bool bIsFaceContactA = faceQueryA.separation > edgeQuery.separation;
-    bool bIsFaceContactB = faceQueryB.separation > edgeQuery.separation;
+    // Prefer face contacts unless an edge pair is clearly the axis of
+    // least penetration (Box2D's relative + absolute tolerance, with the
+    // face separation as the reference). For resting face to face contact
+    // the edge separation ties the face separation up to FP error, and a
+    // single point edge contact there makes stacks unstable.
+    constexpr float face_rel_tolerance = 0.95f;
+    constexpr float face_abs_tolerance = 0.005f;
+    bool a_is_ref = faceQueryA.separation >= faceQueryB.separation;
+    float face_separation =
+        a_is_ref ? faceQueryA.separation : faceQueryB.separation;
 
-    if (bIsFaceContactA || bIsFaceContactB) {
-        bool a_is_ref = faceQueryA.separation >= faceQueryB.separation;
+    bool is_edge_contact = edgeQuery.separation >
+        face_rel_tolerance * face_separation + face_abs_tolerance;
+
+    if (!is_edge_contact) {
 
         Plane ref_plane = a_is_ref ? faceQueryA.plane : faceQueryB.plane;
         CountT ref_face_idx =
@@ -768,6 +782,231 @@ SATResult doSATPlane(MADRONA_GPU_COND(const int32_t mwgpu_lane_id,)
     return result;
 }
 
+// Scratch storage for one triangle of a TriangleMesh primitive as a double
+// sided HullState, so the hull code paths can clip against it. Face 0 is
+// the front face and edge e is half edges 2e (front) and 2e + 1 (back).
+struct TriangleHull {
+    HalfEdge halfEdges[6];
+    uint32_t faceBaseHalfEdges[2];
+    Plane facePlanes[2];
+    Vector3 vertices[3];
+};
+
+static inline HullState makeTriangleHullState(TriangleHull &tri_hull,
+                                              Vector3 a, Vector3 b, Vector3 c,
+                                              Vector3 normal)
+{
+    tri_hull.halfEdges[0] = { 2, 0, 0 };
+    tri_hull.halfEdges[1] = { 5, 1, 1 };
+    tri_hull.halfEdges[2] = { 4, 1, 0 };
+    tri_hull.halfEdges[3] = { 1, 2, 1 };
+    tri_hull.halfEdges[4] = { 0, 2, 0 };
+    tri_hull.halfEdges[5] = { 3, 0, 1 };
+
+    tri_hull.faceBaseHalfEdges[0] = 0;
+    tri_hull.faceBaseHalfEdges[1] = 5;
+
+    float d = dot(normal, a);
+    tri_hull.facePlanes[0] = { normal, d };
+    tri_hull.facePlanes[1] = { -normal, -d };
+
+    tri_hull.vertices[0] = a;
+    tri_hull.vertices[1] = b;
+    tri_hull.vertices[2] = c;
+
+    HalfEdgeMesh mesh {
+        .halfEdges = tri_hull.halfEdges,
+        .faceBaseHalfEdges = tri_hull.faceBaseHalfEdges,
+        .facePlanes = tri_hull.facePlanes,
+        .vertices = tri_hull.vertices,
+        .numHalfEdges = 6,
+        .numFaces = 2,
+        .numVertices = 3,
+    };
+
+    return HullState {
+        mesh,
+        (a + b + c) / 3.f,
+    };
+}
+
+// The Gauss map arc of a triangle edge runs from the front normal through
+// the edge's outward normal to the back normal. It's tested as two arcs,
+// since isMinkowskiFace can't handle the antiparallel face normals.
+static EdgeQuery queryTriangleEdgeDirections(const HullState &hull,
+                                             const HullState &tri)
+{
+    Vector3 tri_normal = tri.mesh.facePlanes[0].normal;
+
+    EdgeQuery query;
+    query.separation = -FLT_MAX;
+    query.normal = Vector3::zero();
+    query.edgeIdxA = 0;
+    query.edgeIdxB = 0;
+
+    const CountT hull_num_edges = hull.mesh.numEdges();
+    for (CountT tri_edge_idx = 0; tri_edge_idx < 3; tri_edge_idx++) {
+        int32_t he_idx_tri = tri.mesh.edgeToHalfEdge(tri_edge_idx);
+        HalfEdge hedge_tri = tri.mesh.halfEdges[he_idx_tri];
+
+        Segment tri_seg = getEdgeSegment(
+            tri.mesh.vertices, tri.mesh.halfEdges, hedge_tri);
+        Vector3 edge_out =
+            cross(tri_seg.p2 - tri_seg.p1, tri_normal).normalize();
+
+        for (CountT edge_idx = 0; edge_idx < hull_num_edges; edge_idx++) {
+            int32_t he_idx_hull = hull.mesh.edgeToHalfEdge(edge_idx);
+            HalfEdge hedge_hull = hull.mesh.halfEdges[he_idx_hull];
+            HalfEdge twin_hull =
+                hull.mesh.halfEdges[hull.mesh.twinIDX(he_idx_hull)];
+
+            auto [hull_normal1, hull_normal2] =
+                getEdgeNormals(hull.mesh, hedge_hull, twin_hull);
+
+            if (!isMinkowskiFace(hull_normal1, hull_normal2,
+                                 -tri_normal, -edge_out) &&
+                    !isMinkowskiFace(hull_normal1, hull_normal2,
+                                     -edge_out, tri_normal)) {
+                continue;
+            }
+
+            EdgeTestResult edge_cmp =
+                edgeDistance(hull, tri, hedge_hull, hedge_tri);
+
+            if (edge_cmp.separation > query.separation) {
+                query.separation = edge_cmp.separation;
+                query.normal = edge_cmp.normal;
+                query.edgeIdxA = he_idx_hull;
+                query.edgeIdxB = he_idx_tri;
+
+                if (query.separation > 0) {
+                    return query;
+                }
+            }
+        }
+    }
+
+    return query;
+}
+
+// SAT between hull a and a triangle b built by makeTriangleHullState.
+// Triangles are one-sided: hulls centered behind the triangle are ignored
+// and the triangle is only ever a reference face through its front face.
+static inline SATResult doSATTriangle(const HullState &hull,
+                                      const HullState &tri)
+{
+    Plane tri_plane = tri.mesh.facePlanes[0];
+
+    if (getDistanceFromPlane(tri_plane, hull.center) < 0.f) {
+        SATResult result;
+        result.type = ContactType::None;
+        return result;
+    }
+
+    float tri_separation = getHullDistanceFromPlane(tri_plane, hull);
+    if (tri_separation > 0.f) {
+        SATResult result;
+        result.type = ContactType::None;
+        return result;
+    }
+
+    FaceQuery hull_face_query = queryFaceDirections(hull, tri);
+    if (hull_face_query.separation > 0.f) {
+        SATResult result;
+        result.type = ContactType::None;
+        return result;
+    }
+
+    EdgeQuery edge_query = queryTriangleEdgeDirections(hull, tri);
+    if (edge_query.separation > 0.f) {
+        SATResult result;
+        result.type = ContactType::None;
+        return result;
+    }
+
+    // Same face preference as doSAT. Ties between the two faces go to the
+    // triangle with the same tolerance, so resting contacts use the
+    // surface normal.
+    constexpr float face_rel_tolerance = 0.95f;
+    constexpr float face_abs_tolerance = 0.005f;
+    bool hull_is_ref = hull_face_query.separation >
+        face_rel_tolerance * tri_separation + face_abs_tolerance;
+    float face_separation =
+        hull_is_ref ? hull_face_query.separation : tri_separation;
+
+    bool is_edge_contact = edge_query.separation >
+        face_rel_tolerance * face_separation + face_abs_tolerance;
+
+    if (is_edge_contact) {
+        SATResult result;
+        result.type = ContactType::SATEdge;
+        result.contact.normal = edge_query.normal;
+        result.contact.planeDOrSeparation = edge_query.separation;
+        result.contact.refFaceIdxOrEdgeIdxA = edge_query.edgeIdxA;
+        result.contact.incidentFaceIdxOrEdgeIdxB = edge_query.edgeIdxB;
+        return result;
+    }
+
+    SATResult result;
+    result.type = ContactType::SATFace;
+
+    if (hull_is_ref) {
+        result.contact.normal = hull_face_query.plane.normal;
+        result.contact.planeDOrSeparation = hull_face_query.plane.d;
+        result.contact.refFaceIdxOrEdgeIdxA =
+            uint32_t(hull_face_query.faceIdx);
+        result.contact.incidentFaceIdxOrEdgeIdxB = uint32_t(
+            findIncidentFace(tri, hull_face_query.plane.normal));
+    } else {
+        result.contact.normal = tri_plane.normal;
+        result.contact.planeDOrSeparation = tri_plane.d;
+        result.contact.refFaceIdxOrEdgeIdxA = 0 | (1_u32 << 31_u32);
+        result.contact.incidentFaceIdxOrEdgeIdxB =
+            uint32_t(findIncidentFace(hull, tri_plane.normal));
+    }
+
+    return result;
+}
+
+// Sphere at sphere_pos against the front side of triangle abc. The contact
+// point is on the triangle and the normal points towards the sphere.
+static inline bool sphereTriangleContact(Vector3 sphere_pos,
+                                         float sphere_radius,
+                                         Vector3 a, Vector3 b, Vector3 c,
+                                         Vector3 tri_normal,
+                                         SphereContact *out_contact)
+{
+    if (dot(sphere_pos - a, tri_normal) < 0.f) {
+        return false;
+    }
+
+    Vector3 to_closest = triangleClosestPointToOrigin(
+        a - sphere_pos, b - sphere_pos, c - sphere_pos, b - a, c - a);
+
+    float dist2 = to_closest.length2();
+    if (dist2 > sphere_radius * sphere_radius) {
+        return false;
+    }
+
+    Vector3 normal;
+    float dist;
+    if (dist2 == 0.f) {
+        normal = tri_normal;
+        dist = 0.f;
+    } else {
+        dist = sqrtf(dist2);
+        normal = -to_closest / dist;
+    }
+
+    *out_contact = SphereContact {
+        .normal = normal,
+        .pt = sphere_pos + to_closest,
+        .depth = sphere_radius - dist,
+    };
+
+    return true;
+}
+
 static Manifold buildFaceContactManifold(
     Vector3 contact_normal,
     Vector3 *contacts,
@@ -1165,30 +1404,141 @@ static inline void addManifoldContacts(
     };
 }
 
-static inline void addSinglePointContact(
+// Tolerances on the change in a candidate's relative pose since its
+// manifold was cached, past which the narrowphase is run again. The
+// distance is a fraction of the pair's size (see minPrimitiveExtent), so
+// it means the same for tiny and huge bodies.
+inline constexpr float manifoldReuseMaxRelDistance = 0.005f;
+// Cosine of half of ~1 degree
+inline constexpr float manifoldReuseMinHalfCos = 0.99996f;
+
+// Smallest side of a primitive's scaled object space AABB. Infinite for
+// planes.
+static inline float minPrimitiveExtent(const AABB &obj_aabb,
+                                       Diag3x3 scale)
+{
+    Vector3 extent = obj_aabb.pMax - obj_aabb.pMin;
+    return fminf(fminf(fabsf(scale.d0) * extent.x,
+                       fabsf(scale.d1) * extent.y),
+                 fabsf(scale.d2) * extent.z);
+}
+
+static inline void saveContacts(
     Context &ctx,
-    Vector3 point,
-    Vector3 normal,
-    float depth,
-    Loc ref_loc,
-    Loc other_loc)
+    CachedManifold &cached_manifold,
+    const Manifold &manifold,
+    bool a_is_ref,
+    Loc a_loc, Loc b_loc,
+    Vector3 a_pos, Vector3 b_pos,
+    Quat a_rot, Quat b_rot)
 {
-    const auto &physics_sys = ctx.singleton<PhysicsSystemState>();
+    if (manifold.numContactPoints == 0) {
+        cached_manifold.numPoints = 0;
+        return;
+    }
 
-    Loc c = ctx.makeTemporary(physics_sys.contactArchetypeID);
+    if (a_is_ref) {
+        addManifoldContacts(ctx, manifold, a_loc, b_loc);
+    } else {
+        addManifoldContacts(ctx, manifold, b_loc, a_loc);
+    }
 
-    ctx.getDirect<ContactConstraint>(RGDCols::ContactConstraint, c) = {
-        ref_loc,
-        other_loc,
-        {
-            Vector4::fromVec3W(point, depth),
-            Vector4::zero(),
-            Vector4::zero(),
-            Vector4::zero(),
-        },
-        1,
-        normal,
-    };
+    Quat to_a = a_rot.inv();
+    cached_manifold.relPos = to_a.rotateVec(b_pos - a_pos);
+    cached_manifold.relRot = to_a * b_rot;
+
+    Vector3 ref_pos = a_is_ref ? a_pos : b_pos;
+    Vector3 other_pos = a_is_ref ? b_pos : a_pos;
+    Quat to_ref = a_is_ref ? to_a : b_rot.inv();
+    Quat to_other = a_is_ref ? b_rot.inv() : to_a;
+
+    // The solver treats the point on the other body as lying
+    // penetrationDepth behind the reference point along the normal
+    cached_manifold.localNormal = to_ref.rotateVec(manifold.normal);
+    for (CountT i = 0; i < manifold.numContactPoints; i++) {
+        Vector3 ref_pt = manifold.contactPoints[i];
+        Vector3 other_pt =
+            ref_pt - manifold.normal * manifold.penetrationDepths[i];
+
+        cached_manifold.refPoints[i] = to_ref.rotateVec(ref_pt - ref_pos);
+        cached_manifold.otherPoints[i] =
+            to_other.rotateVec(other_pt - other_pos);
+    }
+    cached_manifold.numPoints = manifold.numContactPoints;
+    cached_manifold.aIsRef = a_is_ref;
+}
+
+// Re-projects the cached manifold onto the bodies' current poses if they
+// have barely moved relative to each other since it was generated. Points
+// that have separated are dropped. pair_size is the smaller of the two
+// primitives' minPrimitiveExtent. Returns false if the narrowphase needs
+// to be run.
+static inline bool reuseCachedManifold(
+    Context &ctx,
+    const CachedManifold &cached_manifold,
+    Loc a_loc, Loc b_loc,
+    Vector3 a_pos, Vector3 b_pos,
+    Quat a_rot, Quat b_rot,
+    float pair_size)
+{
+    if (cached_manifold.numPoints == 0) {
+        return false;
+    }
+
+    Quat to_a = a_rot.inv();
+    Vector3 rel_pos = to_a.rotateVec(b_pos - a_pos);
+    Quat rel_rot = to_a * b_rot;
+    Quat cached_rot = cached_manifold.relRot;
+
+    float half_cos = fabsf(rel_rot.w * cached_rot.w +
+        rel_rot.x * cached_rot.x + rel_rot.y * cached_rot.y +
+        rel_rot.z * cached_rot.z);
+
+    float max_distance = manifoldReuseMaxRelDistance * pair_size;
+    if (half_cos < manifoldReuseMinHalfCos ||
+            (rel_pos - cached_manifold.relPos).length2() >
+                max_distance * max_distance) {
+        return false;
+    }
+
+    bool a_is_ref = cached_manifold.aIsRef;
+    Vector3 ref_pos = a_is_ref ? a_pos : b_pos;
+    Vector3 other_pos = a_is_ref ? b_pos : a_pos;
+    Quat ref_rot = a_is_ref ? a_rot : b_rot;
+    Quat other_rot = a_is_ref ? b_rot : a_rot;
+
+    Manifold manifold;
+    manifold.normal = ref_rot.rotateVec(cached_manifold.localNormal);
+    manifold.numContactPoints = 0;
+
+    for (CountT i = 0; i < cached_manifold.numPoints; i++) {
+        Vector3 ref_pt =
+            ref_rot.rotateVec(cached_manifold.refPoints[i]) + ref_pos;
+        Vector3 other_pt =
+            other_rot.rotateVec(cached_manifold.otherPoints[i]) + other_pos;
+
+        float depth = dot(ref_pt - other_pt, manifold.normal);
+        if (depth <= 0.f) {
+            continue;
+        }
+
+        int32_t out_idx = manifold.numContactPoints++;
+        manifold.contactPoints[out_idx] = ref_pt;
+        manifold.penetrationDepths[out_idx] = depth;
+    }
+
+    for (CountT i = manifold.numContactPoints; i < 4; i++) {
+        manifold.contactPoints[i] = Vector3::zero();
+        manifold.penetrationDepths[i] = 0.f;
+    }
+
+    if (manifold.numContactPoints > 0) {
+        addManifoldContacts(ctx, manifold,
+                            a_is_ref ? a_loc : b_loc,
+                            a_is_ref ? b_loc : a_loc);
+    }
+
+    return true;
 }
 
 #ifdef MADRONA_GPU_MODE
@@ -1513,30 +1863,44 @@ MADRONA_ALWAYS_INLINE static inline NarrowphaseResult narrowphaseDispatch(
     }
 }
 
-MADRONA_ALWAYS_INLINE static inline void generateContacts(
-    Context &ctx,
+// Builds the manifold for a narrowphase result, the manifold is empty if
+// the primitives aren't touching. *a_is_ref is set to whether a is the
+// reference body of the manifold.
+MADRONA_ALWAYS_INLINE static inline Manifold generateContacts(
     NarrowphaseResult narrowphase_result,
-    Loc a_loc, Loc b_loc,
 #ifdef MADRONA_GPU_MODE
     Vector3 a_pos, Quat a_rot, Diag3x3 a_scale,
     Vector3 b_pos, Quat b_rot, Diag3x3 b_scale,
 #endif
-    void *thread_tmp_storage_a, void *thread_tmp_storage_b)
+    void *thread_tmp_storage_a, void *thread_tmp_storage_b,
+    bool *a_is_ref)
 {
     switch (narrowphase_result.type) {
     case ContactType::None: {
-        return;
+        Manifold manifold;
+        manifold.numContactPoints = 0;
+
+        return manifold;
     } break;
     case ContactType::Sphere: {
         SphereContact sphere_contact = narrowphase_result.sphere;
 
-        addSinglePointContact(ctx, sphere_contact.pt, sphere_contact.normal,
-                              sphere_contact.depth, b_loc, a_loc);
+        Manifold manifold;
+        manifold.contactPoints[0] = sphere_contact.pt;
+        manifold.penetrationDepths[0] = sphere_contact.depth;
+        for (CountT i = 1; i < 4; i++) {
+            manifold.contactPoints[i] = Vector3::zero();
+            manifold.penetrationDepths[i] = 0.f;
+        }
+        manifold.numContactPoints = 1;
+        manifold.normal = sphere_contact.normal;
+
+        *a_is_ref = false;
+        return manifold;
     } break;
     case ContactType::SATPlane: {
         // Plane is always b, always reference
-        Loc ref_loc = b_loc;
-        Loc other_loc = a_loc;
+        *a_is_ref = false;
 
 #ifdef MADRONA_GPU_MODE
         Mat3x4 hull_txfm = Mat3x4::fromTRS(a_pos, a_rot, a_scale);
@@ -1564,11 +1928,9 @@ MADRONA_ALWAYS_INLINE static inline void generateContacts(
 
         // Sadly there are cases where two objects are just barely
         // touching and post contact clipping all the clipped contacts
-        // are just barely separated due to FP32. For now just don't
-        // make a Contact in this situation.
-        if (manifold.numContactPoints > 0) {
-            addManifoldContacts(ctx, manifold, ref_loc, other_loc);
-        }
+        // are just barely separated due to FP32. The manifold is empty
+        // and no Contact is made in this situation.
+        return manifold;
     } break;
     case ContactType::SATFace: {
         const Vector3 *ref_vertices;
@@ -1589,12 +1951,9 @@ MADRONA_ALWAYS_INLINE static inline void generateContacts(
             narrowphase_result.sat.incidentFaceIdxOrEdgeIdxB;
 
         uint32_t ref_face_idx = ref_face_idx_and_ref_mask & 0x7FFF'FFFF;
-        bool a_is_ref = ref_face_idx == ref_face_idx_and_ref_mask;
+        *a_is_ref = ref_face_idx == ref_face_idx_and_ref_mask;
 
-        Loc ref_loc, other_loc;
-        if (a_is_ref) {
-            ref_loc = a_loc;
-            other_loc = b_loc;
+        if (*a_is_ref) {
             ref_vertices = narrowphase_result.aVertices;
             other_vertices = narrowphase_result.bVertices;
             ref_hedges = narrowphase_result.aHalfEdges;
@@ -1606,8 +1965,6 @@ MADRONA_ALWAYS_INLINE static inline void generateContacts(
             other_txfm = Mat3x4::fromTRS(b_pos, b_rot, b_scale);
 #endif
         } else {
-            ref_loc = b_loc;
-            other_loc = a_loc;
             ref_vertices = narrowphase_result.bVertices;
             other_vertices = narrowphase_result.aVertices;
             ref_hedges = narrowphase_result.bHalfEdges;
@@ -1646,16 +2003,13 @@ MADRONA_ALWAYS_INLINE static inline void generateContacts(
 
         // Sadly there are cases where two objects are just barely
         // touching and post contact clipping all the clipped contacts
-        // are just barely separated due to FP32. For now just don't
-        // make a Contact in this situation.
-        if (manifold.numContactPoints > 0) {
-            addManifoldContacts(ctx, manifold, ref_loc, other_loc);
-        }
+        // are just barely separated due to FP32. The manifold is empty
+        // and no Contact is made in this situation.
+        return manifold;
     } break;
     case ContactType::SATEdge: {
         // A is always reference
-        Loc ref_loc = a_loc;
-        Loc other_loc = b_loc;
+        *a_is_ref = true;
 
         // Create edge contact
         Manifold manifold = createEdgeContact(
@@ -1673,15 +2027,168 @@ MADRONA_ALWAYS_INLINE static inline void generateContacts(
 #endif
             { 0, 0, 0 }, { 1, 0, 0, 0 });
 
-        addManifoldContacts(ctx, manifold, ref_loc, other_loc);
+        return manifold;
     } break;
     default: MADRONA_UNREACHABLE();
     }
 }
 
+// Pairs with a TriangleMesh b: a's bounds are moved into the mesh's object
+// space to cull triangles with the MeshBVH, then every overlapping
+// triangle is tested in world space and gets its own Contact. One manifold
+// can't describe these pairs, so they never use the CachedManifold.
+static void runTriangleMeshNarrowphase(
+    Context &ctx,
+    NarrowphaseTest test_type,
+    Loc a_loc, Loc b_loc,
+    const CollisionPrimitive *a_prim, const CollisionPrimitive *b_prim,
+    AABB a_prim_aabb,
+    Vector3 a_pos, Vector3 b_pos,
+    Quat a_rot, Quat b_rot,
+    Diag3x3 a_scale, Diag3x3 b_scale,
+    CountT max_num_tmp_vertices,
+    CountT max_num_tmp_faces,
+    Vector3 *txfm_vertex_buffer,
+    Plane *txfm_face_buffer)
+{
+    // Planes and other meshes are static as well
+    if (test_type != NarrowphaseTest::SphereTriangleMesh &&
+            test_type != NarrowphaseTest::HullTriangleMesh) {
+        return;
+    }
+
+    const MeshBVH &mesh_bvh = b_prim->triMesh.bvh;
+
+    Quat to_mesh_rot = b_rot.inv();
+    AABB query_aabb = a_prim_aabb.applyTRS(
+        to_mesh_rot.rotateVec(a_pos - b_pos), to_mesh_rot * a_rot, a_scale);
+    {
+        Diag3x3 inv_b_scale = b_scale.inv();
+        query_aabb.pMin = inv_b_scale * query_aabb.pMin;
+        query_aabb.pMax = inv_b_scale * query_aabb.pMax;
+    }
+
+    auto txfmTriangle = [&](Vector3 *a, Vector3 *b, Vector3 *c,
+                            Vector3 *normal) {
+        *a = b_rot.rotateVec(b_scale * *a) + b_pos;
+        *b = b_rot.rotateVec(b_scale * *b) + b_pos;
+        *c = b_rot.rotateVec(b_scale * *c) + b_pos;
+
+        Vector3 n = cross(*b - *a, *c - *a);
+        float n_len2 = n.length2();
+        if (n_len2 == 0.f) {
+            return false;
+        }
+
+        *normal = n / sqrtf(n_len2);
+        return true;
+    };
+
+    if (test_type == NarrowphaseTest::SphereTriangleMesh) {
+        assert(a_scale.d0 == a_scale.d1 && a_scale.d0 == a_scale.d2);
+        float sphere_radius = a_scale.d0 * a_prim->sphere.radius;
+
+        // Spheres touching a shared edge or vertex find the same closest
+        // point through every triangle around it
+        constexpr CountT max_saved_points = 8;
+        constexpr float duplicate_dist2 = 1e-8f;
+        Vector3 saved_points[max_saved_points];
+        CountT num_saved_points = 0;
+
+        mesh_bvh.findOverlaps(query_aabb,
+        [&](Vector3 a, Vector3 b, Vector3 c) {
+            Vector3 tri_normal;
+            if (!txfmTriangle(&a, &b, &c, &tri_normal)) {
+                return;
+            }
+
+            SphereContact sphere_contact;
+            if (!sphereTriangleContact(a_pos, sphere_radius, a, b, c,
+                                       tri_normal, &sphere_contact)) {
+                return;
+            }
+
+            for (CountT i = 0; i < num_saved_points; i++) {
+                if (saved_points[i].distance2(sphere_contact.pt) <
+                        duplicate_dist2) {
+                    return;
+                }
+            }
+
+            if (num_saved_points < max_saved_points) {
+                saved_points[num_saved_points++] = sphere_contact.pt;
+            }
+
+            NarrowphaseResult result;
+            result.type = ContactType::Sphere;
+            result.sphere = sphere_contact;
+
+            bool a_is_ref;
+            Manifold manifold = generateContacts(result, nullptr, nullptr,
+                                                 &a_is_ref);
+
+            addManifoldContacts(ctx, manifold, b_loc, a_loc);
+        });
+
+        return;
+    }
+
+    const HalfEdgeMesh &a_he_mesh = a_prim->hull.halfEdgeMesh;
+    assert(a_he_mesh.numFaces < max_num_tmp_faces);
+
+    HullState hull_state = makeHullState(a_he_mesh, a_pos, a_rot, a_scale,
+        txfm_vertex_buffer, txfm_face_buffer);
+
+    // The rest of the vertex buffer is clipping scratch. Clipped polygons
+    // have at most one vertex per hull vertex plus one per triangle edge.
+    CountT num_clip_tmp_vertices =
+        (max_num_tmp_vertices - (CountT)a_he_mesh.numVertices) / 2;
+    assert(num_clip_tmp_vertices >= (CountT)a_he_mesh.numVertices + 3);
+
+    Vector3 *clip_tmp_a = txfm_vertex_buffer + a_he_mesh.numVertices;
+    Vector3 *clip_tmp_b = clip_tmp_a + num_clip_tmp_vertices;
+
+    mesh_bvh.findOverlaps(query_aabb, [&](Vector3 a, Vector3 b, Vector3 c) {
+        Vector3 tri_normal;
+        if (!txfmTriangle(&a, &b, &c, &tri_normal)) {
+            return;
+        }
+
+        TriangleHull tri_hull;
+        HullState tri_state = makeTriangleHullState(
+            tri_hull, a, b, c, tri_normal);
+
+        SATResult sat = doSATTriangle(hull_state, tri_state);
+        if (sat.type == ContactType::None) {
+            return;
+        }
+
+        NarrowphaseResult result;
+        result.type = sat.type;
+        result.sat = sat.contact;
+        result.aVertices = hull_state.mesh.vertices;
+        result.bVertices = tri_state.mesh.vertices;
+        result.aHalfEdges = hull_state.mesh.halfEdges;
+        result.bHalfEdges = tri_state.mesh.halfEdges;
+        result.aFaceHedgeRoots = hull_state.mesh.faceBaseHalfEdges;
+        result.bFaceHedgeRoots = tri_state.mesh.faceBaseHalfEdges;
+
+        bool a_is_ref;
+        Manifold manifold = generateContacts(result, clip_tmp_a, clip_tmp_b,
+                                             &a_is_ref);
+
+        if (manifold.numContactPoints > 0) {
+            addManifoldContacts(ctx, manifold,
+                                a_is_ref ? a_loc : b_loc,
+                                a_is_ref ? b_loc : a_loc);
+        }
+    });
+}
+
 static inline void runNarrowphase(
     Context &ctx,
-    const CandidateCollision &candidate_collision
+    const CandidateCollision &candidate_collision,
+    CachedManifold &cached_manifold
     MADRONA_GPU_COND(,
         const int32_t mwgpu_warp_id,
         const int32_t mwgpu_lane_id,
@@ -1775,13 +2282,52 @@ static inline void runNarrowphase(
 
         if (!a_world_aabb.intersects(b_world_aabb)) {
 #ifdef MADRONA_GPU_MODE
+            // Padding lanes alias the last candidate
+            if (lane_active) {
+                cached_manifold.numPoints = 0;
+            }
             lane_active = false;
 #else
+            cached_manifold.numPoints = 0;
             return;
 #endif
         }
     }
 
+    // Type ordering above puts triangle meshes in b
+    if (raw_type_b == (uint32_t)CollisionPrimitive::Type::TriangleMesh) {
+#ifdef MADRONA_GPU_MODE
+        // The warp narrowphase doesn't support triangle meshes, and
+        // PhysicsLoader rejects them for the CUDA backend
+        lane_active = false;
+#else
+        cached_manifold.numPoints = 0;
+
+        runTriangleMeshNarrowphase(ctx,
+            NarrowphaseTest {raw_type_a | raw_type_b},
+            a_loc, b_loc, a_prim, b_prim,
+            obj_mgr.primitiveAABBs[a_prim_idx],
+            a_pos, b_pos, a_rot, b_rot, a_scale, b_scale,
+            max_num_tmp_vertices, max_num_tmp_faces,
+            tmp_vertices_buffer, tmp_faces_buffer);
+        return;
+#endif
+    }
+
+    float pair_size = fminf(
+        minPrimitiveExtent(obj_mgr.primitiveAABBs[a_prim_idx], a_scale),
+        minPrimitiveExtent(obj_mgr.primitiveAABBs[b_prim_idx], b_scale));
+
+    if (MADRONA_GPU_COND(lane_active &&) reuseCachedManifold(
+            ctx, cached_manifold, a_loc, b_loc, a_pos, b_pos, a_rot, b_rot,
+            pair_size)) {
+#ifdef MADRONA_GPU_MODE
+        lane_active = false;
+#else
+        return;
+#endif
+    }
+
 #ifdef MADRONA_GPU_MODE
     const uint32_t active_mask = __ballot_sync(mwGPU::allActive, lane_active);
 
@@ -1881,13 +2427,17 @@ static inline void runNarrowphase(
     __syncwarp(mwGPU::allActive);
 
     if (lane_active) {
-        generateContacts(ctx, thread_result,
-                         a_loc, b_loc,
-                         a_pos, a_rot, a_scale,
-                         b_pos, b_rot, b_scale,
-                         tmp_faces_buffer,
-                         tmp_faces_buffer + max_num_tmp_faces / 2);
-        
+        bool a_is_ref;
+        Manifold manifold = generateContacts(thread_result,
+                                             a_pos, a_rot, a_scale,
+                                             b_pos, b_rot, b_scale,
+                                             tmp_faces_buffer,
+                                             tmp_faces_buffer +
+                                                 max_num_tmp_faces / 2,
+                                             &a_is_ref);
+
+        saveContacts(ctx, cached_manifold, manifold, a_is_ref,
+                     a_loc, b_loc, a_pos, b_pos, a_rot, b_rot);
     }
 #else
     NarrowphaseResult result = narrowphaseDispatch(
@@ -1899,10 +2449,15 @@ static inline void runNarrowphase(
         max_num_tmp_vertices, max_num_tmp_faces,
         tmp_vertices_buffer, tmp_faces_buffer);
 
-    generateContacts(ctx, result,
-                     a_loc, b_loc,
-                     tmp_faces_buffer,
-                     tmp_faces_buffer + max_num_tmp_faces / 2);
+    bool a_is_ref;
+    Manifold manifold = generateContacts(result,
+                                         tmp_faces_buffer,
+                                         tmp_faces_buffer +
+                                             max_num_tmp_faces / 2,
+                                         &a_is_ref);
+
+    saveContacts(ctx, cached_manifold, manifold, a_is_ref,
+                 a_loc, b_loc, a_pos, b_pos, a_rot, b_rot);
 #endif
 }
 
@@ -1910,10 +2465,12 @@ inline void runNarrowphaseSystem(
 #ifdef MADRONA_GPU_MODE
     WorldID *world_ids,
     const CandidateCollision *candidate_collisions,
+    CachedManifold *cached_manifolds,
     int32_t num_candidates
 #else
     Context &ctx,
-    const CandidateCollision &candidate_collision
+    const CandidateCollision &candidate_collision,
+    CachedManifold &cached_manifold
 #endif
     )
 {
@@ -1937,10 +2494,11 @@ inline void runNarrowphaseSystem(
     PROF_END(world_get_ctr);
 
     runNarrowphase(ctx, candidate_collisions[candidate_idx],
+                   cached_manifolds[candidate_idx],
                    mwgpu_warp_id, mwgpu_lane_id, lane_active);
     
 #else
-    runNarrowphase(ctx, candidate_collision);
+    runNarrowphase(ctx, candidate_collision, cached_manifold);
 #endif
 }
 
@@ -1950,10 +2508,11 @@ TaskGraphNodeID setupTasks(
 {
 #ifdef MADRONA_GPU_MODE
     auto narrowphase = builder.addToGraph<CustomParallelForNode<Context,
-        runNarrowphaseSystem, 32, 32, CandidateCollision>>(deps);
+        runNarrowphaseSystem, 32, 32, CandidateCollision,
+        CachedManifold>>(deps);
 #else
     auto narrowphase = builder.addToGraph<ParallelForNode<Context,
-        runNarrowphaseSystem, CandidateCollision>>(deps);
+        runNarrowphaseSystem, CandidateCollision, CachedManifold>>(deps);
 #endif
 
     auto finished = builder.addToGraph<ResetTmpAllocNode>({narrowphase});
@@ -75,7 +75,8 @@ static void initPhysicsState(Context &ctx,
                              CountT num_substeps,
                              Vector3 gravity,
                              uint32_t contact_archetype_id,
-                             uint32_t joint_archetype_id)
+                             uint32_t joint_archetype_id,
+                             PhysicsSystem::Solver solver)
 {
     float h = delta_t / (float)num_substeps;
     float g_mag = gravity.length();
@@ -88,6 +89,7 @@ static void initPhysicsState(Context &ctx,
         .restitutionThreshold = 2.f * g_mag * h,
         .contactArchetypeID = contact_archetype_id,
         .jointArchetypeID = joint_archetype_id,
+        .solver = solver,
     };
 }
 
@@ -125,21 +127,40 @@ void init(Context &ctx,
 
     initPhysicsState(
         ctx, delta_t, num_substeps, gravity,
-        contact_archetype_id, joint_archetype_id);
+        contact_archetype_id, joint_archetype_id, solver);
 
     switch (solver) {
     case Solver::XPBD: {
-        xpbd::init(ctx);
+        xpbd::init(ctx, max_dynamic_objects);
     } break;
     case Solver::TGS: {
-        tgs::init(ctx);
+        tgs::init(ctx, max_dynamic_objects);
     } break;
     default: MADRONA_UNREACHABLE();
     }
 
+    sleep::init(ctx, max_dynamic_objects);
+
     ctx.singleton<ObjectData>() = { obj_mgr };
 }
 
+void shutdown(Context &ctx)
+{
+    switch (ctx.singleton<PhysicsSystemState>().solver) {
+    case Solver::XPBD: {
+        xpbd::shutdown(ctx);
+    } break;
+    case Solver::TGS: {
+        tgs::shutdown(ctx);
+    } break;
+    default: MADRONA_UNREACHABLE();
+    }
+
+    sleep::shutdown(ctx);
+
+    ctx.singleton<broadphase::BVH>().destroy();
+}
+
 void reset(Context &ctx)
 {
     broadphase::BVH &bvh = ctx.singleton<broadphase::BVH>();
@@ -153,6 +174,12 @@ broadphase::LeafID registerEntity(Context &ctx,
 {
     auto &bvh = ctx.singleton<broadphase::BVH>();
 
+    ctx.get<SleepState>(e) = SleepState {
+        .restTime = 0.f,
+        .asleep = false,
+        .island = -1,
+    };
+
     return bvh.reserveLeaf(e, obj_id);
 }
 
@@ -313,6 +340,7 @@ void registerTypes(ECSRegistry &registry,
     registry.registerComponent<Velocity>();
     registry.registerComponent<ExternalForce>();
     registry.registerComponent<ExternalTorque>();
+    registry.registerComponent<SleepState>();
 
     registry.registerSingleton<broadphase::BVH>();
 
@@ -320,6 +348,7 @@ void registerTypes(ECSRegistry &registry,
     registry.registerArchetype<CollisionEventTemporary>();
 
     registry.registerComponent<CandidateCollision>();
+    registry.registerComponent<CachedManifold>();
     registry.registerArchetype<CandidateTemporary>();
 
     registry.registerComponent<JointConstraint>();
@@ -328,6 +357,8 @@ void registerTypes(ECSRegistry &registry,
     registry.registerSingleton<PhysicsSystemState>();
     registry.registerSingleton<ObjectData>();
 
+    sleep::registerTypes(registry);
+
     switch (solver) {
     case Solver::XPBD: {
         xpbd::registerTypes(registry);
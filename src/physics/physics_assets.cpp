@@ -1,10 +1,12 @@
 #include <madrona/physics_assets.hpp>
 #include <madrona/importer.hpp>
+#include <madrona/mesh_bvh_builder.hpp>
 
 #ifdef MADRONA_CUDA_SUPPORT
 #include <madrona/cuda_utils.hpp>
 #endif
 
+#include <cstdio>
 #include <unordered_map>
 
 namespace madrona::phys {
@@ -1013,9 +1015,10 @@ static inline MassProperties computeMassProperties(
                 .off = Vector3::zero(),
             };
             continue;
-        } else if (prim.type == CollisionPrimitive::Type::Plane) {
-            // Plane has infinite mass / inertia. The rest of the
-            // object must as well
+        } else if (prim.type == CollisionPrimitive::Type::Plane ||
+                   prim.type == CollisionPrimitive::Type::TriangleMesh) {
+            // Plane and triangle meshes have infinite mass / inertia. The
+            // rest of the object must as well
 
             return MassProperties {
                 Diag3x3::uniform(INFINITY),
@@ -1211,8 +1214,27 @@ static void setupHullPrimitive(const SourceCollisionPrimitive &src_prim,
     *out_aabb = mesh_aabb;
 }
 
+static void setupTriangleMeshPrimitive(const MeshBVH &mesh_bvh,
+                                       CollisionPrimitive *out_prim,
+                                       AABB *out_aabb)
+{
+    assert(mesh_bvh.numVerts > 0);
+    out_prim->triMesh.bvh = mesh_bvh;
+
+    // Computed from the vertices rather than taken from the BVH's
+    // quantized root bounds, which are conservative
+    AABB mesh_aabb = AABB::point(mesh_bvh.vertices[0].pos);
+    for (CountT vert_idx = 1; vert_idx < (CountT)mesh_bvh.numVerts;
+         vert_idx++) {
+        mesh_aabb.expand(mesh_bvh.vertices[vert_idx].pos);
+    }
+
+    *out_aabb = mesh_aabb;
+}
+
 static void setupRigidBodyAABBsAndPrimitives(
     HalfEdgeMesh *hull_meshes,
+    const MeshBVH *tri_mesh_bvhs,
     Span<const SourceCollisionObject> collision_objs,
     CollisionPrimitive *out_prims,
     AABB *out_prim_aabbs,
@@ -1223,6 +1245,7 @@ static void setupRigidBodyAABBsAndPrimitives(
     using Type = CollisionPrimitive::Type;
 
     uint32_t cur_prim_offset = 0;
+    CountT cur_tri_mesh_idx = 0;
     for (CountT obj_idx = 0; obj_idx < collision_objs.size(); obj_idx++) {
         const SourceCollisionObject &collision_obj = collision_objs[obj_idx];
 
@@ -1251,6 +1274,10 @@ static void setupRigidBodyAABBsAndPrimitives(
                 setupHullPrimitive(src_prim, hull_meshes,
                     out_prim, &prim_aabb);
             } break;
+            case Type::TriangleMesh: {
+                setupTriangleMeshPrimitive(tri_mesh_bvhs[cur_tri_mesh_idx++],
+                    out_prim, &prim_aabb);
+            } break;
             }
 
             prim_aabbs[prim_idx] = prim_aabb;
@@ -1278,6 +1305,25 @@ void * RigidBodyAssets::processRigidBodyAssets(
     HalfEdgeMesh *built_hulls =
         tmp_alloc.allocN<HalfEdgeMesh>(convex_hull_meshes.size());
 
+    CountT num_tri_meshes = 0;
+    for (const SourceCollisionObject &collision_obj : collision_objs) {
+        for (const SourceCollisionPrimitive &prim : collision_obj.prims) {
+            if (prim.type == CollisionPrimitive::Type::TriangleMesh) {
+                if (collision_obj.invMass != 0.f) {
+                    fprintf(stderr, "TriangleMesh primitives are only "
+                            "supported on static objects (invMass == 0)\n");
+                    tmp_alloc.pop(tmp_frame);
+                    return nullptr;
+                }
+
+                num_tri_meshes += 1;
+            }
+        }
+    }
+
+    MeshBVH *built_tri_mesh_bvhs =
+        tmp_alloc.allocN<MeshBVH>(num_tri_meshes);
+
     auto hull_build_frame = tmp_alloc.push();
 
     bool hull_success = processConvexHulls(convex_hull_meshes,
@@ -1298,6 +1344,27 @@ void * RigidBodyAssets::processRigidBodyAssets(
         total_num_prims += cur_num_prims;
     }
 
+    CountT total_num_tri_mesh_nodes = 0;
+    CountT total_num_tri_mesh_verts = 0;
+    {
+        CountT tri_mesh_idx = 0;
+        for (const SourceCollisionObject &collision_obj : collision_objs) {
+            for (const SourceCollisionPrimitive &prim : collision_obj.prims) {
+                if (prim.type != CollisionPrimitive::Type::TriangleMesh) {
+                    continue;
+                }
+
+                MeshBVH bvh = MeshBVHBuilder::build(
+                    Span<const imp::SourceMesh>(prim.triMeshInput.meshes,
+                                                prim.triMeshInput.numMeshes));
+
+                total_num_tri_mesh_nodes += bvh.numNodes;
+                total_num_tri_mesh_verts += bvh.numVerts;
+                built_tri_mesh_bvhs[tri_mesh_idx++] = bvh;
+            }
+        }
+    }
+
     CountT total_num_halfedges = 0;
     CountT total_num_faces = 0;
     CountT total_num_verts = 0;
@@ -1325,6 +1392,10 @@ void * RigidBodyAssets::processRigidBodyAssets(
             collision_objs.size(), // prim_offsets
         (int64_t)sizeof(uint32_t) *
             collision_objs.size(), // prim_counts
+        (int64_t)sizeof(QBVHNode) *
+            total_num_tri_mesh_nodes, // tri mesh nodes
+        (int64_t)sizeof(MeshBVH::BVHVertex) *
+            total_num_tri_mesh_verts, // tri mesh vertices
     });
 
     int64_t buffer_offsets[buffer_sizes.size() - 1];
@@ -1342,6 +1413,12 @@ void * RigidBodyAssets::processRigidBodyAssets(
             .numFaces = (uint32_t)total_num_faces,
             .numVerts = (uint32_t)total_num_verts,
         },
+        .triMeshData = {
+            .nodes = (QBVHNode *)(buffer + buffer_offsets[9]),
+            .vertices = (MeshBVH::BVHVertex *)(buffer + buffer_offsets[10]),
+            .numNodes = (uint32_t)total_num_tri_mesh_nodes,
+            .numVerts = (uint32_t)total_num_tri_mesh_verts,
+        },
         .primitives = (CollisionPrimitive *)(buffer + buffer_offsets[3]),
         .primitiveAABBs = (AABB *)(buffer + buffer_offsets[4]),
         .metadatas = (RigidBodyMetadata *)(buffer + buffer_offsets[5]),
@@ -1387,7 +1464,36 @@ void * RigidBodyAssets::processRigidBodyAssets(
 
     tmp_alloc.pop(hull_build_frame);
 
+    CountT cur_tri_mesh_node_offset = 0;
+    CountT cur_tri_mesh_vert_offset = 0;
+    for (CountT tri_mesh_idx = 0; tri_mesh_idx < num_tri_meshes;
+         tri_mesh_idx++) {
+        MeshBVH &bvh = built_tri_mesh_bvhs[tri_mesh_idx];
+
+        QBVHNode *nodes_out =
+            &assets.triMeshData.nodes[cur_tri_mesh_node_offset];
+        MeshBVH::BVHVertex *verts_out =
+            &assets.triMeshData.vertices[cur_tri_mesh_vert_offset];
+
+        memcpy(nodes_out, bvh.nodes, sizeof(QBVHNode) * bvh.numNodes);
+        memcpy(verts_out, bvh.vertices,
+               sizeof(MeshBVH::BVHVertex) * bvh.numVerts);
+
+        rawDeallocAligned(bvh.nodes);
+        rawDeallocAligned(bvh.leafMats);
+        rawDeallocAligned(bvh.vertices);
+
+        // Collision doesn't need per triangle materials
+        bvh.nodes = nodes_out;
+        bvh.leafMats = nullptr;
+        bvh.vertices = verts_out;
+
+        cur_tri_mesh_node_offset += bvh.numNodes;
+        cur_tri_mesh_vert_offset += bvh.numVerts;
+    }
+
     setupRigidBodyAABBsAndPrimitives(built_hulls,
+                                     built_tri_mesh_bvhs,
                                      collision_objs,
                                      assets.primitives,
                                      assets.primitiveAABBs,
@@ -1405,4 +1511,269 @@ void * RigidBodyAssets::processRigidBodyAssets(
     return buffer;
 }
 
+namespace {
+
+// Cache kind tag for rigid body assets ("PHYS"). Bump
+// rigidBodyCacheVersion when the processing itself changes in a way that
+// produces different output from the same inputs.
+constexpr uint32_t rigidBodyCacheKind = 0x53594850;
+constexpr uint32_t rigidBodyCacheVersion = 3;
+
+// Sits at the start of the cache payload. Every offset is relative to the
+// start of the copied processRigidBodyAssets buffer that follows it.
+struct CachedRigidBodyAssets {
+    uint64_t halfEdgesOffset;
+    uint64_t faceBaseHalfEdgesOffset;
+    uint64_t facePlanesOffset;
+    uint64_t verticesOffset;
+    uint64_t primitivesOffset;
+    uint64_t primitiveAABBsOffset;
+    uint64_t metadatasOffset;
+    uint64_t objAABBsOffset;
+    uint64_t primOffsetsOffset;
+    uint64_t primCountsOffset;
+    uint64_t triMeshNodesOffset;
+    uint64_t triMeshVerticesOffset;
+    uint64_t numBufferBytes;
+
+    uint32_t numHalfEdges;
+    uint32_t numFaces;
+    uint32_t numVerts;
+    uint32_t numTriMeshNodes;
+    uint32_t numTriMeshVerts;
+    uint32_t numConvexHulls;
+    uint32_t totalNumPrimitives;
+    uint32_t numObjs;
+};
+
+constexpr uint64_t cachedBufferOffset = utils::roundUp(
+    (uint64_t)sizeof(CachedRigidBodyAssets),
+    (uint64_t)assetCachePayloadAlignment);
+
+}
+
+uint64_t RigidBodyAssets::hashSources(
+    Span<const imp::SourceMesh> convex_hull_meshes,
+    Span<const SourceCollisionObject> collision_objs,
+    bool build_convex_hulls)
+{
+    AssetHasher hasher(rigidBodyCacheVersion);
+
+    // Output layout is part of the key, a cache written by a build with
+    // different struct layouts must never be mapped.
+    hasher.add((uint32_t)sizeof(HalfEdge));
+    hasher.add((uint32_t)sizeof(Plane));
+    hasher.add((uint32_t)sizeof(CollisionPrimitive));
+    hasher.add((uint32_t)sizeof(QBVHNode));
+    hasher.add((uint32_t)sizeof(RigidBodyMetadata));
+    hasher.add(build_convex_hulls);
+
+    auto hashMesh = [&hasher](const imp::SourceMesh &mesh) {
+        CountT num_indices = 0;
+        if (mesh.faceCounts == nullptr) {
+            num_indices = 3 * (CountT)mesh.numFaces;
+        } else {
+            for (CountT i = 0; i < (CountT)mesh.numFaces; i++) {
+                num_indices += mesh.faceCounts[i];
+            }
+        }
+
+        hasher.addArray(mesh.positions, mesh.numVertices);
+        hasher.addArray(mesh.faceCounts, mesh.numFaces);
+        hasher.addArray(mesh.indices, num_indices);
+    };
+
+    for (const imp::SourceMesh &mesh : convex_hull_meshes) {
+        hashMesh(mesh);
+    }
+
+    for (const SourceCollisionObject &obj : collision_objs) {
+        hasher.add(obj.invMass);
+        hasher.add(obj.friction);
+        hasher.add(obj.prims.size());
+
+        for (const SourceCollisionPrimitive &prim : obj.prims) {
+            hasher.add(prim.type);
+
+            switch (prim.type) {
+            case CollisionPrimitive::Type::Sphere: {
+                hasher.add(prim.sphere);
+            } break;
+            case CollisionPrimitive::Type::Hull: {
+                hasher.add(prim.hullInput);
+            } break;
+            case CollisionPrimitive::Type::Plane: break;
+            case CollisionPrimitive::Type::TriangleMesh: {
+                hasher.add(prim.triMeshInput.numMeshes);
+                for (CountT i = 0; i < (CountT)prim.triMeshInput.numMeshes;
+                     i++) {
+                    hashMesh(prim.triMeshInput.meshes[i]);
+                }
+            } break;
+            }
+        }
+    }
+
+    return hasher.finish();
+}
+
+bool RigidBodyAssets::writeCache(const char *path,
+                                 uint64_t source_hash,
+                                 const RigidBodyAssets &assets,
+                                 const void *buffer,
+                                 CountT num_bytes)
+{
+    const char *base = (const char *)buffer;
+    auto toOffset = [base](const void *ptr) {
+        return (uint64_t)((const char *)ptr - base);
+    };
+
+    CachedRigidBodyAssets cached {
+        .halfEdgesOffset = toOffset(assets.hullData.halfEdges),
+        .faceBaseHalfEdgesOffset =
+            toOffset(assets.hullData.faceBaseHalfEdges),
+        .facePlanesOffset = toOffset(assets.hullData.facePlanes),
+        .verticesOffset = toOffset(assets.hullData.vertices),
+        .primitivesOffset = toOffset(assets.primitives),
+        .primitiveAABBsOffset = toOffset(assets.primitiveAABBs),
+        .metadatasOffset = toOffset(assets.metadatas),
+        .objAABBsOffset = toOffset(assets.objAABBs),
+        .primOffsetsOffset = toOffset(assets.primOffsets),
+        .primCountsOffset = toOffset(assets.primCounts),
+        .triMeshNodesOffset = toOffset(assets.triMeshData.nodes),
+        .triMeshVerticesOffset = toOffset(assets.triMeshData.vertices),
+        .numBufferBytes = (uint64_t)num_bytes,
+        .numHalfEdges = assets.hullData.numHalfEdges,
+        .numFaces = assets.hullData.numFaces,
+        .numVerts = assets.hullData.numVerts,
+        .numTriMeshNodes = assets.triMeshData.numNodes,
+        .numTriMeshVerts = assets.triMeshData.numVerts,
+        .numConvexHulls = assets.numConvexHulls,
+        .totalNumPrimitives = assets.totalNumPrimitives,
+        .numObjs = assets.numObjs,
+    };
+
+    uint64_t num_payload_bytes = cachedBufferOffset + (uint64_t)num_bytes;
+    char *payload = (char *)malloc(num_payload_bytes);
+    memset(payload, 0, cachedBufferOffset);
+    memcpy(payload, &cached, sizeof(CachedRigidBodyAssets));
+
+    char *buffer_copy = payload + cachedBufferOffset;
+    memcpy(buffer_copy, buffer, num_bytes);
+
+    // Hull and mesh primitives point into the buffer, store those as
+    // offsets too
+    auto prims = (CollisionPrimitive *)(buffer_copy + cached.primitivesOffset);
+    for (CountT i = 0; i < (CountT)assets.totalNumPrimitives; i++) {
+        CollisionPrimitive &prim = prims[i];
+        if (prim.type == CollisionPrimitive::Type::TriangleMesh) {
+            MeshBVH &bvh = prim.triMesh.bvh;
+            bvh.nodes = (QBVHNode *)toOffset(bvh.nodes);
+            bvh.vertices = (MeshBVH::BVHVertex *)toOffset(bvh.vertices);
+            continue;
+        }
+
+        if (prim.type != CollisionPrimitive::Type::Hull) {
+            continue;
+        }
+
+        HalfEdgeMesh &he_mesh = prim.hull.halfEdgeMesh;
+        he_mesh.halfEdges = (HalfEdge *)toOffset(he_mesh.halfEdges);
+        he_mesh.faceBaseHalfEdges =
+            (uint32_t *)toOffset(he_mesh.faceBaseHalfEdges);
+        he_mesh.facePlanes = (Plane *)toOffset(he_mesh.facePlanes);
+        he_mesh.vertices = (Vector3 *)toOffset(he_mesh.vertices);
+    }
+
+    bool success = writeAssetCache(path, rigidBodyCacheKind, source_hash,
+                                   payload, num_payload_bytes);
+
+    free(payload);
+
+    return success;
+}
+
+Optional<MappedAssetCache> RigidBodyAssets::loadCache(
+    const char *path,
+    uint64_t source_hash,
+    RigidBodyAssets *out_assets)
+{
+    Optional<MappedAssetCache> mapped =
+        MappedAssetCache::map(path, rigidBodyCacheKind, source_hash);
+
+    if (!mapped.has_value()) {
+        return mapped;
+    }
+
+    CachedRigidBodyAssets cached;
+    if (mapped->numBytes() < cachedBufferOffset) {
+        return Optional<MappedAssetCache>::none();
+    }
+    memcpy(&cached, mapped->data(), sizeof(CachedRigidBodyAssets));
+
+    if (mapped->numBytes() < cachedBufferOffset + cached.numBufferBytes) {
+        return Optional<MappedAssetCache>::none();
+    }
+
+    char *base = mapped->data() + cachedBufferOffset;
+
+    RigidBodyAssets assets {
+        .hullData = {
+            .halfEdges = (HalfEdge *)(base + cached.halfEdgesOffset),
+            .faceBaseHalfEdges =
+                (uint32_t *)(base + cached.faceBaseHalfEdgesOffset),
+            .facePlanes = (Plane *)(base + cached.facePlanesOffset),
+            .vertices = (Vector3 *)(base + cached.verticesOffset),
+            .numHalfEdges = cached.numHalfEdges,
+            .numFaces = cached.numFaces,
+            .numVerts = cached.numVerts,
+        },
+        .triMeshData = {
+            .nodes = (QBVHNode *)(base + cached.triMeshNodesOffset),
+            .vertices = (MeshBVH::BVHVertex *)(
+                base + cached.triMeshVerticesOffset),
+            .numNodes = cached.numTriMeshNodes,
+            .numVerts = cached.numTriMeshVerts,
+        },
+        .primitives = (CollisionPrimitive *)(base + cached.primitivesOffset),
+        .primitiveAABBs = (AABB *)(base + cached.primitiveAABBsOffset),
+        .metadatas = (RigidBodyMetadata *)(base + cached.metadatasOffset),
+        .objAABBs = (AABB *)(base + cached.objAABBsOffset),
+        .primOffsets = (uint32_t *)(base + cached.primOffsetsOffset),
+        .primCounts = (uint32_t *)(base + cached.primCountsOffset),
+        .numConvexHulls = cached.numConvexHulls,
+        .totalNumPrimitives = cached.totalNumPrimitives,
+        .numObjs = cached.numObjs,
+    };
+
+    // Only the primitive array needs relocating; the mapping is private so
+    // this copies just those pages and leaves the rest shared.
+    for (CountT i = 0; i < (CountT)assets.totalNumPrimitives; i++) {
+        CollisionPrimitive &prim = assets.primitives[i];
+        if (prim.type == CollisionPrimitive::Type::TriangleMesh) {
+            MeshBVH &bvh = prim.triMesh.bvh;
+            bvh.nodes = (QBVHNode *)(base + (uintptr_t)bvh.nodes);
+            bvh.vertices =
+                (MeshBVH::BVHVertex *)(base + (uintptr_t)bvh.vertices);
+            continue;
+        }
+
+        if (prim.type != CollisionPrimitive::Type::Hull) {
+            continue;
+        }
+
+        HalfEdgeMesh &he_mesh = prim.hull.halfEdgeMesh;
+        he_mesh.halfEdges = (HalfEdge *)(base + (uintptr_t)he_mesh.halfEdges);
+        he_mesh.faceBaseHalfEdges =
+            (uint32_t *)(base + (uintptr_t)he_mesh.faceBaseHalfEdges);
+        he_mesh.facePlanes =
+            (Plane *)(base + (uintptr_t)he_mesh.facePlanes);
+        he_mesh.vertices =
+            (Vector3 *)(base + (uintptr_t)he_mesh.vertices);
+    }
+
+    *out_assets = assets;
+    return mapped;
+}
+
 }
@@ -12,9 +12,28 @@ struct PhysicsSystemState {
     float restitutionThreshold;
     uint32_t contactArchetypeID;
     uint32_t jointArchetypeID;
+    PhysicsSystem::Solver solver;
 };
 
-struct CandidateTemporary : Archetype<CandidateCollision> {};
+// Contact manifold from the last full narrowphase run on a candidate,
+// stored in the local space of each body. Later substeps re-project it
+// rather than redoing SAT while the pair's relative pose stays close to
+// the one it was generated at. numPoints is 0 when nothing is cached.
+struct CachedManifold {
+    // Pose of candidate b relative to candidate a
+    math::Vector3 relPos;
+    math::Quat relRot;
+    math::Vector3 localNormal;
+    math::Vector3 refPoints[4];
+    math::Vector3 otherPoints[4];
+    int32_t numPoints;
+    bool aIsRef;
+};
+
+struct CandidateTemporary : Archetype<
+    CandidateCollision,
+    CachedManifold
+> {};
 
 namespace broadphase {
 
@@ -40,6 +59,49 @@ TaskGraphNodeID setupTasks(
 
 }
 
+namespace sleep {
+
+void registerTypes(ECSRegistry &registry);
+
+void init(Context &ctx, CountT max_dynamic_objects);
+void shutdown(Context &ctx);
+
+// Groups bodies into islands and puts islands to sleep or wakes them up.
+// Must run while the step's contacts still exist.
+TaskGraphNodeID setupTasks(
+    TaskGraphBuilder &builder,
+    Span<const TaskGraphNodeID> deps);
+
+// Wakes a sleeping body that has been given a velocity or an external
+// force since it fell asleep. Returns whether the body is still asleep.
+inline bool checkAsleep(SleepState &sleep_state,
+                        const Velocity &vel,
+                        const ExternalForce &ext_force,
+                        const ExternalTorque &ext_torque)
+{
+    if (!sleep_state.asleep) {
+        return false;
+    }
+
+    if (vel.linear.length2() != 0.f || vel.angular.length2() != 0.f ||
+            ext_force.length2() != 0.f || ext_torque.length2() != 0.f) {
+        sleep_state.restTime = 0.f;
+        sleep_state.asleep = false;
+    }
+
+    return sleep_state.asleep;
+}
+
+// Pairs of bodies that are each either static or asleep can't generate
+// any new contacts
+inline bool isInactive(ResponseType response_type,
+                       const SleepState &sleep_state)
+{
+    return response_type == ResponseType::Static || sleep_state.asleep;
+}
+
+}
+
 namespace RGDCols {
     constexpr inline CountT Position = 2;
     constexpr inline CountT Rotation = 3;
@@ -50,9 +112,11 @@ namespace RGDCols {
     constexpr inline CountT Velocity = 8;
     constexpr inline CountT ExternalForce = 9;
     constexpr inline CountT ExternalTorque = 10;
-    constexpr inline CountT SolverBase = 11;
+    constexpr inline CountT SleepState = 11;
+    constexpr inline CountT SolverBase = 12;
 
     constexpr inline CountT CandidateCollision = 2;
+    constexpr inline CountT CachedManifold = 3;
     constexpr inline CountT ContactConstraint = 2;
     constexpr inline CountT JointConstraint = 2;
 };
@@ -212,6 +212,8 @@ CountT PhysicsLoader::loadRigidBodies(const RigidBodyAssets &assets)
     uint32_t *hull_face_base_halfedges;
     Plane *hull_face_planes;
     Vector3 *hull_verts;
+    QBVHNode *tri_mesh_nodes;
+    MeshBVH::BVHVertex *tri_mesh_verts;
     switch (impl_->execMode) {
     case ExecMode::CPU: {
         memcpy(prim_aabbs_dst, assets.primitiveAABBs,
@@ -243,6 +245,16 @@ CountT PhysicsLoader::loadRigidBodies(const RigidBodyAssets &assets)
                sizeof(Plane) * assets.hullData.numFaces);
         memcpy(hull_verts, assets.hullData.vertices,
                sizeof(Vector3) * assets.hullData.numVerts);
+
+        tri_mesh_nodes = (QBVHNode *)malloc(
+            sizeof(QBVHNode) * assets.triMeshData.numNodes);
+        tri_mesh_verts = (MeshBVH::BVHVertex *)malloc(
+            sizeof(MeshBVH::BVHVertex) * assets.triMeshData.numVerts);
+
+        memcpy(tri_mesh_nodes, assets.triMeshData.nodes,
+               sizeof(QBVHNode) * assets.triMeshData.numNodes);
+        memcpy(tri_mesh_verts, assets.triMeshData.vertices,
+               sizeof(MeshBVH::BVHVertex) * assets.triMeshData.numVerts);
     } break;
     case ExecMode::CUDA: {
 #ifndef MADRONA_CUDA_SUPPORT
@@ -286,6 +298,18 @@ CountT PhysicsLoader::loadRigidBodies(const RigidBodyAssets &assets)
         cudaMemcpy(hull_verts, assets.hullData.vertices,
                    sizeof(Vector3) * assets.hullData.numVerts,
                    cudaMemcpyHostToDevice);
+
+        tri_mesh_nodes = (QBVHNode *)cu::allocGPU(
+            sizeof(QBVHNode) * assets.triMeshData.numNodes);
+        tri_mesh_verts = (MeshBVH::BVHVertex *)cu::allocGPU(
+            sizeof(MeshBVH::BVHVertex) * assets.triMeshData.numVerts);
+
+        cudaMemcpy(tri_mesh_nodes, assets.triMeshData.nodes,
+                   sizeof(QBVHNode) * assets.triMeshData.numNodes,
+                   cudaMemcpyHostToDevice);
+        cudaMemcpy(tri_mesh_verts, assets.triMeshData.vertices,
+                   sizeof(MeshBVH::BVHVertex) * assets.triMeshData.numVerts,
+                   cudaMemcpyHostToDevice);
 #endif
     }
     }
@@ -297,6 +321,22 @@ CountT PhysicsLoader::loadRigidBodies(const RigidBodyAssets &assets)
 
     for (CountT i = 0; i < (CountT)assets.totalNumPrimitives; i++) {
         CollisionPrimitive &cur_primitive = primitives_tmp[i];
+        if (cur_primitive.type == CollisionPrimitive::Type::TriangleMesh) {
+            if (impl_->execMode == ExecMode::CUDA) {
+                FATAL("PhysicsLoader: TriangleMesh primitives aren't "
+                      "supported by the CUDA backend");
+            }
+
+            MeshBVH &bvh = cur_primitive.triMesh.bvh;
+
+            CountT node_offset = bvh.nodes - assets.triMeshData.nodes;
+            CountT vert_offset = bvh.vertices - assets.triMeshData.vertices;
+
+            bvh.nodes = tri_mesh_nodes + node_offset;
+            bvh.vertices = tri_mesh_verts + vert_offset;
+            continue;
+        }
+
         if (cur_primitive.type != CollisionPrimitive::Type::Hull) continue;
 
         HalfEdgeMesh &he_mesh = cur_primitive.hull.halfEdgeMesh;
@@ -333,6 +373,50 @@ CountT PhysicsLoader::loadRigidBodies(const RigidBodyAssets &assets)
     return cur_obj_offset;
 }
 
+CountT PhysicsLoader::loadRigidBodies(
+    Span<const imp::SourceMesh> convex_hull_meshes,
+    Span<const SourceCollisionObject> collision_objs,
+    bool build_convex_hulls,
+    const char *cache_path)
+{
+    uint64_t source_hash = 0;
+    if (cache_path != nullptr) {
+        source_hash = RigidBodyAssets::hashSources(
+            convex_hull_meshes, collision_objs, build_convex_hulls);
+
+        // loadRigidBodies copies everything out of the mapping, so it
+        // doesn't need to outlive this call
+        RigidBodyAssets cached_assets;
+        Optional<MappedAssetCache> cached = RigidBodyAssets::loadCache(
+            cache_path, source_hash, &cached_assets);
+        if (cached.has_value()) {
+            return loadRigidBodies(cached_assets);
+        }
+    }
+
+    StackAlloc tmp_alloc;
+    RigidBodyAssets assets;
+    CountT num_bytes;
+    void *buffer = RigidBodyAssets::processRigidBodyAssets(
+        convex_hull_meshes, collision_objs, build_convex_hulls,
+        tmp_alloc, &assets, &num_bytes);
+    if (buffer == nullptr) {
+        FATAL("PhysicsLoader: Invalid collision hull input");
+    }
+
+    if (cache_path != nullptr) {
+        // A failed write only means the next load processes the assets
+        // again
+        RigidBodyAssets::writeCache(cache_path, source_hash, assets,
+                                    buffer, num_bytes);
+    }
+
+    CountT obj_offset = loadRigidBodies(assets);
+    free(buffer);
+
+    return obj_offset;
+}
+
 ObjectManager & PhysicsLoader::getObjectManager()
 {
     return *impl_->mgr;
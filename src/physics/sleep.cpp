@@ -0,0 +1,185 @@
+#include <madrona/physics.hpp>
+#include <madrona/context.hpp>
+
+#include "physics_impl.hpp"
+
+namespace madrona::phys::sleep {
+
+using namespace base;
+using namespace math;
+using broadphase::LeafID;
+
+namespace consts {
+
+// Bodies slower than this count as resting
+inline constexpr float linearSleepVelocity = 0.05f;
+inline constexpr float angularSleepVelocity = 0.05f;
+// Seconds every body in an island must rest before the island sleeps
+inline constexpr float timeToSleep = 0.5f;
+
+}
+
+// Union-find forest over the world's rigid bodies, indexed by BVH leaf.
+// Rebuilt from scratch every step.
+struct SleepIslands {
+    Query<LeafID, ResponseType, SleepState, Velocity> bodyQuery;
+    Query<ContactConstraint> contactQuery;
+    Query<JointConstraint> jointQuery;
+    int32_t *parents;
+    // Per body rest time, for island roots the minimum over the island
+    float *restTimes;
+};
+
+static inline int32_t findIsland(int32_t *parents, int32_t idx)
+{
+    while (parents[idx] != idx) {
+        parents[idx] = parents[parents[idx]];
+        idx = parents[idx];
+    }
+
+    return idx;
+}
+
+static inline void joinIslands(int32_t *parents, int32_t a, int32_t b)
+{
+    a = findIsland(parents, a);
+    b = findIsland(parents, b);
+
+    if (a < b) {
+        parents[b] = a;
+    } else if (b < a) {
+        parents[a] = b;
+    }
+}
+
+// Static and kinematic bodies never sleep and don't join islands, otherwise
+// everything resting on the ground would end up in one island
+static inline void joinBodies(Context &ctx, int32_t *parents,
+                              Loc a, Loc b)
+{
+    if (ctx.getDirect<ResponseType>(RGDCols::ResponseType, a) !=
+            ResponseType::Dynamic ||
+        ctx.getDirect<ResponseType>(RGDCols::ResponseType, b) !=
+            ResponseType::Dynamic) {
+        return;
+    }
+
+    joinIslands(parents,
+                ctx.getDirect<LeafID>(RGDCols::LeafID, a).id,
+                ctx.getDirect<LeafID>(RGDCols::LeafID, b).id);
+}
+
+inline void updateSleepIslands(Context &ctx, SleepIslands &islands)
+{
+    const auto &physics_sys = ctx.singleton<PhysicsSystemState>();
+    int32_t *parents = islands.parents;
+    float *rest_times = islands.restTimes;
+
+    ctx.iterateQuery(islands.bodyQuery,
+    [&](LeafID leaf_id, ResponseType response_type,
+        SleepState &sleep_state, Velocity vel) {
+        parents[leaf_id.id] = leaf_id.id;
+
+        if (response_type != ResponseType::Dynamic || sleep_state.asleep) {
+            rest_times[leaf_id.id] = sleep_state.restTime;
+            return;
+        }
+
+        constexpr float lin_thresh2 =
+            consts::linearSleepVelocity * consts::linearSleepVelocity;
+        constexpr float ang_thresh2 =
+            consts::angularSleepVelocity * consts::angularSleepVelocity;
+
+        if (vel.linear.length2() < lin_thresh2 &&
+                vel.angular.length2() < ang_thresh2) {
+            sleep_state.restTime += physics_sys.deltaT;
+        } else {
+            sleep_state.restTime = 0.f;
+        }
+
+        rest_times[leaf_id.id] = sleep_state.restTime;
+    });
+
+    // Sleeping pairs don't generate contacts, so sleeping bodies are kept
+    // connected through the island they fell asleep in.
+    ctx.iterateQuery(islands.bodyQuery,
+    [&](LeafID leaf_id, ResponseType, SleepState &sleep_state, Velocity) {
+        if (sleep_state.asleep) {
+            joinIslands(parents, leaf_id.id, sleep_state.island);
+        }
+    });
+
+    ctx.iterateQuery(islands.contactQuery, [&](ContactConstraint &contact) {
+        joinBodies(ctx, parents, contact.ref, contact.alt);
+    });
+
+    ctx.iterateQuery(islands.jointQuery, [&](JointConstraint &joint) {
+        joinBodies(ctx, parents, ctx.loc(joint.e1), ctx.loc(joint.e2));
+    });
+
+    ctx.iterateQuery(islands.bodyQuery,
+    [&](LeafID leaf_id, ResponseType response_type, SleepState &, Velocity) {
+        if (response_type != ResponseType::Dynamic) {
+            return;
+        }
+
+        int32_t root = findIsland(parents, leaf_id.id);
+        rest_times[root] = fminf(rest_times[root], rest_times[leaf_id.id]);
+    });
+
+    ctx.iterateQuery(islands.bodyQuery,
+    [&](LeafID leaf_id, ResponseType response_type,
+        SleepState &sleep_state, Velocity &vel) {
+        if (response_type != ResponseType::Dynamic) {
+            return;
+        }
+
+        int32_t root = findIsland(parents, leaf_id.id);
+        if (rest_times[root] < consts::timeToSleep) {
+            sleep_state.asleep = false;
+            return;
+        }
+
+        if (!sleep_state.asleep) {
+            vel.linear = Vector3::zero();
+            vel.angular = Vector3::zero();
+        }
+
+        sleep_state.asleep = true;
+        sleep_state.island = root;
+    });
+}
+
+void registerTypes(ECSRegistry &registry)
+{
+    registry.registerSingleton<SleepIslands>();
+}
+
+void init(Context &ctx, CountT max_dynamic_objects)
+{
+    new (&ctx.singleton<SleepIslands>()) SleepIslands {
+        .bodyQuery = ctx.query<LeafID, ResponseType, SleepState, Velocity>(),
+        .contactQuery = ctx.query<ContactConstraint>(),
+        .jointQuery = ctx.query<JointConstraint>(),
+        .parents = (int32_t *)rawAlloc(
+            sizeof(int32_t) * max_dynamic_objects),
+        .restTimes = (float *)rawAlloc(sizeof(float) * max_dynamic_objects),
+    };
+}
+
+void shutdown(Context &ctx)
+{
+    SleepIslands &islands = ctx.singleton<SleepIslands>();
+    rawDealloc(islands.parents);
+    rawDealloc(islands.restTimes);
+}
+
+TaskGraphNodeID setupTasks(
+    TaskGraphBuilder &builder,
+    Span<const TaskGraphNodeID> deps)
+{
+    return builder.addToGraph<ParallelForNode<Context,
+        updateSleepIslands, SleepIslands>>(deps);
+}
+
+}
@@ -9,24 +9,121 @@
 
 namespace madrona::phys::tgs {
 
-struct Contact : Archetype<ContactConstraint> {};
-struct Joint : Archetype<JointConstraint> {};
+using namespace base;
+using namespace math;
+
+// Soft constraint coefficients for a spring with the given stiffness
+// (hertz) and damping ratio, integrated with timestep h
+struct Softness {
+    float biasRate;
+    float massScale;
+    float impulseScale;
+};
+
+struct TGSContactState {
+    // Contact points on each body in the body's local frame
+    Vector3 localAnchors1[4];
+    Vector3 localAnchors2[4];
+    float normalMass[4];
+    float tangentMass[4][2];
+    float normalImpulse[4];
+    float tangentImpulse[4][2];
+    Vector3 tangents[2];
+    float friction;
+    float invMass1;
+    float invMass2;
+    Diag3x3 invInertia1;
+    Diag3x3 invInertia2;
+};
+
+struct TGSJointState {
+    Loc l1;
+    Loc l2;
+    float invMass1;
+    float invMass2;
+    Diag3x3 invInertia1;
+    Diag3x3 invInertia2;
+    Vector3 linearImpulse;
+    Vector3 angularImpulse;
+};
+
+struct Contact : Archetype<ContactConstraint, TGSContactState> {};
+struct Joint : Archetype<JointConstraint, TGSJointState> {};
 
 // Any per-body solver state would go in components in this bundle
 // (check XPBDRigidBodyState for example).
 struct TGSRigidBodyState : Bundle<
 > {};
 
+// Accumulated contact impulses from the previous step, used to warm
+// start the contacts the narrowphase generates for the next step.
+// Entries are keyed by body pair. The narrowphase doesn't report which
+// features produced each manifold point, so points within a pair are
+// matched by their position in the ref body's frame instead.
+struct ContactCache {
+    struct Point {
+        Vector3 localPos;
+        float normalImpulse;
+        Vector3 tangentImpulse;
+    };
+
+    struct Entry {
+        Entity ref;
+        Entity alt;
+        int32_t numPoints;
+        Point points[4];
+    };
+
+    Entry *entries;
+    int32_t *occupiedSlots;
+    int32_t numOccupied;
+    int32_t capacity;
+};
+
 struct SolverState {
-    Query<JointConstraint> jointQuery;
-    Query<ContactConstraint> contactQuery;
+    Query<JointConstraint, TGSJointState> jointQuery;
+    Query<ContactConstraint, TGSContactState> contactQuery;
+    Softness contactSoftness;
+    Softness jointSoftness;
+    ContactCache contactCache;
 };
 
-using namespace base;
-using namespace math;
+namespace consts {
+
+inline constexpr float contactHertz = 30.f;
+inline constexpr float contactDampingRatio = 10.f;
+// Limits how fast the soft contacts push penetrating bodies apart
+inline constexpr float contactPushMaxVelocity = 3.f;
+inline constexpr float jointHertz = 60.f;
+inline constexpr float jointDampingRatio = 2.f;
+// Cached points further than this from a new point are not reused
+inline constexpr float cacheMatchDistance = 0.05f;
+
+}
+
+static Softness makeSoft(float hertz, float zeta, float h)
+{
+    if (hertz == 0.f) {
+        return Softness { 0.f, 1.f, 0.f };
+    }
+
+    float omega = 2.f * math::pi * hertz;
+    float a1 = 2.f * zeta + h * omega;
+    float a2 = h * omega * a1;
+    float a3 = 1.f / (1.f + a2);
+
+    return Softness {
+        .biasRate = omega / a1,
+        .massScale = a2 * a3,
+        .impulseScale = a3,
+    };
+}
 
 void registerTypes(ECSRegistry &registry)
 {
+    registry.registerComponent<TGSContactState>();
+    registry.registerComponent<TGSJointState>();
+
     registry.registerArchetype<Joint>();
     registry.registerArchetype<Contact>();
 
@@ -41,14 +138,49 @@ void registerTypes(ECSRegistry &registry)
     registry.registerSingleton<SolverState>();
 }
 
-void init(Context &ctx)
+void init(Context &ctx, CountT max_dynamic_objects)
 {
+    const auto &physics_sys = ctx.singleton<PhysicsSystemState>();
+    float h = physics_sys.h;
+
+    // Soft contacts can't be stiffer than the substep rate resolves
+    float contact_hertz = fminf(consts::contactHertz, 0.25f / h);
+    float joint_hertz = fminf(consts::jointHertz, 0.25f / h);
+
+    // Keep the cache at most half full so probe sequences stay short
+    int32_t cache_capacity = (int32_t)utils::int32NextPow2(
+        (uint32_t)std::max(CountT(64), 8 * max_dynamic_objects));
+
+    auto *cache_entries = (ContactCache::Entry *)rawAlloc(
+        sizeof(ContactCache::Entry) * cache_capacity);
+    for (int32_t i = 0; i < cache_capacity; i++) {
+        cache_entries[i].ref = Entity::none();
+    }
+
     new (&ctx.singleton<SolverState>()) SolverState {
-        .jointQuery = ctx.query<JointConstraint>(),
-        .contactQuery = ctx.query<ContactConstraint>(),
+        .jointQuery = ctx.query<JointConstraint, TGSJointState>(),
+        .contactQuery = ctx.query<ContactConstraint, TGSContactState>(),
+        .contactSoftness = makeSoft(
+            contact_hertz, consts::contactDampingRatio, h),
+        .jointSoftness = makeSoft(
+            2.f * joint_hertz, consts::jointDampingRatio, h),
+        .contactCache = {
+            .entries = cache_entries,
+            .occupiedSlots = (int32_t *)rawAlloc(
+                sizeof(int32_t) * cache_capacity / 2),
+            .numOccupied = 0,
+            .capacity = cache_capacity,
+        },
     };
 }
 
+void shutdown(Context &ctx)
+{
+    ContactCache &cache = ctx.singleton<SolverState>().contactCache;
+    rawDealloc(cache.entries);
+    rawDealloc(cache.occupiedSlots);
+}
+
 void getSolverArchetypeIDs(uint32_t *contact_archetype_id,
                            uint32_t *joint_archetype_id)
 {
@@ -56,38 +188,226 @@ void getSolverArchetypeIDs(uint32_t *contact_archetype_id,
     *joint_archetype_id = TypeTracker::typeID<Joint>();
 }
 
-static inline void solveJoints(Context &ctx,
-                               SolverState &solver,
-                               bool use_bias)
+static inline uint32_t cacheSlot(const ContactCache &cache,
+                                 Entity ref, Entity alt)
 {
-    (void)ctx;
-    (void)solver;
-    (void)use_bias;
+    return utils::int32Hash((uint32_t)ref.id * 0x9E37'79B1_u32 ^
+                            (uint32_t)alt.id) & uint32_t(cache.capacity - 1);
 }
 
-static inline void solveContacts(Context &ctx,
-                                 SolverState &solver,
-                                 bool use_bias)
+static inline const ContactCache::Entry * findCacheEntry(
+    const ContactCache &cache, Entity ref, Entity alt)
 {
-    ctx.iterateQuery(solver.contactQuery, [&](ContactConstraint &contact) {
-        // Solve contact
-        (void)contact;
-        (void)use_bias;
-    });
+    uint32_t mask = uint32_t(cache.capacity - 1);
+    for (uint32_t slot = cacheSlot(cache, ref, alt); ;
+         slot = (slot + 1) & mask) {
+        const ContactCache::Entry &entry = cache.entries[slot];
+        if (entry.ref == Entity::none()) {
+            return nullptr;
+        }
+
+        if (entry.ref == ref && entry.alt == alt) {
+            return &entry;
+        }
+    }
+}
+
+static inline void getBodyMass(Context &ctx,
+                               const ObjectManager &obj_mgr,
+                               Loc loc,
+                               float *inv_m,
+                               Diag3x3 *inv_I)
+{
+    ResponseType response_type =
+        ctx.getDirect<ResponseType>(RGDCols::ResponseType, loc);
+
+    if (response_type == ResponseType::Static) {
+        *inv_m = 0.f;
+        *inv_I = Diag3x3 { 0.f, 0.f, 0.f };
+        return;
+    }
+
+    ObjectID obj_id = ctx.getDirect<ObjectID>(RGDCols::ObjectID, loc);
+    const RigidBodyMetadata &metadata = obj_mgr.metadata[obj_id.idx];
+
+    *inv_m = metadata.mass.invMass;
+    *inv_I = Diag3x3::fromVec(metadata.mass.invInertiaTensor);
+}
+
+// Applies the world space inverse inertia tensor of a body with local
+// inverse inertia inv_I and orientation q to v
+static inline Vector3 applyInvInertia(Quat q, Diag3x3 inv_I, Vector3 v)
+{
+    return q.rotateVec(inv_I * q.inv().rotateVec(v));
+}
+
+static inline float effectiveMass(float inv_m1, float inv_m2,
+                                  Diag3x3 inv_I1, Diag3x3 inv_I2,
+                                  Quat q1, Quat q2,
+                                  Vector3 r1, Vector3 r2,
+                                  Vector3 dir)
+{
+    Vector3 r1_x_d = cross(r1, dir);
+    Vector3 r2_x_d = cross(r2, dir);
+
+    float k = inv_m1 + inv_m2 +
+        dot(r1_x_d, applyInvInertia(q1, inv_I1, r1_x_d)) +
+        dot(r2_x_d, applyInvInertia(q2, inv_I2, r2_x_d));
+
+    return k > 0.f ? 1.f / k : 0.f;
+}
+
+// Applies impulse to body 2 at r2 and -impulse to body 1 at r1
+static inline void applyImpulse(Velocity &vel1, Velocity &vel2,
+                                float inv_m1, float inv_m2,
+                                Diag3x3 inv_I1, Diag3x3 inv_I2,
+                                Quat q1, Quat q2,
+                                Vector3 r1, Vector3 r2,
+                                Vector3 impulse)
+{
+    vel1.linear -= inv_m1 * impulse;
+    vel1.angular -= applyInvInertia(q1, inv_I1, cross(r1, impulse));
+
+    vel2.linear += inv_m2 * impulse;
+    vel2.angular += applyInvInertia(q2, inv_I2, cross(r2, impulse));
+}
+
+static inline Vector3 relativeVelocity(const Velocity &vel1,
+                                       const Velocity &vel2,
+                                       Vector3 r1, Vector3 r2)
+{
+    return (vel2.linear + cross(vel2.angular, r2)) -
+        (vel1.linear + cross(vel1.angular, r1));
 }
 
+// The normal points from ref into alt. Each contact point lies on the
+// surface of ref, the matching point on alt is depth along -normal.
 inline void prepareContacts(Context &ctx,
-                            ContactConstraint constraint)
+                            ContactConstraint contact,
+                            TGSContactState &state)
 {
-    (void)ctx;
-    (void)constraint;
+    const ObjectManager &obj_mgr = *ctx.singleton<ObjectData>().mgr;
+    const SolverState &solver = ctx.singleton<SolverState>();
+
+    Vector3 x1 = ctx.getDirect<Position>(RGDCols::Position, contact.ref);
+    Vector3 x2 = ctx.getDirect<Position>(RGDCols::Position, contact.alt);
+    Quat q1 = ctx.getDirect<Rotation>(RGDCols::Rotation, contact.ref);
+    Quat q2 = ctx.getDirect<Rotation>(RGDCols::Rotation, contact.alt);
+
+    getBodyMass(ctx, obj_mgr, contact.ref,
+                &state.invMass1, &state.invInertia1);
+    getBodyMass(ctx, obj_mgr, contact.alt,
+                &state.invMass2, &state.invInertia2);
+
+    {
+        ObjectID obj_id1 =
+            ctx.getDirect<ObjectID>(RGDCols::ObjectID, contact.ref);
+        ObjectID obj_id2 =
+            ctx.getDirect<ObjectID>(RGDCols::ObjectID, contact.alt);
+
+        state.friction = 0.5f * (obj_mgr.metadata[obj_id1.idx].friction.muD +
+                                 obj_mgr.metadata[obj_id2.idx].friction.muD);
+    }
+
+    Vector3 n = contact.normal;
+    Vector3 t1, t2;
+    n.frame(&t1, &t2);
+    t1 = normalize(t1);
+    t2 = cross(n, t1);
+
+    state.tangents[0] = t1;
+    state.tangents[1] = t2;
+
+    Entity ref_entity = ctx.getDirect<Entity>(0, contact.ref);
+    Entity alt_entity = ctx.getDirect<Entity>(0, contact.alt);
+    const ContactCache::Entry *cached =
+        findCacheEntry(solver.contactCache, ref_entity, alt_entity);
+
+    // The narrowphase may pick the other body's face as the reference
+    // from one step to the next. Cached points are then on alt, and the
+    // tangent impulses act in the opposite direction.
+    bool cached_swapped = false;
+    if (cached == nullptr) {
+        cached = findCacheEntry(solver.contactCache, alt_entity, ref_entity);
+        cached_swapped = true;
+    }
+
+    for (CountT i = 0; i < contact.numPoints; i++) {
+        Vector3 p1 = contact.points[i].xyz();
+        Vector3 p2 = p1 - contact.points[i].w * n;
+
+        Vector3 r1 = p1 - x1;
+        Vector3 r2 = p2 - x2;
+
+        state.localAnchors1[i] = q1.inv().rotateVec(r1);
+        state.localAnchors2[i] = q2.inv().rotateVec(r2);
+
+        state.normalMass[i] = effectiveMass(
+            state.invMass1, state.invMass2,
+            state.invInertia1, state.invInertia2,
+            q1, q2, r1, r2, n);
+        state.tangentMass[i][0] = effectiveMass(
+            state.invMass1, state.invMass2,
+            state.invInertia1, state.invInertia2,
+            q1, q2, r1, r2, t1);
+        state.tangentMass[i][1] = effectiveMass(
+            state.invMass1, state.invMass2,
+            state.invInertia1, state.invInertia2,
+            q1, q2, r1, r2, t2);
+
+        state.normalImpulse[i] = 0.f;
+        state.tangentImpulse[i][0] = 0.f;
+        state.tangentImpulse[i][1] = 0.f;
+
+        if (cached == nullptr) {
+            continue;
+        }
+
+        const float max_dist2 =
+            consts::cacheMatchDistance * consts::cacheMatchDistance;
+
+        float best_dist2 = max_dist2;
+        CountT best_match = -1;
+        for (CountT j = 0; j < cached->numPoints; j++) {
+            float dist2 = (cached->points[j].localPos - (cached_swapped ?
+                state.localAnchors2[i] : state.localAnchors1[i])).length2();
+            if (dist2 < best_dist2) {
+                best_dist2 = dist2;
+                best_match = j;
+            }
+        }
+
+        if (best_match != -1) {
+            const ContactCache::Point &pt = cached->points[best_match];
+            Vector3 tangent_impulse = cached_swapped ?
+                -pt.tangentImpulse : pt.tangentImpulse;
+
+            state.normalImpulse[i] = pt.normalImpulse;
+            state.tangentImpulse[i][0] = dot(tangent_impulse, t1);
+            state.tangentImpulse[i][1] = dot(tangent_impulse, t2);
+        }
+    }
 }
 
 inline void prepareJoints(Context &ctx,
-                          JointConstraint constraint)
+                          JointConstraint joint,
+                          TGSJointState &state)
 {
-    (void)ctx;
-    (void)constraint;
+    const ObjectManager &obj_mgr = *ctx.singleton<ObjectData>().mgr;
+
+    state.l1 = ctx.loc(joint.e1);
+    state.l2 = ctx.loc(joint.e2);
+
+    getBodyMass(ctx, obj_mgr, state.l1,
+                &state.invMass1, &state.invInertia1);
+    getBodyMass(ctx, obj_mgr, state.l2,
+                &state.invMass2, &state.invInertia2);
+
+    // Joint entities are created by the generic physics code, which
+    // doesn't know about this solver's state, so joint impulses only warm
+    // start the substeps of a single step.
+    state.linearImpulse = Vector3::zero();
+    state.angularImpulse = Vector3::zero();
 }
 
 inline void integrateVelocities(Context &ctx,
@@ -96,9 +416,11 @@ inline void integrateVelocities(Context &ctx,
                                 ExternalForce ext_force,
                                 ExternalTorque ext_torque,
                                 ObjectID obj_id,
+                                SleepState &sleep_state,
                                 Velocity &vel)
 {
-    if (response_type == ResponseType::Static) {
+    if (response_type == ResponseType::Static ||
+            sleep::checkAsleep(sleep_state, vel, ext_force, ext_torque)) {
         return;
     }
 
@@ -133,7 +455,7 @@ inline void integrateVelocities(Context &ctx,
 
     // Integrate omega in local space
     omega_local +=
-        h * inv_I * (tau_ext_local - (cross(omega_local, I * omega)));
+        h * inv_I * (tau_ext_local - (cross(omega_local, I * omega_local)));
 
     omega = q.rotateVec(omega_local);
 
@@ -143,18 +465,323 @@ inline void integrateVelocities(Context &ctx,
     vel.angular = omega;
 }
 
+// The passes below that write body velocities iterate over all the
+// constraints in a world from a single invocation, since constraints
+// sharing a body can't be solved concurrently.
+
 inline void warmStartContacts(Context &ctx,
-                              ContactConstraint constraint)
+                              SolverState &solver)
+{
+    ctx.iterateQuery(solver.contactQuery,
+    [&](ContactConstraint &contact, TGSContactState &state) {
+        Velocity &vel1 =
+            ctx.getDirect<Velocity>(RGDCols::Velocity, contact.ref);
+        Velocity &vel2 =
+            ctx.getDirect<Velocity>(RGDCols::Velocity, contact.alt);
+        Quat q1 = ctx.getDirect<Rotation>(RGDCols::Rotation, contact.ref);
+        Quat q2 = ctx.getDirect<Rotation>(RGDCols::Rotation, contact.alt);
+
+        for (CountT i = 0; i < contact.numPoints; i++) {
+            Vector3 r1 = q1.rotateVec(state.localAnchors1[i]);
+            Vector3 r2 = q2.rotateVec(state.localAnchors2[i]);
+
+            Vector3 impulse = state.normalImpulse[i] * contact.normal +
+                state.tangentImpulse[i][0] * state.tangents[0] +
+                state.tangentImpulse[i][1] * state.tangents[1];
+
+            applyImpulse(vel1, vel2,
+                         state.invMass1, state.invMass2,
+                         state.invInertia1, state.invInertia2,
+                         q1, q2, r1, r2, impulse);
+        }
+    });
+}
+
+static inline float solveJointAxis(Velocity &vel1, Velocity &vel2,
+                                   const TGSJointState &state,
+                                   Quat q1, Quat q2,
+                                   Vector3 r1, Vector3 r2,
+                                   Vector3 axis,
+                                   float c,
+                                   float accumulated,
+                                   Softness softness,
+                                   bool use_bias)
+{
+    float mass = effectiveMass(state.invMass1, state.invMass2,
+                               state.invInertia1, state.invInertia2,
+                               q1, q2, r1, r2, axis);
+
+    float bias = 0.f;
+    float mass_scale = 1.f;
+    float impulse_scale = 0.f;
+    if (use_bias) {
+        bias = softness.biasRate * c;
+        mass_scale = softness.massScale;
+        impulse_scale = softness.impulseScale;
+    }
+
+    float cdot = dot(relativeVelocity(vel1, vel2, r1, r2), axis);
+    float impulse = -mass * mass_scale * (cdot + bias) -
+        impulse_scale * accumulated;
+
+    applyImpulse(vel1, vel2,
+                 state.invMass1, state.invMass2,
+                 state.invInertia1, state.invInertia2,
+                 q1, q2, r1, r2, impulse * axis);
+
+    return impulse;
+}
+
+static inline float solveJointAngularAxis(Velocity &vel1, Velocity &vel2,
+                                          const TGSJointState &state,
+                                          Quat q1, Quat q2,
+                                          Vector3 axis,
+                                          float c,
+                                          float accumulated,
+                                          Softness softness,
+                                          bool use_bias)
+{
+    float k = dot(axis, applyInvInertia(q1, state.invInertia1, axis)) +
+        dot(axis, applyInvInertia(q2, state.invInertia2, axis));
+    if (k == 0.f) {
+        return 0.f;
+    }
+
+    float bias = 0.f;
+    float mass_scale = 1.f;
+    float impulse_scale = 0.f;
+    if (use_bias) {
+        bias = softness.biasRate * c;
+        mass_scale = softness.massScale;
+        impulse_scale = softness.impulseScale;
+    }
+
+    float cdot = dot(vel2.angular - vel1.angular, axis);
+    float impulse = -mass_scale * (cdot + bias) / k -
+        impulse_scale * accumulated;
+
+    vel1.angular -= applyInvInertia(q1, state.invInertia1, impulse * axis);
+    vel2.angular += applyInvInertia(q2, state.invInertia2, impulse * axis);
+
+    return impulse;
+}
+
+static inline void solveJoints(Context &ctx,
+                               SolverState &solver,
+                               bool use_bias)
 {
-    (void)ctx;
-    (void)constraint;
+    ctx.iterateQuery(solver.jointQuery,
+    [&](JointConstraint &joint, TGSJointState &state) {
+        Velocity &vel1 = ctx.getDirect<Velocity>(RGDCols::Velocity, state.l1);
+        Velocity &vel2 = ctx.getDirect<Velocity>(RGDCols::Velocity, state.l2);
+        Vector3 x1 = ctx.getDirect<Position>(RGDCols::Position, state.l1);
+        Vector3 x2 = ctx.getDirect<Position>(RGDCols::Position, state.l2);
+        Quat q1 = ctx.getDirect<Rotation>(RGDCols::Rotation, state.l1);
+        Quat q2 = ctx.getDirect<Rotation>(RGDCols::Rotation, state.l2);
+
+        Softness softness = solver.jointSoftness;
+
+        Vector3 r1 = q1.rotateVec(joint.r1);
+        Vector3 r2 = q2.rotateVec(joint.r2);
+
+        // Angular constraints
+        switch (joint.type) {
+        case JointConstraint::Type::Fixed: {
+            Quat orientation1 = (q1 * joint.fixed.attachRot1).normalize();
+            Quat orientation2 = (q2 * joint.fixed.attachRot2).normalize();
+
+            // Rotation of 2's attachment frame relative to 1's
+            Quat diff = orientation2 * orientation1.inv();
+            Vector3 angle_err =
+                2.f * Vector3 { diff.x, diff.y, diff.z };
+            if (diff.w < 0.f) {
+                angle_err = -angle_err;
+            }
+
+            // The fixed joint also holds its points separation apart
+            // along the attachment's forward axis
+            r1 += orientation1.rotateVec(
+                joint.fixed.separation * math::fwd);
+
+            const Vector3 axes[3] {
+                math::right,
+                math::fwd,
+                math::up,
+            };
+
+            for (CountT i = 0; i < 3; i++) {
+                state.angularImpulse[i] += solveJointAngularAxis(
+                    vel1, vel2, state, q1, q2, axes[i], angle_err[i],
+                    state.angularImpulse[i], softness, use_bias);
+            }
+        } break;
+        case JointConstraint::Type::Hinge: {
+            Vector3 a1 = q1.rotateVec(joint.hinge.a1Local);
+            Vector3 a2 = q2.rotateVec(joint.hinge.a2Local);
+
+            // Only rotation about the hinge axis is free
+            Vector3 b, c;
+            a1.frame(&b, &c);
+            b = normalize(b);
+            c = cross(a1, b);
+
+            Vector3 angle_err = cross(a1, a2);
+
+            state.angularImpulse[0] += solveJointAngularAxis(
+                vel1, vel2, state, q1, q2, b, dot(angle_err, b),
+                state.angularImpulse[0], softness, use_bias);
+            state.angularImpulse[1] += solveJointAngularAxis(
+                vel1, vel2, state, q1, q2, c, dot(angle_err, c),
+                state.angularImpulse[1], softness, use_bias);
+        } break;
+        default: MADRONA_UNREACHABLE();
+        }
+
+        // Point constraint
+        Vector3 pos_err = (x2 + r2) - (x1 + r1);
+
+        const Vector3 axes[3] {
+            math::right,
+            math::fwd,
+            math::up,
+        };
+
+        for (CountT i = 0; i < 3; i++) {
+            state.linearImpulse[i] += solveJointAxis(
+                vel1, vel2, state, q1, q2, r1, r2, axes[i], pos_err[i],
+                state.linearImpulse[i], softness, use_bias);
+        }
+    });
 }
 
 inline void warmStartJoints(Context &ctx,
-                            JointConstraint constraint)
+                            SolverState &solver)
+{
+    ctx.iterateQuery(solver.jointQuery,
+    [&](JointConstraint &joint, TGSJointState &state) {
+        Velocity &vel1 = ctx.getDirect<Velocity>(RGDCols::Velocity, state.l1);
+        Velocity &vel2 = ctx.getDirect<Velocity>(RGDCols::Velocity, state.l2);
+        Quat q1 = ctx.getDirect<Rotation>(RGDCols::Rotation, state.l1);
+        Quat q2 = ctx.getDirect<Rotation>(RGDCols::Rotation, state.l2);
+
+        Vector3 r1 = q1.rotateVec(joint.r1);
+        Vector3 r2 = q2.rotateVec(joint.r2);
+
+        if (joint.type == JointConstraint::Type::Fixed) {
+            Quat orientation1 = (q1 * joint.fixed.attachRot1).normalize();
+            r1 += orientation1.rotateVec(
+                joint.fixed.separation * math::fwd);
+        }
+
+        applyImpulse(vel1, vel2,
+                     state.invMass1, state.invMass2,
+                     state.invInertia1, state.invInertia2,
+                     q1, q2, r1, r2, state.linearImpulse);
+
+        Vector3 angular_impulse;
+        if (joint.type == JointConstraint::Type::Fixed) {
+            angular_impulse = state.angularImpulse;
+        } else {
+            // Hinge impulses are along the frame of the hinge axis
+            Vector3 a1 = q1.rotateVec(joint.hinge.a1Local);
+            Vector3 b, c;
+            a1.frame(&b, &c);
+            b = normalize(b);
+            c = cross(a1, b);
+
+            angular_impulse = state.angularImpulse.x * b +
+                state.angularImpulse.y * c;
+        }
+
+        vel1.angular -= applyInvInertia(q1, state.invInertia1,
+                                        angular_impulse);
+        vel2.angular += applyInvInertia(q2, state.invInertia2,
+                                        angular_impulse);
+    });
+}
+
+static inline void solveContacts(Context &ctx,
+                                 SolverState &solver,
+                                 bool use_bias)
 {
-    (void)ctx;
-    (void)constraint;
+    const auto &physics_sys = ctx.singleton<PhysicsSystemState>();
+    float inv_h = 1.f / physics_sys.h;
+    Softness softness = solver.contactSoftness;
+
+    ctx.iterateQuery(solver.contactQuery,
+    [&](ContactConstraint &contact, TGSContactState &state) {
+        Velocity &vel1 =
+            ctx.getDirect<Velocity>(RGDCols::Velocity, contact.ref);
+        Velocity &vel2 =
+            ctx.getDirect<Velocity>(RGDCols::Velocity, contact.alt);
+        Vector3 x1 = ctx.getDirect<Position>(RGDCols::Position, contact.ref);
+        Vector3 x2 = ctx.getDirect<Position>(RGDCols::Position, contact.alt);
+        Quat q1 = ctx.getDirect<Rotation>(RGDCols::Rotation, contact.ref);
+        Quat q2 = ctx.getDirect<Rotation>(RGDCols::Rotation, contact.alt);
+
+        Vector3 n = contact.normal;
+
+        for (CountT i = 0; i < contact.numPoints; i++) {
+            Vector3 r1 = q1.rotateVec(state.localAnchors1[i]);
+            Vector3 r2 = q2.rotateVec(state.localAnchors2[i]);
+
+            // Separation with the current body positions, negative when
+            // penetrating
+            float s = dot((x2 + r2) - (x1 + r1), n);
+
+            float bias = 0.f;
+            float mass_scale = 1.f;
+            float impulse_scale = 0.f;
+            if (s > 0.f) {
+                // Speculative, only remove the approaching velocity
+                bias = s * inv_h;
+            } else if (use_bias) {
+                bias = fmaxf(softness.biasRate * s,
+                             -consts::contactPushMaxVelocity);
+                mass_scale = softness.massScale;
+                impulse_scale = softness.impulseScale;
+            }
+
+            float vn = dot(relativeVelocity(vel1, vel2, r1, r2), n);
+
+            float impulse = -state.normalMass[i] * mass_scale * (vn + bias) -
+                impulse_scale * state.normalImpulse[i];
+
+            float new_impulse = fmaxf(state.normalImpulse[i] + impulse, 0.f);
+            impulse = new_impulse - state.normalImpulse[i];
+            state.normalImpulse[i] = new_impulse;
+
+            applyImpulse(vel1, vel2,
+                         state.invMass1, state.invMass2,
+                         state.invInertia1, state.invInertia2,
+                         q1, q2, r1, r2, impulse * n);
+        }
+
+        for (CountT i = 0; i < contact.numPoints; i++) {
+            Vector3 r1 = q1.rotateVec(state.localAnchors1[i]);
+            Vector3 r2 = q2.rotateVec(state.localAnchors2[i]);
+
+            float max_friction = state.friction * state.normalImpulse[i];
+
+            for (CountT j = 0; j < 2; j++) {
+                Vector3 t = state.tangents[j];
+                float vt = dot(relativeVelocity(vel1, vel2, r1, r2), t);
+
+                float impulse = -state.tangentMass[i][j] * vt;
+
+                float new_impulse = fminf(fmaxf(
+                    state.tangentImpulse[i][j] + impulse, -max_friction),
+                    max_friction);
+                impulse = new_impulse - state.tangentImpulse[i][j];
+                state.tangentImpulse[i][j] = new_impulse;
+
+                applyImpulse(vel1, vel2,
+                             state.invMass1, state.invMass2,
+                             state.invInertia1, state.invInertia2,
+                             q1, q2, r1, r2, impulse * t);
+            }
+        }
+    });
 }
 
 inline void solveJointsBiased(Context &ctx,
@@ -172,8 +799,15 @@ inline void solveContactsBiased(Context &ctx,
 inline void integratePositions(Context &ctx,
                                Position &pos,
                                Rotation &rot,
+                               SleepState sleep_state,
                                Velocity vel)
 {
+    // Contact impulses on a sleeping body only take effect once
+    // integrateVelocities has woken it up on the next substep
+    if (sleep_state.asleep) {
+        return;
+    }
+
     Vector3 x = pos;
     Quat q = rot;
 
@@ -206,6 +840,64 @@ inline void solveContactsUnbiased(Context &ctx,
     solveContacts(ctx, solver, false);
 }
 
+// Saves this step's accumulated contact impulses to warm start the
+// contacts of the next step
+inline void storeContactImpulses(Context &ctx,
+                                 SolverState &solver)
+{
+    ContactCache &cache = solver.contactCache;
+
+    for (int32_t i = 0; i < cache.numOccupied; i++) {
+        cache.entries[cache.occupiedSlots[i]].ref = Entity::none();
+    }
+    cache.numOccupied = 0;
+
+    uint32_t mask = uint32_t(cache.capacity - 1);
+
+    ctx.iterateQuery(solver.contactQuery,
+    [&](ContactConstraint &contact, TGSContactState &state) {
+        if (cache.numOccupied == cache.capacity / 2) {
+            return;
+        }
+
+        Entity ref = ctx.getDirect<Entity>(0, contact.ref);
+        Entity alt = ctx.getDirect<Entity>(0, contact.alt);
+
+        uint32_t slot = cacheSlot(cache, ref, alt);
+        while (true) {
+            ContactCache::Entry &entry = cache.entries[slot];
+
+            if (entry.ref == Entity::none()) {
+                entry.ref = ref;
+                entry.alt = alt;
+                entry.numPoints = 0;
+                cache.occupiedSlots[cache.numOccupied++] = (int32_t)slot;
+                break;
+            }
+
+            // The narrowphase can emit several manifolds for one pair
+            // (one per primitive pair). Only the first is cached.
+            if (entry.ref == ref && entry.alt == alt) {
+                return;
+            }
+
+            slot = (slot + 1) & mask;
+        }
+
+        ContactCache::Entry &entry = cache.entries[slot];
+        entry.numPoints = contact.numPoints;
+        for (CountT i = 0; i < contact.numPoints; i++) {
+            entry.points[i] = ContactCache::Point {
+                .localPos = state.localAnchors1[i],
+                .normalImpulse = state.normalImpulse[i],
+                .tangentImpulse =
+                    state.tangentImpulse[i][0] * state.tangents[0] +
+                    state.tangentImpulse[i][1] * state.tangents[1],
+            };
+        }
+    });
+}
+
 TaskGraphNodeID setupTGSSolverTasks(
     TaskGraphBuilder &builder,
     TaskGraphNodeID broadphase,
@@ -215,19 +907,23 @@ TaskGraphNodeID setupTGSSolverTasks(
     auto clear_broadphase = builder.addToGraph<
         ClearTmpNode<CandidateTemporary>>({run_narrowphase});
 
-    auto constraints_ready = clear_broadphase;
-#ifdef MADRONA_GPU_MODE
     // The GPU backend requires constraints to be sorted before iterateQuery
     // can be called. This requires sorting both Contact and Joint entities.
-    constraints_ready = builder.addToGraph<SortArchetypeNode<Contact, WorldID>>(
-        {constraints_ready});
+    // On the CPU the world sorts are no-ops, and there's no sort scratch
+    // in the tmp allocator to reset.
+    auto constraints_ready =
+        builder.addToGraph<SortArchetypeNode<Contact, WorldID>>(
+            {clear_broadphase});
 
+#ifdef MADRONA_GPU_MODE
     constraints_ready =
         builder.addToGraph<ResetTmpAllocNode>({constraints_ready});
+#endif
 
     constraints_ready = builder.addToGraph<SortArchetypeNode<Joint, WorldID>>(
         {constraints_ready});
 
+#ifdef MADRONA_GPU_MODE
     constraints_ready =
         builder.addToGraph<ResetTmpAllocNode>({constraints_ready});
 #endif
@@ -236,14 +932,16 @@ TaskGraphNodeID setupTGSSolverTasks(
 
     cur_node = builder.addToGraph<ParallelForNode<Context,
         prepareContacts,
-            ContactConstraint
+            ContactConstraint,
+            TGSContactState
         >>({cur_node});
 
     cur_node = builder.addToGraph<ParallelForNode<Context,
         prepareJoints,
-            JointConstraint
+            JointConstraint,
+            TGSJointState
         >>({cur_node});
-            
+
     for (CountT i = 0; i < num_substeps; i++) {
         cur_node = builder.addToGraph<ParallelForNode<Context,
             integrateVelocities,
@@ -252,19 +950,20 @@ TaskGraphNodeID setupTGSSolverTasks(
                 ExternalForce,
                 ExternalTorque,
                 ObjectID,
+                SleepState,
                 Velocity
             >>({cur_node});
 
         cur_node = builder.addToGraph<ParallelForNode<Context,
             warmStartContacts,
-                ContactConstraint
+                SolverState
             >>({cur_node});
 
         cur_node = builder.addToGraph<ParallelForNode<Context,
-            warmStartContacts,
-                ContactConstraint
+            warmStartJoints,
+                SolverState
             >>({cur_node});
-         
+
         cur_node = builder.addToGraph<ParallelForNode<Context,
             solveJointsBiased,
                 SolverState
@@ -279,6 +978,7 @@ TaskGraphNodeID setupTGSSolverTasks(
             integratePositions,
                 Position,
                 Rotation,
+                SleepState,
                 Velocity
             >>({cur_node});
 
@@ -293,8 +993,15 @@ TaskGraphNodeID setupTGSSolverTasks(
             >>({cur_node});
     }
 
-    // For now, we don't have any persistent contacts support, so clear
-    // the contacts (free the memory).
+    cur_node = builder.addToGraph<ParallelForNode<Context,
+        storeContactImpulses,
+            SolverState
+        >>({cur_node});
+
+    cur_node = sleep::setupTasks(builder, {cur_node});
+
+    // Contacts are regenerated by the narrowphase every step, their
+    // impulses live on in the contact cache.
     auto clear_contacts = builder.addToGraph<
         ClearTmpNode<Contact>>({cur_node});
 
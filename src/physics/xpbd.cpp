@@ -1,25 +1,57 @@
 #include <madrona/physics.hpp>
 #include <madrona/context.hpp>
 
+#ifndef MADRONA_GPU_MODE
+#include <madrona/simd_math.hpp>
+#endif
+
 #include "physics_impl.hpp"
 #include "xpbd.hpp"
 
+#include <utility>
+
 namespace madrona::phys::xpbd {
 
+namespace consts {
+
+// Contacts are split into this many colors, within a color no two
+// contacts share a non-static body so each color can be solved in
+// parallel. Contacts that don't fit in any color are solved serially
+// after the colored ones, along with all joints.
+inline constexpr int32_t numContactColors = 8;
+// Worlds with fewer contacts than this solve everything serially, in the
+// order the narrowphase produced the contacts
+inline constexpr CountT minColoredContacts = 128;
+
+}
+
 struct XPBDContactState {
     float lambdaN[4];
 };
 
+// See colorContacts. Separate from XPBDContactState so it can be used as
+// the sort key for grouping contacts by color.
+struct ContactColor {
+    int32_t color;
+};
+
 struct Contact : Archetype<
     ContactConstraint,
-    XPBDContactState 
+    XPBDContactState,
+    ContactColor
 > {};
 
 struct Joint : Archetype<JointConstraint> {};
 
 struct SolverState {
     Query<JointConstraint> jointQuery;
-    Query<ContactConstraint, XPBDContactState> contactQuery;
+    Query<ContactConstraint, XPBDContactState, ContactColor> contactQuery;
+    // Colors already used by each body's contacts, indexed by LeafID
+    uint8_t *bodyColorMasks;
+    // Once the contacts are sorted by color, the contacts of color c are
+    // rows [colorOffsets[c], colorOffsets[c + 1]). The last range holds
+    // the serially solved contacts.
+    uint32_t colorOffsets[consts::numContactColors + 2];
 };
 
 struct SubstepPrevState {
@@ -51,6 +83,7 @@ namespace XPBDCols {
 
 using namespace base;
 using namespace math;
+using broadphase::LeafID;
 
 static inline bool hasNaN(Vector3 v)
 {
@@ -105,6 +138,7 @@ inline void substepRigidBodies(Context &ctx,
                                ResponseType response_type,
                                ExternalForce &ext_force,
                                ExternalTorque &ext_torque,
+                               SleepState &sleep_state,
                                SubstepPrevState &prev_state,
                                PreSolvePositional &presolve_pos,
                                PreSolveVelocity &presolve_vel)
@@ -115,7 +149,11 @@ inline void substepRigidBodies(Context &ctx,
     Vector3 v = vel.linear;
     Vector3 omega = vel.angular;
 
-    if (response_type == ResponseType::Static) {
+    // Sleeping bodies are held in place like static bodies, but keep their
+    // mass so an awake body pushing into them moves them and wakes them up
+    bool asleep = sleep::checkAsleep(sleep_state, vel, ext_force, ext_torque);
+
+    if (response_type == ResponseType::Static || asleep) {
         // FIXME: currently presolve_pos and prev_state need to be set every
         // frame even for static objects. A better solution would be on
         // creation / making a non-static object static, these variables are
@@ -184,6 +222,140 @@ inline void substepRigidBodies(Context &ctx,
     presolve_vel.omega = omega;
 }
 
+#ifndef MADRONA_GPU_MODE
+// CPU version of substepRigidBodies that integrates FloatN::width rows at
+// a time. Static and sleeping rows go through the same math with their
+// results discarded by select.
+inline void substepRigidBodiesChunk(Context &ctx,
+                                    CountT num_rows,
+                                    Position *positions,
+                                    Rotation *rotations,
+                                    const Velocity *velocities,
+                                    const ObjectID *obj_ids,
+                                    const ResponseType *response_types,
+                                    const ExternalForce *ext_forces,
+                                    const ExternalTorque *ext_torques,
+                                    SleepState *sleep_states,
+                                    SubstepPrevState *prev_states,
+                                    PreSolvePositional *presolve_positions,
+                                    PreSolveVelocity *presolve_velocities)
+{
+    const auto &physics_sys = ctx.singleton<PhysicsSystemState>();
+    const ObjectManager &obj_mgr = *ctx.singleton<ObjectData>().mgr;
+
+    const FloatN h = FloatN::splat(physics_sys.h);
+    const Vector3N h_g = Vector3N::splat(physics_sys.h * physics_sys.g);
+
+    for (CountT base = 0; base < num_rows; base += FloatN::width) {
+        CountT num_lanes = std::min(FloatN::width, num_rows - base);
+
+        // The sleep check and the mass properties are per row lookups.
+        // Inactive lanes keep zero mass properties.
+        alignas(64) float active_lanes[FloatN::width] = {};
+        alignas(64) float gravity_lanes[FloatN::width] = {};
+        alignas(64) float inv_m_lanes[FloatN::width] = {};
+        alignas(64) float inv_I_lanes[3][FloatN::width] = {};
+
+        for (CountT lane = 0; lane < num_lanes; lane++) {
+            CountT row = base + lane;
+
+            bool asleep = sleep::checkAsleep(sleep_states[row],
+                velocities[row], ext_forces[row], ext_torques[row]);
+
+            ResponseType response_type = response_types[row];
+            if (response_type == ResponseType::Static || asleep) {
+                continue;
+            }
+
+            const RigidBodyMetadata &metadata =
+                obj_mgr.metadata[obj_ids[row].idx];
+
+            active_lanes[lane] = 1.f;
+            gravity_lanes[lane] =
+                response_type == ResponseType::Dynamic ? 1.f : 0.f;
+            inv_m_lanes[lane] = metadata.mass.invMass;
+            inv_I_lanes[0][lane] = metadata.mass.invInertiaTensor.x;
+            inv_I_lanes[1][lane] = metadata.mass.invInertiaTensor.y;
+            inv_I_lanes[2][lane] = metadata.mass.invInertiaTensor.z;
+        }
+
+        MaskN active = FloatN::load(active_lanes) != FloatN::zero();
+
+        Vector3N x = Vector3N::loadAoS(positions + base, num_lanes);
+        QuatN q = QuatN::loadAoS(rotations + base, num_lanes);
+
+        Vector3N v = Vector3N::loadStrided(&velocities[base].linear,
+            sizeof(Velocity), num_lanes);
+        Vector3N omega = Vector3N::loadStrided(&velocities[base].angular,
+            sizeof(Velocity), num_lanes);
+
+        Vector3N ext_force = Vector3N::loadAoS(ext_forces + base, num_lanes);
+        Vector3N ext_torque =
+            Vector3N::loadAoS(ext_torques + base, num_lanes);
+
+        // FIXME: see substepRigidBodies, prev_state and presolve_pos are
+        // also set for static objects every frame
+        x.storeStrided(&prev_states[base].prevPosition,
+                       sizeof(SubstepPrevState), num_lanes);
+        q.storeStrided(&prev_states[base].prevRotation,
+                       sizeof(SubstepPrevState), num_lanes);
+
+        FloatN inv_m = FloatN::load(inv_m_lanes);
+        Vector3N inv_I {
+            FloatN::load(inv_I_lanes[0]),
+            FloatN::load(inv_I_lanes[1]),
+            FloatN::load(inv_I_lanes[2]),
+        };
+
+        v += h_g * FloatN::load(gravity_lanes);
+        v += h * inv_m * ext_force;
+
+        Vector3N new_x = x + h * v;
+
+        const FloatN zero = FloatN::zero();
+        const FloatN one = FloatN::splat(1.f);
+        Vector3N I {
+            select(inv_I.x == zero, zero, one / inv_I.x),
+            select(inv_I.y == zero, zero, one / inv_I.y),
+            select(inv_I.z == zero, zero, one / inv_I.z),
+        };
+
+        QuatN to_local = q.inv();
+
+        Vector3N tau_ext_local = to_local.rotateVec(ext_torque);
+        Vector3N omega_local = to_local.rotateVec(omega);
+
+        Vector3N I_omega_local = mul(I, omega_local);
+
+        omega_local += h * mul(inv_I,
+            tau_ext_local - cross(omega_local, I_omega_local));
+
+        omega = q.rotateVec(omega_local);
+
+        QuatN apply_omega = QuatN::fromAngularVec(0.5f * h * omega);
+
+        QuatN new_q = (q + apply_omega * q).normalize();
+
+        new_x = select(active, new_x, x);
+        new_q = select(active, new_q, q);
+        v = select(active, v, Vector3N::zero());
+        omega = select(active, omega, Vector3N::zero());
+
+        new_x.storeAoS(positions + base, num_lanes);
+        new_q.storeAoS(rotations + base, num_lanes);
+
+        new_x.storeStrided(&presolve_positions[base].x,
+                           sizeof(PreSolvePositional), num_lanes);
+        new_q.storeStrided(&presolve_positions[base].q,
+                           sizeof(PreSolvePositional), num_lanes);
+        v.storeStrided(&presolve_velocities[base].v,
+                       sizeof(PreSolveVelocity), num_lanes);
+        omega.storeStrided(&presolve_velocities[base].omega,
+                           sizeof(PreSolveVelocity), num_lanes);
+    }
+}
+#endif
+
 [[maybe_unused]] inline void checkSubstep(Context &,
                                           Entity,
                                           const Position &pos,
@@ -542,11 +714,17 @@ static inline void handleContact(Context &ctx,
         lambdas[i] = lambda_n;
     }
 
-    *x1_ptr = x1;
-    *x2_ptr = x2;
+    // Static bodies are shared between contacts solved in parallel, they
+    // must not be written to (applyAngularUpdate renormalizes q)
+    if (resp_type1 != ResponseType::Static) {
+        *x1_ptr = x1;
+        *q1_ptr = q1;
+    }
 
-    *q1_ptr = q1;
-    *q2_ptr = q2;
+    if (resp_type2 != ResponseType::Static) {
+        *x2_ptr = x2;
+        *q2_ptr = q2;
+    }
 }
 
 static void applyJointOrientationConstraint(
@@ -717,18 +895,135 @@ inline void handleJointConstraint(Context &ctx,
     *q2_ptr = q2;
 }
 
+// Greedily assigns each contact the first color not yet used by either of
+// its non-static bodies, in contact order, so the coloring (and therefore
+// the solve order) is deterministic. Also records where each color's rows
+// start once the contacts are sorted by color, which is stable and keeps
+// this order within each color.
+inline void colorContacts(Context &ctx, SolverState &solver_state)
+{
+    constexpr int32_t serial_color = consts::numContactColors;
+    uint8_t *body_masks = solver_state.bodyColorMasks;
+
+    uint32_t num_contacts = 0;
+    ctx.iterateQuery(solver_state.contactQuery,
+    [&](ContactConstraint &contact, XPBDContactState &,
+        ContactColor &contact_color) {
+        contact_color.color = serial_color;
+
+        body_masks[ctx.getDirect<LeafID>(
+            RGDCols::LeafID, contact.ref).id] = 0;
+        body_masks[ctx.getDirect<LeafID>(
+            RGDCols::LeafID, contact.alt).id] = 0;
+
+        num_contacts++;
+    });
+
+    if (num_contacts < (uint32_t)consts::minColoredContacts) {
+        // Every colored range is empty, so the colored solves don't
+        // touch the contacts
+        for (int32_t color = 0; color <= serial_color; color++) {
+            solver_state.colorOffsets[color] = 0;
+        }
+        solver_state.colorOffsets[serial_color + 1] = num_contacts;
+
+        return;
+    }
+
+    uint32_t color_counts[serial_color + 1] = {};
+
+    ctx.iterateQuery(solver_state.contactQuery,
+    [&](ContactConstraint &contact, XPBDContactState &,
+        ContactColor &contact_color) {
+        bool static1 = ctx.getDirect<ResponseType>(
+            RGDCols::ResponseType, contact.ref) == ResponseType::Static;
+        bool static2 = ctx.getDirect<ResponseType>(
+            RGDCols::ResponseType, contact.alt) == ResponseType::Static;
+
+        uint8_t *mask1 = &body_masks[ctx.getDirect<LeafID>(
+            RGDCols::LeafID, contact.ref).id];
+        uint8_t *mask2 = &body_masks[ctx.getDirect<LeafID>(
+            RGDCols::LeafID, contact.alt).id];
+
+        uint32_t used = (static1 ? 0 : *mask1) | (static2 ? 0 : *mask2);
+
+        int32_t color = 0;
+        while (color < serial_color && (used & (1_u32 << color)) != 0) {
+            color++;
+        }
+
+        contact_color.color = color;
+        color_counts[color]++;
+
+        if (color == serial_color) {
+            return;
+        }
+
+        if (!static1) {
+            *mask1 |= uint8_t(1 << color);
+        }
+
+        if (!static2) {
+            *mask2 |= uint8_t(1 << color);
+        }
+    });
+
+    uint32_t offset = 0;
+    for (int32_t color = 0; color <= serial_color; color++) {
+        solver_state.colorOffsets[color] = offset;
+        offset += color_counts[color];
+    }
+    solver_state.colorOffsets[serial_color + 1] = offset;
+}
+
+static inline void solveContactPositions(
+    Context &ctx,
+    ObjectManager &obj_mgr,
+    ContactConstraint &contact,
+    XPBDContactState &contact_solver_state)
+{
+    contact_solver_state.lambdaN[0] = 0.f;
+    contact_solver_state.lambdaN[1] = 0.f;
+    contact_solver_state.lambdaN[2] = 0.f;
+    contact_solver_state.lambdaN[3] = 0.f;
+    handleContact(ctx, obj_mgr, contact, contact_solver_state.lambdaN);
+}
+
+template <int32_t color>
+inline void solveColoredPositions(Context &ctx,
+                                  ContactConstraint &contact,
+                                  XPBDContactState &contact_solver_state,
+                                  ContactColor &contact_color)
+{
+#ifdef MADRONA_GPU_MODE
+    // See setupColoredSolveTasks
+    if (contact_color.color != color) {
+        return;
+    }
+#else
+    (void)contact_color;
+#endif
+
+    ObjectManager &obj_mgr = *ctx.singleton<ObjectData>().mgr;
+    solveContactPositions(ctx, obj_mgr, contact, contact_solver_state);
+}
+
+// On the CPU the serial contacts have their own node, see
+// setupColoredSolveTasks
 inline void solvePositions(Context &ctx, SolverState &solver_state)
 {
+#ifdef MADRONA_GPU_MODE
     ObjectManager &obj_mgr = *ctx.singleton<ObjectData>().mgr;
 
     ctx.iterateQuery(solver_state.contactQuery,
-    [&](ContactConstraint &contact, XPBDContactState &contact_solver_state) {
-        contact_solver_state.lambdaN[0] = 0.f;
-        contact_solver_state.lambdaN[1] = 0.f;
-        contact_solver_state.lambdaN[2] = 0.f;
-        contact_solver_state.lambdaN[3] = 0.f;
-        handleContact(ctx, obj_mgr, contact, contact_solver_state.lambdaN);
+    [&](ContactConstraint &contact, XPBDContactState &contact_solver_state,
+        ContactColor &contact_color) {
+        if (contact_color.color == consts::numContactColors) {
+            solveContactPositions(ctx, obj_mgr, contact,
+                                  contact_solver_state);
+        }
     });
+#endif
 
     ctx.iterateQuery(solver_state.jointQuery, [&](JointConstraint joint) {
         handleJointConstraint(ctx, joint);
@@ -778,6 +1073,54 @@ inline void setVelocities(Context &ctx,
     vel.angular = delta_q.w > 0.f ? new_omega : -new_omega;
 }
 
+#ifndef MADRONA_GPU_MODE
+// CPU version of setVelocities, FloatN::width rows at a time
+inline void setVelocitiesChunk(Context &ctx,
+                               CountT num_rows,
+                               const Position *positions,
+                               const Rotation *rotations,
+                               const SubstepPrevState *prev_states,
+                               Velocity *velocities)
+{
+    const auto &physics_sys = ctx.singleton<PhysicsSystemState>();
+    const FloatN h = FloatN::splat(physics_sys.h);
+    const FloatN omega_scale = FloatN::splat(2.f / physics_sys.h);
+
+    for (CountT base = 0; base < num_rows; base += FloatN::width) {
+        CountT num_lanes = std::min(FloatN::width, num_rows - base);
+
+        Vector3N x = Vector3N::loadAoS(positions + base, num_lanes);
+        QuatN q = QuatN::loadAoS(rotations + base, num_lanes);
+
+        Vector3N x_prev = Vector3N::loadStrided(
+            &prev_states[base].prevPosition, sizeof(SubstepPrevState),
+            num_lanes);
+        QuatN q_prev = QuatN::loadStrided(
+            &prev_states[base].prevRotation, sizeof(SubstepPrevState),
+            num_lanes);
+
+        // See setVelocities for why unchanged rotations are special cased
+        MaskN unchanged = (q.w == q_prev.w) & (q.x == q_prev.x) &
+            (q.y == q_prev.y) & (q.z == q_prev.z);
+
+        QuatN delta_q = select(unchanged, QuatN::identity(),
+                               q * q_prev.inv());
+
+        Vector3N new_omega =
+            omega_scale * Vector3N { delta_q.x, delta_q.y, delta_q.z };
+
+        Vector3N linear = (x - x_prev) / h;
+        Vector3N angular = select(delta_q.w > FloatN::zero(),
+                                  new_omega, -new_omega);
+
+        linear.storeStrided(&velocities[base].linear, sizeof(Velocity),
+                            num_lanes);
+        angular.storeStrided(&velocities[base].angular, sizeof(Velocity),
+                             num_lanes);
+    }
+}
+#endif
+
 static inline Vector3 computeRelativeVelocity(
     Vector3 v1, Vector3 v2,
     Vector3 omega1, Vector3 omega2,
@@ -1034,22 +1377,153 @@ static inline void solveVelocitiesForContact(Context &ctx,
             lambdaN[0] * (contact.points[i].w / penetration_sum));
     }
 
-    *v1_out = Velocity { v1, omega1 };
-    *v2_out = Velocity { v2, omega2 };
+    if (resp_type1 != ResponseType::Static) {
+        *v1_out = Velocity { v1, omega1 };
+    }
+
+    if (resp_type2 != ResponseType::Static) {
+        *v2_out = Velocity { v2, omega2 };
+    }
 }
 
+template <int32_t color>
+inline void solveColoredVelocities(Context &ctx,
+                                   ContactConstraint &contact,
+                                   XPBDContactState &contact_solver_state,
+                                   ContactColor &contact_color)
+{
+#ifdef MADRONA_GPU_MODE
+    if (contact_color.color != color) {
+        return;
+    }
+#else
+    (void)contact_color;
+#endif
+
+    ObjectManager &obj_mgr = *ctx.singleton<ObjectData>().mgr;
+    PhysicsSystemState &physics_sys = ctx.singleton<PhysicsSystemState>();
+
+    solveVelocitiesForContact(
+        ctx, obj_mgr, contact, contact_solver_state.lambdaN,
+        physics_sys.h, physics_sys.restitutionThreshold);
+}
+
+#ifdef MADRONA_GPU_MODE
 inline void solveVelocities(Context &ctx, SolverState &solver)
 {
     ObjectManager &obj_mgr = *ctx.singleton<ObjectData>().mgr;
     PhysicsSystemState &physics_sys = ctx.singleton<PhysicsSystemState>();
 
     ctx.iterateQuery(solver.contactQuery,
-    [&](ContactConstraint &contact, XPBDContactState &contact_solver_state) {
-        solveVelocitiesForContact(
-            ctx, obj_mgr, contact, contact_solver_state.lambdaN,
-            physics_sys.h, physics_sys.restitutionThreshold);
+    [&](ContactConstraint &contact, XPBDContactState &contact_solver_state,
+        ContactColor &contact_color) {
+        if (contact_color.color == consts::numContactColors) {
+            solveVelocitiesForContact(
+                ctx, obj_mgr, contact, contact_solver_state.lambdaN,
+                physics_sys.h, physics_sys.restitutionThreshold);
+        }
     });
 }
+#else
+// Runs Fn over the rows of one color, which the sort by ContactColor
+// after colorContacts leaves contiguous. Like a ParallelForNode, the
+// colored ranges can be split across workers. The serial range (color ==
+// consts::numContactColors) is always a single invocation.
+template <auto Fn, int32_t color>
+class ContactColorNode : public NodeBase {
+public:
+    ContactColorNode(
+            Query<ContactConstraint, XPBDContactState, ContactColor> &&query)
+        : query_(std::move(query))
+    {}
+
+    void run(Context &ctx, TaskGraph &taskgraph)
+    {
+        const SolverState &solver_state = taskgraph.singleton<SolverState>();
+        uint32_t start = solver_state.colorOffsets[color];
+        uint32_t end = solver_state.colorOffsets[color + 1];
+
+        taskgraph.iterateQueryRange(ctx, query_, start, end - start, Fn);
+    }
+
+    uint32_t numInvocations(TaskGraph &taskgraph)
+    {
+        const SolverState &solver_state = taskgraph.singleton<SolverState>();
+        uint32_t num_contacts = solver_state.colorOffsets[color + 1] -
+            solver_state.colorOffsets[color];
+
+        if constexpr (color == consts::numContactColors) {
+            return num_contacts > 0 ? 1 : 0;
+        } else {
+            return num_contacts;
+        }
+    }
+
+    void runRange(Context &ctx, TaskGraph &taskgraph,
+                  uint32_t offset, uint32_t num_invocations)
+    {
+        if constexpr (color == consts::numContactColors) {
+            run(ctx, taskgraph);
+        } else {
+            uint32_t start =
+                taskgraph.singleton<SolverState>().colorOffsets[color];
+
+            taskgraph.iterateQueryRange(ctx, query_, start + offset,
+                                        num_invocations, Fn);
+        }
+    }
+
+    static TaskGraphNodeID addToGraph(
+        StateManager &state_mgr,
+        TaskGraphBuilder &builder,
+        Span<const TaskGraphNodeID> dependencies)
+    {
+        return builder.addDefaultNode<ContactColorNode>(dependencies,
+            state_mgr.query<ContactConstraint, XPBDContactState,
+                            ContactColor>());
+    }
+
+private:
+    Query<ContactConstraint, XPBDContactState, ContactColor> query_;
+};
+#endif
+
+// On the CPU the contacts are sorted by color, so each color's node only
+// visits that color's rows, and the serial contacts get a final node.
+// Worlds that skipped coloring have empty colored ranges. The GPU sorts
+// archetypes across all worlds, which would break the per world grouping
+// of the contacts, so there each color's node checks every contact
+// instead and solvePositions / solveVelocities handle the serial ones.
+template <int32_t... colors>
+static TaskGraphNodeID setupColoredSolveTasks(
+    TaskGraphBuilder &builder,
+    TaskGraphNodeID cur_node,
+    std::integer_sequence<int32_t, colors...>,
+    bool velocities)
+{
+#ifdef MADRONA_GPU_MODE
+    if (velocities) {
+        ((cur_node = builder.addToGraph<ParallelForNode<Context,
+            solveColoredVelocities<colors>, ContactConstraint,
+            XPBDContactState, ContactColor>>({cur_node})), ...);
+    } else {
+        ((cur_node = builder.addToGraph<ParallelForNode<Context,
+            solveColoredPositions<colors>, ContactConstraint,
+            XPBDContactState, ContactColor>>({cur_node})), ...);
+    }
+#else
+    // colors ends with the serial color here, see setupXPBDSolverTasks
+    if (velocities) {
+        ((cur_node = builder.addToGraph<ContactColorNode<
+            solveColoredVelocities<colors>, colors>>({cur_node})), ...);
+    } else {
+        ((cur_node = builder.addToGraph<ContactColorNode<
+            solveColoredPositions<colors>, colors>>({cur_node})), ...);
+    }
+#endif
+
+    return cur_node;
+}
 
 void registerTypes(ECSRegistry &registry)
 {
@@ -1057,6 +1531,7 @@ void registerTypes(ECSRegistry &registry)
     registry.registerComponent<PreSolvePositional>();
     registry.registerComponent<PreSolveVelocity>();
     registry.registerComponent<XPBDContactState>();
+    registry.registerComponent<ContactColor>();
 
     registry.registerArchetype<Joint>();
     registry.registerArchetype<Contact>();
@@ -1067,14 +1542,23 @@ void registerTypes(ECSRegistry &registry)
     registry.registerBundleAlias<SolverBundleAlias, XPBDRigidBodyState>();
 }
 
-void init(Context &ctx)
+void init(Context &ctx, CountT max_dynamic_objects)
 {
     new (&ctx.singleton<SolverState>()) SolverState {
         .jointQuery = ctx.query<JointConstraint>(),
-        .contactQuery = ctx.query<ContactConstraint, XPBDContactState>(),
+        .contactQuery =
+            ctx.query<ContactConstraint, XPBDContactState, ContactColor>(),
+        .bodyColorMasks = (uint8_t *)rawAlloc(
+            sizeof(uint8_t) * max_dynamic_objects),
+        .colorOffsets = {},
     };
 }
 
+void shutdown(Context &ctx)
+{
+    rawDealloc(ctx.singleton<SolverState>().bodyColorMasks);
+}
+
 void getSolverArchetypeIDs(uint32_t *contact_archetype_id,
                            uint32_t *joint_archetype_id)
 {
@@ -1087,41 +1571,85 @@ TaskGraphNodeID setupXPBDSolverTasks(
     TaskGraphNodeID broadphase,
     CountT num_substeps)
 {
+#ifdef MADRONA_GPU_MODE
+    using SolveColors =
+        std::make_integer_sequence<int32_t, consts::numContactColors>;
+#else
+    // One more node for the serially solved contacts
+    using SolveColors =
+        std::make_integer_sequence<int32_t, consts::numContactColors + 1>;
+#endif
+
     auto cur_node = broadphase;
 
-#ifdef MADRONA_GPU_MODE
-    cur_node = 
+    cur_node =
         builder.addToGraph<SortArchetypeNode<Joint, WorldID>>({cur_node});
+#ifdef MADRONA_GPU_MODE
     cur_node = builder.addToGraph<ResetTmpAllocNode>({cur_node});
 #endif
 
     for (CountT i = 0; i < num_substeps; i++) {
+#ifdef MADRONA_GPU_MODE
         auto rgb_update = builder.addToGraph<ParallelForNode<Context,
             substepRigidBodies, Position, Rotation, Velocity, ObjectID,
-            ResponseType, ExternalForce, ExternalTorque,
+            ResponseType, ExternalForce, ExternalTorque, SleepState,
+            SubstepPrevState, PreSolvePositional,
+            PreSolveVelocity>>({cur_node});
+#else
+        auto rgb_update = builder.addToGraph<ParallelForChunkNode<Context,
+            substepRigidBodiesChunk, Position, Rotation, Velocity, ObjectID,
+            ResponseType, ExternalForce, ExternalTorque, SleepState,
             SubstepPrevState, PreSolvePositional,
             PreSolveVelocity>>({cur_node});
+#endif
 
         auto run_narrowphase = narrowphase::setupTasks(builder, {rgb_update});
 
-#ifdef MADRONA_GPU_MODE
         run_narrowphase = builder.addToGraph<SortArchetypeNode<Contact, WorldID>>(
                 {run_narrowphase});
 
+#ifdef MADRONA_GPU_MODE
         run_narrowphase = builder.addToGraph<ResetTmpAllocNode>(
             {run_narrowphase});
 #endif
 
-        auto solve_pos = builder.addToGraph<ParallelForNode<Context,
-            solvePositions, SolverState>>(
-                {run_narrowphase});
+        auto colored = builder.addToGraph<ParallelForNode<Context,
+            colorContacts, SolverState>>({run_narrowphase});
+
+#ifndef MADRONA_GPU_MODE
+        colored = builder.addToGraph<SortArchetypeNode<Contact, ContactColor>>(
+            {colored});
+#endif
+
+        auto solve_pos = setupColoredSolveTasks(builder, colored,
+            SolveColors(), false);
+
+        solve_pos = builder.addToGraph<ParallelForNode<Context,
+            solvePositions, SolverState>>({solve_pos});
 
+#ifdef MADRONA_GPU_MODE
         auto vel_set = builder.addToGraph<ParallelForNode<Context,
             setVelocities, Position, Rotation,
             SubstepPrevState, Velocity>>({solve_pos});
+#else
+        auto vel_set = builder.addToGraph<ParallelForChunkNode<Context,
+            setVelocitiesChunk, Position, Rotation,
+            SubstepPrevState, Velocity>>({solve_pos});
+#endif
 
-        auto solve_vel = builder.addToGraph<ParallelForNode<Context,
-            solveVelocities, SolverState>>({vel_set});
+        auto solve_vel = setupColoredSolveTasks(builder, vel_set,
+            SolveColors(), true);
+
+#ifdef MADRONA_GPU_MODE
+        solve_vel = builder.addToGraph<ParallelForNode<Context,
+            solveVelocities, SolverState>>({solve_vel});
+#endif
+
+        // Islands come from the last substep's contacts and final
+        // velocities
+        if (i == num_substeps - 1) {
+            solve_vel = sleep::setupTasks(builder, {solve_vel});
+        }
 
         auto clear_contacts = builder.addToGraph<
             ClearTmpNode<Contact>>({solve_vel});
@@ -9,7 +9,8 @@ void registerTypes(ECSRegistry &registry);
 void getSolverArchetypeIDs(uint32_t *contact_archetype_id,
                            uint32_t *joint_archetype_id);
 
-void init(Context &ctx);
+void init(Context &ctx, CountT max_dynamic_objects);
+void shutdown(Context &ctx);
 
 TaskGraphNodeID setupXPBDSolverTasks(
     TaskGraphBuilder &builder,
@@ -6,6 +6,7 @@
 #include <madrona/render/asset_processor.hpp>
 #include <madrona/heap_array.hpp>
 #include <madrona/mesh_bvh_builder.hpp>
+#include <madrona/asset_cache.hpp>
 
 #include <filesystem>
 
@@ -32,91 +33,185 @@ namespace madrona::render {
 namespace AssetProcessor {
 
 #ifdef MADRONA_CUDA_SUPPORT
-static bool loadCache(const char *location,
-                      HeapArray<MeshBVH> &bvhs_out)
+// Cache kind tag for mesh BVHs ("MBVH"). Bump bvhCacheVersion when
+// MeshBVHBuilder output changes for the same input meshes.
+static constexpr uint32_t bvhCacheKind = 0x4856424d;
+static constexpr uint32_t bvhCacheVersion = 2;
+
+// One record per BVH at the start of the cache payload, followed by the
+// node, leaf material and vertex arrays. Offsets are relative to the
+// start of the payload so the file can be mapped at any address.
+struct CachedMeshBVH {
+    uint64_t nodesOffset;
+    uint64_t leafMatsOffset;
+    uint64_t verticesOffset;
+    math::AABB rootAABB;
+    uint32_t numNodes;
+    uint32_t numLeaves;
+    uint32_t numVerts;
+    uint32_t maxDepth;
+    int32_t materialIDX;
+};
+
+static CountT numCachedLeafMats(const MeshBVH &bvh)
 {
-    FILE *ptr;
-    ptr = fopen(location, "rb");
+#ifdef MADRONA_COMPRESSED_DEINDEXED_TEX
+    return bvh.numVerts / 3;
+#else
+    (void)bvh;
+    return 0;
+#endif
+}
 
-    if(ptr == nullptr){
-        return false;
-    }
+static uint64_t hashBVHSources(Span<const SourceObject> objs)
+{
+    AssetHasher hasher(bvhCacheVersion);
 
-    const CountT num_bvhs = bvhs_out.size();
-    for (CountT i = 0; i < num_bvhs; i++) {
-        uint32_t num_verts;
-        uint32_t num_nodes;
-        uint32_t num_leaves;
-        math::AABB aabb_out;
-        int32_t material_idx;
-        fread(&num_verts, sizeof(num_verts), 1, ptr);
-        fread(&num_nodes, sizeof(num_nodes), 1, ptr);
-        fread(&num_leaves, sizeof(num_leaves), 1, ptr);
-        fread(&aabb_out, sizeof(aabb_out), 1, ptr);
-        fread(&material_idx, sizeof(material_idx), 1, ptr);
-
-        DynArray<QBVHNode> nodes{num_nodes};
-        fread(nodes.data(), sizeof(QBVHNode), num_nodes, ptr);
-
-#if 0
-        DynArray<MeshBVH::LeafGeometry> leaf_geos{num_leaves};
-        fread(leaf_geos.data(), sizeof(MeshBVH::LeafGeometry), num_leaves, ptr);
+    hasher.add((uint32_t)MeshBVH::nodeWidth);
+    hasher.add((uint32_t)MeshBVH::numTrisPerLeaf);
+    hasher.add((uint32_t)sizeof(QBVHNode));
+    hasher.add((uint32_t)sizeof(MeshBVH::BVHVertex));
+    hasher.add((uint32_t)sizeof(MeshBVH::LeafMaterial));
+#if defined(MADRONA_COMPRESSED_DEINDEXED_TEX)
+    hasher.add((uint32_t)2);
+#elif defined(MADRONA_COMPRESSED_DEINDEXED)
+    hasher.add((uint32_t)1);
+#else
+    hasher.add((uint32_t)0);
 #endif
 
-        DynArray<MeshBVH::BVHVertex> vertices{num_verts};
-        fread(vertices.data(), sizeof(MeshBVH::BVHVertex), num_verts, ptr);
+    hasher.add(objs.size());
+    for (const SourceObject &obj : objs) {
+        hasher.add(obj.meshes.size());
+
+        for (const SourceMesh &mesh : obj.meshes) {
+            CountT num_indices = 0;
+            if (mesh.faceCounts == nullptr) {
+                num_indices = 3 * (CountT)mesh.numFaces;
+            } else {
+                for (CountT i = 0; i < (CountT)mesh.numFaces; i++) {
+                    num_indices += mesh.faceCounts[i];
+                }
+            }
 
+            hasher.addArray(mesh.positions, mesh.numVertices);
+            hasher.addArray(mesh.uvs, mesh.numVertices);
+            hasher.addArray(mesh.faceCounts, mesh.numFaces);
+            hasher.addArray(mesh.faceMaterials, mesh.numFaces);
+            hasher.addArray(mesh.indices, num_indices);
+            hasher.add(mesh.materialIDX);
+        }
+    }
 
+    return hasher.finish();
+}
 
-#ifdef MADRONA_COMPRESSED_DEINDEXED_TEX
-        DynArray<MeshBVH::LeafMaterial> leaf_materials{num_verts/3};
-        fread(leaf_materials.data(), sizeof(MeshBVH::LeafMaterial), num_verts/3, ptr);
-#endif
+// The returned BVHs point straight into the mapping, nothing is copied or
+// parsed, so the mapping must outlive them.
+static Optional<MappedAssetCache> loadCache(const char *location,
+                                            uint64_t source_hash,
+                                            HeapArray<MeshBVH> &bvhs_out)
+{
+    Optional<MappedAssetCache> mapped =
+        MappedAssetCache::map(location, bvhCacheKind, source_hash);
+    if (!mapped.has_value()) {
+        return mapped;
+    }
+
+    const CountT num_bvhs = bvhs_out.size();
+    if (mapped->numBytes() < sizeof(CachedMeshBVH) * num_bvhs) {
+        return Optional<MappedAssetCache>::none();
+    }
+
+    char *base = mapped->data();
+    const auto *records = (const CachedMeshBVH *)base;
+
+    for (CountT i = 0; i < num_bvhs; i++) {
+        const CachedMeshBVH &record = records[i];
 
         MeshBVH bvh;
-        bvh.numNodes = num_nodes;
-        bvh.numLeaves = num_leaves;
-        bvh.numVerts = num_verts;
-
-        bvh.nodes = nodes.retrieve_ptr();
-        // bvh.leafGeos = leaf_geos.release(true);
-        bvh.leafMats = leaf_materials.retrieve_ptr();
-        bvh.vertices = vertices.retrieve_ptr();
-        bvh.rootAABB = aabb_out;
-        bvh.materialIDX = material_idx;
+        bvh.nodes = (QBVHNode *)(base + record.nodesOffset);
+        bvh.leafMats = (MeshBVH::LeafMaterial *)(base + record.leafMatsOffset);
+        bvh.vertices = (MeshBVH::BVHVertex *)(base + record.verticesOffset);
+        bvh.rootAABB = record.rootAABB;
+        bvh.numNodes = record.numNodes;
+        bvh.numLeaves = record.numLeaves;
+        bvh.numVerts = record.numVerts;
+        bvh.maxDepth = record.maxDepth;
+        bvh.materialIDX = record.materialIDX;
         bvhs_out.emplace(i, bvh);
     }
 
-    fclose(ptr);
-    return true;
+    return mapped;
 }
 
-static void writeCache(const char *location, HeapArray<MeshBVH> &bvhs)
+static void writeCache(const char *location,
+                       uint64_t source_hash,
+                       const HeapArray<MeshBVH> &bvhs)
 {
-    FILE *ptr;
-    ptr = fopen(location, "wb");
+    const CountT num_bvhs = bvhs.size();
+
+    uint64_t num_payload_bytes = utils::roundUp(
+        (uint64_t)sizeof(CachedMeshBVH) * num_bvhs,
+        (uint64_t)alignof(QBVHNode));
+
+    HeapArray<CachedMeshBVH> records(num_bvhs);
+    for (CountT i = 0; i < num_bvhs; i++) {
+        const MeshBVH &bvh = bvhs[i];
+
+        CachedMeshBVH &record = records[i];
+        record.rootAABB = bvh.rootAABB;
+        record.numNodes = bvh.numNodes;
+        record.numLeaves = bvh.numLeaves;
+        record.numVerts = bvh.numVerts;
+        record.maxDepth = bvh.maxDepth;
+        record.materialIDX = bvh.materialIDX;
+
+        record.nodesOffset = num_payload_bytes;
+        num_payload_bytes = utils::roundUp(num_payload_bytes +
+            sizeof(QBVHNode) * bvh.numNodes,
+            (uint64_t)alignof(MeshBVH::LeafMaterial));
+
+        record.leafMatsOffset = num_payload_bytes;
+        num_payload_bytes = utils::roundUp(num_payload_bytes +
+            sizeof(MeshBVH::LeafMaterial) * numCachedLeafMats(bvh),
+            (uint64_t)alignof(MeshBVH::BVHVertex));
+
+        record.verticesOffset = num_payload_bytes;
+        num_payload_bytes = utils::roundUp(num_payload_bytes +
+            sizeof(MeshBVH::BVHVertex) * bvh.numVerts,
+            (uint64_t)alignof(QBVHNode));
+    }
 
-    for (CountT i = 0; i < bvhs.size(); i++) {
-        fwrite(&bvhs[i].numVerts, sizeof(uint32_t), 1, ptr);
-        fwrite(&bvhs[i].numNodes, sizeof(uint32_t), 1, ptr);
-        fwrite(&bvhs[i].numLeaves, sizeof(uint32_t), 1, ptr);
-        fwrite(&bvhs[i].rootAABB, sizeof(math::AABB), 1, ptr);
-        fwrite(&bvhs[i].materialIDX, sizeof(int32_t), 1, ptr);
+    char *payload = (char *)malloc(num_payload_bytes);
+    memset(payload, 0, num_payload_bytes);
+    memcpy(payload, records.data(), sizeof(CachedMeshBVH) * num_bvhs);
 
-        fwrite(bvhs[i].nodes, sizeof(QBVHNode), bvhs[i].numNodes, ptr);
-        // fwrite(bvhs[i].leafGeos, sizeof(MeshBVH::LeafGeometry), bvhs[i].numLeaves, ptr);
-        fwrite(bvhs[i].vertices, sizeof(MeshBVH::BVHVertex), bvhs[i].numVerts, ptr);
+    for (CountT i = 0; i < num_bvhs; i++) {
+        const MeshBVH &bvh = bvhs[i];
+        const CachedMeshBVH &record = records[i];
+
+        memcpy(payload + record.nodesOffset, bvh.nodes,
+               sizeof(QBVHNode) * bvh.numNodes);
+        if (numCachedLeafMats(bvh) > 0) {
+            memcpy(payload + record.leafMatsOffset, bvh.leafMats,
+                   sizeof(MeshBVH::LeafMaterial) * numCachedLeafMats(bvh));
+        }
+        memcpy(payload + record.verticesOffset, bvh.vertices,
+               sizeof(MeshBVH::BVHVertex) * bvh.numVerts);
+    }
 
-#ifdef MADRONA_COMPRESSED_DEINDEXED_TEX
-        fwrite(bvhs[i].leafMats, sizeof(MeshBVH::LeafMaterial), bvhs[i].numVerts/3, ptr);
-#endif
+    if (!writeAssetCache(location, bvhCacheKind, source_hash,
+                         payload, num_payload_bytes)) {
+        fprintf(stderr, "Failed to write BVH cache to %s\n", location);
     }
 
-    fclose(ptr);
+    free(payload);
 }
 
 static HeapArray<MeshBVH> createMeshBVHs(
-    Span<const SourceObject> objs)
+    Span<const SourceObject> objs,
+    Optional<MappedAssetCache> &cache_out)
 {
     char *bvh_cache_path = getenv("MADRONA_BVH_CACHE");
 
@@ -130,10 +225,15 @@ static HeapArray<MeshBVH> createMeshBVHs(
 
     HeapArray<MeshBVH> mesh_bvhs(objs.size());
 
+    uint64_t source_hash = 0;
+    if (bvh_cache_path) {
+        source_hash = hashBVHSources(objs);
+    }
+
     if (bvh_cache_path && !regen_cache) {
-        bool valid_cache = loadCache(bvh_cache_path, mesh_bvhs);
+        cache_out = loadCache(bvh_cache_path, source_hash, mesh_bvhs);
 
-        if (valid_cache) {
+        if (cache_out.has_value()) {
             return mesh_bvhs;
         }
     }
@@ -146,7 +246,7 @@ static HeapArray<MeshBVH> createMeshBVHs(
     }
 
      if (bvh_cache_path) {
-         writeCache(bvh_cache_path, mesh_bvhs);
+         writeCache(bvh_cache_path, source_hash, mesh_bvhs);
      }
 
     return mesh_bvhs;
@@ -154,7 +254,9 @@ static HeapArray<MeshBVH> createMeshBVHs(
 
 MeshBVHData makeBVHData(Span<const imp::SourceObject> src_objs)
 {
-    HeapArray<MeshBVH> mesh_bvhs = createMeshBVHs(src_objs);
+    // Keeps a mapped BVH cache alive until everything is copied to the GPU
+    Optional<MappedAssetCache> bvh_cache = Optional<MappedAssetCache>::none();
+    HeapArray<MeshBVH> mesh_bvhs = createMeshBVHs(src_objs, bvh_cache);
 
     uint64_t num_bvhs = (uint32_t)mesh_bvhs.size();
     uint64_t num_nodes = 0;
@@ -0,0 +1,730 @@
+#include <madrona/render/cpu_raycast.hpp>
+#include <madrona/simd_math.hpp>
+#include <madrona/memory.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+namespace madrona::render {
+
+using namespace math;
+
+namespace {
+
+// Same limits as the GPU raytracer
+constexpr float defaultFarPlane = 10000.f;
+constexpr float shadowRayTMin = 0.000001f;
+constexpr float minLightContribution = 0.2f;
+
+// Also enough for the TLAS, whose median splits keep it balanced
+constexpr CountT traversalStackSize = MeshBVH::maxTraversalStackSize;
+constexpr CountT packetWidth = FloatN::width;
+
+// FloatN::width rays traced together. Lanes outside active are ignored.
+struct RayPacket {
+    Vector3N o;
+    Vector3N d;
+    Vector3N invD;
+    FloatN tMin;
+    // Distance to the closest hit so far
+    FloatN tMax;
+    MaskN active;
+};
+
+struct PacketHits {
+    MaskN hit;
+    FloatN texU;
+    FloatN texV;
+
+    // Geometric normal in the space of the hit instance's mesh
+    Vector3 objectNormals[packetWidth];
+    int32_t instanceIdxs[packetWidth];
+    uint32_t leafMaterialIdxs[packetWidth];
+};
+
+// Ray generation basis, matches calculateOutRay in bvh_raycast.cpp
+struct ViewBasis {
+    Vector3 origin;
+    Vector3 lowerLeft;
+    Vector3 horizontal;
+    Vector3 vertical;
+
+    static ViewBasis make(const PerspectiveCameraData &view)
+    {
+        Quat rot = view.rotation.inv();
+        Vector3 forward = rot.rotateVec({ 0, 1, 0 }).normalize();
+        Vector3 u = rot.rotateVec({ 1, 0, 0 });
+        Vector3 v = cross(forward, u).normalize();
+
+        const float h = 1.f / (-view.yScale);
+        const float viewport_height = 2.f * h;
+        const float viewport_width = viewport_height;
+
+        Vector3 horizontal = u * viewport_width;
+        Vector3 vertical = v * viewport_height;
+
+        return ViewBasis {
+            .origin = view.position,
+            .lowerLeft = view.position - horizontal / 2.f -
+                vertical / 2.f + forward,
+            .horizontal = horizontal,
+            .vertical = vertical,
+        };
+    }
+
+    Vector3 rayDir(uint32_t x, uint32_t y, float inv_res) const
+    {
+        float pixel_u = ((float)x + 0.5f) * inv_res;
+        float pixel_v = ((float)y + 0.5f) * inv_res;
+
+        return (lowerLeft + pixel_u * horizontal +
+            pixel_v * vertical - origin).normalize();
+    }
+};
+
+}
+
+static inline MaskN noLanes()
+{
+    return MaskN::firstLanes(0);
+}
+
+// 1 / d, with the same clamp as the GPU's 1 / diveps for axis aligned rays
+// so the slab tests never compute 0 * inf
+static inline FloatN safeInv(FloatN x)
+{
+    constexpr float max_inv = 1e7f;
+
+    return min(max(FloatN::splat(1.f) / x, FloatN::splat(-max_inv)),
+               FloatN::splat(max_inv));
+}
+
+static inline Vector3N safeInv(const Vector3N &d)
+{
+    return Vector3N {
+        safeInv(d.x),
+        safeInv(d.y),
+        safeInv(d.z),
+    };
+}
+
+static inline MaskN intersectAABB(const RayPacket &ray, const AABB &aabb)
+{
+    FloatN t_min_x = (FloatN::splat(aabb.pMin.x) - ray.o.x) * ray.invD.x;
+    FloatN t_min_y = (FloatN::splat(aabb.pMin.y) - ray.o.y) * ray.invD.y;
+    FloatN t_min_z = (FloatN::splat(aabb.pMin.z) - ray.o.z) * ray.invD.z;
+
+    FloatN t_max_x = (FloatN::splat(aabb.pMax.x) - ray.o.x) * ray.invD.x;
+    FloatN t_max_y = (FloatN::splat(aabb.pMax.y) - ray.o.y) * ray.invD.y;
+    FloatN t_max_z = (FloatN::splat(aabb.pMax.z) - ray.o.z) * ray.invD.z;
+
+    FloatN t_near = max(max(min(t_min_x, t_max_x), min(t_min_y, t_max_y)),
+                        max(min(t_min_z, t_max_z), FloatN::zero()));
+    FloatN t_far = min(min(max(t_min_x, t_max_x), max(t_min_y, t_max_y)),
+                       min(max(t_min_z, t_max_z), ray.tMax));
+
+    return (t_near <= t_far) & ray.active;
+}
+
+// Moller-Trumbore against one triangle for the whole packet. Back faces
+// are culled with the same winding as MeshBVH::rayTriangleIntersection.
+template <bool any_hit>
+static inline void intersectTriangle(const MeshBVH &bvh,
+                                     int32_t tri_idx,
+                                     int32_t instance_idx,
+                                     RayPacket &ray,
+                                     PacketHits &hits)
+{
+    const MeshBVH::BVHVertex *verts = bvh.vertices + 3 * tri_idx;
+
+    Vector3 e1 = verts[1].pos - verts[0].pos;
+    Vector3 e2 = verts[2].pos - verts[0].pos;
+
+    Vector3N e1_n = Vector3N::splat(e1);
+    Vector3N e2_n = Vector3N::splat(e2);
+
+    Vector3N p = cross(ray.d, e2_n);
+    FloatN det = dot(e1_n, p);
+
+    Vector3N to_o = ray.o - Vector3N::splat(verts[0].pos);
+    FloatN u = dot(to_o, p);
+
+    Vector3N q = cross(to_o, e1_n);
+    FloatN v = dot(ray.d, q);
+
+    // Barycentrics are still scaled by det here
+    MaskN hit = ray.active & (det > FloatN::zero()) &
+        (u >= FloatN::zero()) & (v >= FloatN::zero()) & (u + v <= det);
+    if (!hit.any()) {
+        return;
+    }
+
+    FloatN inv_det = FloatN::splat(1.f) / det;
+    FloatN t = dot(e2_n, q) * inv_det;
+
+    hit = hit & (t > ray.tMin) & (t <= ray.tMax);
+    if (!hit.any()) {
+        return;
+    }
+
+    hits.hit = hits.hit | hit;
+
+    if constexpr (any_hit) {
+        // Shadow rays only need to know something is in the way
+        ray.active = ray.active & ~hit;
+        return;
+    }
+
+    ray.tMax = select(hit, t, ray.tMax);
+
+    u *= inv_det;
+    v *= inv_det;
+    FloatN w = FloatN::splat(1.f) - u - v;
+
+    hits.texU = select(hit,
+        w * verts[0].uv.x + u * verts[1].uv.x + v * verts[2].uv.x,
+        hits.texU);
+    hits.texV = select(hit,
+        w * verts[0].uv.y + u * verts[1].uv.y + v * verts[2].uv.y,
+        hits.texV);
+
+    Vector3 normal = cross(e1, e2).normalize();
+
+    uint32_t hit_bits = hit.bits();
+    while (hit_bits != 0) {
+        int lane = std::countr_zero(hit_bits);
+        hit_bits &= hit_bits - 1;
+
+        hits.objectNormals[lane] = normal;
+        hits.instanceIdxs[lane] = instance_idx;
+        hits.leafMaterialIdxs[lane] = (uint32_t)tri_idx;
+    }
+}
+
+// ray is in the space of the mesh
+template <bool any_hit>
+static void traceBLAS(const MeshBVH &bvh,
+                      int32_t instance_idx,
+                      RayPacket &ray,
+                      PacketHits &hits)
+{
+    int32_t stack[traversalStackSize];
+    CountT stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0) {
+        const QBVHNode &node = bvh.nodes[stack[--stack_size]];
+
+        for (CountT i = 0; i < MeshBVH::nodeWidth; i++) {
+            if (!node.hasChild(i)) {
+                continue;
+            }
+
+            MaskN child_hit = intersectAABB(ray, node.convertToAABB(i));
+            if (!child_hit.any()) {
+                continue;
+            }
+
+            if (node.isLeaf(i)) {
+                int32_t leaf_idx = (int32_t)node.leafIDX(i);
+                for (int32_t j = 0; j < (int32_t)node.triSize[i]; j++) {
+                    intersectTriangle<any_hit>(
+                        bvh, leaf_idx + j, instance_idx, ray, hits);
+                }
+
+                if (any_hit && !ray.active.any()) {
+                    return;
+                }
+            } else {
+                assert(stack_size < traversalStackSize);
+                stack[stack_size++] = (int32_t)node.childrenIdx[i];
+            }
+        }
+    }
+}
+
+// Rays are moved into the instance's space without renormalizing the
+// direction, so hit distances are the same in both spaces
+static inline RayPacket toInstanceSpace(const RayPacket &ray,
+                                        const InstanceData &instance,
+                                        MaskN active)
+{
+    QuatN to_local = QuatN::splat(instance.rotation.inv());
+    Diag3x3 inv_scale = instance.scale.inv();
+    Vector3N inv_scale_n = Vector3N::splat(
+        Vector3 { inv_scale.d0, inv_scale.d1, inv_scale.d2 });
+
+    Vector3N o = mul(inv_scale_n, to_local.rotateVec(
+        ray.o - Vector3N::splat(instance.position)));
+    Vector3N d = mul(inv_scale_n, to_local.rotateVec(ray.d));
+
+    return RayPacket {
+        .o = o,
+        .d = d,
+        .invD = safeInv(d),
+        .tMin = ray.tMin,
+        .tMax = ray.tMax,
+        .active = active,
+    };
+}
+
+template <bool any_hit>
+static void traceWorld(const CPURaycastConfig &cfg,
+                       const CPURaycastWorld &world,
+                       RayPacket &ray,
+                       PacketHits &hits)
+{
+    hits.hit = noLanes();
+    hits.texU = FloatN::zero();
+    hits.texV = FloatN::zero();
+
+    const CPURaycastTLAS &tlas = *world.tlas;
+    if (tlas.numNodes == 0) {
+        return;
+    }
+
+    int32_t stack[traversalStackSize];
+    CountT stack_size = 0;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0) {
+        const QBVHNode &node = tlas.nodes[stack[--stack_size]];
+
+        for (CountT i = 0; i < QBVHNode::NodeWidth; i++) {
+            if (!node.hasChild(i)) {
+                continue;
+            }
+
+            MaskN child_hit = intersectAABB(ray, node.convertToAABB(i));
+            if (!child_hit.any()) {
+                continue;
+            }
+
+            if (!node.isLeaf(i)) {
+                assert(stack_size < traversalStackSize);
+                stack[stack_size++] = (int32_t)node.childrenIdx[i];
+                continue;
+            }
+
+            int32_t instance_idx = (int32_t)node.leafIDX(i);
+            const InstanceData &instance = world.instances[instance_idx];
+
+            RayPacket local_ray = toInstanceSpace(ray, instance, child_hit);
+            traceBLAS<any_hit>(cfg.bvhs[instance.objectID], instance_idx,
+                               local_ray, hits);
+
+            if constexpr (any_hit) {
+                ray.active = ray.active & ~hits.hit;
+                if (!ray.active.any()) {
+                    return;
+                }
+            } else {
+                ray.tMax = local_ray.tMax;
+            }
+        }
+    }
+}
+
+static inline Vector3 hexToRgb(uint32_t hex)
+{
+    return Vector3 {
+        ((hex >> 16) & 0xFF) / 255.f,
+        ((hex >> 8) & 0xFF) / 255.f,
+        (hex & 0xFF) / 255.f,
+    };
+}
+
+// Bilinear filtering with wrapping, like the GPU's texture objects
+static Vector3 sampleTexture(const CPURaycastTexture &tex, float u, float v)
+{
+    auto wrap = [](float coord, uint32_t size) {
+        return coord - floorf(coord / (float)size) * (float)size;
+    };
+
+    float x = wrap(u * (float)tex.width - 0.5f, tex.width);
+    float y = wrap(v * (float)tex.height - 0.5f, tex.height);
+
+    uint32_t x0 = std::min((uint32_t)x, tex.width - 1);
+    uint32_t y0 = std::min((uint32_t)y, tex.height - 1);
+    uint32_t x1 = x0 + 1 == tex.width ? 0 : x0 + 1;
+    uint32_t y1 = y0 + 1 == tex.height ? 0 : y0 + 1;
+
+    float tx = x - (float)x0;
+    float ty = y - (float)y0;
+
+    auto texel = [&tex](uint32_t tx, uint32_t ty) {
+        const uint8_t *p = tex.pixels + 4 * ((CountT)ty * tex.width + tx);
+        return Vector3 { p[0] / 255.f, p[1] / 255.f, p[2] / 255.f };
+    };
+
+    Vector3 top = (1.f - tx) * texel(x0, y0) + tx * texel(x1, y0);
+    Vector3 bottom = (1.f - tx) * texel(x0, y1) + tx * texel(x1, y1);
+
+    return (1.f - ty) * top + ty * bottom;
+}
+
+static Vector3 surfaceColor(const CPURaycastConfig &cfg,
+                            const InstanceData &instance,
+                            uint32_t leaf_material_idx,
+                            float tex_u,
+                            float tex_v)
+{
+    int32_t material_idx = instance.matID;
+
+    if (material_idx == MaterialOverride::UseOverrideColor) {
+        return hexToRgb(instance.color);
+    }
+
+    if (material_idx == MaterialOverride::UseDefaultMaterial) {
+        material_idx = (int32_t)cfg.bvhs[instance.objectID].getMaterialIDX(
+            (int32_t)leaf_material_idx);
+    }
+
+    if (material_idx == -1) {
+        return Vector3 { 1.f, 1.f, 1.f };
+    }
+
+    const Material &mat = cfg.materials[material_idx];
+    Vector3 color { mat.color.x, mat.color.y, mat.color.z };
+
+    if (mat.textureIdx != -1) {
+        Vector3 tex_color = sampleTexture(cfg.textures[mat.textureIdx],
+                                          tex_u, 1.f - tex_v);
+        color.x *= tex_color.x;
+        color.y *= tex_color.y;
+        color.z *= tex_color.z;
+    }
+
+    return color;
+}
+
+// Same model as computeFragment in bvh_raycast.cpp: the sum of N.L over
+// the lights that reach the hit point, with a floor of
+// minLightContribution
+static FloatN lightContribution(const CPURaycastConfig &cfg,
+                                const CPURaycastWorld &world,
+                                const Vector3N &hit_pos,
+                                const Vector3N &normal,
+                                MaskN hit)
+{
+    FloatN contrib = FloatN::zero();
+
+    for (uint32_t light_idx = 0; light_idx < world.numLights; light_idx++) {
+        const LightDesc &desc = world.lights[light_idx];
+        if (!desc.active) {
+            continue;
+        }
+
+        MaskN lit = hit;
+        Vector3N light_dir;
+        if (desc.type == LightDesc::Type::Spotlight) {
+            light_dir = (Vector3N::splat(desc.position) - hit_pos).normalize();
+
+            if (desc.cutoff != -1.f) {
+                // acos(cos_angle) > |cutoff|, without the acos
+                Vector3 spot_dir = desc.direction.normalize();
+                FloatN cos_angle = -dot(light_dir, Vector3N::splat(spot_dir));
+                float cos_cutoff = cosf(std::min(fabsf(desc.cutoff), math::pi));
+
+                lit = lit & (cos_angle >= FloatN::splat(cos_cutoff));
+            }
+        } else {
+            light_dir = Vector3N::splat(-desc.direction);
+        }
+
+        FloatN n_dot_l = dot(normal, light_dir);
+
+        if (desc.castShadow) {
+            lit = lit & (n_dot_l > FloatN::zero());
+
+            if (lit.any()) {
+                RayPacket shadow_ray {
+                    .o = hit_pos,
+                    .d = light_dir,
+                    .invD = safeInv(light_dir),
+                    .tMin = FloatN::splat(shadowRayTMin),
+                    .tMax = FloatN::splat(defaultFarPlane),
+                    .active = lit,
+                };
+
+                PacketHits shadow_hits;
+                traceWorld<true>(cfg, world, shadow_ray, shadow_hits);
+
+                lit = lit & ~shadow_hits.hit;
+            }
+        }
+
+        contrib += select(lit,
+            min(max(n_dot_l, FloatN::zero()), FloatN::splat(1.f)),
+            FloatN::zero());
+    }
+
+    return max(contrib, FloatN::splat(minLightContribution));
+}
+
+static void shadePacket(const CPURaycastConfig &cfg,
+                        const CPURaycastWorld &world,
+                        const RayPacket &ray,
+                        const PacketHits &hits,
+                        CountT num_lanes,
+                        uint8_t *rgb_out)
+{
+    Vector3 colors[packetWidth];
+    Vector3 normals[packetWidth];
+
+    for (CountT lane = 0; lane < packetWidth; lane++) {
+        if ((hits.hit.bits() & (1_u32 << lane)) == 0) {
+            colors[lane] = Vector3::zero();
+            normals[lane] = Vector3::zero();
+            continue;
+        }
+
+        const InstanceData &instance =
+            world.instances[hits.instanceIdxs[lane]];
+
+        colors[lane] = surfaceColor(cfg, instance,
+            hits.leafMaterialIdxs[lane], hits.texU[lane], hits.texV[lane]);
+
+        // Normals transform with the inverse transpose of rotation * scale
+        normals[lane] = instance.rotation.rotateVec(
+            instance.scale.inv() * hits.objectNormals[lane]).normalize();
+    }
+
+    if (hits.hit.any()) {
+        Vector3N hit_pos = ray.o + ray.d * ray.tMax;
+        FloatN light = lightContribution(cfg, world, hit_pos,
+            Vector3N::loadAoS(normals), hits.hit);
+
+        for (CountT lane = 0; lane < packetWidth; lane++) {
+            colors[lane] *= light[lane];
+        }
+    }
+
+    for (CountT lane = 0; lane < num_lanes; lane++) {
+        Vector3 c = colors[lane];
+        uint8_t *pixel = rgb_out + 4 * lane;
+
+        pixel[0] = (uint8_t)(fminf(fmaxf(c.x, 0.f), 1.f) * 255.f);
+        pixel[1] = (uint8_t)(fminf(fmaxf(c.y, 0.f), 1.f) * 255.f);
+        pixel[2] = (uint8_t)(fminf(fmaxf(c.z, 0.f), 1.f) * 255.f);
+        pixel[3] = 255;
+    }
+}
+
+namespace CPURaycaster {
+
+// Splits idxs in two at the median instance centroid along the widest
+// axis of the centroids' bounds. Returns the size of the first half.
+static CountT splitMedian(const AABB *aabbs, uint32_t *idxs, CountT num)
+{
+    Vector3 centroid_min = Vector3::all(FLT_MAX);
+    Vector3 centroid_max = Vector3::all(-FLT_MAX);
+    for (CountT i = 0; i < num; i++) {
+        const AABB &aabb = aabbs[idxs[i]];
+        Vector3 centroid = (aabb.pMin + aabb.pMax) / 2.f;
+
+        centroid_min = Vector3::min(centroid_min, centroid);
+        centroid_max = Vector3::max(centroid_max, centroid);
+    }
+
+    Vector3 extent = centroid_max - centroid_min;
+    CountT axis = 0;
+    if (extent.y > extent.x && extent.y >= extent.z) {
+        axis = 1;
+    } else if (extent.z > extent.x && extent.z > extent.y) {
+        axis = 2;
+    }
+
+    CountT mid = num / 2;
+    std::nth_element(idxs, idxs + mid, idxs + num,
+        [aabbs, axis](uint32_t a, uint32_t b) {
+            return aabbs[a].pMin[axis] + aabbs[a].pMax[axis] <
+                aabbs[b].pMin[axis] + aabbs[b].pMax[axis];
+        });
+
+    return mid;
+}
+
+// Returns the child index of the node, in the format expected by
+// QBVHNode::construct
+static int32_t buildTLASNode(CPURaycastTLAS &tlas,
+                             uint32_t *idxs,
+                             CountT num,
+                             AABB *out_aabb)
+{
+    uint32_t node_idx = tlas.numNodes++;
+    assert(node_idx < tlas.nodeCapacity);
+
+    const AABB *aabbs = tlas.instanceAABBs;
+
+    // Up to 4 children, from splitting at the median and then splitting
+    // each half again
+    CountT child_offsets[MADRONA_BVH_WIDTH + 1];
+    CountT num_children;
+    if (num <= MADRONA_BVH_WIDTH) {
+        num_children = num;
+        for (CountT i = 0; i <= num; i++) {
+            child_offsets[i] = i;
+        }
+    } else {
+        CountT mid = splitMedian(aabbs, idxs, num);
+
+        num_children = 4;
+        child_offsets[0] = 0;
+        child_offsets[1] = splitMedian(aabbs, idxs, mid);
+        child_offsets[2] = mid;
+        child_offsets[3] = mid + splitMedian(aabbs, idxs + mid, num - mid);
+        child_offsets[4] = num;
+    }
+
+    AABB child_aabbs[MADRONA_BVH_WIDTH];
+    int32_t child_idxs[MADRONA_BVH_WIDTH];
+    for (CountT i = 0; i < num_children; i++) {
+        CountT child_offset = child_offsets[i];
+        CountT child_num = child_offsets[i + 1] - child_offset;
+
+        if (child_num == 1) {
+            uint32_t instance_idx = idxs[child_offset];
+            child_aabbs[i] = aabbs[instance_idx];
+            child_idxs[i] = -((int32_t)instance_idx + 1);
+        } else {
+            child_idxs[i] = buildTLASNode(tlas, idxs + child_offset,
+                                          child_num, &child_aabbs[i]);
+        }
+    }
+
+    AABB node_aabb = child_aabbs[0];
+    for (CountT i = 1; i < num_children; i++) {
+        node_aabb = AABB::merge(node_aabb, child_aabbs[i]);
+    }
+
+    tlas.nodes[node_idx] = QBVHNode::construct(
+        (uint32_t)num_children, child_aabbs, child_idxs);
+
+    *out_aabb = node_aabb;
+    return (int32_t)node_idx + 1;
+}
+
+void buildTLAS(CPURaycastTLAS &tlas,
+               const MeshBVH *bvhs,
+               const InstanceData *instances,
+               CountT num_instances)
+{
+    if ((uint32_t)num_instances > tlas.instanceCapacity) {
+        rawDealloc(tlas.nodes);
+        rawDealloc(tlas.instanceIdxs);
+        rawDealloc(tlas.instanceAABBs);
+
+        uint32_t new_capacity = std::max((uint32_t)num_instances,
+                                         2 * tlas.instanceCapacity);
+
+        // Every node has at least 2 children, except a root with a single
+        // instance
+        tlas.nodeCapacity = new_capacity;
+        tlas.nodes = (QBVHNode *)rawAlloc(sizeof(QBVHNode) * new_capacity);
+        tlas.instanceIdxs =
+            (uint32_t *)rawAlloc(sizeof(uint32_t) * new_capacity);
+        tlas.instanceAABBs = (AABB *)rawAlloc(sizeof(AABB) * new_capacity);
+        tlas.instanceCapacity = new_capacity;
+    }
+
+    CountT num_leaves = 0;
+    for (CountT i = 0; i < num_instances; i++) {
+        const InstanceData &instance = instances[i];
+
+        if (instance.scale.d0 == 0.f && instance.scale.d1 == 0.f &&
+                instance.scale.d2 == 0.f) {
+            continue;
+        }
+
+        AABB aabb = bvhs[instance.objectID].rootAABB.applyTRS(
+            instance.position, instance.rotation, instance.scale);
+
+        // Flat meshes would otherwise give nodes with 0 extent, which
+        // QBVHNode's quantization can't represent
+        float padding = 1e-4f + 1e-6f * std::max(
+            std::max(fabsf(aabb.pMin.x), fabsf(aabb.pMax.x)),
+            std::max(std::max(fabsf(aabb.pMin.y), fabsf(aabb.pMax.y)),
+                     std::max(fabsf(aabb.pMin.z), fabsf(aabb.pMax.z))));
+        aabb.pMin -= Vector3::all(padding);
+        aabb.pMax += Vector3::all(padding);
+
+        tlas.instanceAABBs[i] = aabb;
+        tlas.instanceIdxs[num_leaves++] = (uint32_t)i;
+    }
+
+    tlas.numNodes = 0;
+    if (num_leaves > 0) {
+        AABB root_aabb;
+        buildTLASNode(tlas, tlas.instanceIdxs, num_leaves, &root_aabb);
+    }
+}
+
+void freeTLAS(CPURaycastTLAS &tlas)
+{
+    rawDealloc(tlas.nodes);
+    rawDealloc(tlas.instanceIdxs);
+    rawDealloc(tlas.instanceAABBs);
+
+    tlas = CPURaycastTLAS {};
+}
+
+void renderPixels(const CPURaycastConfig &cfg,
+                  const CPURaycastWorld &world,
+                  const PerspectiveCameraData &view,
+                  uint32_t pixel_offset,
+                  uint32_t num_pixels,
+                  uint8_t *rgb_out,
+                  float *depth_out)
+{
+    const uint32_t res = cfg.renderResolution;
+    const float inv_res = 1.f / (float)res;
+    const bool render_rgb =
+        cfg.renderMode == CPURaycastConfig::RenderMode::RGBD;
+    const float t_max = cfg.farPlane > 0.f ? cfg.farPlane : defaultFarPlane;
+
+    ViewBasis basis = ViewBasis::make(view);
+
+    // Rays for consecutive pixels in a row are close, so packets are just
+    // runs of FloatN::width pixels
+    const uint32_t pixel_end = pixel_offset + num_pixels;
+    for (uint32_t base = pixel_offset; base < pixel_end;
+         base += (uint32_t)packetWidth) {
+        CountT num_lanes =
+            std::min((CountT)(pixel_end - base), packetWidth);
+
+        Vector3 dirs[packetWidth];
+        for (CountT lane = 0; lane < num_lanes; lane++) {
+            uint32_t pixel_idx = base + (uint32_t)lane;
+            dirs[lane] = basis.rayDir(pixel_idx % res, pixel_idx / res,
+                                      inv_res);
+        }
+
+        Vector3N d = Vector3N::loadAoS(dirs, num_lanes);
+
+        RayPacket ray {
+            .o = Vector3N::splat(basis.origin),
+            .d = d,
+            .invD = safeInv(d),
+            .tMin = FloatN::splat(cfg.nearPlane),
+            .tMax = FloatN::splat(t_max),
+            .active = MaskN::firstLanes(num_lanes),
+        };
+
+        PacketHits hits;
+        traceWorld<false>(cfg, world, ray, hits);
+
+        FloatN depth = select(hits.hit, ray.tMax, FloatN::zero());
+        depth.storePartial(depth_out + base, num_lanes);
+
+        if (render_rgb) {
+            shadePacket(cfg, world, ray, hits, num_lanes,
+                        rgb_out + 4 * (CountT)base);
+        }
+    }
+}
+
+}
+
+}
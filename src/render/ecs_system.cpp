@@ -1,4 +1,5 @@
 #ifndef MADRONA_GPU_MODE
+#include <algorithm>
 #include <bit>
 #endif
 
@@ -15,6 +16,7 @@
 #include <madrona/mw_gpu/host_print.hpp>
 #define LOG(...) mwGPU::HostPrint::log(__VA_ARGS__)
 #else
+#include <madrona/render/cpu_raycast.hpp>
 #define LOG(...)
 #endif
 
@@ -46,6 +48,17 @@ struct RenderingSystemState {
     uint32_t numBVHs;
 
     bool enableRaycaster;
+
+#ifndef MADRONA_GPU_MODE
+    // Set by init, the CPU counterpart of the raycast settings in
+    // GPUImplConsts. renderResolution is 0 when raycasting is disabled.
+    CPURaycastConfig raycastConfig;
+
+    // Rebuilt every step by CPURaycastTLASNode when raycasting, freed by
+    // shutdown
+    CPURaycastTLAS raycastTLAS;
+    CPURaycastWorld raycastWorld;
+#endif
 };
 
 static inline uint32_t leftShift3(uint32_t x)
@@ -160,6 +173,81 @@ inline void instanceTransformUpdate(Context &ctx,
 #endif
 }
 
+#ifndef MADRONA_GPU_MODE
+// CPU version of instanceTransformUpdate over a span of rows: reserves the
+// instance slots for the whole span with a single atomic rather than one
+// per row.
+inline void instanceTransformUpdateChunk(Context &ctx,
+                                         CountT num_rows,
+                                         const Entity *entities,
+                                         const Position *positions,
+                                         const Rotation *rotations,
+                                         const Scale *scales,
+                                         const ObjectID *obj_ids,
+                                         const Renderable *renderables)
+{
+    uint32_t num_instances = 0;
+    for (CountT i = 0; i < num_rows; i++) {
+        if (renderables[i].renderEntity != Entity::none()) {
+            num_instances++;
+        }
+    }
+
+    if (num_instances == 0) {
+        return;
+    }
+
+    auto &system_state = ctx.singleton<RenderingSystemState>();
+    const int32_t world_idx = ctx.worldID().idx;
+
+    // The CPU raytracer reads the per world InstanceData rows rather than
+    // the renderer's flat buffer
+    if (system_state.enableRaycaster) {
+        for (CountT i = 0; i < num_rows; i++) {
+            if (renderables[i].renderEntity == Entity::none()) {
+                continue;
+            }
+
+            InstanceData &data =
+                ctx.get<InstanceData>(renderables[i].renderEntity);
+            data.position = positions[i];
+            data.rotation = rotations[i];
+            data.scale = scales[i];
+            data.worldIDX = world_idx;
+            data.objectID = obj_ids[i].idx;
+        }
+    }
+
+    if (system_state.instancesCPU == nullptr) {
+        return;
+    }
+
+    uint32_t instance_id = system_state.totalNumInstancesCPU->
+        fetch_add<sync::acq_rel>(num_instances);
+
+    uint64_t world_id_bits = (uint64_t)world_idx << 32;
+
+    for (CountT i = 0; i < num_rows; i++) {
+        if (renderables[i].renderEntity == Entity::none()) {
+            continue;
+        }
+
+        // Required for stable sorting on CPU
+        system_state.instanceWorldIDsCPU[instance_id] =
+            world_id_bits | (uint64_t)entities[i].id;
+
+        InstanceData &data = system_state.instancesCPU[instance_id];
+        data.position = positions[i];
+        data.rotation = rotations[i];
+        data.scale = scales[i];
+        data.worldIDX = world_idx;
+        data.objectID = obj_ids[i].idx;
+
+        instance_id++;
+    }
+}
+#endif
+
 uint32_t rgbToHex(Vector3 c) {
     float r = c.x;
     float g = c.y;
@@ -231,17 +319,8 @@ inline void instanceTransformUpdateWithMat(Context &ctx,
 
     auto &system_state = ctx.singleton<RenderingSystemState>();
 #else
-    (void)renderable;
-
-    // Just update the instance data that is associated with this entity
-    auto &system_state = ctx.singleton<RenderingSystemState>();
-    uint32_t instance_id = system_state.totalNumInstancesCPU->fetch_add<sync::acq_rel>(1);
-
-    // Required for stable sorting on CPU
-    system_state.instanceWorldIDsCPU[instance_id] = 
-        ((uint64_t)ctx.worldID().idx << 32) | (uint64_t)e.id;
-
-    InstanceData &data = system_state.instancesCPU[instance_id];
+    // Every field is written below, the copies are made at the end
+    InstanceData data;
 #endif
 
     data.position = pos;
@@ -254,6 +333,25 @@ inline void instanceTransformUpdateWithMat(Context &ctx,
     data.worldIDX = ctx.worldID().idx;
     data.objectID = obj_id.idx;
 
+#ifndef MADRONA_GPU_MODE
+    auto &system_state = ctx.singleton<RenderingSystemState>();
+
+    if (system_state.enableRaycaster) {
+        ctx.get<InstanceData>(renderable.renderEntity) = data;
+    }
+
+    if (system_state.instancesCPU != nullptr) {
+        uint32_t instance_id =
+            system_state.totalNumInstancesCPU->fetch_add<sync::acq_rel>(1);
+
+        // Required for stable sorting on CPU
+        system_state.instanceWorldIDsCPU[instance_id] = 
+            ((uint64_t)ctx.worldID().idx << 32) | (uint64_t)e.id;
+
+        system_state.instancesCPU[instance_id] = data;
+    }
+#endif
+
     // Get the root AABB from the model and translate it to store
     // it in the TLBVHNode structure.
 
@@ -293,13 +391,10 @@ inline void viewTransformUpdate(Context &ctx,
 
 #else
     auto &system_state = ctx.singleton<RenderingSystemState>();
-    uint32_t view_id = system_state.totalNumViewsCPU->fetch_add<sync::acq_rel>(1);
-
-    // Required for stable sorting on CPU
-    system_state.viewWorldIDsCPU[view_id] = 
-        ((uint64_t)ctx.worldID().idx << 32) | (uint64_t)e.id;
 
-    PerspectiveCameraData &cam_data = system_state.viewsCPU[view_id];
+    // Every field is written below, the copies are made at the end
+    PerspectiveCameraData cam_data;
+    cam_data.pad = 0;
 #endif
     cam_data.position = camera_pos;
     cam_data.rotation = rot.inv();
@@ -312,9 +407,180 @@ inline void viewTransformUpdate(Context &ctx,
     cam_data.xScale = x_scale;
     cam_data.yScale = y_scale;
     cam_data.zNear = cam.zNear;
+
+    // The CPU raytracer renders from the camera entities
+    if (system_state.enableRaycaster) {
+        ctx.get<PerspectiveCameraData>(cam.cameraEntity) = cam_data;
+    }
+
+    if (system_state.viewsCPU != nullptr) {
+        uint32_t view_id =
+            system_state.totalNumViewsCPU->fetch_add<sync::acq_rel>(1);
+
+        // Required for stable sorting on CPU
+        system_state.viewWorldIDsCPU[view_id] = 
+            ((uint64_t)ctx.worldID().idx << 32) | (uint64_t)e.id;
+
+        system_state.viewsCPU[view_id] = cam_data;
+    }
 #endif
 }
 
+#ifndef MADRONA_GPU_MODE
+// Rebuilds the world's CPURaycastTLAS from the InstanceData rows written
+// by the instance update systems
+class CPURaycastTLASNode : public NodeBase {
+public:
+    CPURaycastTLASNode(Query<InstanceData> &&instances,
+                       Query<LightDesc> &&lights)
+        : instances_(std::move(instances)),
+          lights_(std::move(lights))
+    {}
+
+    void run(Context &ctx, TaskGraph &taskgraph)
+    {
+        auto &system_state = ctx.singleton<RenderingSystemState>();
+        if (!system_state.enableRaycaster) {
+            return;
+        }
+
+        // RenderableArchetype and LightArchetype are the only archetypes
+        // with these components, so there is at most one chunk of each
+        const InstanceData *instances = nullptr;
+        CountT num_instances = 0;
+        taskgraph.iterateQueryChunks(ctx, instances_,
+            [&](Context &, CountT num_rows, InstanceData *rows) {
+                instances = rows;
+                num_instances = num_rows;
+            });
+
+        const LightDesc *lights = nullptr;
+        CountT num_lights = 0;
+        taskgraph.iterateQueryChunks(ctx, lights_,
+            [&](Context &, CountT num_rows, LightDesc *rows) {
+                lights = rows;
+                num_lights = num_rows;
+            });
+
+        CPURaycaster::buildTLAS(system_state.raycastTLAS,
+            system_state.raycastConfig.bvhs, instances, num_instances);
+
+        system_state.raycastWorld = CPURaycastWorld {
+            .tlas = &system_state.raycastTLAS,
+            .instances = instances,
+            .lights = lights,
+            .numLights = (uint32_t)num_lights,
+        };
+    }
+
+    static TaskGraphNodeID addToGraph(
+        StateManager &state_mgr,
+        TaskGraphBuilder &builder,
+        Span<const TaskGraphNodeID> dependencies)
+    {
+        return builder.addDefaultNode<CPURaycastTLASNode>(dependencies,
+            state_mgr.query<InstanceData>(), state_mgr.query<LightDesc>());
+    }
+
+private:
+    Query<InstanceData> instances_;
+    Query<LightDesc> lights_;
+};
+
+// Renders every view of the world into its RaycastOutputArchetype entity.
+// Each pixel is an invocation, so the backend can spread a world's views
+// (or a single large view) across worker threads.
+class CPURaycastNode : public NodeBase {
+public:
+    CPURaycastNode(Query<PerspectiveCameraData, RenderOutputRef> &&views,
+                   Query<RGBOutputBuffer, DepthOutputBuffer> &&outputs)
+        : views_(std::move(views)),
+          outputs_(std::move(outputs))
+    {}
+
+    void run(Context &ctx, TaskGraph &taskgraph)
+    {
+        runRange(ctx, taskgraph, 0, numInvocations(taskgraph));
+    }
+
+    uint32_t numInvocations(TaskGraph &taskgraph)
+    {
+        uint32_t res = taskgraph.singleton<RenderingSystemState>()
+            .raycastConfig.renderResolution;
+        return taskgraph.numMatchingEntities(views_) * res * res;
+    }
+
+    void runRange(Context &ctx, TaskGraph &taskgraph,
+                  uint32_t offset, uint32_t num_invocations)
+    {
+        if (num_invocations == 0) {
+            return;
+        }
+
+        auto &system_state = ctx.singleton<RenderingSystemState>();
+        const CPURaycastConfig &cfg = system_state.raycastConfig;
+        const CPURaycastWorld &world = system_state.raycastWorld;
+
+        const uint32_t pixels_per_view =
+            cfg.renderResolution * cfg.renderResolution;
+        const CountT rgb_bytes =
+            cfg.renderMode == CPURaycastConfig::RenderMode::RGBD ?
+                (CountT)pixels_per_view * 4 : 4;
+        const CountT depth_bytes = (CountT)pixels_per_view * sizeof(float);
+
+        // The outputs are runtime sized, so rows are addressed manually
+        // from the column base rather than through ctx.get
+        uint8_t *rgb_base = nullptr;
+        uint8_t *depth_base = nullptr;
+        taskgraph.iterateQueryChunks(ctx, outputs_,
+            [&](Context &, CountT, RGBOutputBuffer *rgb,
+                DepthOutputBuffer *depth) {
+                rgb_base = (uint8_t *)rgb;
+                depth_base = (uint8_t *)depth;
+            });
+
+        const uint32_t end = offset + num_invocations;
+        const uint32_t first_view = offset / pixels_per_view;
+        const uint32_t last_view = (end - 1) / pixels_per_view;
+
+        uint32_t view_idx = first_view;
+        taskgraph.iterateQueryChunksRange(ctx, views_,
+            first_view, last_view - first_view + 1,
+            [&](Context &ctx, CountT num_rows,
+                PerspectiveCameraData *cams, RenderOutputRef *refs) {
+                for (CountT i = 0; i < num_rows; i++, view_idx++) {
+                    uint32_t view_start = view_idx * pixels_per_view;
+                    uint32_t pixel_offset =
+                        std::max(offset, view_start) - view_start;
+                    uint32_t pixel_end = std::min(end,
+                        view_start + pixels_per_view) - view_start;
+
+                    CountT out_row = ctx.loc(refs[i].outputEntity).row;
+
+                    CPURaycaster::renderPixels(cfg, world, cams[i],
+                        pixel_offset, pixel_end - pixel_offset,
+                        rgb_base + out_row * rgb_bytes,
+                        (float *)(depth_base + out_row * depth_bytes));
+                }
+            });
+    }
+
+    static TaskGraphNodeID addToGraph(
+        StateManager &state_mgr,
+        TaskGraphBuilder &builder,
+        Span<const TaskGraphNodeID> dependencies)
+    {
+        return builder.addDefaultNode<CPURaycastNode>(dependencies,
+            state_mgr.query<PerspectiveCameraData, RenderOutputRef>(),
+            state_mgr.query<RGBOutputBuffer, DepthOutputBuffer>());
+    }
+
+private:
+    Query<PerspectiveCameraData, RenderOutputRef> views_;
+    Query<RGBOutputBuffer, DepthOutputBuffer> outputs_;
+};
+#endif
+
 #ifdef MADRONA_GPU_MODE
 inline void exportCountsGPU(Context &ctx,
                             RenderingSystemState &sys_state)
@@ -381,9 +647,13 @@ inline void exportCountsGPU(Context &ctx,
 #endif
 
 void registerTypes(ECSRegistry &registry,
-                   const RenderECSBridge *bridge)
+                   const RenderECSBridge *bridge,
+                   const CPURaycastConfig *raycast_cfg)
 {
 #ifdef MADRONA_GPU_MODE
+    // The GPU raytracer is configured through GPUImplConsts
+    (void)raycast_cfg;
+
     uint32_t render_output_res = 
         mwGPU::GPUImplConsts::get().raycastOutputResolution;
 
@@ -400,8 +670,20 @@ void registerTypes(ECSRegistry &registry,
         rgb_output_bytes = 4;
     }
 #else
+    uint32_t render_output_res =
+        raycast_cfg ? raycast_cfg->renderResolution : 0;
+
     uint32_t rgb_output_bytes = 4;
     uint32_t depth_output_bytes = 4;
+
+    if (render_output_res != 0) {
+        depth_output_bytes = render_output_res * render_output_res * 4;
+
+        if (raycast_cfg->renderMode ==
+                CPURaycastConfig::RenderMode::RGBD) {
+            rgb_output_bytes = render_output_res * render_output_res * 4;
+        }
+    }
 #endif
 
     registry.registerComponent<RenderCamera>();
@@ -493,6 +775,7 @@ TaskGraphNodeID setupTasks(TaskGraphBuilder &builder,
     // state rather than needing to continually reset the instance count
     // and recreate the buffer. However, this might be hard to handle with
     // double buffering
+#ifdef MADRONA_GPU_MODE
     auto instance_setup = builder.addToGraph<ParallelForNode<Context,
         instanceTransformUpdate,
             Entity,
@@ -502,6 +785,17 @@ TaskGraphNodeID setupTasks(TaskGraphBuilder &builder,
             ObjectID,
             Renderable
         >>(deps);
+#else
+    auto instance_setup = builder.addToGraph<ParallelForChunkNode<Context,
+        instanceTransformUpdateChunk,
+            Entity,
+            Position,
+            Rotation,
+            Scale,
+            ObjectID,
+            Renderable
+        >>(deps);
+#endif
 
     if (update_visual_properties) {
         instance_setup = builder.addToGraph<ParallelForNode<Context,
@@ -599,12 +893,19 @@ TaskGraphNodeID setupTasks(TaskGraphBuilder &builder,
 
     return export_counts;
 #else
-    return viewdata_update;
+    // Both nodes are no-ops unless init got a CPURaycastConfig
+    auto raycast_tlas = builder.addToGraph<CPURaycastTLASNode>(
+        {mortoncode_update});
+
+    auto raycast = builder.addToGraph<CPURaycastNode>({raycast_tlas});
+
+    return raycast;
 #endif
 }
 
 void init(Context &ctx,
-          const RenderECSBridge *bridge)
+          const RenderECSBridge *bridge,
+          const CPURaycastConfig *raycast_cfg)
 {
     auto &system_state = ctx.singleton<RenderingSystemState>();
 
@@ -632,6 +933,31 @@ void init(Context &ctx,
 
         system_state.voxels = bridge->voxels;
     }
+#if !defined(MADRONA_GPU_MODE)
+    else {
+        system_state.totalNumViews = nullptr;
+        system_state.totalNumInstances = nullptr;
+        system_state.totalNumViewsCPU = nullptr;
+        system_state.totalNumInstancesCPU = nullptr;
+        system_state.instancesCPU = nullptr;
+        system_state.viewsCPU = nullptr;
+        system_state.instanceWorldIDsCPU = nullptr;
+        system_state.viewWorldIDsCPU = nullptr;
+        system_state.voxels = nullptr;
+
+        // The raycaster's outputs are always square
+        system_state.aspectRatio = 1.f;
+    }
+
+    system_state.raycastConfig =
+        raycast_cfg ? *raycast_cfg : CPURaycastConfig {};
+    system_state.enableRaycaster =
+        system_state.raycastConfig.renderResolution != 0;
+    system_state.raycastTLAS = CPURaycastTLAS {};
+    system_state.raycastWorld = CPURaycastWorld {};
+#else
+    (void)raycast_cfg;
+#endif
 
 #if 0
     bool raycast_enabled = 
@@ -641,6 +967,18 @@ void init(Context &ctx,
 #endif
 }
 
+void shutdown(Context &ctx)
+{
+#ifndef MADRONA_GPU_MODE
+    auto &system_state = ctx.singleton<RenderingSystemState>();
+
+    CPURaycaster::freeTLAS(system_state.raycastTLAS);
+    system_state.raycastWorld = CPURaycastWorld {};
+#else
+    (void)ctx;
+#endif
+}
+
 void makeEntityRenderable(Context &ctx,
                           Entity e)
 {
@@ -650,6 +988,12 @@ void makeEntityRenderable(Context &ctx,
     // Set default mat / color to not be overriden
     ctx.get<InstanceData>(render_entity).matID = -1;
     ctx.get<InstanceData>(render_entity).color = 0;
+
+#ifndef MADRONA_GPU_MODE
+    // Keeps the CPU raytracer from reading the instance before the first
+    // transform update
+    ctx.get<InstanceData>(render_entity).scale = Diag3x3 { 0, 0, 0 };
+#endif
 }
 
 void disableEntityRenderable(Context &ctx,
@@ -692,7 +1036,7 @@ void attachEntityToView(Context &ctx,
     bool raycast_enabled = 
         mwGPU::GPUImplConsts::get().raycastOutputResolution != 0;
 #else
-    bool raycast_enabled = false;
+    bool raycast_enabled = state.enableRaycaster;
 #endif
 
     if (raycast_enabled) {
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <madrona/physics.hpp>
+
+#include <bit>
+
+using namespace madrona;
+using namespace madrona::math;
+using namespace madrona::phys::broadphase;
+
+// A flat grid of leaves all overlapping the query keeps most of the tree
+// on the traversal stack at once
+TEST(Broadphase, FindIntersectingWideQuery)
+{
+    constexpr int32_t grid_size = 128;
+    constexpr int32_t num_leaves = grid_size * grid_size;
+
+    BVH bvh(nullptr, num_leaves, 0.f, 0.f);
+    for (int32_t i = 0; i < num_leaves; i++) {
+        LeafID leaf = bvh.reserveLeaf(Entity { 0, i }, base::ObjectID { 0 });
+        bvh.updateLeafPosition(leaf,
+            Vector3 { float(i % grid_size), float(i / grid_size), 0 },
+            Quat { 1, 0, 0, 0 }, Diag3x3 { 1, 1, 1 }, Vector3::zero(),
+            AABB { Vector3::all(-0.6f), Vector3::all(0.6f) });
+    }
+    bvh.rebuildOnUpdate();
+    bvh.updateTree();
+
+    int32_t num_found = 0;
+    bvh.findIntersecting(AABB { Vector3::all(-1000), Vector3::all(1000) },
+                         [&](Entity) { num_found++; });
+
+    EXPECT_EQ(num_found, num_leaves);
+}
+
+// Rays parallel to an axis give 0 * inf = NaN slab distances when they
+// start on a box's planes. The SIMD child tests have to resolve those like
+// the scalar AABB::rayIntersects.
+TEST(Broadphase, RayIntersectMaskMatchesAABB)
+{
+    const AABB boxes[4] = {
+        { { 0, 0, 0 }, { 1, 1, 1 } },
+        { { -2, 0, 0 }, { -1, 1, 1 } },
+        { { 0, -1, 0 }, { 2, 0, 1 } },
+        { { 0, 0, 1 }, { 1, 2, 2 } },
+    };
+
+    BVH::Node node;
+    for (int32_t i = 0; i < 4; i++) {
+        node.minX[i] = boxes[i].pMin.x;
+        node.minY[i] = boxes[i].pMin.y;
+        node.minZ[i] = boxes[i].pMin.z;
+        node.maxX[i] = boxes[i].pMax.x;
+        node.maxY[i] = boxes[i].pMax.y;
+        node.maxZ[i] = boxes[i].pMax.z;
+        node.setInternal(i, i + 1);
+    }
+    node.parentID = -1;
+
+    BVH::Node partial = node;
+    partial.clearChild(2);
+
+    const float coords[] = { -3.f, -2.f, -1.f, 0.f, 0.5f, 1.f, 2.f };
+    const float dirs[] = { -1.f, -0.f, 0.f, 0.5f, 1.f };
+    const float t_maxes[] = { INFINITY, 1.5f };
+
+    CountT num_hits = 0;
+    CountT num_tests = 0;
+    for (float ox : coords) for (float oy : coords) for (float oz : coords) {
+        for (float dx : dirs) for (float dy : dirs) for (float dz : dirs) {
+            for (float t_max : t_maxes) {
+                Vector3 o { ox, oy, oz };
+                Diag3x3 inv_d = Diag3x3::fromVec({ dx, dy, dz }).inv();
+
+                uint32_t expected = 0;
+                for (int32_t i = 0; i < 4; i++) {
+                    AABB box = boxes[i];
+                    if (box.rayIntersects(o, inv_d, 0.f, t_max)) {
+                        expected |= 1u << i;
+                    }
+                }
+
+                ASSERT_EQ(node.rayIntersectMask(o, inv_d, 0.f, t_max),
+                          expected)
+                    << "o (" << ox << ", " << oy << ", " << oz << ") d ("
+                    << dx << ", " << dy << ", " << dz << ") t_max "
+                    << t_max;
+                ASSERT_EQ(partial.rayIntersectMask(o, inv_d, 0.f, t_max),
+                          expected & ~4u);
+
+#ifdef MADRONA_BVH_AVX2
+                ASSERT_EQ(BVH::Node::rayIntersectMask2(
+                    node, partial, o, inv_d, 0.f, t_max),
+                    expected | ((expected & ~4u) << 4));
+#endif
+
+                num_hits += std::popcount(expected);
+                num_tests += 4;
+            }
+        }
+    }
+
+    EXPECT_GT(num_hits, 0);
+    EXPECT_LT(num_hits, num_tests);
+}
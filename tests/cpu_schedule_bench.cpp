@@ -0,0 +1,173 @@
+// Compares the WorldMajor and NodeMajor schedules of the CPU backend.
+// Each world runs a chain of systems that all read from a large block of
+// data shared across worlds (standing in for physics / render assets),
+// which is the case NodeMajor is designed for.
+//
+// Usage: cpu_schedule_bench [num_worlds] [entities_per_world] [num_steps]
+
+#include <madrona/mw_cpu.hpp>
+#include <madrona/custom_context.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace madrona;
+
+namespace {
+
+constexpr CountT numSharedValues = 256 * 1024;
+constexpr CountT numSystems = 16;
+
+struct BenchConfig {
+    const float *sharedValues;
+};
+
+struct Value {
+    float v;
+};
+
+struct Index {
+    uint32_t idx;
+};
+
+struct BenchEntity : Archetype<Value, Index> {};
+
+class Engine;
+
+struct BenchWorld : public WorldBase {
+    static void registerTypes(ECSRegistry &registry, const BenchConfig &);
+    static void setupTasks(TaskGraphManager &mgr, const BenchConfig &);
+
+    BenchWorld(Engine &ctx, const BenchConfig &cfg, const int32_t &num_entities);
+
+    const float *sharedValues;
+};
+
+class Engine : public CustomContext<Engine, BenchWorld> {
+public:
+    using CustomContext::CustomContext;
+};
+
+template <int32_t system_idx>
+struct SharedLookupSystem {
+    static void run(Engine &ctx, Value &value, Index &index)
+    {
+        const float *shared = ctx.data().sharedValues;
+
+        uint32_t lookup = (index.idx * (2 * system_idx + 1) + system_idx) %
+            uint32_t(numSharedValues);
+
+        value.v = value.v * 0.5f + shared[lookup];
+        index.idx = index.idx * 1664525u + 1013904223u;
+    }
+};
+
+template <int32_t system_idx>
+TaskGraphNodeID addSystem(TaskGraphBuilder &builder,
+                          Span<const TaskGraphNodeID> dependencies)
+{
+    return builder.addToGraph<ParallelForNode<Engine,
+        SharedLookupSystem<system_idx>::run, Value, Index>>(dependencies);
+}
+
+template <int32_t... system_idxs>
+TaskGraphNodeID addSystems(TaskGraphBuilder &builder,
+                           std::integer_sequence<int32_t, system_idxs...>)
+{
+    TaskGraphNodeID cur_node = addSystem<0>(builder, {});
+    ((cur_node = addSystem<system_idxs + 1>(builder, {cur_node})), ...);
+
+    return cur_node;
+}
+
+void BenchWorld::registerTypes(ECSRegistry &registry, const BenchConfig &)
+{
+    registry.registerComponent<Value>();
+    registry.registerComponent<Index>();
+    registry.registerArchetype<BenchEntity>();
+}
+
+void BenchWorld::setupTasks(TaskGraphManager &mgr, const BenchConfig &)
+{
+    TaskGraphBuilder &builder = mgr.init(0);
+    addSystems(builder,
+               std::make_integer_sequence<int32_t, numSystems - 1>());
+}
+
+BenchWorld::BenchWorld(Engine &ctx, const BenchConfig &cfg,
+                       const int32_t &num_entities)
+    : WorldBase(ctx),
+      sharedValues(cfg.sharedValues)
+{
+    for (int32_t i = 0; i < num_entities; i++) {
+        Entity e = ctx.makeEntity<BenchEntity>();
+        ctx.get<Value>(e).v = 0.f;
+        ctx.get<Index>(e).idx = uint32_t(i) * 2654435761u;
+    }
+}
+
+using BenchExecutor =
+    TaskGraphExecutor<Engine, BenchWorld, BenchConfig, int32_t>;
+
+double benchmarkSchedule(ThreadPoolExecutor::Schedule schedule,
+                         const BenchConfig &bench_cfg,
+                         const HeapArray<int32_t> &world_inits,
+                         CountT num_steps)
+{
+    BenchExecutor exec({
+        .numWorlds = uint32_t(world_inits.size()),
+        .numExportedBuffers = 0,
+        .schedule = schedule,
+    }, bench_cfg, world_inits.data(), 1);
+
+    // Warm up
+    exec.run();
+
+    auto start = std::chrono::steady_clock::now();
+    for (CountT i = 0; i < num_steps; i++) {
+        exec.run();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>(end - start).count() /
+        double(num_steps);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    CountT num_worlds = argc > 1 ? atoi(argv[1]) : 4096;
+    int32_t entities_per_world = argc > 2 ? atoi(argv[2]) : 32;
+    CountT num_steps = argc > 3 ? atoi(argv[3]) : 100;
+
+    HeapArray<float> shared_values(numSharedValues);
+    for (CountT i = 0; i < numSharedValues; i++) {
+        shared_values[i] = float(i % 1024) / 1024.f;
+    }
+
+    BenchConfig bench_cfg {
+        .sharedValues = shared_values.data(),
+    };
+
+    HeapArray<int32_t> world_inits(num_worlds);
+    for (CountT i = 0; i < num_worlds; i++) {
+        world_inits[i] = entities_per_world;
+    }
+
+    double world_major_ms = benchmarkSchedule(
+        ThreadPoolExecutor::Schedule::WorldMajor, bench_cfg, world_inits,
+        num_steps);
+
+    double node_major_ms = benchmarkSchedule(
+        ThreadPoolExecutor::Schedule::NodeMajor, bench_cfg, world_inits,
+        num_steps);
+
+    printf("%ld worlds, %d entities / world, %ld systems\n",
+           (long)num_worlds, entities_per_world, (long)numSystems);
+    printf("WorldMajor: %.3f ms / step\n", world_major_ms);
+    printf("NodeMajor:  %.3f ms / step\n", node_major_ms);
+
+    return 0;
+}
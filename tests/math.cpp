@@ -8,6 +8,11 @@
 #include <gtest/gtest.h>
 
 #include <madrona/math.hpp>
+#include <madrona/simd_math.hpp>
+#include <madrona/rand.hpp>
+
+#include <algorithm>
+#include <cstring>
 
 using namespace madrona;
 using namespace madrona::math;
@@ -50,3 +55,222 @@ TEST(Math, Quaternions)
 TEST(Math, Mat3x4)
 {
 }
+
+namespace {
+
+// Rows don't start on a lane boundary, so the partial load / store paths get
+// exercised along with the full width ones
+constexpr CountT simdTestRows = 3 * FloatN::width + 1;
+
+struct SIMDRows {
+    Vector3 v[simdTestRows];
+    Vector3 u[simdTestRows];
+    Quat q[simdTestRows];
+    Quat r[simdTestRows];
+    AABB aabb[simdTestRows];
+
+    SIMDRows()
+    {
+        RNG rng(5);
+        auto randVec = [&]() {
+            return Vector3 {
+                rng.sampleUniform() * 4.f - 2.f,
+                rng.sampleUniform() * 4.f - 2.f,
+                rng.sampleUniform() * 4.f - 2.f,
+            };
+        };
+
+        auto randQuat = [&]() {
+            return Quat::angleAxis(rng.sampleUniform() * 2.f * math::pi,
+                                   randVec().normalize());
+        };
+
+        for (CountT i = 0; i < simdTestRows; i++) {
+            v[i] = randVec();
+            u[i] = randVec();
+            q[i] = randQuat();
+            r[i] = randQuat();
+
+            Vector3 a = randVec(), b = randVec();
+            aabb[i] = AABB {
+                Vector3::min(a, b),
+                Vector3::max(a, b),
+            };
+        }
+    }
+};
+
+}
+
+static inline void expectVec(Vector3 a, Vector3 b)
+{
+    EXPECT_NEAR(a.x, b.x, 1e-4f);
+    EXPECT_NEAR(a.y, b.y, 1e-4f);
+    EXPECT_NEAR(a.z, b.z, 1e-4f);
+}
+
+TEST(Math, SIMDLoadStore)
+{
+    SIMDRows rows;
+
+    Vector3 v_out[simdTestRows];
+    Quat q_out[simdTestRows];
+    AABB aabb_out[simdTestRows];
+    for (CountT i = 0; i < simdTestRows; i++) {
+        v_out[i] = Vector3 { -1, -1, -1 };
+        q_out[i] = Quat { -1, -1, -1, -1 };
+    }
+
+    for (CountT base = 0; base < simdTestRows; base += FloatN::width) {
+        CountT num_lanes = std::min(FloatN::width, simdTestRows - base);
+
+        Vector3N v = Vector3N::loadAoS(rows.v + base, num_lanes);
+        QuatN q = QuatN::loadAoS(rows.q + base, num_lanes);
+        AABBN aabb = AABBN::loadAoS(rows.aabb + base, num_lanes);
+
+        for (CountT lane = 0; lane < FloatN::width; lane++) {
+            if (lane < num_lanes) {
+                EXPECT_EQ(v.lane(lane).x, rows.v[base + lane].x);
+                EXPECT_EQ(v.lane(lane).z, rows.v[base + lane].z);
+                EXPECT_EQ(q.lane(lane).w, rows.q[base + lane].w);
+                EXPECT_EQ(q.lane(lane).y, rows.q[base + lane].y);
+            } else {
+                EXPECT_EQ(v.x[lane], 0.f);
+            }
+        }
+
+        v.storeAoS(v_out + base, num_lanes);
+        q.storeAoS(q_out + base, num_lanes);
+        aabb.storeAoS(aabb_out + base, num_lanes);
+    }
+
+    EXPECT_EQ(memcmp(v_out, rows.v, sizeof(v_out)), 0);
+    EXPECT_EQ(memcmp(q_out, rows.q, sizeof(q_out)), 0);
+    EXPECT_EQ(memcmp(aabb_out, rows.aabb, sizeof(aabb_out)), 0);
+
+    // Fields of a larger struct
+    struct Body {
+        Vector3 v;
+        Quat q;
+        float pad;
+    };
+
+    Body bodies[simdTestRows];
+    for (CountT i = 0; i < simdTestRows; i++) {
+        bodies[i] = Body { rows.v[i], rows.q[i], 7.f };
+    }
+
+    for (CountT base = 0; base < simdTestRows; base += FloatN::width) {
+        CountT num_lanes = std::min(FloatN::width, simdTestRows - base);
+
+        Vector3N v = Vector3N::loadStrided(&bodies[base].v, sizeof(Body),
+                                           num_lanes);
+        QuatN q = QuatN::loadStrided(&bodies[base].q, sizeof(Body),
+                                     num_lanes);
+
+        for (CountT lane = 0; lane < num_lanes; lane++) {
+            EXPECT_EQ(v.lane(lane).y, rows.v[base + lane].y);
+            EXPECT_EQ(q.lane(lane).z, rows.q[base + lane].z);
+        }
+
+        (-v).storeStrided(&bodies[base].v, sizeof(Body), num_lanes);
+        q.inv().storeStrided(&bodies[base].q, sizeof(Body), num_lanes);
+    }
+
+    for (CountT i = 0; i < simdTestRows; i++) {
+        EXPECT_EQ(bodies[i].v.x, -rows.v[i].x);
+        EXPECT_EQ(bodies[i].q.w, rows.q[i].w);
+        EXPECT_EQ(bodies[i].q.y, -rows.q[i].y);
+        EXPECT_EQ(bodies[i].pad, 7.f);
+    }
+
+    // Partial stores leave the following rows alone
+    Vector3 tail[FloatN::width + 1];
+    for (Vector3 &t : tail) {
+        t = Vector3 { 7, 7, 7 };
+    }
+    Vector3N::splat(Vector3 { 1, 2, 3 }).storeAoS(tail, FloatN::width - 1);
+    if (FloatN::width > 1) {
+        EXPECT_EQ(tail[0].z, 3.f);
+    }
+    EXPECT_EQ(tail[FloatN::width - 1].x, 7.f);
+    EXPECT_EQ(tail[FloatN::width].x, 7.f);
+
+    float floats[FloatN::width + 1];
+    for (float &f : floats) {
+        f = 7.f;
+    }
+    FloatN partial = FloatN::loadPartial(floats, 1, -1.f);
+    EXPECT_EQ(partial[0], 7.f);
+    if (FloatN::width > 1) {
+        EXPECT_EQ(partial[1], -1.f);
+    }
+    FloatN::splat(2.f).storePartial(floats, FloatN::width - 1);
+    EXPECT_EQ(floats[FloatN::width - 1], 7.f);
+}
+
+TEST(Math, SIMDMatchesScalar)
+{
+    SIMDRows rows;
+
+    for (CountT base = 0; base < simdTestRows; base += FloatN::width) {
+        CountT num_lanes = std::min(FloatN::width, simdTestRows - base);
+
+        Vector3N v = Vector3N::loadAoS(rows.v + base, num_lanes);
+        Vector3N u = Vector3N::loadAoS(rows.u + base, num_lanes);
+        QuatN q = QuatN::loadAoS(rows.q + base, num_lanes);
+        QuatN r = QuatN::loadAoS(rows.r + base, num_lanes);
+        AABBN aabb = AABBN::loadAoS(rows.aabb + base, num_lanes);
+
+        FloatN dots = dot(v, u);
+        Vector3N crosses = cross(v, u);
+        Vector3N normalized = v.normalize();
+        Vector3N rotated = q.rotateVec(v);
+        Vector3N inv_rotated = q.inv().rotateVec(rotated);
+        QuatN products = (q * r).normalize();
+        QuatN integrated = (q + QuatN::fromAngularVec(u * 0.01f) * q)
+            .normalize();
+        AABBN txfmed = aabb.applyTRS(u, q, v);
+        MaskN longer = v.length2() > u.length2();
+
+        for (CountT lane = 0; lane < num_lanes; lane++) {
+            SCOPED_TRACE(base + lane);
+
+            Vector3 sv = rows.v[base + lane];
+            Vector3 su = rows.u[base + lane];
+            Quat sq = rows.q[base + lane];
+            Quat sr = rows.r[base + lane];
+            AABB saabb = rows.aabb[base + lane];
+
+            EXPECT_NEAR(dots[lane], dot(sv, su), 1e-4f);
+            expectVec(crosses.lane(lane), cross(sv, su));
+            expectVec(normalized.lane(lane), sv.normalize());
+            expectVec(rotated.lane(lane), sq.rotateVec(sv));
+            expectVec(inv_rotated.lane(lane), sv);
+            expectQuat(products.lane(lane), (sq * sr).normalize());
+            expectQuat(integrated.lane(lane),
+                (sq + Quat::fromAngularVec(su * 0.01f) * sq).normalize());
+
+            AABB expected = saabb.applyTRS(su, sq, Diag3x3::fromVec(sv));
+            expectVec(txfmed.pMin.lane(lane), expected.pMin);
+            expectVec(txfmed.pMax.lane(lane), expected.pMax);
+
+            EXPECT_EQ((longer.bits() >> lane) & 1,
+                      sv.length2() > su.length2() ? 1u : 0u);
+        }
+    }
+
+    MaskN first = MaskN::firstLanes(1);
+    EXPECT_EQ(first.bits(), 1u);
+    EXPECT_TRUE(first.any());
+    EXPECT_EQ(first.all(), FloatN::width == 1);
+    EXPECT_TRUE((first | ~first).all());
+    EXPECT_FALSE((first & ~first).any());
+
+    FloatN picked = select(first, FloatN::splat(1.f), FloatN::splat(2.f));
+    EXPECT_EQ(picked[0], 1.f);
+    EXPECT_EQ(picked[FloatN::width - 1], FloatN::width == 1 ? 1.f : 2.f);
+    EXPECT_EQ(fmadd(FloatN::splat(2.f), FloatN::splat(3.f),
+                    FloatN::splat(1.f))[0], 7.f);
+    EXPECT_EQ(abs(FloatN::splat(-2.f))[0], 2.f);
+}
@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+
+// The SAT helpers are internal to narrowphase.cpp
+#include "../src/physics/narrowphase.cpp"
+
+#include <array>
+#include <map>
+
+using namespace madrona;
+using namespace madrona::math;
+using namespace madrona::geo;
+using namespace madrona::phys::narrowphase;
+
+namespace {
+
+// Box hull already transformed into world space
+struct BoxHull {
+    std::array<Vector3, 8> vertices;
+    std::array<HalfEdge, 24> halfEdges;
+    std::array<uint32_t, 6> faceBaseHalfEdges;
+    std::array<Plane, 6> facePlanes;
+
+    BoxHull(Vector3 pos, Quat rot, Vector3 half_extents)
+    {
+        for (int32_t i = 0; i < 8; i++) {
+            Vector3 corner {
+                (i & 1) ? half_extents.x : -half_extents.x,
+                (i & 2) ? half_extents.y : -half_extents.y,
+                (i & 4) ? half_extents.z : -half_extents.z,
+            };
+            vertices[i] = pos + rot.rotateVec(corner);
+        }
+
+        // Counter clockwise seen from outside
+        const uint32_t faces[6][4] = {
+            { 0, 4, 6, 2 }, // -x
+            { 1, 3, 7, 5 }, // +x
+            { 0, 1, 5, 4 }, // -y
+            { 2, 6, 7, 3 }, // +y
+            { 0, 2, 3, 1 }, // -z
+            { 4, 5, 7, 6 }, // +z
+        };
+
+        // Edge e is half edges 2e and 2e + 1 (HalfEdgeMesh::twinIDX)
+        std::map<std::pair<uint32_t, uint32_t>, uint32_t> edge_ids;
+        for (uint32_t face = 0; face < 6; face++) {
+            uint32_t hedges[4];
+            for (uint32_t i = 0; i < 4; i++) {
+                uint32_t a = faces[face][i];
+                uint32_t b = faces[face][(i + 1) % 4];
+
+                auto key = std::make_pair(std::min(a, b), std::max(a, b));
+                auto iter = edge_ids.find(key);
+                if (iter == edge_ids.end()) {
+                    uint32_t edge_id = (uint32_t)edge_ids.size();
+                    edge_ids.emplace(key, edge_id);
+                    hedges[i] = edge_id * 2;
+                } else {
+                    hedges[i] = iter->second * 2 + 1;
+                }
+
+                halfEdges[hedges[i]].rootVertex = a;
+                halfEdges[hedges[i]].face = face;
+            }
+
+            for (uint32_t i = 0; i < 4; i++) {
+                halfEdges[hedges[i]].next = hedges[(i + 1) % 4];
+            }
+            faceBaseHalfEdges[face] = hedges[0];
+
+            Vector3 v0 = vertices[faces[face][0]];
+            Vector3 n = cross(vertices[faces[face][1]] - v0,
+                              vertices[faces[face][2]] - v0).normalize();
+            facePlanes[face] = Plane { n, dot(n, v0) };
+        }
+    }
+
+    HullState state(Vector3 center)
+    {
+        return HullState {
+            .mesh = HalfEdgeMesh {
+                .halfEdges = halfEdges.data(),
+                .faceBaseHalfEdges = faceBaseHalfEdges.data(),
+                .facePlanes = facePlanes.data(),
+                .vertices = vertices.data(),
+                .numHalfEdges = 24,
+                .numFaces = 6,
+                .numVertices = 8,
+            },
+            .center = center,
+        };
+    }
+};
+
+}
+
+// Boxes sunk deep into each other face to face. The top box is twisted and
+// slightly tilted, so its best edge pair separation is within the face
+// tolerance of the face separation, but the face is still the axis of
+// least penetration. SAT has to keep the face axis and clip a full
+// manifold.
+TEST(Narrowphase, DeepFaceOverlapUsesFaceContact)
+{
+    Vector3 a_pos { 0, 0, 0 };
+    Vector3 b_pos { 0.05f, -0.02f, 0.6f };
+    Quat b_rot = Quat::angleAxis(0.05f, { 1, 0, 0 }) *
+        Quat::angleAxis(0.3f, { 0, 0, 1 });
+
+    BoxHull a(a_pos, Quat { 1, 0, 0, 0 }, { 1, 1, 0.5f });
+    BoxHull b(b_pos, b_rot, { 0.5f, 0.5f, 0.5f });
+
+    HullState a_state = a.state(a_pos);
+    HullState b_state = b.state(b_pos);
+
+    SATResult sat = doSAT(a_state, b_state);
+    ASSERT_EQ(sat.type, ContactType::SATFace);
+    EXPECT_NEAR(std::abs(sat.contact.normal.z), 1.f, 1e-3f);
+
+    uint32_t ref_face_idx = sat.contact.refFaceIdxOrEdgeIdxA & 0x7FFF'FFFF;
+    bool a_is_ref = ref_face_idx == sat.contact.refFaceIdxOrEdgeIdxA;
+    BoxHull &ref = a_is_ref ? a : b;
+    BoxHull &other = a_is_ref ? b : a;
+
+    Vector3 tmp_buf1[64];
+    float tmp_buf2[64];
+    Manifold manifold = createFaceContact(
+        Plane { sat.contact.normal, sat.contact.planeDOrSeparation },
+        int32_t(ref_face_idx),
+        int32_t(sat.contact.incidentFaceIdxOrEdgeIdxB),
+        ref.vertices.data(), other.vertices.data(),
+        ref.halfEdges.data(), other.halfEdges.data(),
+        ref.faceBaseHalfEdges.data(), other.faceBaseHalfEdges.data(),
+        tmp_buf1, tmp_buf2,
+        { 0, 0, 0 }, { 1, 0, 0, 0 });
+
+    EXPECT_EQ(manifold.numContactPoints, 4);
+    for (int32_t i = 0; i < manifold.numContactPoints; i++) {
+        EXPECT_GT(manifold.penetrationDepths[i], 0.35f);
+        EXPECT_LT(manifold.penetrationDepths[i], 0.5f);
+    }
+}
+
+// Same for a box sunk deep into a large triangle: the triangle's front face
+// is the reference face, not an edge pair between the box and triangle.
+TEST(Narrowphase, DeepTriangleOverlapUsesTriangleFace)
+{
+    Vector3 box_pos { 0.05f, -0.02f, 0.05f };
+    Quat box_rot = Quat::angleAxis(0.02f, { 1, 0, 0 }) *
+        Quat::angleAxis(0.3f, { 0, 0, 1 });
+    BoxHull box(box_pos, box_rot, { 0.5f, 0.5f, 0.5f });
+    HullState box_state = box.state(box_pos);
+
+    TriangleHull tri;
+    HullState tri_state = makeTriangleHullState(tri,
+        { -5, -5, 0 }, { 5, -5, 0 }, { 0, 5, 0 }, { 0, 0, 1 });
+
+    SATResult sat = doSATTriangle(box_state, tri_state);
+    ASSERT_EQ(sat.type, ContactType::SATFace);
+    EXPECT_EQ(sat.contact.refFaceIdxOrEdgeIdxA, 1_u32 << 31_u32);
+    EXPECT_EQ(sat.contact.normal.z, 1.f);
+
+    Vector3 tmp_buf1[64];
+    float tmp_buf2[64];
+    Manifold manifold = createFaceContact(
+        Plane { sat.contact.normal, sat.contact.planeDOrSeparation },
+        0, int32_t(sat.contact.incidentFaceIdxOrEdgeIdxB),
+        tri.vertices, box.vertices.data(),
+        tri.halfEdges, box.halfEdges.data(),
+        tri.faceBaseHalfEdges, box.faceBaseHalfEdges.data(),
+        tmp_buf1, tmp_buf2,
+        { 0, 0, 0 }, { 1, 0, 0, 0 });
+
+    EXPECT_EQ(manifold.numContactPoints, 4);
+    for (int32_t i = 0; i < manifold.numContactPoints; i++) {
+        EXPECT_GT(manifold.penetrationDepths[i], 0.4f);
+        EXPECT_LT(manifold.penetrationDepths[i], 0.5f);
+    }
+}
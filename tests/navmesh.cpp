@@ -0,0 +1,314 @@
+#include <gtest/gtest.h>
+
+#include <madrona/navmesh.hpp>
+#include <madrona/navmesh_distances.hpp>
+#include <madrona/memory.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+using namespace madrona;
+using namespace madrona::math;
+
+namespace {
+
+// Square grid of quads, num_quads x num_quads, each quad 1 unit wide and
+// split into two triangles by initFromPolygons. Quads in blocked are left
+// out.
+struct GridNavmesh {
+    Navmesh navmesh;
+    std::vector<float> costs;
+    std::vector<float> estimates;
+    std::vector<Vector3> entryPoints;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> heap;
+    std::vector<uint32_t> heapIndex;
+    std::vector<uint32_t> visitGenerations;
+
+    GridNavmesh(uint32_t num_quads, const std::vector<bool> &blocked)
+    {
+        std::vector<Vector3> verts;
+        for (uint32_t y = 0; y <= num_quads; y++) {
+            for (uint32_t x = 0; x <= num_quads; x++) {
+                verts.push_back(Vector3 { float(x), float(y), 0.f });
+            }
+        }
+
+        std::vector<uint32_t> idxs, offsets, sizes;
+        for (uint32_t y = 0; y < num_quads; y++) {
+            for (uint32_t x = 0; x < num_quads; x++) {
+                if (!blocked.empty() && blocked[y * num_quads + x]) {
+                    continue;
+                }
+
+                uint32_t base = y * (num_quads + 1) + x;
+                offsets.push_back(idxs.size());
+                sizes.push_back(4);
+                idxs.push_back(base);
+                idxs.push_back(base + 1);
+                idxs.push_back(base + num_quads + 2);
+                idxs.push_back(base + num_quads + 1);
+            }
+        }
+
+        navmesh = Navmesh::initFromPolygons(verts.data(), idxs.data(),
+            offsets.data(), sizes.data(), verts.size(), sizes.size());
+
+        costs.resize(navmesh.numTris);
+        estimates.resize(navmesh.numTris);
+        entryPoints.resize(navmesh.numTris);
+        parents.resize(navmesh.numTris);
+        heap.resize(navmesh.numTris);
+        heapIndex.resize(navmesh.numTris);
+        visitGenerations.resize(navmesh.numTris, 0);
+    }
+
+    Navmesh::PathFindState pathState()
+    {
+        return Navmesh::PathFindState {
+            .costs = costs.data(),
+            .estimates = estimates.data(),
+            .entryPoints = entryPoints.data(),
+            .parents = parents.data(),
+            .heap = heap.data(),
+            .heapIndex = heapIndex.data(),
+            .visitGenerations = visitGenerations.data(),
+            .generation = 0,
+        };
+    }
+};
+
+}
+
+TEST(Navmesh, FindPoly)
+{
+    GridNavmesh grid(8, {});
+    Navmesh &navmesh = grid.navmesh;
+
+    for (float y = 0.05f; y < 8.f; y += 0.3f) {
+        for (float x = 0.05f; x < 8.f; x += 0.3f) {
+            uint32_t poly = navmesh.findPoly(Vector3 { x, y, 1.f });
+            ASSERT_NE(poly, Navmesh::sentinel);
+
+            Vector3 a, b, c;
+            navmesh.getTriangleVertices(poly, &a, &b, &c);
+
+            // Inside the triangle's XY bounds
+            EXPECT_GE(x, fminf(fminf(a.x, b.x), c.x));
+            EXPECT_LE(x, fmaxf(fmaxf(a.x, b.x), c.x));
+            EXPECT_GE(y, fminf(fminf(a.y, b.y), c.y));
+            EXPECT_LE(y, fmaxf(fmaxf(a.y, b.y), c.y));
+        }
+    }
+
+    EXPECT_EQ(navmesh.findPoly(Vector3 { -0.5f, 2.f, 0.f }),
+              Navmesh::sentinel);
+    EXPECT_EQ(navmesh.findPoly(Vector3 { 2.f, 8.5f, 0.f }),
+              Navmesh::sentinel);
+}
+
+TEST(Navmesh, PathAroundWall)
+{
+    // Wall along x = 4 covering every row but the top one
+    constexpr uint32_t num_quads = 8;
+    std::vector<bool> blocked(num_quads * num_quads, false);
+    for (uint32_t y = 0; y < num_quads - 1; y++) {
+        blocked[y * num_quads + 4] = true;
+    }
+
+    GridNavmesh grid(num_quads, blocked);
+    Navmesh &navmesh = grid.navmesh;
+    Navmesh::PathFindState path_state = grid.pathState();
+
+    Vector3 start { 1.5f, 0.5f, 0.f };
+    Vector3 goal { 7.5f, 0.5f, 0.f };
+
+    uint32_t start_poly = navmesh.findPoly(start);
+    uint32_t goal_poly = navmesh.findPoly(goal);
+    ASSERT_NE(start_poly, Navmesh::sentinel);
+    ASSERT_NE(goal_poly, Navmesh::sentinel);
+
+    uint32_t corridor[128];
+    Vector3 path[32];
+
+    // Repeated searches reuse the state without clearing it
+    for (int i = 0; i < 3; i++) {
+        CountT num_polys = navmesh.findPolyPath(start_poly, start,
+            goal_poly, goal, path_state, corridor, 128);
+        ASSERT_GT(num_polys, 0);
+        EXPECT_EQ(corridor[0], start_poly);
+        EXPECT_EQ(corridor[num_polys - 1], goal_poly);
+
+        CountT num_points = navmesh.funnelPath(corridor, num_polys,
+            start, goal, path, 32);
+        ASSERT_GE(num_points, 4);
+        EXPECT_EQ(path[0].x, start.x);
+        EXPECT_EQ(path[num_points - 1].x, goal.x);
+
+        // Every segment stays on the navmesh, so the path goes through the
+        // gap at the top of the wall
+        float path_len = 0.f;
+        for (CountT j = 1; j < num_points; j++) {
+            path_len += path[j - 1].distance(path[j]);
+
+            for (float t = 0.f; t <= 1.f; t += 1.f / 64.f) {
+                Vector3 p = path[j - 1] + t * (path[j] - path[j - 1]);
+                EXPECT_NE(navmesh.findPoly(p), Navmesh::sentinel);
+            }
+        }
+
+        // Corridors are found with approximate portal costs, so the path
+        // is only close to the shortest one through the gap corners
+        float shortest_len = start.distance(Vector3 { 4.f, 7.f, 0.f }) +
+            1.f + Vector3 { 5.f, 7.f, 0.f }.distance(goal);
+        EXPECT_GE(path_len, shortest_len - 1e-4f);
+        EXPECT_LE(path_len, shortest_len * 1.05f);
+    }
+
+    // Straight line within the open area
+    Vector3 near_goal { 3.5f, 6.5f, 0.f };
+    CountT num_polys = navmesh.findPolyPath(start_poly, start,
+        navmesh.findPoly(near_goal), near_goal, path_state, corridor, 128);
+    ASSERT_GT(num_polys, 0);
+    EXPECT_EQ(navmesh.funnelPath(corridor, num_polys, start, near_goal,
+                                 path, 32), 2);
+}
+
+TEST(Navmesh, Unreachable)
+{
+    // Full wall along x = 4
+    constexpr uint32_t num_quads = 8;
+    std::vector<bool> blocked(num_quads * num_quads, false);
+    for (uint32_t y = 0; y < num_quads; y++) {
+        blocked[y * num_quads + 4] = true;
+    }
+
+    GridNavmesh grid(num_quads, blocked);
+    Navmesh &navmesh = grid.navmesh;
+    Navmesh::PathFindState path_state = grid.pathState();
+
+    Vector3 start { 1.5f, 0.5f, 0.f };
+    Vector3 goal { 7.5f, 0.5f, 0.f };
+
+    uint32_t corridor[128];
+    EXPECT_EQ(navmesh.findPolyPath(navmesh.findPoly(start), start,
+        navmesh.findPoly(goal), goal, path_state, corridor, 128), 0);
+}
+
+TEST(Navmesh, DistanceTable)
+{
+    // Wall along x = 4 with a gap in the top row, and a second region
+    // right of a full wall at x = 6 that can't be reached
+    constexpr uint32_t num_quads = 8;
+    std::vector<bool> blocked(num_quads * num_quads, false);
+    for (uint32_t y = 0; y < num_quads; y++) {
+        if (y < num_quads - 1) {
+            blocked[y * num_quads + 4] = true;
+        }
+        blocked[y * num_quads + 6] = true;
+    }
+
+    GridNavmesh grid(num_quads, blocked);
+    Navmesh &navmesh = grid.navmesh;
+
+    NavmeshDistanceTable tbl = NavmeshDistanceTableBuilder::build(navmesh, 4);
+    NavmeshDistanceTable serial_tbl =
+        NavmeshDistanceTableBuilder::build(navmesh, 1);
+
+    const uint32_t num_tris = navmesh.numTris;
+    EXPECT_EQ(memcmp(tbl.distances, serial_tbl.distances,
+                     sizeof(uint16_t) * num_tris * num_tris), 0);
+    EXPECT_EQ(memcmp(tbl.nextHops, serial_tbl.nextHops,
+                     num_tris * tbl.nextHopRowBytes()), 0);
+
+    uint32_t start_poly = navmesh.findPoly(Vector3 { 1.5f, 0.5f, 0.f });
+    uint32_t goal_poly = navmesh.findPoly(Vector3 { 5.5f, 0.5f, 0.f });
+    uint32_t cut_off_poly = navmesh.findPoly(Vector3 { 7.5f, 0.5f, 0.f });
+
+    EXPECT_EQ(tbl.distance(start_poly, start_poly), 0.f);
+    EXPECT_EQ(tbl.nextHop(navmesh, start_poly, start_poly),
+              Navmesh::sentinel);
+
+    EXPECT_EQ(tbl.distance(start_poly, cut_off_poly), FLT_MAX);
+    EXPECT_EQ(tbl.nextHop(navmesh, start_poly, cut_off_poly),
+              Navmesh::sentinel);
+
+    // Around the wall, so at least up to the gap and back down
+    float start_dist = tbl.distance(start_poly, goal_poly);
+    EXPECT_GT(start_dist, 12.f);
+    EXPECT_NEAR(start_dist, tbl.distance(goal_poly, start_poly), 1e-2f);
+
+    // Following next hops gets strictly closer and ends at the goal
+    uint32_t cur_poly = start_poly;
+    float cur_dist = start_dist;
+    CountT num_hops = 0;
+    while (cur_poly != goal_poly && num_hops < (CountT)num_tris) {
+        cur_poly = tbl.nextHop(navmesh, cur_poly, goal_poly);
+        ASSERT_NE(cur_poly, Navmesh::sentinel);
+
+        float next_dist = tbl.distance(cur_poly, goal_poly);
+        EXPECT_LT(next_dist, cur_dist);
+        cur_dist = next_dist;
+        num_hops++;
+    }
+
+    EXPECT_EQ(cur_poly, goal_poly);
+
+    NavmeshDistanceTableBuilder::free(tbl);
+    NavmeshDistanceTableBuilder::free(serial_tbl);
+}
+
+TEST(Navmesh, DistanceTableCacheRoundTrip)
+{
+    constexpr uint32_t num_quads = 6;
+    std::vector<bool> blocked(num_quads * num_quads, false);
+    for (uint32_t y = 1; y < num_quads; y++) {
+        blocked[y * num_quads + 3] = true;
+    }
+
+    GridNavmesh grid(num_quads, blocked);
+    Navmesh &navmesh = grid.navmesh;
+
+    std::filesystem::path cache_path =
+        std::filesystem::temp_directory_path() /
+        "madrona_test_navmesh_distances.bin";
+    std::filesystem::remove(cache_path);
+
+    NavmeshDistanceTable tbl = NavmeshDistanceTableBuilder::build(navmesh, 2);
+    uint64_t source_hash = NavmeshDistanceTableBuilder::hashSources(navmesh);
+    ASSERT_TRUE(NavmeshDistanceTableBuilder::writeCache(
+        cache_path.c_str(), source_hash, tbl));
+
+    {
+        NavmeshDistanceTable loaded;
+        Optional<MappedAssetCache> cached =
+            NavmeshDistanceTableBuilder::loadCache(
+                cache_path.c_str(), source_hash, &loaded);
+        ASSERT_TRUE(cached.has_value());
+
+        const uint32_t num_tris = navmesh.numTris;
+        ASSERT_EQ(loaded.numTris, num_tris);
+        EXPECT_EQ(loaded.distanceScale, tbl.distanceScale);
+        EXPECT_EQ(memcmp(loaded.distances, tbl.distances,
+                         sizeof(uint16_t) * num_tris * num_tris), 0);
+        EXPECT_EQ(memcmp(loaded.nextHops, tbl.nextHops,
+                         num_tris * tbl.nextHopRowBytes()), 0);
+
+        for (uint32_t a = 0; a < num_tris; a++) {
+            for (uint32_t b = 0; b < num_tris; b++) {
+                EXPECT_EQ(loaded.distance(a, b), tbl.distance(a, b));
+                EXPECT_EQ(loaded.nextHop(navmesh, a, b),
+                          tbl.nextHop(navmesh, a, b));
+            }
+        }
+    }
+
+    // A different navmesh misses
+    NavmeshDistanceTable missed;
+    EXPECT_FALSE(NavmeshDistanceTableBuilder::loadCache(
+        cache_path.c_str(), source_hash + 1, &missed).has_value());
+
+    NavmeshDistanceTableBuilder::free(tbl);
+    std::filesystem::remove(cache_path);
+}
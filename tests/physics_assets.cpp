@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+
+#include <madrona/physics_loader.hpp>
+#include <madrona/stack_alloc.hpp>
+
+#include <filesystem>
+
+using namespace madrona;
+using namespace madrona::math;
+using namespace madrona::phys;
+
+namespace {
+
+struct TestObjects {
+    Vector3 cubePositions[8];
+    uint32_t cubeIndices[24];
+    uint32_t cubeFaceCounts[6];
+    imp::SourceMesh cube;
+
+    SourceCollisionPrimitive cubePrim;
+    SourceCollisionPrimitive spherePrim;
+    SourceCollisionObject objs[2];
+
+    TestObjects()
+    {
+        for (int32_t i = 0; i < 8; i++) {
+            cubePositions[i] = {
+                (i & 1) ? 1.f : -1.f,
+                (i & 2) ? 1.f : -1.f,
+                (i & 4) ? 1.f : -1.f,
+            };
+        }
+
+        // Counter clockwise seen from outside
+        const uint32_t faces[6][4] = {
+            { 0, 4, 6, 2 }, { 1, 3, 7, 5 },
+            { 0, 1, 5, 4 }, { 2, 6, 7, 3 },
+            { 0, 2, 3, 1 }, { 4, 5, 7, 6 },
+        };
+        for (int32_t i = 0; i < 6; i++) {
+            cubeFaceCounts[i] = 4;
+            for (int32_t j = 0; j < 4; j++) {
+                cubeIndices[i * 4 + j] = faces[i][j];
+            }
+        }
+
+        cube = imp::SourceMesh {
+            .positions = cubePositions,
+            .normals = nullptr,
+            .tangentAndSigns = nullptr,
+            .uvs = nullptr,
+            .indices = cubeIndices,
+            .faceCounts = cubeFaceCounts,
+            .faceMaterials = nullptr,
+            .numVertices = 8,
+            .numFaces = 6,
+            .materialIDX = 0,
+        };
+
+        cubePrim.type = CollisionPrimitive::Type::Hull;
+        cubePrim.hullInput = { 0 };
+
+        spherePrim.type = CollisionPrimitive::Type::Sphere;
+        spherePrim.sphere = { 0.5f };
+
+        objs[0] = SourceCollisionObject {
+            .prims = Span<const SourceCollisionPrimitive>(&cubePrim, 1),
+            .invMass = 0.5f,
+            .friction = { 0.5f, 0.4f },
+        };
+
+        objs[1] = SourceCollisionObject {
+            .prims = Span<const SourceCollisionPrimitive>(&spherePrim, 1),
+            .invMass = 1.f,
+            .friction = { 0.7f, 0.6f },
+        };
+    }
+
+    Span<const imp::SourceMesh> hulls() const
+    {
+        return Span<const imp::SourceMesh>(&cube, 1);
+    }
+
+    Span<const SourceCollisionObject> objects() const
+    {
+        return Span<const SourceCollisionObject>(objs, 2);
+    }
+};
+
+void expectSameObjects(const ObjectManager &a, const ObjectManager &b,
+                       CountT num_objs)
+{
+    for (CountT i = 0; i < num_objs; i++) {
+        EXPECT_EQ(a.metadata[i].mass.invMass, b.metadata[i].mass.invMass);
+        EXPECT_EQ(a.metadata[i].friction.muS, b.metadata[i].friction.muS);
+        EXPECT_EQ(a.rigidBodyAABBs[i].pMax.x, b.rigidBodyAABBs[i].pMax.x);
+        ASSERT_EQ(a.rigidBodyPrimitiveCounts[i],
+                  b.rigidBodyPrimitiveCounts[i]);
+        ASSERT_EQ(a.rigidBodyPrimitiveOffsets[i],
+                  b.rigidBodyPrimitiveOffsets[i]);
+
+        for (uint32_t j = 0; j < a.rigidBodyPrimitiveCounts[i]; j++) {
+            uint32_t prim_idx = a.rigidBodyPrimitiveOffsets[i] + j;
+            const CollisionPrimitive &a_prim = a.collisionPrimitives[prim_idx];
+            const CollisionPrimitive &b_prim = b.collisionPrimitives[prim_idx];
+            ASSERT_EQ(a_prim.type, b_prim.type);
+
+            if (a_prim.type == CollisionPrimitive::Type::Sphere) {
+                EXPECT_EQ(a_prim.sphere.radius, b_prim.sphere.radius);
+                continue;
+            }
+
+            const geo::HalfEdgeMesh &a_mesh = a_prim.hull.halfEdgeMesh;
+            const geo::HalfEdgeMesh &b_mesh = b_prim.hull.halfEdgeMesh;
+            ASSERT_EQ(a_mesh.numHalfEdges, b_mesh.numHalfEdges);
+            ASSERT_EQ(a_mesh.numFaces, b_mesh.numFaces);
+            ASSERT_EQ(a_mesh.numVertices, b_mesh.numVertices);
+
+            for (uint32_t k = 0; k < a_mesh.numFaces; k++) {
+                EXPECT_EQ(a_mesh.facePlanes[k].d, b_mesh.facePlanes[k].d);
+                EXPECT_EQ(a_mesh.faceBaseHalfEdges[k],
+                          b_mesh.faceBaseHalfEdges[k]);
+            }
+
+            for (uint32_t k = 0; k < a_mesh.numHalfEdges; k++) {
+                EXPECT_EQ(a_mesh.halfEdges[k].next, b_mesh.halfEdges[k].next);
+                EXPECT_EQ(a_mesh.halfEdges[k].rootVertex,
+                          b_mesh.halfEdges[k].rootVertex);
+            }
+
+            for (uint32_t k = 0; k < a_mesh.numVertices; k++) {
+                EXPECT_EQ(a_mesh.vertices[k].x, b_mesh.vertices[k].x);
+                EXPECT_EQ(a_mesh.vertices[k].y, b_mesh.vertices[k].y);
+                EXPECT_EQ(a_mesh.vertices[k].z, b_mesh.vertices[k].z);
+            }
+        }
+    }
+}
+
+}
+
+TEST(PhysicsAssets, RigidBodyCacheRoundTrip)
+{
+    TestObjects objs;
+
+    std::filesystem::path cache_path =
+        std::filesystem::temp_directory_path() /
+        "madrona_test_rigid_body_cache.bin";
+    std::filesystem::remove(cache_path);
+
+    uint64_t source_hash = RigidBodyAssets::hashSources(
+        objs.hulls(), objs.objects(), false);
+
+    RigidBodyAssets cached_assets;
+    EXPECT_FALSE(RigidBodyAssets::loadCache(
+        cache_path.c_str(), source_hash, &cached_assets).has_value());
+
+    // Miss: processes the assets and writes the cache
+    PhysicsLoader built_loader(ExecMode::CPU, 4);
+    EXPECT_EQ(built_loader.loadRigidBodies(objs.hulls(), objs.objects(),
+                                           false, cache_path.c_str()), 0);
+
+    {
+        Optional<MappedAssetCache> cached = RigidBodyAssets::loadCache(
+            cache_path.c_str(), source_hash, &cached_assets);
+        ASSERT_TRUE(cached.has_value());
+        EXPECT_EQ(cached_assets.numObjs, 2u);
+        EXPECT_EQ(cached_assets.totalNumPrimitives, 2u);
+        EXPECT_EQ(cached_assets.numConvexHulls, 1u);
+    }
+
+    // Hit: maps the cache and loads from it without rewriting it
+    auto cache_write_time = std::filesystem::last_write_time(cache_path);
+
+    PhysicsLoader cached_loader(ExecMode::CPU, 4);
+    EXPECT_EQ(cached_loader.loadRigidBodies(objs.hulls(), objs.objects(),
+                                            false, cache_path.c_str()), 0);
+    EXPECT_EQ(std::filesystem::last_write_time(cache_path), cache_write_time);
+
+    expectSameObjects(built_loader.getObjectManager(),
+                      cached_loader.getObjectManager(), 2);
+
+    // Any change to the sources misses
+    objs.objs[1].invMass = 2.f;
+    uint64_t changed_hash = RigidBodyAssets::hashSources(
+        objs.hulls(), objs.objects(), false);
+    EXPECT_NE(changed_hash, source_hash);
+    EXPECT_FALSE(RigidBodyAssets::loadCache(
+        cache_path.c_str(), changed_hash, &cached_assets).has_value());
+
+    std::filesystem::remove(cache_path);
+}
+
+TEST(PhysicsAssets, RejectsDynamicTriangleMesh)
+{
+    TestObjects objs;
+
+    SourceCollisionPrimitive tri_prim;
+    tri_prim.type = CollisionPrimitive::Type::TriangleMesh;
+    tri_prim.triMeshInput = { &objs.cube, 1 };
+    objs.objs[1].prims = Span<const SourceCollisionPrimitive>(&tri_prim, 1);
+
+    StackAlloc tmp_alloc;
+    RigidBodyAssets assets;
+    CountT num_bytes;
+    EXPECT_EQ(RigidBodyAssets::processRigidBodyAssets(
+        objs.hulls(), objs.objects(), false, tmp_alloc,
+        &assets, &num_bytes), nullptr);
+}
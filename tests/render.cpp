@@ -0,0 +1,320 @@
+#include <gtest/gtest.h>
+
+#include <madrona/render/cpu_raycast.hpp>
+#include <madrona/rand.hpp>
+
+#include <vector>
+
+using namespace madrona;
+using namespace madrona::math;
+using namespace madrona::render;
+
+namespace {
+
+// Unit cube centered on the origin, wound counter clockwise when seen from
+// outside. mesh_bvh_builder needs embree, so the two level BVH (a root
+// over two nodes with three 2 triangle leaves each) is built by hand.
+struct CubeBVH {
+    std::vector<MeshBVH::BVHVertex> vertices;
+    std::vector<QBVHNode> nodes;
+    std::vector<MeshBVH::LeafMaterial> leafMats;
+    MeshBVH bvh;
+
+    CubeBVH()
+    {
+        auto quad = [this](Vector3 a, Vector3 b, Vector3 c, Vector3 d) {
+            for (Vector3 v : { a, b, c, a, c, d }) {
+                vertices.push_back({ v, Vector2 { v.x + 0.5f, v.y + 0.5f } });
+            }
+        };
+
+        const float h = 0.5f;
+        quad({ -h, -h, h }, { h, -h, h }, { h, h, h }, { -h, h, h });
+        quad({ -h, -h, -h }, { -h, h, -h }, { h, h, -h }, { h, -h, -h });
+        quad({ h, -h, -h }, { h, h, -h }, { h, h, h }, { h, -h, h });
+        quad({ -h, -h, -h }, { -h, -h, h }, { -h, h, h }, { -h, h, -h });
+        quad({ -h, h, -h }, { -h, h, h }, { h, h, h }, { h, h, -h });
+        quad({ -h, -h, -h }, { h, -h, -h }, { h, -h, h }, { -h, -h, h });
+
+        auto leafAABB = [this](int32_t first_tri) {
+            AABB aabb = AABB::invalid();
+            for (int32_t i = 0; i < 6; i++) {
+                aabb.expand(vertices[first_tri * 3 + i].pos);
+            }
+            return aabb;
+        };
+
+        nodes.resize(3);
+        AABB inner_aabbs[2];
+        for (int32_t inner = 0; inner < 2; inner++) {
+            AABB leaf_aabbs[3];
+            int32_t leaf_idxs[3];
+            for (int32_t i = 0; i < 3; i++) {
+                int32_t first_tri = (inner * 3 + i) * 2;
+                leaf_aabbs[i] = leafAABB(first_tri);
+                leaf_idxs[i] = -(first_tri + 1);
+            }
+
+            inner_aabbs[inner] = AABB::merge(AABB::merge(
+                leaf_aabbs[0], leaf_aabbs[1]), leaf_aabbs[2]);
+
+            nodes[inner + 1] = QBVHNode::construct(3, leaf_aabbs, leaf_idxs);
+            for (int32_t i = 0; i < 3; i++) {
+                nodes[inner + 1].triSize[i] = 2;
+            }
+        }
+
+        int32_t inner_idxs[2] = { 2, 3 };
+        nodes[0] = QBVHNode::construct(2, inner_aabbs, inner_idxs);
+
+        leafMats.resize(12, MeshBVH::LeafMaterial { { { -1 } } });
+
+        bvh = MeshBVH {
+            .nodes = nodes.data(),
+            .leafMats = leafMats.data(),
+            .vertices = vertices.data(),
+            .rootAABB = { Vector3::all(-h), Vector3::all(h) },
+            .numNodes = 3,
+            .numLeaves = 6,
+            .numVerts = (uint32_t)vertices.size(),
+            .maxDepth = 2,
+            .materialIDX = -1,
+            .magic = 0,
+        };
+    }
+};
+
+constexpr uint32_t testResolution = 37;
+
+PerspectiveCameraData testView()
+{
+    // Looking down +y at the origin, with a 90 degree vertical fov
+    return PerspectiveCameraData {
+        .position = { 0.3f, -8.f, 0.2f },
+        .rotation = Quat::angleAxis(0.05f, { 0, 0, 1 }).inv(),
+        .xScale = 1.f,
+        .yScale = -1.f,
+        .zNear = 0.f,
+        .worldIDX = 0,
+        .pad = 0,
+    };
+}
+
+std::vector<InstanceData> randomInstances(CountT num_instances)
+{
+    RandKey key = rand::initKey(7);
+
+    std::vector<InstanceData> instances;
+    for (CountT i = 0; i < num_instances; i++) {
+        RandKey inst_key = rand::split_i(key, (uint32_t)i);
+        Vector2 xz = rand::sample2xUniform(rand::split_i(inst_key, 0));
+        Vector2 ys = rand::sample2xUniform(rand::split_i(inst_key, 1));
+        Vector2 rot = rand::sample2xUniform(rand::split_i(inst_key, 2));
+
+        instances.push_back(InstanceData {
+            .position = { 6.f * xz.x - 3.f, 6.f * ys.x - 3.f, 6.f * xz.y - 3.f },
+            .rotation = Quat::angleAxis(rot.x * 2.f * math::pi,
+                Vector3 { rot.y, 1.f - rot.y, 0.5f }.normalize()),
+            .scale = Diag3x3 { 0.5f + ys.y, 0.7f, 1.5f - ys.y },
+            .matID = -1,
+            .objectID = 0,
+            .worldIDX = 0,
+            .color = 0,
+        });
+    }
+
+    return instances;
+}
+
+// One ray per pixel against every instance with MeshBVH::traceRay
+std::vector<float> referenceDepth(const MeshBVH &bvh,
+                                  const std::vector<InstanceData> &instances,
+                                  const PerspectiveCameraData &view)
+{
+    Quat rot = view.rotation.inv();
+    Vector3 forward = rot.rotateVec({ 0, 1, 0 }).normalize();
+    Vector3 u = rot.rotateVec({ 1, 0, 0 });
+    Vector3 v = cross(forward, u).normalize();
+    float h = 1.f / (-view.yScale);
+    Vector3 horizontal = u * 2.f * h;
+    Vector3 vertical = v * 2.f * h;
+    Vector3 lower_left = view.position - horizontal / 2.f -
+        vertical / 2.f + forward;
+
+    std::vector<float> depth(testResolution * testResolution, 0.f);
+    for (uint32_t y = 0; y < testResolution; y++) {
+        for (uint32_t x = 0; x < testResolution; x++) {
+            Vector3 dir = (lower_left +
+                ((float)x + 0.5f) / testResolution * horizontal +
+                ((float)y + 0.5f) / testResolution * vertical -
+                view.position).normalize();
+
+            float closest = FLT_MAX;
+            for (const InstanceData &instance : instances) {
+                if (instance.scale.d0 == 0.f) {
+                    continue;
+                }
+
+                Quat to_local = instance.rotation.inv();
+                Diag3x3 inv_scale = instance.scale.inv();
+                Vector3 o = inv_scale * to_local.rotateVec(
+                    view.position - instance.position);
+                Vector3 d = inv_scale * to_local.rotateVec(dir);
+
+                int32_t stack[MeshBVH::maxTraversalStackSize];
+                int32_t stack_size = 0;
+                MeshBVH::HitInfo hit;
+                if (bvh.traceRay(o, d, &hit, stack, stack_size, closest)) {
+                    closest = hit.tHit;
+                }
+            }
+
+            depth[y * testResolution + x] =
+                closest == FLT_MAX ? 0.f : closest;
+        }
+    }
+
+    return depth;
+}
+
+}
+
+TEST(CPURaycast, DepthMatchesMeshBVH)
+{
+    CubeBVH cube;
+
+    std::vector<InstanceData> instances = randomInstances(9);
+    // Hidden instances are skipped by the TLAS
+    instances[4].scale = Diag3x3 { 0, 0, 0 };
+
+    CPURaycastTLAS tlas {};
+    CPURaycaster::buildTLAS(tlas, &cube.bvh, instances.data(),
+                            (CountT)instances.size());
+    EXPECT_GT(tlas.numNodes, 1u);
+
+    CPURaycastConfig cfg {
+        .renderMode = CPURaycastConfig::RenderMode::Depth,
+        .bvhs = &cube.bvh,
+        .numBVHs = 1,
+        .materials = nullptr,
+        .textures = nullptr,
+        .renderResolution = testResolution,
+    };
+
+    CPURaycastWorld world {
+        .tlas = &tlas,
+        .instances = instances.data(),
+        .lights = nullptr,
+        .numLights = 0,
+    };
+
+    PerspectiveCameraData view = testView();
+    std::vector<float> expected = referenceDepth(cube.bvh, instances, view);
+
+    // Uneven ranges, so packets start mid row and have unused lanes
+    const uint32_t num_pixels = testResolution * testResolution;
+    std::vector<float> depth(num_pixels, -1.f);
+    for (uint32_t offset = 0; offset < num_pixels; offset += 101) {
+        CPURaycaster::renderPixels(cfg, world, view, offset,
+            std::min(101u, num_pixels - offset), nullptr, depth.data());
+    }
+
+    uint32_t num_hits = 0;
+    for (uint32_t i = 0; i < num_pixels; i++) {
+        EXPECT_NEAR(depth[i], expected[i], 1e-3f) << "pixel " << i;
+        num_hits += expected[i] > 0.f ? 1 : 0;
+    }
+
+    EXPECT_GT(num_hits, 0u);
+    EXPECT_LT(num_hits, num_pixels);
+
+    CPURaycaster::freeTLAS(tlas);
+    EXPECT_EQ(tlas.nodes, nullptr);
+    EXPECT_EQ(tlas.instanceCapacity, 0u);
+}
+
+TEST(CPURaycast, RGBUsesMaterialAndLights)
+{
+    CubeBVH cube;
+    cube.bvh.materialIDX = 0;
+
+    Material material {
+        .color = { 1.f, 0.5f, 0.f, 1.f },
+        .textureIdx = -1,
+        .roughness = 0.f,
+        .metalness = 0.f,
+    };
+
+    std::vector<InstanceData> instances = {
+        InstanceData {
+            .position = Vector3::zero(),
+            .rotation = Quat { 1, 0, 0, 0 },
+            .scale = Diag3x3 { 2, 2, 2 },
+            .matID = -1,
+            .objectID = 0,
+            .worldIDX = 0,
+            .color = 0,
+        },
+    };
+
+    CPURaycastTLAS tlas {};
+    CPURaycaster::buildTLAS(tlas, &cube.bvh, instances.data(), 1);
+
+    // Shines straight at the face the camera sees
+    LightDesc light {
+        .type = LightDesc::Directional,
+        .castShadow = true,
+        .position = Vector3::zero(),
+        .direction = { 0, 1, 0 },
+        .cutoff = 0.f,
+        .intensity = 1.f,
+        .active = true,
+    };
+
+    CPURaycastConfig cfg {
+        .renderMode = CPURaycastConfig::RenderMode::RGBD,
+        .bvhs = &cube.bvh,
+        .numBVHs = 1,
+        .materials = &material,
+        .textures = nullptr,
+        .renderResolution = testResolution,
+    };
+
+    CPURaycastWorld world {
+        .tlas = &tlas,
+        .instances = instances.data(),
+        .lights = &light,
+        .numLights = 1,
+    };
+
+    PerspectiveCameraData view = testView();
+    view.rotation = Quat { 1, 0, 0, 0 };
+
+    const uint32_t num_pixels = testResolution * testResolution;
+    std::vector<uint8_t> rgb(num_pixels * 4, 0);
+    std::vector<float> depth(num_pixels, 0.f);
+    CPURaycaster::renderPixels(cfg, world, view, 0, num_pixels,
+                               rgb.data(), depth.data());
+
+    // Center pixel hits the -y face of the cube head on
+    uint32_t center = (testResolution / 2) * testResolution +
+        testResolution / 2;
+    EXPECT_NEAR(depth[center], 7.f, 0.05f);
+    EXPECT_EQ(rgb[center * 4 + 0], 255);
+    EXPECT_EQ(rgb[center * 4 + 1], 127);
+    EXPECT_EQ(rgb[center * 4 + 2], 0);
+    EXPECT_EQ(rgb[center * 4 + 3], 255);
+
+    // Corners miss
+    EXPECT_EQ(depth[0], 0.f);
+    EXPECT_EQ(rgb[0], 0);
+    EXPECT_EQ(rgb[3], 255);
+
+    // Turning the light off leaves the ambient term
+    light.active = false;
+    CPURaycaster::renderPixels(cfg, world, view, 0, num_pixels,
+                               rgb.data(), depth.data());
+    EXPECT_EQ(rgb[center * 4 + 0], (uint8_t)(0.2f * 255.f));
+
+    CPURaycaster::freeTLAS(tlas);
+}
@@ -269,3 +269,103 @@ TEST(State, Reset)
         EXPECT_TRUE(state.get<Component1>(e).valid());
     }
 }
+
+TEST(State, Sort)
+{
+    StateManager state;
+    StateCache cache;
+    ECSRegistry registry(&state, nullptr);
+    registry.registerComponent<Component1>();
+    registry.registerComponent<Component2>();
+    registry.registerComponent<Component3>();
+    registry.registerArchetype<Archetype2>();
+
+    int num_entities = 10'000;
+
+    DynArray<Entity> entities(num_entities);
+    for (int i = 0; i < num_entities; i++) {
+        Entity e = state.makeEntityNow<Archetype2>(cache);
+        entities.push_back(e);
+
+        uint32_t key = (uint32_t)i * 2654435761u;
+        state.get<Component1>(e).value().v = key;
+        state.get<Component2>(e).value().x = (uint32_t)i;
+        state.get<Component3>(e).value().v = key % 256;
+    }
+
+    state.sortArchetype<Archetype2, Component1>();
+
+    uint32_t prev_key = 0;
+    for (int i = 0; i < num_entities; i++) {
+        Loc loc { state.archetypeID<Archetype2>().id, i };
+
+        uint32_t key = state.get<Component1>(loc).value().v;
+        EXPECT_LE(prev_key, key);
+        prev_key = key;
+    }
+
+    for (int i = 0; i < num_entities; i++) {
+        Entity e = entities[i];
+        uint32_t key = (uint32_t)i * 2654435761u;
+
+        EXPECT_EQ(state.get<Component1>(e).value().v, key);
+        EXPECT_EQ(state.get<Component2>(e).value().x, (uint32_t)i);
+        EXPECT_EQ(state.get<Component3>(e).value().v, key % 256);
+    }
+}
+
+TEST(State, QueryRanges)
+{
+    StateManager state;
+    StateCache cache;
+    ECSRegistry registry(&state, nullptr);
+    registry.registerComponent<Component1>();
+    registry.registerComponent<Component2>();
+    registry.registerComponent<Component3>();
+    registry.registerArchetype<Archetype1>();
+    registry.registerArchetype<Archetype2>();
+
+    constexpr int num_first = 37;
+    constexpr int num_second = 100;
+
+    for (int i = 0; i < num_first; i++) {
+        Entity e = state.makeEntityNow<Archetype1>(cache);
+        state.get<Component1>(e).value().v = 1;
+    }
+
+    for (int i = 0; i < num_second; i++) {
+        Entity e = state.makeEntityNow<Archetype2>(cache);
+        state.get<Component1>(e).value().v = 1;
+    }
+
+    auto query = state.query<Component1>();
+    EXPECT_EQ(state.numMatchingEntities(query), num_first + num_second);
+
+    // Split the query at uneven boundaries, every row should be visited
+    // once and each call should stay within one archetype
+    constexpr int split_size = 30;
+    int num_calls = 0;
+    for (int offset = 0; offset < num_first + num_second;
+         offset += split_size) {
+        state.iterateArchetypesRange(query, offset, split_size,
+                [&](CountT num_rows, Component1 *c) {
+            EXPECT_GT(num_rows, 0);
+            EXPECT_LE(num_rows, split_size);
+
+            for (CountT i = 0; i < num_rows; i++) {
+                c[i].v += 1;
+            }
+            num_calls++;
+        });
+    }
+
+    // 5 ranges, one of which straddles the two archetypes
+    EXPECT_EQ(num_calls, 6);
+
+    int num_visited = 0;
+    state.iterateQuery(query, [&](Component1 &c) {
+        EXPECT_EQ(c.v, 2u);
+        num_visited++;
+    });
+    EXPECT_EQ(num_visited, num_first + num_second);
+}
@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+
+#include <madrona/state.hpp>
+#include <madrona/registry.hpp>
+
+#include <vector>
+
+using namespace madrona;
+
+namespace {
+
+struct Value {
+    uint32_t v;
+};
+
+struct Pair {
+    uint64_t a;
+    uint64_t b;
+};
+
+struct Flag {
+    uint8_t v;
+};
+
+struct Blob {
+    uint64_t words[32];
+};
+
+struct ZeroCopyArchetype : Archetype<Value> {};
+struct DynamicArchetype : Archetype<Value, Pair, Flag> {};
+struct BlobArchetype : Archetype<Value, Blob> {};
+
+}
+
+TEST(StateMW, ZeroCopyRowRangesPastInt32)
+{
+    // Enough worlds that world_idx * zeroCopyMaxRowsPerWorld doesn't fit
+    // in an int32_t
+    constexpr CountT num_worlds = 2100;
+    static_assert(num_worlds * StateManager::zeroCopyMaxRowsPerWorld >
+                  (CountT)INT32_MAX);
+
+    StateManager state_mgr(num_worlds);
+    StateCache cache;
+
+    void *export_ptrs[2];
+    ECSRegistry registry(&state_mgr, export_ptrs);
+    registry.registerComponent<Value>();
+    registry.registerArchetype<ZeroCopyArchetype>(
+        ComponentMetadataSelector<> {}, ArchetypeFlags::ZeroCopyExport);
+    registry.exportColumn<ZeroCopyArchetype, Value>(0);
+    registry.exportRowRanges<ZeroCopyArchetype>(1);
+
+    const uint32_t worlds[] = { 0, 2047, 2048, num_worlds - 1 };
+    for (uint32_t world_idx : worlds) {
+        for (uint32_t i = 0; i <= world_idx % 3; i++) {
+            Entity e = state_mgr.makeEntityNow<ZeroCopyArchetype>(
+                world_idx, cache);
+            state_mgr.getUnsafe<Value>(world_idx, e.id).v =
+                world_idx * 10 + i;
+        }
+    }
+
+    state_mgr.prepareCopyOut();
+
+    const Value *values = (const Value *)export_ptrs[0];
+    const ExportedRowRange *ranges = (const ExportedRowRange *)export_ptrs[1];
+
+    for (uint32_t world_idx : worlds) {
+        const ExportedRowRange &range = ranges[world_idx];
+
+        EXPECT_EQ(range.offset,
+                  (int64_t)world_idx * StateManager::zeroCopyMaxRowsPerWorld);
+        ASSERT_EQ(range.numRows, (int32_t)(world_idx % 3 + 1));
+
+        for (int32_t i = 0; i < range.numRows; i++) {
+            EXPECT_EQ(values[range.offset + i].v, world_idx * 10 + i);
+        }
+    }
+
+    EXPECT_EQ(ranges[1].numRows, 0);
+}
+
+TEST(StateMW, DynamicTablesWithManyWorlds)
+{
+    // One mapping per column and world would pass Linux's default
+    // vm.max_map_count of 65530 here
+    constexpr CountT num_worlds = 8192;
+
+    StateManager state_mgr(num_worlds);
+    StateCache cache;
+
+    ECSRegistry registry(&state_mgr, nullptr);
+    registry.registerComponent<Value>();
+    registry.registerComponent<Pair>();
+    registry.registerComponent<Flag>();
+    registry.registerArchetype<DynamicArchetype>();
+
+    auto makeRow = [&](uint32_t world_idx, uint32_t i) {
+        Entity e = state_mgr.makeEntityNow<DynamicArchetype>(
+            world_idx, cache);
+        state_mgr.getUnsafe<Value>(world_idx, e.id).v = world_idx + i;
+        state_mgr.getUnsafe<Pair>(world_idx, e.id) = { world_idx, i };
+        state_mgr.getUnsafe<Flag>(world_idx, e.id).v = uint8_t(i);
+        return e;
+    };
+
+    std::vector<Entity> first_entities;
+    for (uint32_t world_idx = 0; world_idx < num_worlds; world_idx++) {
+        first_entities.push_back(makeRow(world_idx, 0));
+    }
+
+    // Grow a couple of worlds across many commits, next to worlds that
+    // stay small
+    constexpr uint32_t num_big_rows = 100'000;
+    const uint32_t big_worlds[] = { 1, 4000 };
+    for (uint32_t world_idx : big_worlds) {
+        for (uint32_t i = 1; i < num_big_rows; i++) {
+            makeRow(world_idx, i);
+        }
+    }
+
+    for (uint32_t world_idx = 0; world_idx < num_worlds; world_idx++) {
+        Entity e = first_entities[world_idx];
+        EXPECT_EQ(state_mgr.getUnsafe<Value>(world_idx, e.id).v, world_idx);
+        EXPECT_EQ(state_mgr.getUnsafe<Pair>(world_idx, e.id).a, world_idx);
+    }
+
+    Query<Value, Pair, Flag> query = state_mgr.query<Value, Pair, Flag>();
+    for (uint32_t world_idx : { 0u, 1u, 2u, 4000u }) {
+        bool big = world_idx == 1 || world_idx == 4000;
+
+        uint32_t num_rows = 0;
+        state_mgr.iterateQuery(world_idx, query,
+                [&](Value &value, Pair &pair, Flag &flag) {
+            EXPECT_EQ(pair.a, world_idx);
+            EXPECT_EQ(value.v, world_idx + pair.b);
+            EXPECT_EQ(flag.v, uint8_t(pair.b));
+            num_rows++;
+        });
+
+        EXPECT_EQ(num_rows, big ? num_big_rows : 1u);
+    }
+}
+
+TEST(StateMW, DynamicTableGrowsPastWorldReservation)
+{
+    // With this many worlds each table's slot in the shared column regions
+    // holds well under 100K rows of BlobArchetype
+    constexpr CountT num_worlds = 8192;
+
+    StateManager state_mgr(num_worlds);
+    StateCache cache;
+
+    ECSRegistry registry(&state_mgr, nullptr);
+    registry.registerComponent<Value>();
+    registry.registerComponent<Blob>();
+    registry.registerArchetype<BlobArchetype>();
+
+    auto makeRow = [&](uint32_t world_idx, uint32_t i) {
+        Entity e = state_mgr.makeEntityNow<BlobArchetype>(world_idx, cache);
+        state_mgr.getUnsafe<Value>(world_idx, e.id).v = i;
+        state_mgr.getUnsafe<Blob>(world_idx, e.id).words[31] =
+            uint64_t(world_idx) << 32 | i;
+        return e;
+    };
+
+    Entity neighbor = makeRow(2, 7);
+
+    constexpr uint32_t num_big_rows = 300'000;
+    std::vector<Entity> entities;
+    for (uint32_t i = 0; i < num_big_rows; i++) {
+        entities.push_back(makeRow(1, i));
+    }
+
+    for (uint32_t i = 0; i < num_big_rows; i += 997) {
+        EXPECT_EQ(state_mgr.getUnsafe<Value>(1, entities[i].id).v, i);
+    }
+
+    // Removing rows after the move still backfills from the end
+    for (uint32_t i = 0; i < num_big_rows / 2; i++) {
+        state_mgr.destroyEntityNow(1, cache, entities[i]);
+    }
+
+    Query<Value, Blob> query = state_mgr.query<Value, Blob>();
+    uint32_t num_rows = 0;
+    state_mgr.iterateQuery(1, query, [&](Value &value, Blob &blob) {
+        EXPECT_GE(value.v, num_big_rows / 2);
+        EXPECT_EQ(blob.words[31], uint64_t(1) << 32 | value.v);
+        num_rows++;
+    });
+    EXPECT_EQ(num_rows, num_big_rows / 2);
+
+    EXPECT_EQ(state_mgr.getUnsafe<Value>(2, neighbor.id).v, 7u);
+    EXPECT_EQ(state_mgr.getUnsafe<Blob>(2, neighbor.id).words[31],
+              uint64_t(2) << 32 | 7);
+}